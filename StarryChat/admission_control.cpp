@@ -0,0 +1,160 @@
+#include "admission_control.h"
+
+#include <algorithm>
+#include <cmath>
+#include "rpc_errors.h"
+
+namespace StarryChat {
+
+namespace {
+
+int64_t nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::chrono::microseconds targetLatencyFor(RpcPriority priority) {
+  const auto& options = AdmissionController::getInstance().options();
+  int millis = priority == RpcPriority::kBulk ? options.bulkTargetLatencyMs
+                                              : options.targetLatencyMs;
+  return std::chrono::milliseconds(millis);
+}
+
+// 占用一个名额，当前在途数达到 capacity 时失败
+bool acquireBelow(std::atomic<int>& inflight, int capacity) {
+  int current = inflight.load(std::memory_order_relaxed);
+  do {
+    if (current >= capacity) {
+      return false;
+    }
+  } while (!inflight.compare_exchange_weak(current, current + 1,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_relaxed));
+  return true;
+}
+
+}  // namespace
+
+// AdaptiveLimiter 实现
+
+AdaptiveLimiter::AdaptiveLimiter(double initialLimit,
+                                 double minLimit,
+                                 double maxLimit,
+                                 std::chrono::microseconds targetLatency)
+    : minLimit_(minLimit),
+      maxLimit_(maxLimit),
+      targetLatency_(targetLatency),
+      limit_(std::clamp(initialLimit, minLimit, maxLimit)) {}
+
+bool AdaptiveLimiter::tryAcquire() {
+  return acquireBelow(inflight_, static_cast<int>(limit()));
+}
+
+void AdaptiveLimiter::release(std::chrono::microseconds latency) {
+  int inflight = inflight_.fetch_sub(1, std::memory_order_acq_rel);
+  double current = limit();
+
+  if (latency > targetLatency_) {
+    int64_t now = nowMicros();
+    int64_t last = lastDecrease_.load(std::memory_order_relaxed);
+    if (now - last >= targetLatency_.count() &&
+        lastDecrease_.compare_exchange_strong(last, now,
+                                              std::memory_order_relaxed)) {
+      limit_.store(std::max(minLimit_, current * kBackoff),
+                   std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  // 只有并发确实用到上限附近时才放宽，空闲时上限不会无限增长
+  if (inflight * 2 >= current) {
+    limit_.store(std::min(maxLimit_, current + 1.0 / current),
+                 std::memory_order_relaxed);
+  }
+}
+
+// AdmissionController 实现
+
+AdmissionController& AdmissionController::getInstance() {
+  static AdmissionController instance;
+  return instance;
+}
+
+void AdmissionController::configure(const AdmissionOptions& options) {
+  options_ = options;
+}
+
+int AdmissionController::capacityFor(RpcPriority priority) const {
+  double share = 1.0;
+  if (priority == RpcPriority::kNormal) {
+    share = options_.normalShare;
+  } else if (priority == RpcPriority::kBulk) {
+    share = options_.bulkShare;
+  }
+  return std::max(1,
+                  static_cast<int>(std::floor(options_.maxInflight * share)));
+}
+
+bool AdmissionController::tryAcquire(RpcPriority priority) {
+  return acquireBelow(inflight_, capacityFor(priority));
+}
+
+void AdmissionController::release() {
+  inflight_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+// RpcAdmission 实现
+
+RpcAdmission::RpcAdmission(const std::string& service,
+                           const std::string& method,
+                           RpcPriority priority)
+    : priority_(priority),
+      limiter_(AdmissionController::getInstance().options().maxInflight,
+               1,
+               AdmissionController::getInstance().options().maxInflight,
+               targetLatencyFor(priority)),
+      rejected_(MetricsRegistry::getInstance().counter(
+          "starrychat_rpc_rejected_total",
+          "RPC calls rejected by admission control",
+          {{"service", service}, {"method", method}})),
+      limit_(MetricsRegistry::getInstance().gauge(
+          "starrychat_rpc_concurrency_limit",
+          "Adaptive concurrency limit per RPC method",
+          {{"service", service}, {"method", method}})) {
+  limit_.set(static_cast<int64_t>(limiter_.limit()));
+}
+
+starry::RpcDoneCallback RpcAdmission::admit(
+    const google::protobuf::Message& prototype,
+    const starry::RpcDoneCallback& done) {
+  auto& controller = AdmissionController::getInstance();
+  if (!controller.enabled()) {
+    return done;
+  }
+
+  if (!controller.tryAcquire(priority_)) {
+    rejected_.inc();
+    replyError(prototype, done, starrychat::ERROR_CODE_OVERLOADED,
+               "Server overloaded, please retry later");
+    return nullptr;
+  }
+  if (!limiter_.tryAcquire()) {
+    controller.release();
+    rejected_.inc();
+    replyError(prototype, done, starrychat::ERROR_CODE_OVERLOADED,
+               "Server overloaded, please retry later");
+    return nullptr;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  return [this, done, start](google::protobuf::Message* response) {
+    limiter_.release(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start));
+    limit_.set(static_cast<int64_t>(limiter_.limit()));
+    AdmissionController::getInstance().release();
+    done(response);
+  };
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <google/protobuf/message.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "metrics.h"
+#include "service.h"
+
+namespace StarryChat {
+
+/**
+ * RPC 优先级
+ * 全局并发上限按优先级划分可用份额：批量查询最先被拒绝，
+ * 登录和心跳等关键请求可以使用全部并发。
+ */
+enum class RpcPriority {
+  kCritical,  // Login、UpdateHeartbeat、Logout
+  kNormal,
+  kBulk,  // GetMessages 历史翻页等开销大的读
+};
+
+struct AdmissionOptions {
+  bool enabled{false};
+  int maxInflight{16};         // 全局并发上限
+  double normalShare{0.75};    // 普通请求可用的并发份额
+  double bulkShare{0.5};       // 批量请求可用的并发份额
+  int targetLatencyMs{50};     // 关键/普通请求的目标延迟
+  int bulkTargetLatencyMs{200};  // 批量请求的目标延迟
+};
+
+/**
+ * 自适应并发限制（AIMD）
+ * 请求在目标延迟内完成且并发接近上限时，上限每轮约加 1；
+ * 超过目标延迟时上限乘以 kBackoff，同一个目标延迟周期内最多减一次，
+ * 避免一批同时变慢的请求把上限直接压到最小值。
+ * 上限的读写不加锁，并发更新时偶尔丢失一次增量可以接受。
+ */
+class AdaptiveLimiter {
+ public:
+  static constexpr double kBackoff = 0.9;
+
+  AdaptiveLimiter(double initialLimit,
+                  double minLimit,
+                  double maxLimit,
+                  std::chrono::microseconds targetLatency);
+
+  bool tryAcquire();
+  void release(std::chrono::microseconds latency);
+
+  double limit() const { return limit_.load(std::memory_order_relaxed); }
+  int inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+ private:
+  const double minLimit_;
+  const double maxLimit_;
+  const std::chrono::microseconds targetLatency_;
+
+  std::atomic<double> limit_;
+  std::atomic<int> inflight_{0};
+  std::atomic<int64_t> lastDecrease_{0};  // steady_clock 微秒
+};
+
+/**
+ * 全局准入控制
+ * 维护全进程的在途请求数，并持有各方法限流器共用的配置。
+ * 处理器在 IO 线程上同步执行，在途数不会超过线程数；
+ * 限制的意义在于不让慢请求占满全部 IO 线程。
+ */
+class AdmissionController {
+ public:
+  static AdmissionController& getInstance();
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+  AdmissionController(AdmissionController&&) = delete;
+  AdmissionController& operator=(AdmissionController&&) = delete;
+
+  /**
+   * 设置准入参数，应在启动服务之前调用
+   */
+  void configure(const AdmissionOptions& options);
+
+  const AdmissionOptions& options() const { return options_; }
+  bool enabled() const { return options_.enabled; }
+
+  /**
+   * 按优先级份额占用一个全局并发名额
+   */
+  bool tryAcquire(RpcPriority priority);
+  void release();
+
+ private:
+  AdmissionController() = default;
+  ~AdmissionController() = default;
+
+  int capacityFor(RpcPriority priority) const;
+
+  AdmissionOptions options_;
+  std::atomic<int> inflight_{0};
+};
+
+/**
+ * 单个 RPC 方法的准入控制
+ * 每个服务方法持有一个静态实例，在处理请求前调用 admit：
+ * 全局份额或本方法的自适应上限已满时，立即以 ERROR_CODE_OVERLOADED
+ * 应答并返回空回调；否则返回包装后的回调，应答时归还名额并反馈延迟。
+ */
+class RpcAdmission {
+ public:
+  RpcAdmission(const std::string& service,
+               const std::string& method,
+               RpcPriority priority);
+
+  starry::RpcDoneCallback admit(const google::protobuf::Message& prototype,
+                                const starry::RpcDoneCallback& done);
+
+ private:
+  RpcPriority priority_;
+  AdaptiveLimiter limiter_;
+  Counter& rejected_;
+  Gauge& limit_;
+};
+
+}  // namespace StarryChat
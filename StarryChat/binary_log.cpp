@@ -0,0 +1,83 @@
+#include "binary_log.h"
+
+#include <chrono>
+#include "async_logging.h"
+
+namespace StarryChat {
+
+BinaryLog& BinaryLog::getInstance() {
+  static BinaryLog instance;
+  return instance;
+}
+
+BinaryLog::~BinaryLog() = default;
+
+void BinaryLog::start(const std::string& basename,
+                      int64_t rollSize,
+                      int flushInterval) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (output_) {
+    return;
+  }
+
+  output_ = std::make_unique<starry::AsyncLogging>(basename, rollSize,
+                                                   flushInterval);
+  output_->start();
+
+  // 先写出已注册的格式定义，保证事件记录之前可解码
+  for (size_t i = 0; i < formats_.size(); ++i) {
+    std::string record = encodeFormat(static_cast<uint32_t>(i), formats_[i]);
+    output_->append(record.data(), static_cast<int>(record.size()));
+  }
+
+  enabled_.store(true, std::memory_order_release);
+}
+
+void BinaryLog::stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (enabled_.exchange(false, std::memory_order_acq_rel)) {
+    // 保留 output_ 对象，避免与并发的 write 产生悬垂指针
+    output_->stop();
+  }
+}
+
+uint32_t BinaryLog::registerFormat(const char* file,
+                                   int line,
+                                   const char* fmt) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t formatId = static_cast<uint32_t>(formats_.size());
+  formats_.push_back(Format{file, line, fmt});
+
+  if (output_) {
+    std::string record = encodeFormat(formatId, formats_.back());
+    output_->append(record.data(), static_cast<int>(record.size()));
+  }
+  return formatId;
+}
+
+int64_t BinaryLog::nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string BinaryLog::encodeFormat(uint32_t formatId, const Format& format) {
+  std::string record;
+  put<uint8_t>(record, binlog::kFormatRecord);
+  put<uint32_t>(record, formatId);
+  put<uint32_t>(record, static_cast<uint32_t>(format.line));
+  put<uint16_t>(record, static_cast<uint16_t>(format.file.size()));
+  record += format.file;
+  put<uint16_t>(record, static_cast<uint16_t>(format.fmt.size()));
+  record += format.fmt;
+  return record;
+}
+
+void BinaryLog::append(const std::string& record) {
+  // AsyncLogging::append 内部加锁，单条记录整体写入
+  if (isEnabled()) {
+    output_->append(record.data(), static_cast<int>(record.size()));
+  }
+}
+
+}  // namespace StarryChat
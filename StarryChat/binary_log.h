@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "binary_log_format.h"
+#include "logging.h"
+
+namespace starry {
+class AsyncLogging;
+}
+
+namespace StarryChat {
+
+/**
+ * 二进制日志
+ * 热路径只序列化格式串ID和原始参数，写入独立的 AsyncLogging 文件，
+ * 省去格式化开销并显著减小日志体积。格式定义随日志写出，
+ * 离线解码工具 starrychat_logdecode 据此还原文本。
+ */
+class BinaryLog {
+ public:
+  static BinaryLog& getInstance();
+
+  BinaryLog(const BinaryLog&) = delete;
+  BinaryLog& operator=(const BinaryLog&) = delete;
+  BinaryLog(BinaryLog&&) = delete;
+  BinaryLog& operator=(BinaryLog&&) = delete;
+
+  /**
+   * 启用二进制日志，之前已注册的格式定义会先写出
+   * 停止后不能再次启动
+   */
+  void start(const std::string& basename, int64_t rollSize, int flushInterval);
+  void stop();
+
+  bool isEnabled() const { return enabled_.load(std::memory_order_acquire); }
+
+  /**
+   * 注册格式串，返回格式串ID
+   * 通常在调用点以静态变量缓存，每个调用点只注册一次
+   */
+  uint32_t registerFormat(const char* file, int line, const char* fmt);
+
+  template <typename... Args>
+  void write(uint32_t formatId, starry::LogLevel level, const Args&... args) {
+    std::string record;
+    record.reserve(32);
+    put<uint8_t>(record, binlog::kEventRecord);
+    put<uint32_t>(record, formatId);
+    put<int64_t>(record, nowMicros());
+    put<uint8_t>(record, static_cast<uint8_t>(level));
+    put<uint8_t>(record, static_cast<uint8_t>(sizeof...(Args)));
+    (putArg(record, args), ...);
+    append(record);
+  }
+
+ private:
+  BinaryLog() = default;
+  ~BinaryLog();
+
+  struct Format {
+    std::string file;
+    int line;
+    std::string fmt;
+  };
+
+  template <typename T>
+  static void put(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+  }
+
+  static void putString(std::string& out, std::string_view value) {
+    put<uint8_t>(out, binlog::kArgString);
+    put<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out.append(value.data(), value.size());
+  }
+
+  template <typename T>
+  static void putArg(std::string& out, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+      put<uint8_t>(out, binlog::kArgBool);
+      put<uint8_t>(out, value ? 1 : 0);
+    } else if constexpr (std::is_enum_v<T>) {
+      put<uint8_t>(out, binlog::kArgInt);
+      put<int64_t>(out, static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      put<uint8_t>(out, binlog::kArgInt);
+      put<int64_t>(out, value);
+    } else if constexpr (std::is_integral_v<T>) {
+      put<uint8_t>(out, binlog::kArgUInt);
+      put<uint64_t>(out, value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+      put<uint8_t>(out, binlog::kArgDouble);
+      put<double>(out, value);
+    } else {
+      putString(out, std::string_view(value));
+    }
+  }
+
+  static int64_t nowMicros();
+  static std::string encodeFormat(uint32_t formatId, const Format& format);
+
+  void append(const std::string& record);
+
+  std::atomic<bool> enabled_{false};
+  std::unique_ptr<starry::AsyncLogging> output_;
+
+  std::mutex mutex_;
+  std::vector<Format> formats_;
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace StarryChat {
+
+/**
+ * 二进制日志记录格式（主机字节序，小端）
+ *
+ * 格式定义记录，每个格式串首次使用时写入一次：
+ *   u8 'F' | u32 formatId | u32 line | u16 fileLen | file | u16 fmtLen | fmt
+ *
+ * 事件记录：
+ *   u8 'E' | u32 formatId | i64 unixMicros | u8 level | u8 argc | args...
+ *
+ * 参数以类型标签开头：
+ *   'i' i64 | 'u' u64 | 'd' double | 'b' u8 | 's' u32 len + bytes
+ */
+namespace binlog {
+
+constexpr uint8_t kFormatRecord = 'F';
+constexpr uint8_t kEventRecord = 'E';
+
+constexpr uint8_t kArgInt = 'i';
+constexpr uint8_t kArgUInt = 'u';
+constexpr uint8_t kArgDouble = 'd';
+constexpr uint8_t kArgBool = 'b';
+constexpr uint8_t kArgString = 's';
+
+}  // namespace binlog
+
+}  // namespace StarryChat
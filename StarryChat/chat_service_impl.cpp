@@ -2,14 +2,27 @@
 
 #include <algorithm>
 #include <chrono>
+#include <google/protobuf/arena.h>
 #include <mariadb/conncpp.hpp>
+#include "admission_control.h"
 #include "chat_room.h"
+#include "circuit_breaker.h"
 #include "db_manager.h"
+#include "deadline.h"
+#include "log_control.h"
 #include "logging.h"
+#include "metrics.h"
+#include "redis_keys.h"
 #include "redis_manager.h"
 
 namespace StarryChat {
 
+namespace {
+
+constexpr LogModule kLogModule = LogModule::kChat;
+
+}  // namespace
+
 std::shared_ptr<sql::Connection> ChatServiceImpl::getConnection() {
   return DBManager::getInstance().getConnection();
 }
@@ -18,7 +31,16 @@ std::shared_ptr<sql::Connection> ChatServiceImpl::getConnection() {
 void ChatServiceImpl::CreateChatRoom(
     const starrychat::CreateChatRoomRequestPtr& request,
     const starrychat::CreateChatRoomResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "CreateChatRoom");
+  static RpcAdmission admission("ChatService", "CreateChatRoom",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -45,11 +67,10 @@ void ChatServiceImpl::CreateChatRoom(
 
         // 获取创建的聊天室信息
         auto conn = getConnection();
-        std::unique_ptr<sql::PreparedStatement> stmt(
-            conn->prepareStatement("SELECT * FROM chat_rooms WHERE id = ?"));
+        TimedStatement stmt(conn, "SELECT * FROM chat_rooms WHERE id = ?");
         stmt->setUInt64(1, chatRoomId);
 
-        std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+        std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
         if (rs->next()) {
           ChatRoom chatRoom;
           chatRoom.setId(rs->getUInt64("id"));
@@ -79,9 +100,14 @@ void ChatServiceImpl::CreateChatRoom(
       response->set_error_message("Failed to create chat room");
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "CreateChatRoom SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "CreateChatRoom error: " << e.what();
     response->set_success(false);
@@ -95,7 +121,16 @@ void ChatServiceImpl::CreateChatRoom(
 void ChatServiceImpl::GetChatRoom(
     const starrychat::GetChatRoomRequestPtr& request,
     const starrychat::GetChatRoomResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "GetChatRoom");
+  static RpcAdmission admission("ChatService", "GetChatRoom",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -127,14 +162,16 @@ void ChatServiceImpl::GetChatRoom(
       members = getChatRoomMembersFromCache(request->chat_room_id());
       if (!members.empty()) {
         cacheMiss = false;
-        LOG_INFO << "Chat room and members cache hit for ID: "
-                 << request->chat_room_id();
+        MLOG_DEBUG(kLogModule) << "Chat room and members cache hit for ID: "
+                               << request->chat_room_id();
       } else {
-        LOG_INFO << "Chat room cache hit but members cache miss for ID: "
-                 << request->chat_room_id();
+        MLOG_DEBUG(kLogModule)
+            << "Chat room cache hit but members cache miss for ID: "
+            << request->chat_room_id();
       }
     } else {
-      LOG_INFO << "Chat room cache miss for ID: " << request->chat_room_id();
+      MLOG_DEBUG(kLogModule) << "Chat room cache miss for ID: "
+                             << request->chat_room_id();
     }
 
     if (cacheMiss) {
@@ -142,11 +179,10 @@ void ChatServiceImpl::GetChatRoom(
       auto conn = getConnection();
 
       // 获取聊天室信息
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("SELECT * FROM chat_rooms WHERE id = ?"));
+      TimedStatement stmt(conn, "SELECT * FROM chat_rooms WHERE id = ?");
       stmt->setUInt64(1, request->chat_room_id());
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
       if (rs->next()) {
         chatRoom.setId(rs->getUInt64("id"));
         chatRoom.setName(std::string(rs->getString("name")));
@@ -160,14 +196,14 @@ void ChatServiceImpl::GetChatRoom(
         cacheChatRoom(chatRoom);
 
         // 获取成员列表
-        std::unique_ptr<sql::PreparedStatement> memberStmt(
-            conn->prepareStatement(
-                "SELECT m.*, u.nickname FROM chat_room_members m "
-                "JOIN users u ON m.user_id = u.id "
-                "WHERE m.chat_room_id = ?"));
+        TimedStatement memberStmt(conn,
+                                  "SELECT m.*, u.nickname "
+                                  "FROM chat_room_members m JOIN users u "
+                                  "ON m.user_id = u.id "
+                                  "WHERE m.chat_room_id = ?");
         memberStmt->setUInt64(1, request->chat_room_id());
 
-        std::unique_ptr<sql::ResultSet> memberRs(memberStmt->executeQuery());
+        std::unique_ptr<sql::ResultSet> memberRs(memberStmt.executeQuery());
         while (memberRs->next()) {
           // 获取所需数据
           ChatRoomMember member(
@@ -203,9 +239,14 @@ void ChatServiceImpl::GetChatRoom(
     }
 
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "GetChatRoom SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "GetChatRoom error: " << e.what();
     response->set_success(false);
@@ -219,7 +260,16 @@ void ChatServiceImpl::GetChatRoom(
 void ChatServiceImpl::UpdateChatRoom(
     const starrychat::UpdateChatRoomRequestPtr& request,
     const starrychat::UpdateChatRoomResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "UpdateChatRoom");
+  static RpcAdmission admission("ChatService", "UpdateChatRoom",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -265,8 +315,7 @@ void ChatServiceImpl::UpdateChatRoom(
 
     updateQuery += " WHERE id = ?";
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement(updateQuery));
+    TimedStatement stmt(conn, updateQuery);
     int paramIndex = 1;
 
     if (!request->name().empty()) {
@@ -283,13 +332,12 @@ void ChatServiceImpl::UpdateChatRoom(
 
     stmt->setUInt64(paramIndex, request->chat_room_id());
 
-    if (stmt->executeUpdate() > 0) {
+    if (stmt.executeUpdate() > 0) {
       // 获取更新后的聊天室信息
-      std::unique_ptr<sql::PreparedStatement> selectStmt(
-          conn->prepareStatement("SELECT * FROM chat_rooms WHERE id = ?"));
+      TimedStatement selectStmt(conn, "SELECT * FROM chat_rooms WHERE id = ?");
       selectStmt->setUInt64(1, request->chat_room_id());
 
-      std::unique_ptr<sql::ResultSet> rs(selectStmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(selectStmt.executeQuery());
       if (rs->next()) {
         ChatRoom chatRoom;
         chatRoom.setId(rs->getUInt64("id"));
@@ -318,9 +366,14 @@ void ChatServiceImpl::UpdateChatRoom(
       response->set_error_message("No changes made");
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "UpdateChatRoom SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "UpdateChatRoom error: " << e.what();
     response->set_success(false);
@@ -334,7 +387,16 @@ void ChatServiceImpl::UpdateChatRoom(
 void ChatServiceImpl::DissolveChatRoom(
     const starrychat::DissolveChatRoomRequestPtr& request,
     const starrychat::DissolveChatRoomResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "DissolveChatRoom");
+  static RpcAdmission admission("ChatService", "DissolveChatRoom",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -358,30 +420,33 @@ void ChatServiceImpl::DissolveChatRoom(
 
       if (memberIds.empty()) {
         // 缓存未命中，从数据库获取
-        std::unique_ptr<sql::PreparedStatement> memberStmt(
-            conn->prepareStatement("SELECT user_id FROM chat_room_members "
-                                   "WHERE chat_room_id = ?"));
+        TimedStatement memberStmt(conn,
+                                  "SELECT user_id FROM chat_room_members "
+                                  "WHERE chat_room_id = ?");
         memberStmt->setUInt64(1, request->chat_room_id());
 
-        std::unique_ptr<sql::ResultSet> memberRs(memberStmt->executeQuery());
+        std::unique_ptr<sql::ResultSet> memberRs(memberStmt.executeQuery());
         while (memberRs->next()) {
           memberIds.push_back(memberRs->getUInt64("user_id"));
         }
       }
 
       // 删除所有成员
-      std::unique_ptr<sql::PreparedStatement> deleteMembers(
-          conn->prepareStatement(
-              "DELETE FROM chat_room_members WHERE chat_room_id = ?"));
+      for (uint64_t memberId : memberIds) {
+        DBManager::getInstance().noteWrite(memberId);
+      }
+      TimedStatement deleteMembers(conn,
+                                   "DELETE FROM chat_room_members "
+                                   "WHERE chat_room_id = ?");
       deleteMembers->setUInt64(1, request->chat_room_id());
-      deleteMembers->executeUpdate();
+      deleteMembers.executeUpdate();
 
       // 删除聊天室
-      std::unique_ptr<sql::PreparedStatement> deleteChatRoom(
-          conn->prepareStatement("DELETE FROM chat_rooms WHERE id = ?"));
+      TimedStatement deleteChatRoom(conn,
+                                    "DELETE FROM chat_rooms WHERE id = ?");
       deleteChatRoom->setUInt64(1, request->chat_room_id());
 
-      if (deleteChatRoom->executeUpdate() > 0) {
+      if (deleteChatRoom.executeUpdate() > 0) {
         conn->commit();
         response->set_success(true);
 
@@ -404,9 +469,14 @@ void ChatServiceImpl::DissolveChatRoom(
       throw;
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "DissolveChatRoom SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "DissolveChatRoom error: " << e.what();
     response->set_success(false);
@@ -420,7 +490,16 @@ void ChatServiceImpl::DissolveChatRoom(
 void ChatServiceImpl::AddChatRoomMember(
     const starrychat::AddChatRoomMemberRequestPtr& request,
     const starrychat::AddChatRoomMemberResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "AddChatRoomMember");
+  static RpcAdmission admission("ChatService", "AddChatRoomMember",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -447,11 +526,11 @@ void ChatServiceImpl::AddChatRoomMember(
       if (addChatRoomMemberToDB(request->chat_room_id(), userId,
                                 starrychat::MEMBER_ROLE_MEMBER)) {
         // 获取用户信息
-        std::unique_ptr<sql::PreparedStatement> userStmt(
-            conn->prepareStatement("SELECT nickname FROM users WHERE id = ?"));
+        TimedStatement userStmt(conn,
+                                "SELECT nickname FROM users WHERE id = ?");
         userStmt->setUInt64(1, userId);
 
-        std::unique_ptr<sql::ResultSet> userRs(userStmt->executeQuery());
+        std::unique_ptr<sql::ResultSet> userRs(userStmt.executeQuery());
         if (userRs->next()) {
           // 创建成员对象
           ChatRoomMember member(request->chat_room_id(), userId,
@@ -496,9 +575,14 @@ void ChatServiceImpl::AddChatRoomMember(
     updateChatRoomMemberCount(request->chat_room_id());
 
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "AddChatRoomMember SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "AddChatRoomMember error: " << e.what();
     response->set_success(false);
@@ -512,7 +596,16 @@ void ChatServiceImpl::AddChatRoomMember(
 void ChatServiceImpl::RemoveChatRoomMember(
     const starrychat::RemoveChatRoomMemberRequestPtr& request,
     const starrychat::RemoveChatRoomMemberResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "RemoveChatRoomMember");
+  static RpcAdmission admission("ChatService", "RemoveChatRoomMember",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -556,9 +649,14 @@ void ChatServiceImpl::RemoveChatRoomMember(
     updateChatRoomMemberCount(request->chat_room_id());
 
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "RemoveChatRoomMember SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "RemoveChatRoomMember error: " << e.what();
     response->set_success(false);
@@ -572,7 +670,16 @@ void ChatServiceImpl::RemoveChatRoomMember(
 void ChatServiceImpl::UpdateMemberRole(
     const starrychat::UpdateMemberRoleRequestPtr& request,
     const starrychat::UpdateMemberRoleResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "UpdateMemberRole");
+  static RpcAdmission admission("ChatService", "UpdateMemberRole",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -595,23 +702,24 @@ void ChatServiceImpl::UpdateMemberRole(
     auto conn = getConnection();
 
     // 更新成员角色
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("UPDATE chat_room_members SET role = ? WHERE "
-                               "chat_room_id = ? AND user_id = ?"));
+    TimedStatement stmt(conn,
+                        "UPDATE chat_room_members SET role = ? WHERE "
+                        "chat_room_id = ? AND user_id = ?");
     stmt->setInt(1, static_cast<int>(request->new_role()));
     stmt->setUInt64(2, request->chat_room_id());
     stmt->setUInt64(3, request->user_id());
 
-    if (stmt->executeUpdate() > 0) {
+    if (stmt.executeUpdate() > 0) {
       // 获取更新后的成员信息
-      std::unique_ptr<sql::PreparedStatement> selectStmt(conn->prepareStatement(
-          "SELECT m.*, u.nickname FROM chat_room_members m "
-          "JOIN users u ON m.user_id = u.id "
-          "WHERE m.chat_room_id = ? AND m.user_id = ?"));
+      TimedStatement selectStmt(conn,
+                                "SELECT m.*, u.nickname "
+                                "FROM chat_room_members m JOIN users u "
+                                "ON m.user_id = u.id "
+                                "WHERE m.chat_room_id = ? AND m.user_id = ?");
       selectStmt->setUInt64(1, request->chat_room_id());
       selectStmt->setUInt64(2, request->user_id());
 
-      std::unique_ptr<sql::ResultSet> rs(selectStmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(selectStmt.executeQuery());
       if (rs->next()) {
         ChatRoomMember member(rs->getUInt64("chat_room_id"),
                               rs->getUInt64("user_id"),
@@ -640,9 +748,14 @@ void ChatServiceImpl::UpdateMemberRole(
       response->set_error_message("No changes made");
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "UpdateMemberRole SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "UpdateMemberRole error: " << e.what();
     response->set_success(false);
@@ -656,7 +769,16 @@ void ChatServiceImpl::UpdateMemberRole(
 void ChatServiceImpl::LeaveChatRoom(
     const starrychat::LeaveChatRoomRequestPtr& request,
     const starrychat::LeaveChatRoomResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "LeaveChatRoom");
+  static RpcAdmission admission("ChatService", "LeaveChatRoom",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -700,9 +822,14 @@ void ChatServiceImpl::LeaveChatRoom(
       response->set_error_message("Failed to leave chat room");
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "LeaveChatRoom SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "LeaveChatRoom error: " << e.what();
     response->set_success(false);
@@ -716,17 +843,25 @@ void ChatServiceImpl::LeaveChatRoom(
 void ChatServiceImpl::CreatePrivateChat(
     const starrychat::CreatePrivateChatRequestPtr& request,
     const starrychat::CreatePrivateChatResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "CreatePrivateChat");
+  static RpcAdmission admission("ChatService", "CreatePrivateChat",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
     // 检查用户是否存在
     auto conn = getConnection();
-    std::unique_ptr<sql::PreparedStatement> userStmt(
-        conn->prepareStatement("SELECT 1 FROM users WHERE id = ?"));
+    TimedStatement userStmt(conn, "SELECT 1 FROM users WHERE id = ?");
     userStmt->setUInt64(1, request->receiver_id());
 
-    std::unique_ptr<sql::ResultSet> userRs(userStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> userRs(userStmt.executeQuery());
     if (!userRs->next()) {
       response->set_success(false);
       response->set_error_message("Receiver not found");
@@ -740,11 +875,10 @@ void ChatServiceImpl::CreatePrivateChat(
 
     if (privateChatId > 0) {
       // 获取私聊信息
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("SELECT * FROM private_chats WHERE id = ?"));
+      TimedStatement stmt(conn, "SELECT * FROM private_chats WHERE id = ?");
       stmt->setUInt64(1, privateChatId);
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
       if (rs->next()) {
         starrychat::PrivateChat privateChat;
         privateChat.set_id(rs->getUInt64("id"));
@@ -778,9 +912,14 @@ void ChatServiceImpl::CreatePrivateChat(
       response->set_error_message("Failed to create private chat");
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "CreatePrivateChat SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "CreatePrivateChat error: " << e.what();
     response->set_success(false);
@@ -794,7 +933,16 @@ void ChatServiceImpl::CreatePrivateChat(
 void ChatServiceImpl::GetPrivateChat(
     const starrychat::GetPrivateChatRequestPtr& request,
     const starrychat::GetPrivateChatResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "GetPrivateChat");
+  static RpcAdmission admission("ChatService", "GetPrivateChat",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -807,11 +955,11 @@ void ChatServiceImpl::GetPrivateChat(
     if (cachedPrivateChat) {
       privateChat = *cachedPrivateChat;
       cacheMiss = false;
-      LOG_INFO << "Private chat cache hit for ID: "
-               << request->private_chat_id();
+      MLOG_DEBUG(kLogModule) << "Private chat cache hit for ID: "
+                             << request->private_chat_id();
     } else {
-      LOG_INFO << "Private chat cache miss for ID: "
-               << request->private_chat_id();
+      MLOG_DEBUG(kLogModule) << "Private chat cache miss for ID: "
+                             << request->private_chat_id();
     }
 
     if (cacheMiss) {
@@ -819,11 +967,10 @@ void ChatServiceImpl::GetPrivateChat(
       auto conn = getConnection();
 
       // 获取私聊信息
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("SELECT * FROM private_chats WHERE id = ?"));
+      TimedStatement stmt(conn, "SELECT * FROM private_chats WHERE id = ?");
       stmt->setUInt64(1, request->private_chat_id());
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
       if (!rs->next()) {
         response->set_success(false);
         response->set_error_message("Private chat not found");
@@ -860,7 +1007,7 @@ void ChatServiceImpl::GetPrivateChat(
 
     // 尝试从Redis缓存获取用户信息
     auto& redis = RedisManager::getInstance();
-    std::string userKey = "user:" + std::to_string(partnerId);
+    auto userKey = RedisKeys::user(partnerId);
     auto userData = redis.hgetall(userKey);
 
     if (userData && !userData->empty()) {
@@ -891,15 +1038,14 @@ void ChatServiceImpl::GetPrivateChat(
         partnerInfo->set_last_login_time(
             std::stoull((*userData)["last_login_time"]));
 
-      LOG_INFO << "Partner info cache hit for ID: " << partnerId;
+      MLOG_DEBUG(kLogModule) << "Partner info cache hit for ID: " << partnerId;
     } else {
       // 缓存未命中，从数据库获取用户信息
       auto conn = getConnection();
-      std::unique_ptr<sql::PreparedStatement> userStmt(
-          conn->prepareStatement("SELECT * FROM users WHERE id = ?"));
+      TimedStatement userStmt(conn, "SELECT * FROM users WHERE id = ?");
       userStmt->setUInt64(1, partnerId);
 
-      std::unique_ptr<sql::ResultSet> userRs(userStmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> userRs(userStmt.executeQuery());
       if (userRs->next()) {
         auto* partnerInfo = response->mutable_partner_info();
         partnerInfo->set_id(userRs->getUInt64("id"));
@@ -925,9 +1071,14 @@ void ChatServiceImpl::GetPrivateChat(
     response->set_success(true);
     *response->mutable_private_chat() = privateChat;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "GetPrivateChat SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "GetPrivateChat error: " << e.what();
     response->set_success(false);
@@ -941,30 +1092,49 @@ void ChatServiceImpl::GetPrivateChat(
 void ChatServiceImpl::GetUserChats(
     const starrychat::GetUserChatsRequestPtr& request,
     const starrychat::GetUserChatsResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("ChatService", "GetUserChats");
+  static RpcAdmission admission("ChatService", "GetUserChats",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
-    // 尝试从缓存获取聊天列表
-    auto cachedChats = getUserChatsListFromCache(request->user_id());
-    if (cachedChats) {
-      LOG_INFO << "User chats list cache hit for user ID: "
-               << request->user_id();
+    // 尝试从缓存获取聊天列表，直接解析到响应中
+    if (getUserChatsListFromCache(request->user_id(), response)) {
+      MLOG_DEBUG(kLogModule) << "User chats list cache hit for user ID: "
+                             << request->user_id();
 
       response->set_success(true);
-      for (const auto& chat : *cachedChats) {
-        *response->add_chats() = chat;
-      }
+      done(response);
+      return;
+    }
+
+    MLOG_DEBUG(kLogModule) << "User chats list cache miss for user ID: "
+                           << request->user_id();
 
+    // 客户端已超时，不再查询数据库
+    if (deadline.expired()) {
+      setDeadlineExceeded(response);
       done(response);
       return;
     }
 
-    LOG_INFO << "User chats list cache miss for user ID: "
-             << request->user_id();
+    // 数据库已熔断，只能提供缓存中的聊天列表
+    if (DBManager::getInstance().degraded()) {
+      setUnavailable(response);
+      done(response);
+      return;
+    }
 
     // 缓存未命中，从数据库获取
-    auto conn = getConnection();
+    auto conn = DBManager::getInstance().getConnection(DBAccess::kReadOnly,
+                                                       request->user_id());
     if (!conn) {
       response->set_success(false);
       response->set_error_message("Database connection failed");
@@ -972,53 +1142,65 @@ void ChatServiceImpl::GetUserChats(
       return;
     }
 
-    std::vector<starrychat::ChatSummary> chats;
-
     // 获取私聊列表
-    std::unique_ptr<sql::PreparedStatement> privateStmt(conn->prepareStatement(
-        "SELECT * FROM private_chats WHERE user1_id = ? OR user2_id = ? "
-        "ORDER BY last_message_time DESC, created_time DESC"));
+    TimedStatement privateStmt(conn,
+                               "SELECT * FROM private_chats "
+                               "WHERE user1_id = ? OR user2_id = ? "
+                               "ORDER BY last_message_time DESC, "
+                               "created_time DESC");
     privateStmt->setUInt64(1, request->user_id());
     privateStmt->setUInt64(2, request->user_id());
 
-    std::unique_ptr<sql::ResultSet> privateRs(privateStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> privateRs(privateStmt.executeQuery());
 
     while (privateRs->next()) {
       uint64_t privateChatId = privateRs->getUInt64("id");
-      starrychat::ChatSummary chatSummary = getChatSummary(
+      *response->add_chats() = getChatSummary(
           starrychat::CHAT_TYPE_PRIVATE, privateChatId, request->user_id());
+    }
 
-      *response->add_chats() = chatSummary;
-      chats.push_back(chatSummary);
+    // 私聊摘要逐个查询，完成后再确认一次
+    if (deadline.expired()) {
+      setDeadlineExceeded(response);
+      done(response);
+      return;
     }
 
     // 获取群聊列表
-    std::unique_ptr<sql::PreparedStatement> groupStmt(conn->prepareStatement(
-        "SELECT cr.* FROM chat_rooms cr "
-        "JOIN chat_room_members crm ON cr.id = crm.chat_room_id "
-        "WHERE crm.user_id = ? "
-        "ORDER BY last_message_time DESC, created_time DESC"));
+    TimedStatement groupStmt(conn,
+                             "SELECT cr.* FROM chat_rooms cr "
+                             "JOIN chat_room_members crm "
+                             "ON cr.id = crm.chat_room_id "
+                             "WHERE crm.user_id = ? "
+                             "ORDER BY last_message_time DESC, created_time "
+                             "DESC");
     groupStmt->setUInt64(1, request->user_id());
 
-    std::unique_ptr<sql::ResultSet> groupRs(groupStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> groupRs(groupStmt.executeQuery());
 
     while (groupRs->next()) {
       uint64_t chatRoomId = groupRs->getUInt64("id");
-      starrychat::ChatSummary chatSummary = getChatSummary(
+      *response->add_chats() = getChatSummary(
           starrychat::CHAT_TYPE_GROUP, chatRoomId, request->user_id());
-
-      *response->add_chats() = chatSummary;
-      chats.push_back(chatSummary);
     }
 
-    // 缓存聊天列表
-    cacheUserChatsList(request->user_id(), chats);
-
+    // 响应本身就是缓存格式，直接序列化缓存；从库的结果可能缺少其他用户
+    // 刚提交的变更（如把该用户拉入群聊），不回填共享缓存
     response->set_success(true);
+    if (!DBManager::servedByReplica(conn)) {
+      cacheUserChatsList(request->user_id(), *response);
+    }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "GetUserChats SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    response->clear_chats();
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    response->clear_chats();
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "GetUserChats error: " << e.what();
     response->set_success(false);
@@ -1034,8 +1216,7 @@ bool ChatServiceImpl::isChatRoomOwner(uint64_t userId, uint64_t chatRoomId) {
     auto& redis = RedisManager::getInstance();
 
     // 从Redis缓存检查
-    std::string key = "chat_room:" + std::to_string(chatRoomId) +
-                      ":member:" + std::to_string(userId);
+    auto key = RedisKeys::chatRoomMember(chatRoomId, userId);
     auto roleStr = redis.hget(key, "role");
 
     if (roleStr) {
@@ -1046,14 +1227,14 @@ bool ChatServiceImpl::isChatRoomOwner(uint64_t userId, uint64_t chatRoomId) {
     // 缓存未命中，从数据库查询
     auto conn = getConnection();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-        "SELECT 1 FROM chat_room_members WHERE chat_room_id = ? AND user_id = "
-        "? AND role = ?"));
+    TimedStatement stmt(conn,
+                        "SELECT 1 FROM chat_room_members "
+                        "WHERE chat_room_id = ? AND user_id = ? AND role = ?");
     stmt->setUInt64(1, chatRoomId);
     stmt->setUInt64(2, userId);
     stmt->setInt(3, static_cast<int>(starrychat::MEMBER_ROLE_OWNER));
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     bool result = rs->next();
 
     // 如果是所有者，缓存结果
@@ -1077,8 +1258,7 @@ bool ChatServiceImpl::isChatRoomAdmin(uint64_t userId, uint64_t chatRoomId) {
     auto& redis = RedisManager::getInstance();
 
     // 从Redis缓存检查
-    std::string key = "chat_room:" + std::to_string(chatRoomId) +
-                      ":member:" + std::to_string(userId);
+    auto key = RedisKeys::chatRoomMember(chatRoomId, userId);
     auto roleStr = redis.hget(key, "role");
 
     if (roleStr) {
@@ -1090,13 +1270,13 @@ bool ChatServiceImpl::isChatRoomAdmin(uint64_t userId, uint64_t chatRoomId) {
     // 缓存未命中，从数据库查询
     auto conn = getConnection();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("SELECT role FROM chat_room_members WHERE "
-                               "chat_room_id = ? AND user_id = ?"));
+    TimedStatement stmt(conn,
+                        "SELECT role FROM chat_room_members WHERE "
+                        "chat_room_id = ? AND user_id = ?");
     stmt->setUInt64(1, chatRoomId);
     stmt->setUInt64(2, userId);
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     if (rs->next()) {
       starrychat::MemberRole role =
           static_cast<starrychat::MemberRole>(rs->getInt("role"));
@@ -1121,8 +1301,7 @@ bool ChatServiceImpl::isChatRoomMember(uint64_t userId, uint64_t chatRoomId) {
     auto& redis = RedisManager::getInstance();
 
     // 从Redis缓存检查
-    std::string memberKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto memberKey = RedisKeys::chatRoomMembers(chatRoomId);
     auto members = redis.smembers(memberKey);
     if (members && !members->empty()) {
       std::string userIdStr = std::to_string(userId);
@@ -1131,8 +1310,7 @@ bool ChatServiceImpl::isChatRoomMember(uint64_t userId, uint64_t chatRoomId) {
     }
 
     // 单独检查成员记录
-    std::string key = "chat_room:" + std::to_string(chatRoomId) +
-                      ":member:" + std::to_string(userId);
+    auto key = RedisKeys::chatRoomMember(chatRoomId, userId);
     if (redis.exists(key)) {
       return true;
     }
@@ -1140,13 +1318,13 @@ bool ChatServiceImpl::isChatRoomMember(uint64_t userId, uint64_t chatRoomId) {
     // 缓存未命中，从数据库查询
     auto conn = getConnection();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("SELECT 1 FROM chat_room_members WHERE "
-                               "chat_room_id = ? AND user_id = ?"));
+    TimedStatement stmt(conn,
+                        "SELECT 1 FROM chat_room_members WHERE "
+                        "chat_room_id = ? AND user_id = ?");
     stmt->setUInt64(1, chatRoomId);
     stmt->setUInt64(2, userId);
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     bool result = rs->next();
 
     // 如果是成员，缓存结果
@@ -1169,7 +1347,7 @@ bool ChatServiceImpl::isPrivateChatMember(uint64_t userId,
     auto& redis = RedisManager::getInstance();
 
     // 从Redis缓存检查
-    std::string key = "private_chat:" + std::to_string(privateChatId);
+    auto key = RedisKeys::privateChat(privateChatId);
     auto cachedChat = redis.get(key);
 
     if (cachedChat) {
@@ -1183,14 +1361,14 @@ bool ChatServiceImpl::isPrivateChatMember(uint64_t userId,
     // 缓存未命中，从数据库查询
     auto conn = getConnection();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("SELECT 1 FROM private_chats WHERE id = ? AND "
-                               "(user1_id = ? OR user2_id = ?)"));
+    TimedStatement stmt(conn,
+                        "SELECT 1 FROM private_chats WHERE id = ? AND "
+                        "(user1_id = ? OR user2_id = ?)");
     stmt->setUInt64(1, privateChatId);
     stmt->setUInt64(2, userId);
     stmt->setUInt64(3, userId);
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     return rs->next();
   } catch (std::exception& e) {
     LOG_ERROR << "isPrivateChatMember error: " << e.what();
@@ -1211,11 +1389,11 @@ uint64_t ChatServiceImpl::createChatRoomInDB(const std::string& name,
             std::chrono::system_clock::now().time_since_epoch())
             .count();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-        "INSERT INTO chat_rooms (name, description, creator_id, created_time, "
-        "member_count, avatar_url) "
-        "VALUES (?, ?, ?, ?, 0, ?)",
-        sql::Statement::RETURN_GENERATED_KEYS));
+    TimedStatement stmt(conn,
+                        "INSERT INTO chat_rooms (name, description, "
+                        "creator_id, created_time, member_count, avatar_url) "
+                        "VALUES (?, ?, ?, ?, 0, ?)",
+                        sql::Statement::RETURN_GENERATED_KEYS);
 
     stmt->setString(1, name);
     stmt->setString(2, description);
@@ -1223,7 +1401,7 @@ uint64_t ChatServiceImpl::createChatRoomInDB(const std::string& name,
     stmt->setUInt64(4, currentTime);
     stmt->setString(5, avatarUrl);
 
-    if (stmt->executeUpdate() > 0) {
+    if (stmt.executeUpdate() > 0) {
       std::unique_ptr<sql::ResultSet> rs(stmt->getGeneratedKeys());
       if (rs->next()) {
         return rs->getUInt64(1);
@@ -1232,6 +1410,7 @@ uint64_t ChatServiceImpl::createChatRoomInDB(const std::string& name,
 
     return 0;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "createChatRoomInDB SQL error: " << e.what();
     return 0;
   } catch (std::exception& e) {
@@ -1252,12 +1431,12 @@ bool ChatServiceImpl::addChatRoomMemberToDB(uint64_t chatRoomId,
                             std::chrono::system_clock::now().time_since_epoch())
                             .count();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("INSERT INTO chat_room_members (chat_room_id, "
-                               "user_id, role, join_time, display_name) "
-                               "VALUES (?, ?, ?, ?, ?) "
-                               "ON DUPLICATE KEY UPDATE role = VALUES(role), "
-                               "display_name = VALUES(display_name)"));
+    TimedStatement stmt(conn,
+                        "INSERT INTO chat_room_members (chat_room_id, "
+                        "user_id, role, join_time, display_name) "
+                        "VALUES (?, ?, ?, ?, ?) "
+                        "ON DUPLICATE KEY UPDATE role = VALUES(role), "
+                        "display_name = VALUES(display_name)");
 
     stmt->setUInt64(1, chatRoomId);
     stmt->setUInt64(2, userId);
@@ -1265,8 +1444,11 @@ bool ChatServiceImpl::addChatRoomMemberToDB(uint64_t chatRoomId,
     stmt->setUInt64(4, joinTime);
     stmt->setString(5, displayName);
 
-    return stmt->executeUpdate() > 0;
+    // 成员的聊天列表马上会读取，从库可能还没有这一行
+    DBManager::getInstance().noteWrite(userId);
+    return stmt.executeUpdate() > 0;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "addChatRoomMemberToDB SQL error: " << e.what();
     return false;
   } catch (std::exception& e) {
@@ -1281,15 +1463,17 @@ bool ChatServiceImpl::removeChatRoomMemberFromDB(uint64_t chatRoomId,
   try {
     auto conn = getConnection();
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("DELETE FROM chat_room_members WHERE "
-                               "chat_room_id = ? AND user_id = ?"));
+    TimedStatement stmt(conn,
+                        "DELETE FROM chat_room_members WHERE "
+                        "chat_room_id = ? AND user_id = ?");
 
     stmt->setUInt64(1, chatRoomId);
     stmt->setUInt64(2, userId);
 
-    return stmt->executeUpdate() > 0;
+    DBManager::getInstance().noteWrite(userId);
+    return stmt.executeUpdate() > 0;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "removeChatRoomMemberFromDB SQL error: " << e.what();
     return false;
   } catch (std::exception& e) {
@@ -1304,22 +1488,23 @@ bool ChatServiceImpl::updateChatRoomMemberCount(uint64_t chatRoomId) {
     auto conn = getConnection();
 
     // 查询成员数量
-    std::unique_ptr<sql::PreparedStatement> countStmt(
-        conn->prepareStatement("SELECT COUNT(*) AS count FROM "
-                               "chat_room_members WHERE chat_room_id = ?"));
+    TimedStatement countStmt(conn,
+                             "SELECT COUNT(*) AS count FROM "
+                             "chat_room_members WHERE chat_room_id = ?");
     countStmt->setUInt64(1, chatRoomId);
 
-    std::unique_ptr<sql::ResultSet> countRs(countStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> countRs(countStmt.executeQuery());
     if (countRs->next()) {
       uint64_t memberCount = countRs->getUInt64("count");
 
       // 更新数据库中的成员数量
-      std::unique_ptr<sql::PreparedStatement> updateStmt(conn->prepareStatement(
-          "UPDATE chat_rooms SET member_count = ? WHERE id = ?"));
+      TimedStatement updateStmt(conn,
+                                "UPDATE chat_rooms SET member_count = ? "
+                                "WHERE id = ?");
       updateStmt->setUInt64(1, memberCount);
       updateStmt->setUInt64(2, chatRoomId);
 
-      bool result = updateStmt->executeUpdate() > 0;
+      bool result = updateStmt.executeUpdate() > 0;
 
       // 如果更新成功，同时更新缓存
       if (result) {
@@ -1347,6 +1532,7 @@ bool ChatServiceImpl::updateChatRoomMemberCount(uint64_t chatRoomId) {
 
     return false;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "updateChatRoomMemberCount SQL error: " << e.what();
     return false;
   } catch (std::exception& e) {
@@ -1367,8 +1553,7 @@ uint64_t ChatServiceImpl::findOrCreatePrivateChat(uint64_t user1Id,
     }
 
     // 尝试从缓存获取
-    std::string cacheKey = "private_chat:users:" + std::to_string(user1Id) +
-                           ":" + std::to_string(user2Id);
+    auto cacheKey = RedisKeys::privateChatUsers(user1Id, user2Id);
     auto cachedId = redis.get(cacheKey);
 
     if (cachedId) {
@@ -1381,12 +1566,13 @@ uint64_t ChatServiceImpl::findOrCreatePrivateChat(uint64_t user1Id,
     }
 
     // 查找现有私聊
-    std::unique_ptr<sql::PreparedStatement> findStmt(conn->prepareStatement(
-        "SELECT id FROM private_chats WHERE user1_id = ? AND user2_id = ?"));
+    TimedStatement findStmt(conn,
+                            "SELECT id FROM private_chats WHERE user1_id = ? "
+                            "AND user2_id = ?");
     findStmt->setUInt64(1, user1Id);
     findStmt->setUInt64(2, user2Id);
 
-    std::unique_ptr<sql::ResultSet> findRs(findStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> findRs(findStmt.executeQuery());
     if (findRs->next()) {
       uint64_t privateChatId = findRs->getUInt64("id");
 
@@ -1403,16 +1589,18 @@ uint64_t ChatServiceImpl::findOrCreatePrivateChat(uint64_t user1Id,
             std::chrono::system_clock::now().time_since_epoch())
             .count();
 
-    std::unique_ptr<sql::PreparedStatement> createStmt(
-        conn->prepareStatement("INSERT INTO private_chats (user1_id, user2_id, "
-                               "created_time) VALUES (?, ?, ?)",
-                               sql::Statement::RETURN_GENERATED_KEYS));
+    TimedStatement createStmt(conn,
+                              "INSERT INTO private_chats (user1_id, "
+                              "user2_id, created_time) VALUES (?, ?, ?)",
+                              sql::Statement::RETURN_GENERATED_KEYS);
 
     createStmt->setUInt64(1, user1Id);
     createStmt->setUInt64(2, user2Id);
     createStmt->setUInt64(3, createdTime);
 
-    if (createStmt->executeUpdate() > 0) {
+    DBManager::getInstance().noteWrite(user1Id);
+    DBManager::getInstance().noteWrite(user2Id);
+    if (createStmt.executeUpdate() > 0) {
       std::unique_ptr<sql::ResultSet> rs(createStmt->getGeneratedKeys());
       if (rs->next()) {
         uint64_t privateChatId = rs->getUInt64(1);
@@ -1427,6 +1615,7 @@ uint64_t ChatServiceImpl::findOrCreatePrivateChat(uint64_t user1Id,
 
     return 0;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "findOrCreatePrivateChat SQL error: " << e.what();
     return 0;
   } catch (std::exception& e) {
@@ -1444,7 +1633,8 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
 
   try {
     auto& redis = RedisManager::getInstance();
-    auto conn = getConnection();
+    auto conn =
+        DBManager::getInstance().getConnection(DBAccess::kReadOnly, userId);
 
     summary.set_id(chatId);
     summary.set_type(type);
@@ -1459,7 +1649,7 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
         uint64_t partnerId = (userId == user1Id) ? user2Id : user1Id;
 
         // 尝试从缓存获取伙伴信息
-        std::string userKey = "user:" + std::to_string(partnerId);
+        auto userKey = RedisKeys::user(partnerId);
         auto userData = redis.hgetall(userKey);
 
         if (userData && !userData->empty()) {
@@ -1470,12 +1660,12 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
             summary.set_avatar_url((*userData)["avatar_url"]);
         } else {
           // 从数据库获取伙伴信息
-          std::unique_ptr<sql::PreparedStatement> userStmt(
-              conn->prepareStatement(
-                  "SELECT nickname, avatar_url FROM users WHERE id = ?"));
+          TimedStatement userStmt(conn,
+                                  "SELECT nickname, avatar_url FROM users "
+                                  "WHERE id = ?");
           userStmt->setUInt64(1, partnerId);
 
-          std::unique_ptr<sql::ResultSet> userRs(userStmt->executeQuery());
+          std::unique_ptr<sql::ResultSet> userRs(userStmt.executeQuery());
           if (userRs->next()) {
             summary.set_name(std::string(userRs->getString("nickname")));
             summary.set_avatar_url(
@@ -1491,16 +1681,16 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
         }
       } else {
         // 从数据库获取私聊信息
-        std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-            "SELECT pc.*, u1.nickname as nick1, u1.avatar_url as avatar1, "
-            "u2.nickname as nick2, u2.avatar_url as avatar2 "
-            "FROM private_chats pc "
-            "JOIN users u1 ON pc.user1_id = u1.id "
-            "JOIN users u2 ON pc.user2_id = u2.id "
-            "WHERE pc.id = ?"));
+        TimedStatement stmt(conn,
+                            "SELECT pc.*, u1.nickname as nick1, "
+                            "u1.avatar_url as avatar1, "
+                            "u2.nickname as nick2, u2.avatar_url as avatar2 "
+                            "FROM private_chats pc JOIN users u1 "
+                            "ON pc.user1_id = u1.id JOIN users u2 "
+                            "ON pc.user2_id = u2.id WHERE pc.id = ?");
         stmt->setUInt64(1, chatId);
 
-        std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+        std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
         if (rs->next()) {
           uint64_t user1Id = rs->getUInt64("user1_id");
 
@@ -1529,9 +1719,7 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
         summary.set_avatar_url(cachedChatRoom->getAvatarUrl());
 
         // 检查是否有最后消息时间
-        std::string lastActiveKey =
-            "chat:last_active:" + std::to_string(static_cast<int>(type)) + ":" +
-            std::to_string(chatId);
+        auto lastActiveKey = RedisKeys::chatLastActive(type, chatId);
         auto lastActiveTime = redis.get(lastActiveKey);
 
         if (lastActiveTime) {
@@ -1541,11 +1729,10 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
         }
       } else {
         // 从数据库获取群聊信息
-        std::unique_ptr<sql::PreparedStatement> stmt(
-            conn->prepareStatement("SELECT * FROM chat_rooms WHERE id = ?"));
+        TimedStatement stmt(conn, "SELECT * FROM chat_rooms WHERE id = ?");
         stmt->setUInt64(1, chatId);
 
-        std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+        std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
         if (rs->next()) {
           summary.set_name(std::string(rs->getString("name")));
           summary.set_avatar_url(std::string(rs->getString("avatar_url")));
@@ -1566,6 +1753,7 @@ starrychat::ChatSummary ChatServiceImpl::getChatSummary(
     summary.set_unread_count(getUnreadCount(userId, type, chatId));
 
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "getChatSummary SQL error: " << e.what();
   } catch (std::exception& e) {
     LOG_ERROR << "getChatSummary error: " << e.what();
@@ -1581,29 +1769,27 @@ std::string ChatServiceImpl::getLastMessagePreview(starrychat::ChatType type,
     auto& redis = RedisManager::getInstance();
 
     // 尝试从缓存获取最后一条消息
-    std::string lastMessageKey =
-        "chat:last_message:" + std::to_string(static_cast<int>(type)) + ":" +
-        std::to_string(chatId);
+    auto lastMessageKey = RedisKeys::chatLastMessage(type, chatId);
 
     auto preview = redis.get(lastMessageKey);
     if (preview) {
       return *preview;
     }
 
-    // 缓存未命中，从数据库查询
-    auto conn = getConnection();
+    // 缓存未命中，从数据库查询；刚发送的消息已写入上面的缓存，可以读从库
+    auto conn = DBManager::getInstance().getConnection(DBAccess::kReadOnly);
     if (!conn) {
       return "";
     }
 
-    std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-        "SELECT type, content, system_code FROM messages "
-        "WHERE chat_type = ? AND chat_id = ? "
-        "ORDER BY timestamp DESC LIMIT 1"));
+    TimedStatement stmt(conn,
+                        "SELECT type, content, system_code FROM messages "
+                        "WHERE chat_type = ? AND chat_id = ? "
+                        "ORDER BY timestamp DESC LIMIT 1");
     stmt->setInt(1, static_cast<int>(type));
     stmt->setUInt64(2, chatId);
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     if (rs->next()) {
       starrychat::MessageType msgType =
           static_cast<starrychat::MessageType>(rs->getInt("type"));
@@ -1641,6 +1827,7 @@ std::string ChatServiceImpl::getLastMessagePreview(starrychat::ChatType type,
       return previewText;
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "getLastMessagePreview SQL error: " << e.what();
   } catch (std::exception& e) {
     LOG_ERROR << "getLastMessagePreview error: " << e.what();
@@ -1657,9 +1844,7 @@ uint64_t ChatServiceImpl::getUnreadCount(uint64_t userId,
     auto& redis = RedisManager::getInstance();
 
     // 未读计数键
-    std::string unreadKey = "unread:" + std::to_string(userId) + ":" +
-                            std::to_string(static_cast<int>(type)) + ":" +
-                            std::to_string(chatId);
+    auto unreadKey = RedisKeys::unread(userId, type, chatId);
 
     auto countStr = redis.get(unreadKey);
     if (countStr) {
@@ -1679,14 +1864,15 @@ void ChatServiceImpl::notifyChatRoomChanged(uint64_t chatRoomId) {
     auto& redis = RedisManager::getInstance();
 
     // 发布聊天室变更通知
-    std::string channel = "chat_room:changed:" + std::to_string(chatRoomId);
+    auto channel = RedisKeys::chatRoomChangedChannel(chatRoomId);
     redis.publish(channel, std::to_string(chatRoomId));
 
     // 使聊天室缓存失效，以便下次获取最新数据
     invalidateChatRoomCache(chatRoomId);
 
-    LOG_INFO << "Published chat room change notification for room ID: "
-             << chatRoomId;
+    MLOG_DEBUG(kLogModule)
+        << "Published chat room change notification for room ID: "
+        << chatRoomId;
   } catch (std::exception& e) {
     LOG_ERROR << "notifyChatRoomChanged error: " << e.what();
   }
@@ -1700,19 +1886,20 @@ void ChatServiceImpl::notifyMembershipChanged(uint64_t chatRoomId,
     auto& redis = RedisManager::getInstance();
 
     // 发布成员资格变更通知
-    std::string channel = "chat_room:membership:" + std::to_string(chatRoomId);
+    auto channel = RedisKeys::chatRoomMembershipChannel(chatRoomId);
     std::string message = std::to_string(userId) + ":" + (added ? "1" : "0");
     redis.publish(channel, message);
 
     // 个人通知
-    std::string userChannel = "user:chat_room:" + std::to_string(userId);
+    auto userChannel = RedisKeys::userChatRoomChannel(userId);
     std::string userMessage =
         std::to_string(chatRoomId) + ":" + (added ? "1" : "0");
     redis.publish(userChannel, userMessage);
 
-    LOG_INFO << "Published membership change notification: User " << userId
-             << (added ? " added to " : " removed from ") << "chat room "
-             << chatRoomId;
+    MLOG_DEBUG(kLogModule) << "Published membership change notification: User "
+                           << userId
+                           << (added ? " added to " : " removed from ")
+                           << "chat room " << chatRoomId;
   } catch (std::exception& e) {
     LOG_ERROR << "notifyMembershipChanged error: " << e.what();
   }
@@ -1727,16 +1914,17 @@ void ChatServiceImpl::notifyPrivateChatCreated(uint64_t privateChatId,
 
     // 通知两个用户
     for (uint64_t userId : {user1Id, user2Id}) {
-      std::string channel = "user:private_chat:" + std::to_string(userId);
+      auto channel = RedisKeys::userPrivateChatChannel(userId);
       redis.publish(channel, std::to_string(privateChatId));
 
       // 使用户的聊天列表缓存失效
       invalidateUserChatsListCache(userId);
     }
 
-    LOG_INFO << "Published private chat creation notification: Chat "
-             << privateChatId << " between users " << user1Id << " and "
-             << user2Id;
+    MLOG_DEBUG(kLogModule)
+        << "Published private chat creation notification: Chat "
+        << privateChatId << " between users " << user1Id
+        << " and " << user2Id;
   } catch (std::exception& e) {
     LOG_ERROR << "notifyPrivateChatCreated error: " << e.what();
   }
@@ -1746,7 +1934,7 @@ void ChatServiceImpl::notifyPrivateChatCreated(uint64_t privateChatId,
 bool ChatServiceImpl::validateSession(const std::string& token,
                                       uint64_t userId) {
   auto& redis = RedisManager::getInstance();
-  auto sessionUserId = redis.get("session:" + token);
+  auto sessionUserId = redis.get(RedisKeys::session(token));
 
   if (!sessionUserId) {
     return false;
@@ -1761,7 +1949,7 @@ bool ChatServiceImpl::validateSession(const std::string& token,
 void ChatServiceImpl::cacheChatRoom(const ChatRoom& chatRoom) {
   try {
     auto& redis = RedisManager::getInstance();
-    std::string key = "chat_room:" + std::to_string(chatRoom.getId());
+    auto key = RedisKeys::chatRoom(chatRoom.getId());
 
     // 序列化聊天室信息
     std::string data = serializeChatRoom(chatRoom);
@@ -1769,7 +1957,7 @@ void ChatServiceImpl::cacheChatRoom(const ChatRoom& chatRoom) {
     // 存储聊天室信息
     redis.set(key, data, std::chrono::hours(24));
 
-    LOG_INFO << "Cached chat room: " << chatRoom.getId();
+    MLOG_DEBUG(kLogModule) << "Cached chat room: " << chatRoom.getId();
   } catch (std::exception& e) {
     LOG_ERROR << "cacheChatRoom error: " << e.what();
   }
@@ -1780,7 +1968,7 @@ std::optional<ChatRoom> ChatServiceImpl::getChatRoomFromCache(
     uint64_t chatRoomId) {
   try {
     auto& redis = RedisManager::getInstance();
-    std::string key = "chat_room:" + std::to_string(chatRoomId);
+    auto key = RedisKeys::chatRoom(chatRoomId);
 
     auto data = redis.get(key);
     if (!data) {
@@ -1806,12 +1994,12 @@ void ChatServiceImpl::invalidateChatRoomCache(uint64_t chatRoomId) {
     auto& redis = RedisManager::getInstance();
 
     // 删除聊天室缓存
-    redis.del("chat_room:" + std::to_string(chatRoomId));
+    redis.del(RedisKeys::chatRoom(chatRoomId));
 
     // 删除成员列表缓存
-    redis.del("chat_room:" + std::to_string(chatRoomId) + ":members");
+    redis.del(RedisKeys::chatRoomMembers(chatRoomId));
 
-    LOG_INFO << "Invalidated cache for chat room: " << chatRoomId;
+    MLOG_DEBUG(kLogModule) << "Invalidated cache for chat room: " << chatRoomId;
   } catch (std::exception& e) {
     LOG_ERROR << "invalidateChatRoomCache error: " << e.what();
   }
@@ -1826,14 +2014,12 @@ void ChatServiceImpl::cacheChatRoomMember(const ChatRoomMember& member) {
     uint64_t userId = member.getUserId();
 
     // 缓存成员详细信息
-    std::string memberKey = "chat_room:" + std::to_string(chatRoomId) +
-                            ":member:" + std::to_string(userId);
+    auto memberKey = RedisKeys::chatRoomMember(chatRoomId, userId);
     std::string data = serializeChatRoomMember(member);
     redis.set(memberKey, data, std::chrono::hours(24));
 
     // 添加到成员列表
-    std::string membersKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto membersKey = RedisKeys::chatRoomMembers(chatRoomId);
     redis.sadd(membersKey, std::to_string(userId));
     redis.expire(membersKey, std::chrono::hours(24));
 
@@ -1841,8 +2027,8 @@ void ChatServiceImpl::cacheChatRoomMember(const ChatRoomMember& member) {
     redis.hset(memberKey, "role",
                std::to_string(static_cast<int>(member.getRole())));
 
-    LOG_INFO << "Cached chat room member: Room " << chatRoomId << ", User "
-             << userId;
+    MLOG_DEBUG(kLogModule) << "Cached chat room member: Room " << chatRoomId
+                           << ", User " << userId;
   } catch (std::exception& e) {
     LOG_ERROR << "cacheChatRoomMember error: " << e.what();
   }
@@ -1857,35 +2043,38 @@ std::vector<ChatRoomMember> ChatServiceImpl::getChatRoomMembersFromCache(
     auto& redis = RedisManager::getInstance();
 
     // 获取成员ID列表
-    std::string membersKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto membersKey = RedisKeys::chatRoomMembers(chatRoomId);
     auto memberIds = redis.smembers(membersKey);
 
     if (!memberIds || memberIds->empty()) {
       return members;
     }
 
+    // 解析用的临时对象分配在 arena 上并在循环中复用，
+    // 函数返回时整体释放，避免每个成员一次堆分配
+    google::protobuf::Arena arena;
+    auto* proto =
+        google::protobuf::Arena::CreateMessage<starrychat::ChatRoomMember>(
+            &arena);
+
     // 获取每个成员的详细信息
+    members.reserve(memberIds->size());
     for (const auto& idStr : *memberIds) {
       // 获取成员数据
-      std::string memberKey =
-          "chat_room:" + std::to_string(chatRoomId) + ":member:" + idStr;
+      auto memberKey = RedisKeys::chatRoomMember(chatRoomId, idStr);
 
       auto data = redis.get(memberKey);
-      if (data) {
-        starrychat::ChatRoomMember proto;
-        if (proto.ParseFromString(*data)) {
-          // 创建新的成员，避免复制
-          members.push_back(ChatRoomMember::fromProto(proto));
-        }
+      if (data && proto->ParseFromString(*data)) {
+        members.push_back(ChatRoomMember::fromProto(*proto));
       }
     }
 
     // 刷新缓存过期时间
     redis.expire(membersKey, std::chrono::hours(24));
 
-    LOG_INFO << "Retrieved " << members.size()
-             << " members from cache for chat room " << chatRoomId;
+    MLOG_DEBUG(kLogModule) << "Retrieved " << members.size()
+                           << " members from cache for chat room "
+                           << chatRoomId;
   } catch (std::exception& e) {
     LOG_ERROR << "getChatRoomMembersFromCache error: " << e.what();
   }
@@ -1901,19 +2090,17 @@ void ChatServiceImpl::addChatRoomMemberToCache(uint64_t chatRoomId,
     auto& redis = RedisManager::getInstance();
 
     // 添加到成员列表
-    std::string membersKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto membersKey = RedisKeys::chatRoomMembers(chatRoomId);
     redis.sadd(membersKey, std::to_string(userId));
     redis.expire(membersKey, std::chrono::hours(24));
 
     // 缓存成员角色
-    std::string memberKey = "chat_room:" + std::to_string(chatRoomId) +
-                            ":member:" + std::to_string(userId);
+    auto memberKey = RedisKeys::chatRoomMember(chatRoomId, userId);
     redis.hset(memberKey, "role", std::to_string(static_cast<int>(role)));
     redis.expire(memberKey, std::chrono::hours(24));
 
-    LOG_INFO << "Added member to cache: Room " << chatRoomId << ", User "
-             << userId;
+    MLOG_DEBUG(kLogModule) << "Added member to cache: Room " << chatRoomId
+                           << ", User " << userId;
   } catch (std::exception& e) {
     LOG_ERROR << "addChatRoomMemberToCache error: " << e.what();
   }
@@ -1926,17 +2113,15 @@ void ChatServiceImpl::removeChatRoomMemberFromCache(uint64_t chatRoomId,
     auto& redis = RedisManager::getInstance();
 
     // 从成员列表中移除
-    std::string membersKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto membersKey = RedisKeys::chatRoomMembers(chatRoomId);
     redis.srem(membersKey, std::to_string(userId));
 
     // 删除成员详细信息
-    std::string memberKey = "chat_room:" + std::to_string(chatRoomId) +
-                            ":member:" + std::to_string(userId);
+    auto memberKey = RedisKeys::chatRoomMember(chatRoomId, userId);
     redis.del(memberKey);
 
-    LOG_INFO << "Removed member from cache: Room " << chatRoomId << ", User "
-             << userId;
+    MLOG_DEBUG(kLogModule) << "Removed member from cache: Room " << chatRoomId
+                           << ", User " << userId;
   } catch (std::exception& e) {
     LOG_ERROR << "removeChatRoomMemberFromCache error: " << e.what();
   }
@@ -1949,19 +2134,18 @@ void ChatServiceImpl::updateChatRoomMembersInCache(uint64_t chatRoomId) {
     auto& redis = RedisManager::getInstance();
 
     // 获取所有成员
-    std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-        "SELECT m.*, u.nickname FROM chat_room_members m "
-        "JOIN users u ON m.user_id = u.id "
-        "WHERE m.chat_room_id = ?"));
+    TimedStatement stmt(conn,
+                        "SELECT m.*, u.nickname FROM chat_room_members m "
+                        "JOIN users u ON m.user_id = u.id "
+                        "WHERE m.chat_room_id = ?");
     stmt->setUInt64(1, chatRoomId);
 
     // 清除现有成员缓存
-    std::string membersKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto membersKey = RedisKeys::chatRoomMembers(chatRoomId);
     redis.del(membersKey);
 
     // 获取并缓存成员
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     while (rs->next()) {
       uint64_t userId = rs->getUInt64("user_id");
       MemberRole role = static_cast<MemberRole>(rs->getInt("role"));
@@ -1983,7 +2167,8 @@ void ChatServiceImpl::updateChatRoomMembersInCache(uint64_t chatRoomId) {
       cacheChatRoomMember(member);
     }
 
-    LOG_INFO << "Updated members cache for chat room " << chatRoomId;
+    MLOG_DEBUG(kLogModule) << "Updated members cache for chat room "
+                           << chatRoomId;
   } catch (std::exception& e) {
     LOG_ERROR << "updateChatRoomMembersInCache error: " << e.what();
   }
@@ -1998,8 +2183,7 @@ std::vector<uint64_t> ChatServiceImpl::getChatRoomMemberIdsFromCache(
     auto& redis = RedisManager::getInstance();
 
     // 获取成员ID列表
-    std::string membersKey =
-        "chat_room:" + std::to_string(chatRoomId) + ":members";
+    auto membersKey = RedisKeys::chatRoomMembers(chatRoomId);
     auto members = redis.smembers(membersKey);
 
     if (members && !members->empty()) {
@@ -2011,8 +2195,9 @@ std::vector<uint64_t> ChatServiceImpl::getChatRoomMemberIdsFromCache(
       redis.expire(membersKey, std::chrono::hours(24));
     }
 
-    LOG_INFO << "Retrieved " << memberIds.size()
-             << " member IDs from cache for chat room " << chatRoomId;
+    MLOG_DEBUG(kLogModule) << "Retrieved " << memberIds.size()
+                           << " member IDs from cache for chat room "
+                           << chatRoomId;
   } catch (std::exception& e) {
     LOG_ERROR << "getChatRoomMemberIdsFromCache error: " << e.what();
   }
@@ -2030,24 +2215,22 @@ void ChatServiceImpl::cachePrivateChat(
     std::string data = serializePrivateChat(privateChat);
 
     // 存储私聊信息
-    std::string key = "private_chat:" + std::to_string(privateChat.id());
+    auto key = RedisKeys::privateChat(privateChat.id());
     redis.set(key, data, std::chrono::hours(24));
 
     // 缓存用户ID映射
-    std::string userMapKey =
-        "private_chat:users:" + std::to_string(privateChat.user1_id()) + ":" +
-        std::to_string(privateChat.user2_id());
+    auto userMapKey = RedisKeys::privateChatUsers(privateChat.user1_id(),
+                                                  privateChat.user2_id());
     redis.set(userMapKey, std::to_string(privateChat.id()),
               std::chrono::hours(24));
 
     // 缓存成员关系
-    std::string membersKey =
-        "private_chat:" + std::to_string(privateChat.id()) + ":members";
+    auto membersKey = RedisKeys::privateChatMembers(privateChat.id());
     redis.sadd(membersKey, std::to_string(privateChat.user1_id()));
     redis.sadd(membersKey, std::to_string(privateChat.user2_id()));
     redis.expire(membersKey, std::chrono::hours(24));
 
-    LOG_INFO << "Cached private chat: " << privateChat.id();
+    MLOG_DEBUG(kLogModule) << "Cached private chat: " << privateChat.id();
   } catch (std::exception& e) {
     LOG_ERROR << "cachePrivateChat error: " << e.what();
   }
@@ -2058,7 +2241,7 @@ std::optional<starrychat::PrivateChat> ChatServiceImpl::getPrivateChatFromCache(
     uint64_t privateChatId) {
   try {
     auto& redis = RedisManager::getInstance();
-    std::string key = "private_chat:" + std::to_string(privateChatId);
+    auto key = RedisKeys::privateChat(privateChatId);
 
     auto data = redis.get(key);
     if (!data) {
@@ -2086,19 +2269,19 @@ void ChatServiceImpl::invalidatePrivateChatCache(uint64_t privateChatId) {
     // 获取私聊信息以便删除用户映射
     auto cachedChat = getPrivateChatFromCache(privateChatId);
     if (cachedChat) {
-      std::string userMapKey =
-          "private_chat:users:" + std::to_string(cachedChat->user1_id()) + ":" +
-          std::to_string(cachedChat->user2_id());
+      auto userMapKey = RedisKeys::privateChatUsers(cachedChat->user1_id(),
+                                                    cachedChat->user2_id());
       redis.del(userMapKey);
     }
 
     // 删除私聊缓存
-    redis.del("private_chat:" + std::to_string(privateChatId));
+    redis.del(RedisKeys::privateChat(privateChatId));
 
     // 删除成员列表缓存
-    redis.del("private_chat:" + std::to_string(privateChatId) + ":members");
+    redis.del(RedisKeys::privateChatMembers(privateChatId));
 
-    LOG_INFO << "Invalidated cache for private chat: " << privateChatId;
+    MLOG_DEBUG(kLogModule) << "Invalidated cache for private chat: "
+                           << privateChatId;
   } catch (std::exception& e) {
     LOG_ERROR << "invalidatePrivateChatCache error: " << e.what();
   }
@@ -2107,64 +2290,54 @@ void ChatServiceImpl::invalidatePrivateChatCache(uint64_t privateChatId) {
 // 缓存用户聊天列表
 void ChatServiceImpl::cacheUserChatsList(
     uint64_t userId,
-    const std::vector<starrychat::ChatSummary>& chats) {
+    const starrychat::GetUserChatsResponse& response) {
   try {
     auto& redis = RedisManager::getInstance();
-    std::string key = "user:chats:" + std::to_string(userId);
+    auto key = RedisKeys::userChats(userId);
 
     // 序列化聊天列表
     std::string data;
-    starrychat::GetUserChatsResponse response;
-    response.set_success(true);
-
-    for (const auto& chat : chats) {
-      *response.add_chats() = chat;
-    }
-
     if (response.SerializeToString(&data)) {
       // 存储聊天列表
       redis.set(key, data,
                 std::chrono::minutes(
                     30));  // 使用较短的过期时间，因为聊天列表会频繁变化
-      LOG_INFO << "Cached user chats list for user " << userId << " with "
-               << chats.size() << " chats";
+      MLOG_DEBUG(kLogModule) << "Cached user chats list for user " << userId
+                             << " with " << response.chats_size()
+                             << " chats";
     }
   } catch (std::exception& e) {
     LOG_ERROR << "cacheUserChatsList error: " << e.what();
   }
 }
 
-// 从缓存获取用户聊天列表
-std::optional<std::vector<starrychat::ChatSummary>>
-ChatServiceImpl::getUserChatsListFromCache(uint64_t userId) {
+// 从缓存获取用户聊天列表，直接解析到响应中
+bool ChatServiceImpl::getUserChatsListFromCache(
+    uint64_t userId,
+    starrychat::GetUserChatsResponse* response) {
   try {
     auto& redis = RedisManager::getInstance();
-    std::string key = "user:chats:" + std::to_string(userId);
+    auto key = RedisKeys::userChats(userId);
 
     auto data = redis.get(key);
     if (!data) {
-      return std::nullopt;
+      return false;
     }
 
     // 反序列化聊天列表
-    starrychat::GetUserChatsResponse response;
-    if (!response.ParseFromString(*data)) {
-      return std::nullopt;
+    if (!response->ParseFromString(*data)) {
+      response->Clear();
+      return false;
     }
 
     // 刷新缓存过期时间
     redis.expire(key, std::chrono::minutes(30));
 
-    // 转换为 vector
-    std::vector<starrychat::ChatSummary> result;
-    for (int i = 0; i < response.chats_size(); i++) {
-      result.push_back(response.chats(i));
-    }
-
-    return result;
+    return true;
   } catch (std::exception& e) {
     LOG_ERROR << "getUserChatsListFromCache error: " << e.what();
-    return std::nullopt;
+    response->Clear();
+    return false;
   }
 }
 
@@ -2172,9 +2345,10 @@ ChatServiceImpl::getUserChatsListFromCache(uint64_t userId) {
 void ChatServiceImpl::invalidateUserChatsListCache(uint64_t userId) {
   try {
     auto& redis = RedisManager::getInstance();
-    std::string key = "user:chats:" + std::to_string(userId);
+    auto key = RedisKeys::userChats(userId);
     redis.del(key);
-    LOG_INFO << "Invalidated chats list cache for user " << userId;
+    MLOG_DEBUG(kLogModule) << "Invalidated chats list cache for user "
+                           << userId;
   } catch (std::exception& e) {
     LOG_ERROR << "invalidateUserChatsListCache error: " << e.what();
   }
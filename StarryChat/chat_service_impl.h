@@ -149,9 +149,10 @@ class ChatServiceImpl : public starrychat::ChatService {
 
   // 用户聊天列表缓存
   void cacheUserChatsList(uint64_t userId,
-                          const std::vector<starrychat::ChatSummary>& chats);
-  std::optional<std::vector<starrychat::ChatSummary>> getUserChatsListFromCache(
-      uint64_t userId);
+                          const starrychat::GetUserChatsResponse& response);
+  // 直接解析到响应对象，未命中返回 false
+  bool getUserChatsListFromCache(uint64_t userId,
+                                 starrychat::GetUserChatsResponse* response);
   void invalidateUserChatsListCache(uint64_t userId);
 
   // 序列化/反序列化辅助方法
@@ -0,0 +1,190 @@
+#include "circuit_breaker.h"
+
+#include <algorithm>
+#include "logging.h"
+
+namespace StarryChat {
+
+namespace {
+
+const char* stateName(CircuitBreaker::State state) {
+  switch (state) {
+    case CircuitBreaker::State::kClosed:
+      return "closed";
+    case CircuitBreaker::State::kOpen:
+      return "open";
+    case CircuitBreaker::State::kHalfOpen:
+      return "half-open";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+CircuitBreaker::CircuitBreaker(const std::string& backend)
+    : backend_(backend),
+      stateGauge_(MetricsRegistry::getInstance().gauge(
+          "starrychat_circuit_state",
+          "Circuit breaker state (0 closed, 1 open, 2 half-open)",
+          {{"backend", backend}})),
+      rejected_(MetricsRegistry::getInstance().counter(
+          "starrychat_circuit_rejected_total",
+          "Calls rejected by an open circuit breaker",
+          {{"backend", backend}})) {}
+
+int64_t CircuitBreaker::nowSeconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+void CircuitBreaker::configure(const CircuitBreakerOptions& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+  options_.windowSeconds =
+      std::clamp(options_.windowSeconds, 1, kMaxWindowSeconds);
+  for (auto& bucket : buckets_) {
+    bucket.second.store(-1, std::memory_order_relaxed);
+  }
+  state_.store(State::kClosed, std::memory_order_release);
+  stateGauge_.set(static_cast<int64_t>(State::kClosed));
+}
+
+bool CircuitBreaker::allow() {
+  State current = state();
+  if (current == State::kClosed) {
+    return true;
+  }
+
+  if (current == State::kOpen) {
+    if (nowSeconds() - openedAt_.load(std::memory_order_relaxed) <
+        options_.openSeconds) {
+      rejected_.inc();
+      return false;
+    }
+    transition(State::kHalfOpen);
+  }
+
+  // 半开状态只放行有限的探测调用
+  if (probesIssued_.fetch_add(1, std::memory_order_relaxed) <
+      options_.halfOpenProbes) {
+    return true;
+  }
+
+  // 探测调用迟迟没有结果（如放行后调用方并未真正访问后端），重新放行一轮
+  int64_t since = openedAt_.load(std::memory_order_relaxed);
+  if (nowSeconds() - since >= options_.openSeconds &&
+      openedAt_.compare_exchange_strong(since, nowSeconds(),
+                                        std::memory_order_relaxed)) {
+    probesIssued_.store(1, std::memory_order_relaxed);
+    return true;
+  }
+  rejected_.inc();
+  return false;
+}
+
+void CircuitBreaker::recordSuccess(std::chrono::microseconds latency) {
+  bool slow = latency >= std::chrono::milliseconds(options_.slowCallMs);
+  if (state() == State::kHalfOpen) {
+    if (slow) {
+      transition(State::kOpen);
+    } else if (probesSucceeded_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+               options_.halfOpenProbes) {
+      transition(State::kClosed);
+    }
+    return;
+  }
+  record(false, slow);
+}
+
+void CircuitBreaker::recordFailure() {
+  if (state() == State::kHalfOpen) {
+    transition(State::kOpen);
+    return;
+  }
+  record(true, false);
+}
+
+CircuitBreaker::Bucket& CircuitBreaker::currentBucket() {
+  int64_t now = nowSeconds();
+  auto& bucket = buckets_[now % options_.windowSeconds];
+
+  // 桶属于更早的秒时清零；并发清零时可能丢失少量计数，可以接受
+  int64_t second = bucket.second.load(std::memory_order_relaxed);
+  if (second != now &&
+      bucket.second.compare_exchange_strong(second, now,
+                                            std::memory_order_relaxed)) {
+    bucket.calls.store(0, std::memory_order_relaxed);
+    bucket.failures.store(0, std::memory_order_relaxed);
+    bucket.slow.store(0, std::memory_order_relaxed);
+  }
+  return bucket;
+}
+
+void CircuitBreaker::record(bool failed, bool slow) {
+  auto& bucket = currentBucket();
+  bucket.calls.fetch_add(1, std::memory_order_relaxed);
+  if (failed) {
+    bucket.failures.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (slow) {
+    bucket.slow.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (failed || slow) {
+    evaluate();
+  }
+}
+
+void CircuitBreaker::evaluate() {
+  int64_t now = nowSeconds();
+  uint64_t calls = 0;
+  uint64_t failures = 0;
+  uint64_t slow = 0;
+
+  for (int i = 0; i < options_.windowSeconds; ++i) {
+    const auto& bucket = buckets_[i];
+    if (now - bucket.second.load(std::memory_order_relaxed) >=
+        options_.windowSeconds) {
+      continue;
+    }
+    calls += bucket.calls.load(std::memory_order_relaxed);
+    failures += bucket.failures.load(std::memory_order_relaxed);
+    slow += bucket.slow.load(std::memory_order_relaxed);
+  }
+
+  if (calls < static_cast<uint64_t>(options_.minCalls)) {
+    return;
+  }
+  if (failures >= options_.failureRate * calls ||
+      slow >= options_.slowCallRate * calls) {
+    transition(State::kOpen);
+  }
+}
+
+void CircuitBreaker::transition(State to) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  State from = state();
+  if (from == to) {
+    return;
+  }
+
+  if (to == State::kOpen) {
+    openedAt_.store(nowSeconds(), std::memory_order_relaxed);
+  } else if (to == State::kHalfOpen) {
+    openedAt_.store(nowSeconds(), std::memory_order_relaxed);
+    probesIssued_.store(0, std::memory_order_relaxed);
+    probesSucceeded_.store(0, std::memory_order_relaxed);
+  } else {
+    for (auto& bucket : buckets_) {
+      bucket.second.store(-1, std::memory_order_relaxed);
+    }
+  }
+
+  state_.store(to, std::memory_order_release);
+  stateGauge_.set(static_cast<int64_t>(to));
+  LOG_WARN << "Circuit breaker for " << backend_ << " " << stateName(from)
+           << " -> " << stateName(to);
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include "common.pb.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+struct CircuitBreakerOptions {
+  int windowSeconds{10};     // 统计窗口（秒）
+  int minCalls{20};          // 窗口内调用数达到后才判断
+  double failureRate{0.5};   // 失败比例达到后熔断
+  int slowCallMs{1000};      // 超过该耗时的调用计为慢调用
+  double slowCallRate{0.8};  // 慢调用比例达到后熔断
+  int openSeconds{5};        // 熔断持续时间，之后进入半开
+  int halfOpenProbes{3};     // 半开状态放行的探测调用数
+};
+
+/**
+ * 熔断器
+ * 关闭状态下按秒分桶统计调用数、失败数和慢调用数，窗口内任一比例超过阈值
+ * 即打开；打开状态直接拒绝调用，openSeconds 后进入半开，放行 halfOpenProbes
+ * 个探测调用，全部成功则关闭，任一失败或变慢则重新打开。
+ * 分桶计数为无锁更新，只有状态切换加锁。
+ */
+class CircuitBreaker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class State { kClosed = 0, kOpen = 1, kHalfOpen = 2 };
+
+  static constexpr int kMaxWindowSeconds = 60;
+
+  explicit CircuitBreaker(const std::string& backend);
+
+  CircuitBreaker(const CircuitBreaker&) = delete;
+  CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+  /**
+   * 更新参数并回到关闭状态，应在开始处理请求之前调用
+   */
+  void configure(const CircuitBreakerOptions& options);
+
+  /**
+   * 是否允许本次调用，打开状态或半开探测名额用完时返回 false
+   */
+  bool allow();
+
+  void recordSuccess(std::chrono::microseconds latency);
+  void recordFailure();
+
+  State state() const { return state_.load(std::memory_order_acquire); }
+  bool isOpen() const { return state() == State::kOpen; }
+
+ private:
+  struct alignas(64) Bucket {
+    std::atomic<int64_t> second{-1};
+    std::atomic<uint32_t> calls{0};
+    std::atomic<uint32_t> failures{0};
+    std::atomic<uint32_t> slow{0};
+  };
+
+  static int64_t nowSeconds();
+
+  void record(bool failed, bool slow);
+  Bucket& currentBucket();
+  void evaluate();
+  void transition(State to);
+
+  std::string backend_;
+  CircuitBreakerOptions options_;
+
+  std::atomic<State> state_{State::kClosed};
+  std::atomic<int64_t> openedAt_{0};  // 进入当前状态的时间，steady_clock 秒
+  std::atomic<int> probesIssued_{0};
+  std::atomic<int> probesSucceeded_{0};
+
+  std::array<Bucket, kMaxWindowSeconds> buckets_;
+  std::mutex mutex_;  // 保护状态切换
+
+  Gauge& stateGauge_;
+  Counter& rejected_;
+};
+
+/**
+ * 一次后端调用
+ * 析构时记录延迟，并把结果反馈给熔断器；调用方在异常分支调用 fail。
+ */
+class BackendCall {
+ public:
+  BackendCall(CircuitBreaker& breaker, Histogram& latency)
+      : breaker_(breaker), latency_(latency), start_(Clock::now()) {}
+
+  ~BackendCall() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start_);
+    latency_.record(elapsed.count());
+    if (failed_) {
+      breaker_.recordFailure();
+    } else {
+      breaker_.recordSuccess(elapsed);
+    }
+  }
+
+  BackendCall(const BackendCall&) = delete;
+  BackendCall& operator=(const BackendCall&) = delete;
+
+  void fail() { failed_ = true; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  CircuitBreaker& breaker_;
+  Histogram& latency_;
+  Clock::time_point start_;
+  bool failed_{false};
+};
+
+/**
+ * 后端已熔断，调用被拒绝
+ */
+class BackendUnavailable : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * 将响应标记为后端不可用
+ * 响应中没有的字段跳过，与 replyError 一致
+ */
+template <typename Response>
+void setUnavailable(Response* response) {
+  if constexpr (requires { response->set_success(false); }) {
+    response->set_success(false);
+  }
+  if constexpr (requires { response->set_error_message(""); }) {
+    response->set_error_message("Service temporarily unavailable");
+  }
+  if constexpr (requires {
+                  response->set_error_code(starrychat::ERROR_CODE_UNAVAILABLE);
+                }) {
+    response->set_error_code(starrychat::ERROR_CODE_UNAVAILABLE);
+  }
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,182 @@
+#include "cluster_membership.h"
+
+#include <algorithm>
+#include <vector>
+#include "logging.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+
+namespace StarryChat {
+
+ClusterMembership& ClusterMembership::getInstance() {
+  static ClusterMembership instance;
+  return instance;
+}
+
+ClusterMembership::ClusterMembership()
+    : nodes_(MetricsRegistry::getInstance().gauge(
+          "starrychat_cluster_nodes",
+          "Nodes in this node's view of the cluster")),
+      changes_(MetricsRegistry::getInstance().counter(
+          "starrychat_cluster_membership_changes_total",
+          "Times the cluster membership changed and rooms were rebalanced")) {}
+
+ClusterMembership::~ClusterMembership() {
+  stop();
+}
+
+void ClusterMembership::configure(const ClusterOptions& options) {
+  options_ = options;
+}
+
+void ClusterMembership::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+
+  // 先登记再读取，保证本节点出现在第一份成员列表中
+  renew();
+  refresh();
+
+  thread_ = std::thread([this] { run(); });
+  LOG_INFO << "Cluster membership started for node " << options_.nodeId
+           << " at " << options_.address;
+}
+
+void ClusterMembership::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  wake_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  auto& redis = RedisManager::getInstance();
+  redis.del(RedisKeys::clusterNode(options_.nodeId));
+  redis.srem(RedisKeys::kClusterNodes, options_.nodeId);
+  LOG_INFO << "Node " << options_.nodeId << " left the cluster";
+}
+
+void ClusterMembership::run() {
+  auto interval = std::max<std::chrono::seconds>(options_.lease / 3,
+                                                 std::chrono::seconds(1));
+  while (running_) {
+    {
+      std::unique_lock<std::mutex> lock(wakeMutex_);
+      wake_.wait_for(lock, interval, [this] { return !running_; });
+    }
+    if (!running_) {
+      break;
+    }
+
+    renew();
+    refresh();
+  }
+}
+
+void ClusterMembership::renew() {
+  auto& redis = RedisManager::getInstance();
+  redis.hsetWithExpire(RedisKeys::clusterNode(options_.nodeId),
+                       {{"address", options_.address}}, options_.lease);
+  redis.sadd(RedisKeys::kClusterNodes, options_.nodeId);
+}
+
+void ClusterMembership::refresh() {
+  auto& redis = RedisManager::getInstance();
+
+  // Redis 不可用时保留当前视图，不因读取失败而换主
+  auto members = redis.smembers(RedisKeys::kClusterNodes);
+  if (!members) {
+    return;
+  }
+  std::vector<std::string> ids(members->begin(), members->end());
+  std::vector<std::string> keys;
+  keys.reserve(ids.size());
+  for (const auto& id : ids) {
+    keys.push_back(RedisKeys::clusterNode(id).str());
+  }
+  auto leases = redis.hgetallBatch(keys);
+  if (!leases) {
+    return;
+  }
+
+  std::vector<std::string> alive;
+  std::unordered_map<std::string, std::string> addresses;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    auto it = (*leases)[i].find("address");
+    if (it == (*leases)[i].end()) {
+      // 租约已过期，节点宕机或失联
+      redis.srem(RedisKeys::kClusterNodes, ids[i]);
+      continue;
+    }
+    alive.push_back(ids[i]);
+    addresses[ids[i]] = it->second;
+  }
+  if (!addresses.count(options_.nodeId)) {
+    alive.push_back(options_.nodeId);
+    addresses[options_.nodeId] = options_.address;
+  }
+
+  auto ring = std::make_shared<const HashRing>(std::move(alive),
+                                               options_.virtualNodes);
+  ChangeListener listener;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    addresses_ = std::move(addresses);
+    if (ring_ && ring_->nodes() == ring->nodes()) {
+      return;
+    }
+    ring_ = ring;
+    listener = listener_;
+  }
+
+  nodes_.set(static_cast<int64_t>(ring->nodes().size()));
+  changes_.inc();
+  LOG_INFO << "Cluster membership changed, " << ring->nodes().size()
+           << " nodes";
+  if (listener) {
+    listener(*ring);
+  }
+}
+
+std::optional<std::string> ClusterMembership::remoteOwner(
+    uint64_t chatRoomId) {
+  if (!running_) {
+    return std::nullopt;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::string* owner = ring_ ? ring_->owner(chatRoomId) : nullptr;
+  if (!owner || *owner == options_.nodeId) {
+    return std::nullopt;
+  }
+  return *owner;
+}
+
+bool ClusterMembership::ownsLocally(uint64_t chatRoomId) {
+  if (!running_) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::string* owner = ring_ ? ring_->owner(chatRoomId) : nullptr;
+  return owner && *owner == options_.nodeId;
+}
+
+std::optional<std::string> ClusterMembership::address(
+    const std::string& nodeId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = addresses_.find(nodeId);
+  if (it == addresses_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void ClusterMembership::setChangeListener(ChangeListener listener) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  listener_ = std::move(listener);
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "hash_ring.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+struct ClusterOptions {
+  std::string nodeId;
+  std::string address;  // 其他节点转发请求时连接的 host:port
+  std::chrono::seconds lease{10};
+  int virtualNodes{64};
+};
+
+/**
+ * 集群成员和聊天室归属
+ * 每个节点在 Redis 中登记带租约的 cluster:node:{id}，并加入 cluster:nodes；
+ * 后台线程每 lease / 3 续租一次并重新读取成员，租约过期的节点被移出集合。
+ * 成员列表变化时重建一致性哈希环并通知监听者，聊天室随之换主。
+ * 各节点的成员视图在一个续租周期内可能不一致，期间转发的请求由
+ * 收到的节点直接处理，不会再次转发。
+ */
+class ClusterMembership {
+ public:
+  // 成员变化后调用，在续租线程上执行
+  using ChangeListener = std::function<void(const HashRing& ring)>;
+
+  static ClusterMembership& getInstance();
+
+  ClusterMembership(const ClusterMembership&) = delete;
+  ClusterMembership& operator=(const ClusterMembership&) = delete;
+  ClusterMembership(ClusterMembership&&) = delete;
+  ClusterMembership& operator=(ClusterMembership&&) = delete;
+
+  void configure(const ClusterOptions& options);
+
+  /**
+   * 登记本节点并启动续租线程
+   */
+  void start();
+
+  /**
+   * 停止续租并注销本节点，其他节点在下一次刷新时接管其聊天室
+   */
+  void stop();
+
+  /**
+   * 聊天室属于其他节点时返回该节点ID；属于本节点或集群未启用时返回 nullopt
+   */
+  std::optional<std::string> remoteOwner(uint64_t chatRoomId);
+
+  /**
+   * 集群已启用且聊天室属于本节点
+   */
+  bool ownsLocally(uint64_t chatRoomId);
+
+  /**
+   * 节点登记的地址
+   */
+  std::optional<std::string> address(const std::string& nodeId);
+
+  void setChangeListener(ChangeListener listener);
+
+ private:
+  ClusterMembership();
+  ~ClusterMembership();
+
+  void run();
+  void renew();
+  void refresh();
+
+  ClusterOptions options_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+  std::mutex wakeMutex_;
+  std::condition_variable wake_;
+
+  std::mutex mutex_;  // 保护 ring_、addresses_ 和 listener_
+  std::shared_ptr<const HashRing> ring_;
+  std::unordered_map<std::string, std::string> addresses_;
+  ChangeListener listener_;
+
+  Gauge& nodes_;
+  Counter& changes_;
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,124 @@
+#include "cluster_peers.h"
+
+#include <unordered_set>
+#include "cluster_membership.h"
+#include "inet_address.h"
+#include "logging.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 解析 "host:port"，格式错误时返回 nullopt
+std::optional<starry::InetAddress> parseAddress(const std::string& address) {
+  auto colon = address.rfind(':');
+  if (colon == std::string::npos || colon == 0) {
+    return std::nullopt;
+  }
+  try {
+    int port = std::stoi(address.substr(colon + 1));
+    if (port <= 0 || port > 65535) {
+      return std::nullopt;
+    }
+    return starry::InetAddress(address.substr(0, colon),
+                               static_cast<uint16_t>(port));
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+}  // namespace
+
+ClusterPeers::Peer::Peer(starry::EventLoop* loop,
+                         const starry::InetAddress& address,
+                         const std::string& name)
+    : client(loop, address, name),
+      channel(std::make_shared<starry::RpcChannel>()),
+      stub(channel.get()) {
+  client.setConnectionCallback([this](const starry::TcpConnectionPtr& conn) {
+    if (conn->connected()) {
+      channel->setConnection(conn);
+      connected = true;
+    } else {
+      channel->setConnection(starry::TcpConnectionPtr());
+      connected = false;
+    }
+  });
+  client.setMessageCallback(
+      [this](const starry::TcpConnectionPtr& conn, starry::Buffer* buffer,
+             starry::Timestamp receiveTime) {
+        channel->onMessage(conn, buffer, receiveTime);
+      });
+  client.enableRetry();
+}
+
+ClusterPeers& ClusterPeers::getInstance() {
+  static ClusterPeers instance;
+  return instance;
+}
+
+ClusterPeers::ClusterPeers()
+    : forwarded_(MetricsRegistry::getInstance().counter(
+          "starrychat_cluster_forwarded_total",
+          "Requests forwarded to the owning node")),
+      failed_(MetricsRegistry::getInstance().counter(
+          "starrychat_cluster_forward_failures_total",
+          "Forwarded requests that got no reply before the deadline")),
+      unavailable_(MetricsRegistry::getInstance().counter(
+          "starrychat_cluster_peer_unavailable_total",
+          "Requests not forwarded because the owner was not connected")) {}
+
+void ClusterPeers::start(std::chrono::milliseconds timeout) {
+  if (loop_) {
+    return;
+  }
+  timeout_ = timeout;
+  loopThread_ = std::make_unique<starry::EventLoopThread>();
+  loop_ = loopThread_->startLoop();
+}
+
+std::shared_ptr<ClusterPeers::Peer> ClusterPeers::connectedPeer(
+    const std::string& nodeId) {
+  if (!loop_) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = peers_.find(nodeId);
+  if (it != peers_.end()) {
+    return it->second->connected ? it->second : nullptr;
+  }
+
+  auto address = ClusterMembership::getInstance().address(nodeId);
+  auto inetAddress = address ? parseAddress(*address) : std::nullopt;
+  if (!inetAddress) {
+    LOG_ERROR << "No valid address for cluster node " << nodeId;
+    return nullptr;
+  }
+
+  auto peer = std::make_shared<Peer>(loop_, *inetAddress,
+                                     "ClusterPeer-" + nodeId);
+  peer->client.connect();
+  peers_.emplace(nodeId, std::move(peer));
+  LOG_INFO << "Connecting to cluster node " << nodeId << " at " << *address;
+  return nullptr;
+}
+
+void ClusterPeers::retain(const std::vector<std::string>& nodes) {
+  std::unordered_set<std::string> alive(nodes.begin(), nodes.end());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = peers_.begin(); it != peers_.end();) {
+    if (alive.count(it->first)) {
+      ++it;
+      continue;
+    }
+
+    // 连接在自己的 EventLoop 上断开和析构
+    auto peer = std::move(it->second);
+    it = peers_.erase(it);
+    loop_->runInLoop([peer] { peer->client.disconnect(); });
+  }
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "eventloop.h"
+#include "eventloop_thread.h"
+#include "message.pb.h"
+#include "metrics.h"
+#include "rpc_channel.h"
+#include "tcp_client.h"
+
+namespace StarryChat {
+
+/**
+ * 到其他节点的 RPC 连接，用于把请求转发给聊天室的所属节点
+ * 所有连接和超时定时器运行在同一个专用 EventLoop 线程上。
+ * 第一次转发到某个节点时才建立连接，连接尚未建立或已断开时
+ * forward 返回 false，调用方在本节点处理只读请求，发送则应答不可用。
+ */
+class ClusterPeers {
+ public:
+  template <typename Request, typename Response>
+  using StubMethod = void (starrychat::MessageService::Stub::*)(
+      const Request&,
+      const std::function<void(const std::shared_ptr<Response>&)>&);
+
+  static ClusterPeers& getInstance();
+
+  ClusterPeers(const ClusterPeers&) = delete;
+  ClusterPeers& operator=(const ClusterPeers&) = delete;
+  ClusterPeers(ClusterPeers&&) = delete;
+  ClusterPeers& operator=(ClusterPeers&&) = delete;
+
+  void start(std::chrono::milliseconds timeout);
+
+  // 转发的默认超时，请求带有截止时间时取两者中较小的一个
+  std::chrono::milliseconds timeout() const { return timeout_; }
+
+  /**
+   * 断开已离开集群的节点
+   */
+  void retain(const std::vector<std::string>& nodes);
+
+  /**
+   * 向节点发起一次调用，应答或 timeout 到期时调用 done，超时时参数为空
+   * 节点没有可用连接时返回 false，done 不会被调用
+   */
+  template <typename Request, typename Response>
+  bool forward(
+      const std::string& nodeId,
+      StubMethod<Request, Response> method,
+      const Request& request,
+      std::chrono::milliseconds timeout,
+      std::function<void(const std::shared_ptr<Response>&)> done);
+
+ private:
+  struct Peer {
+    Peer(starry::EventLoop* loop,
+         const starry::InetAddress& address,
+         const std::string& name);
+
+    starry::TcpClient client;
+    std::shared_ptr<starry::RpcChannel> channel;
+    starrychat::MessageService::Stub stub;
+    std::atomic<bool> connected{false};
+  };
+
+  ClusterPeers();
+  ~ClusterPeers() = default;
+
+  // 返回已连接的节点，没有连接时发起连接并返回 nullptr
+  std::shared_ptr<Peer> connectedPeer(const std::string& nodeId);
+
+  std::unique_ptr<starry::EventLoopThread> loopThread_;
+  starry::EventLoop* loop_{nullptr};
+  std::chrono::milliseconds timeout_{3000};
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Peer>> peers_;
+
+  Counter& forwarded_;
+  Counter& failed_;
+  Counter& unavailable_;
+};
+
+template <typename Request, typename Response>
+bool ClusterPeers::forward(
+    const std::string& nodeId,
+    StubMethod<Request, Response> method,
+    const Request& request,
+    std::chrono::milliseconds timeout,
+    std::function<void(const std::shared_ptr<Response>&)> done) {
+  auto peer = connectedPeer(nodeId);
+  if (!peer) {
+    unavailable_.inc();
+    return false;
+  }
+
+  // 应答和超时只有先到的一方生效
+  auto finished = std::make_shared<std::atomic<bool>>(false);
+  auto finish = [this, finished,
+                 done = std::move(done)](const std::shared_ptr<Response>& r) {
+    if (finished->exchange(true)) {
+      return;
+    }
+    if (!r) {
+      failed_.inc();
+    }
+    done(r);
+  };
+
+  loop_->runAfter(static_cast<double>(timeout.count()) / 1000,
+                  [finish] { finish(nullptr); });
+  (peer->stub.*method)(request, finish);
+  forwarded_.inc();
+  return true;
+}
+
+}  // namespace StarryChat
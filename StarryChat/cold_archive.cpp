@@ -0,0 +1,632 @@
+#include "cold_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <tuple>
+#include "logging.h"
+#include "varint.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 冷数据只写一次，用较高的压缩级别换更小的文件
+constexpr int kCompressionLevel = 9;
+
+struct CCtxDeleter {
+  void operator()(ZSTD_CCtx* ctx) const { ZSTD_freeCCtx(ctx); }
+};
+
+struct DCtxDeleter {
+  void operator()(ZSTD_DCtx* ctx) const { ZSTD_freeDCtx(ctx); }
+};
+
+ZSTD_CCtx* threadCCtx() {
+  thread_local std::unique_ptr<ZSTD_CCtx, CCtxDeleter> ctx(ZSTD_createCCtx());
+  return ctx.get();
+}
+
+ZSTD_DCtx* threadDCtx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, DCtxDeleter> ctx(ZSTD_createDCtx());
+  return ctx.get();
+}
+
+void putString(std::string& out, const std::optional<std::string>& value) {
+  if (!value) {
+    putVarint(out, 0);
+    return;
+  }
+  putVarint(out, value->size() + 1);
+  out += *value;
+}
+
+bool getString(const char*& p,
+               const char* end,
+               std::optional<std::string>* value) {
+  uint64_t length;
+  if (!getVarint(p, end, &length)) {
+    return false;
+  }
+  if (length == 0) {
+    value->reset();
+    return true;
+  }
+  if (length - 1 > static_cast<uint64_t>(end - p)) {
+    return false;
+  }
+  value->emplace(p, length - 1);
+  p += length - 1;
+  return true;
+}
+
+auto sortKey(const ArchivedMessage& message) {
+  return std::make_tuple(message.chatType, message.chatId, message.timestamp,
+                         message.id);
+}
+
+// 解压并按列解析一个数据块
+bool decodeBlock(const char* data,
+                 size_t size,
+                 const coldseg::BlockIndex& entry,
+                 std::vector<ArchivedMessage>* messages) {
+  unsigned long long rawSize = ZSTD_getFrameContentSize(data, size);
+  if (rawSize == ZSTD_CONTENTSIZE_ERROR ||
+      rawSize == ZSTD_CONTENTSIZE_UNKNOWN || rawSize > coldseg::kMaxBlockSize) {
+    return false;
+  }
+
+  thread_local std::string buffer;
+  buffer.resize(rawSize);
+  size_t decoded =
+      ZSTD_decompressDCtx(threadDCtx(), buffer.data(), rawSize, data, size);
+  if (ZSTD_isError(decoded) || decoded != rawSize) {
+    return false;
+  }
+
+  const char* p = buffer.data();
+  const char* end = p + decoded;
+  uint64_t count;
+  if (!getVarint(p, end, &count) || count != entry.count ||
+      count > coldseg::kBlockMessages) {
+    return false;
+  }
+
+  messages->assign(count, ArchivedMessage{});
+  uint64_t value;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (!getVarint(p, end, &value)) {
+      return false;
+    }
+    auto& message = (*messages)[i];
+    message.chatType = entry.chatType;
+    message.chatId = entry.chatId;
+    message.id = i == 0 ? value
+                        : (*messages)[i - 1].id +
+                              static_cast<uint64_t>(unzigzag(value));
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    if (!getVarint(p, end, &value)) {
+      return false;
+    }
+    (*messages)[i].timestamp =
+        i == 0 ? value : (*messages)[i - 1].timestamp + value;
+  }
+  for (auto& message : *messages) {
+    if (!getVarint(p, end, &message.senderId)) {
+      return false;
+    }
+  }
+  for (auto& message : *messages) {
+    if (!getVarint(p, end, &message.replyToId)) {
+      return false;
+    }
+  }
+  if (static_cast<uint64_t>(end - p) < count * 2) {
+    return false;
+  }
+  for (auto& message : *messages) {
+    message.type = static_cast<uint8_t>(*p++);
+  }
+  for (auto& message : *messages) {
+    message.status = static_cast<uint8_t>(*p++);
+  }
+  for (auto& message : *messages) {
+    if (!getString(p, end, &message.content)) {
+      return false;
+    }
+  }
+  for (auto& message : *messages) {
+    if (!getString(p, end, &message.systemCode)) {
+      return false;
+    }
+  }
+  return p == end;
+}
+
+}  // namespace
+
+ColdSegmentWriter::ColdSegmentWriter(std::string path)
+    : path_(std::move(path)) {
+  // 每个写出者独占自己的临时文件，不与其他节点或进程的导出互相覆盖
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp",
+                std::random_device{}(), std::random_device{}());
+  tmpPath_ = path_ + suffix;
+}
+
+ColdSegmentWriter::~ColdSegmentWriter() {
+  if (file_) {
+    std::fclose(file_);
+    std::remove(tmpPath_.c_str());
+  }
+}
+
+bool ColdSegmentWriter::open() {
+  std::error_code ec;
+  if (std::filesystem::exists(path_, ec)) {
+    LOG_ERROR << "Cold archive segment already exists: " << path_;
+    return false;
+  }
+
+  int fd = ::open(tmpPath_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                  0644);
+  file_ = fd >= 0 ? ::fdopen(fd, "wb") : nullptr;
+  if (!file_) {
+    LOG_ERROR << "Failed to create " << tmpPath_ << ": "
+              << std::strerror(errno);
+    if (fd >= 0) {
+      ::close(fd);
+      std::remove(tmpPath_.c_str());
+    }
+    return false;
+  }
+  return write(coldseg::kMagic, sizeof(coldseg::kMagic));
+}
+
+bool ColdSegmentWriter::append(const ArchivedMessage& message) {
+  if (!file_ || failed_) {
+    return false;
+  }
+  if (last_ && sortKey(message) < *last_) {
+    LOG_ERROR << "Cold archive segment rows out of order at message "
+              << message.id;
+    failed_ = true;
+    return false;
+  }
+  last_ = sortKey(message);
+
+  if (!block_.empty() && (block_.back().chatType != message.chatType ||
+                          block_.back().chatId != message.chatId)) {
+    if (!flushBlock()) {
+      return false;
+    }
+  }
+
+  block_.push_back(message);
+  minTimestamp_ = std::min(minTimestamp_, message.timestamp);
+  maxTimestamp_ = std::max(maxTimestamp_, message.timestamp);
+  ++messages_;
+
+  if (block_.size() >= coldseg::kBlockMessages) {
+    return flushBlock();
+  }
+  return true;
+}
+
+bool ColdSegmentWriter::flushBlock() {
+  if (block_.empty()) {
+    return true;
+  }
+
+  coldseg::BlockIndex entry{};
+  entry.chatType = block_.front().chatType;
+  entry.chatId = block_.front().chatId;
+  entry.minId = UINT64_MAX;
+  entry.minTimestamp = block_.front().timestamp;
+  entry.maxTimestamp = block_.back().timestamp;
+  entry.count = static_cast<uint32_t>(block_.size());
+  entry.offset = offset_;
+
+  std::string raw;
+  putVarint(raw, block_.size());
+  for (size_t i = 0; i < block_.size(); ++i) {
+    const auto& message = block_[i];
+    entry.minId = std::min(entry.minId, message.id);
+    entry.maxId = std::max(entry.maxId, message.id);
+    putVarint(raw, i == 0 ? message.id
+                          : zigzag(static_cast<int64_t>(message.id -
+                                                        block_[i - 1].id)));
+  }
+  for (size_t i = 0; i < block_.size(); ++i) {
+    putVarint(raw, i == 0 ? block_[i].timestamp
+                          : block_[i].timestamp - block_[i - 1].timestamp);
+  }
+  for (const auto& message : block_) {
+    putVarint(raw, message.senderId);
+  }
+  for (const auto& message : block_) {
+    putVarint(raw, message.replyToId);
+  }
+  for (const auto& message : block_) {
+    raw.push_back(static_cast<char>(message.type));
+  }
+  for (const auto& message : block_) {
+    raw.push_back(static_cast<char>(message.status));
+  }
+  for (const auto& message : block_) {
+    putString(raw, message.content);
+  }
+  for (const auto& message : block_) {
+    putString(raw, message.systemCode);
+  }
+  block_.clear();
+
+  if (raw.size() > coldseg::kMaxBlockSize) {
+    LOG_ERROR << "Cold archive block too large for chat " << entry.chatId;
+    failed_ = true;
+    return false;
+  }
+
+  std::string compressed(ZSTD_compressBound(raw.size()), '\0');
+  size_t written =
+      ZSTD_compressCCtx(threadCCtx(), compressed.data(), compressed.size(),
+                        raw.data(), raw.size(), kCompressionLevel);
+  if (ZSTD_isError(written)) {
+    LOG_ERROR << "Failed to compress cold archive block: "
+              << ZSTD_getErrorName(written);
+    failed_ = true;
+    return false;
+  }
+
+  entry.size = static_cast<uint32_t>(written);
+  index_.push_back(entry);
+  return write(compressed.data(), written);
+}
+
+bool ColdSegmentWriter::write(const void* data, size_t size) {
+  if (std::fwrite(data, 1, size, file_) != size) {
+    LOG_ERROR << "Failed to write " << tmpPath_ << ": " << std::strerror(errno);
+    failed_ = true;
+    return false;
+  }
+  offset_ += size;
+  return true;
+}
+
+bool ColdSegmentWriter::finish() {
+  if (!file_ || failed_ || !flushBlock()) {
+    return false;
+  }
+
+  coldseg::Footer footer{};
+  footer.indexOffset = offset_;
+  footer.minTimestamp = messages_ > 0 ? minTimestamp_ : 0;
+  footer.maxTimestamp = maxTimestamp_;
+  footer.blockCount = static_cast<uint32_t>(index_.size());
+  footer.version = coldseg::kVersion;
+  std::memcpy(footer.magic, coldseg::kMagic, sizeof(footer.magic));
+
+  if (!write(index_.data(), index_.size() * sizeof(coldseg::BlockIndex)) ||
+      !write(&footer, sizeof(footer))) {
+    return false;
+  }
+
+  // 数据落盘后再发布，崩溃时目录中不会留下不完整的段文件。link 在目标
+  // 已存在时失败，rename 则会覆盖其他节点已发布的段文件
+  bool ok = std::fflush(file_) == 0 && ::fsync(fileno(file_)) == 0;
+  ok = std::fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  ok = ok && ::link(tmpPath_.c_str(), path_.c_str()) == 0;
+  int error = errno;
+  std::remove(tmpPath_.c_str());
+  if (!ok) {
+    LOG_ERROR << "Failed to finish " << path_ << ": " << std::strerror(error);
+    return false;
+  }
+
+  auto directory = std::filesystem::path(path_).parent_path();
+  int fd = ::open(directory.empty() ? "." : directory.c_str(),
+                  O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+  return true;
+}
+
+/**
+ * 一个只读映射的段文件
+ */
+class ColdArchive::Segment {
+ public:
+  static std::shared_ptr<const Segment> open(const std::string& path);
+
+  ~Segment() { ::munmap(const_cast<char*>(base_), size_); }
+
+  Segment(const Segment&) = delete;
+  Segment& operator=(const Segment&) = delete;
+
+  const std::string& path() const { return path_; }
+  uint64_t maxTimestamp() const { return footer_.maxTimestamp; }
+
+  // 把符合条件的消息按时间从新到旧追加到 out，直到共有 limit 条
+  void read(uint8_t chatType,
+            uint64_t chatId,
+            uint64_t beforeId,
+            uint64_t startTime,
+            uint64_t endTime,
+            size_t limit,
+            std::vector<ArchivedMessage>* out,
+            Counter& blocksDecoded) const;
+
+ private:
+  Segment(std::string path, const char* base, size_t size)
+      : path_(std::move(path)), base_(base), size_(size) {}
+
+  coldseg::BlockIndex entry(uint32_t i) const {
+    coldseg::BlockIndex entry;
+    std::memcpy(&entry,
+                base_ + footer_.indexOffset + i * sizeof(coldseg::BlockIndex),
+                sizeof(entry));
+    return entry;
+  }
+
+  // 第一个 (chatType, chatId) 不小于给定值（upper 为真时大于）的块
+  uint32_t bound(uint8_t chatType, uint64_t chatId, bool upper) const;
+
+  std::string path_;
+  const char* base_;
+  size_t size_;
+  coldseg::Footer footer_{};
+};
+
+std::shared_ptr<const ColdArchive::Segment> ColdArchive::Segment::open(
+    const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR << "Failed to open " << path << ": " << std::strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) <
+          sizeof(coldseg::kMagic) + sizeof(coldseg::Footer)) {
+    LOG_ERROR << "Invalid cold archive segment " << path;
+    ::close(fd);
+    return nullptr;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    LOG_ERROR << "Failed to map " << path << ": " << std::strerror(errno);
+    return nullptr;
+  }
+  // 按聊天读取时只访问少数几个块
+  ::madvise(base, size, MADV_RANDOM);
+
+  std::shared_ptr<Segment> segment(
+      new Segment(path, static_cast<const char*>(base), size));
+  auto& footer = segment->footer_;
+  std::memcpy(&footer, segment->base_ + size - sizeof(footer), sizeof(footer));
+  if (std::memcmp(segment->base_, coldseg::kMagic, sizeof(coldseg::kMagic)) !=
+          0 ||
+      std::memcmp(footer.magic, coldseg::kMagic, sizeof(footer.magic)) != 0 ||
+      footer.version != coldseg::kVersion ||
+      footer.indexOffset +
+              uint64_t{footer.blockCount} * sizeof(coldseg::BlockIndex) +
+              sizeof(footer) !=
+          size) {
+    LOG_ERROR << "Corrupt cold archive segment " << path;
+    return nullptr;
+  }
+  return segment;
+}
+
+uint32_t ColdArchive::Segment::bound(uint8_t chatType,
+                                     uint64_t chatId,
+                                     bool upper) const {
+  auto key = std::make_pair(chatType, chatId);
+  uint32_t low = 0;
+  uint32_t high = footer_.blockCount;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    auto e = entry(mid);
+    auto midKey = std::make_pair(e.chatType, e.chatId);
+    if (upper ? midKey <= key : midKey < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void ColdArchive::Segment::read(uint8_t chatType,
+                                uint64_t chatId,
+                                uint64_t beforeId,
+                                uint64_t startTime,
+                                uint64_t endTime,
+                                size_t limit,
+                                std::vector<ArchivedMessage>* out,
+                                Counter& blocksDecoded) const {
+  uint32_t first = bound(chatType, chatId, false);
+  uint32_t last = bound(chatType, chatId, true);
+
+  std::vector<ArchivedMessage> messages;
+  // 同一聊天的块按时间排列，从最后一块往前读
+  for (uint32_t i = last; i > first && out->size() < limit; --i) {
+    auto e = entry(i - 1);
+    if (startTime > 0 && e.maxTimestamp < startTime) {
+      break;
+    }
+    if ((endTime > 0 && e.minTimestamp > endTime) ||
+        (beforeId > 0 && e.minId >= beforeId)) {
+      continue;
+    }
+    if (e.offset + e.size > footer_.indexOffset ||
+        !decodeBlock(base_ + e.offset, e.size, e, &messages)) {
+      LOG_ERROR << "Corrupt block at offset " << e.offset << " in " << path_;
+      continue;
+    }
+    blocksDecoded.inc();
+
+    for (auto it = messages.rbegin(); it != messages.rend(); ++it) {
+      if ((beforeId > 0 && it->id >= beforeId) ||
+          (endTime > 0 && it->timestamp > endTime)) {
+        continue;
+      }
+      if (startTime > 0 && it->timestamp < startTime) {
+        break;
+      }
+      out->push_back(std::move(*it));
+      if (out->size() >= limit) {
+        break;
+      }
+    }
+  }
+}
+
+ColdArchive& ColdArchive::getInstance() {
+  static ColdArchive instance;
+  return instance;
+}
+
+ColdArchive::ColdArchive()
+    : segmentCount_(MetricsRegistry::getInstance().gauge(
+          "starrychat_cold_archive_segments",
+          "Cold history segment files mapped")),
+      reads_(MetricsRegistry::getInstance().counter(
+          "starrychat_cold_archive_reads_total",
+          "History pages read from cold archive segments")),
+      blocksDecoded_(MetricsRegistry::getInstance().counter(
+          "starrychat_cold_archive_blocks_decoded_total",
+          "Cold archive blocks decompressed for reads")) {}
+
+std::string ColdArchive::segmentPath(const std::string& directory,
+                                     const std::string& partition) {
+  return (std::filesystem::path(directory) / ("messages-" + partition + ".seg"))
+      .string();
+}
+
+bool ColdArchive::load(const std::string& directory) {
+  std::lock_guard<std::mutex> loading(loadMutex_);
+  return loadLocked(directory);
+}
+
+bool ColdArchive::loadLocked(const std::string& directory) {
+  std::vector<std::shared_ptr<const Segment>> current;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current = segments_;
+  }
+
+  // 扫描前取修改时间，扫描期间新增的段文件留给下一次 refresh
+  std::error_code ec;
+  auto modified = std::filesystem::last_write_time(directory, ec);
+  std::filesystem::directory_iterator it(directory, ec);
+  if (ec) {
+    LOG_ERROR << "Failed to scan cold archive directory " << directory << ": "
+              << ec.message();
+    return false;
+  }
+
+  std::vector<std::shared_ptr<const Segment>> segments;
+  bool ok = true;
+  for (const auto& file : it) {
+    if (file.path().extension() != ".seg") {
+      continue;
+    }
+
+    // 段文件不会被修改，已映射的直接沿用
+    std::string path = file.path().string();
+    auto mapped = std::find_if(
+        current.begin(), current.end(),
+        [&path](const auto& segment) { return segment->path() == path; });
+    auto segment = mapped != current.end() ? *mapped : Segment::open(path);
+    if (!segment) {
+      ok = false;
+      continue;
+    }
+    segments.push_back(std::move(segment));
+  }
+
+  std::sort(segments.begin(), segments.end(),
+            [](const auto& a, const auto& b) {
+              return a->maxTimestamp() > b->maxTimestamp();
+            });
+  segmentCount_.set(static_cast<int64_t>(segments.size()));
+  LOG_INFO << "Loaded " << segments.size() << " cold archive segments from "
+           << directory;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  segments_ = std::move(segments);
+  directory_ = directory;
+  loadedAt_ = modified;
+  return ok;
+}
+
+void ColdArchive::refresh() {
+  std::unique_lock<std::mutex> loading(loadMutex_, std::try_to_lock);
+  if (!loading.owns_lock()) {
+    return;
+  }
+
+  std::string directory;
+  std::filesystem::file_time_type loadedAt;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory = directory_;
+    loadedAt = loadedAt_;
+  }
+  if (directory.empty()) {
+    return;
+  }
+
+  std::error_code ec;
+  auto modified = std::filesystem::last_write_time(directory, ec);
+  if (!ec && modified != loadedAt) {
+    loadLocked(directory);
+  }
+}
+
+bool ColdArchive::empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return segments_.empty();
+}
+
+std::vector<ArchivedMessage> ColdArchive::read(uint8_t chatType,
+                                               uint64_t chatId,
+                                               uint64_t beforeId,
+                                               uint64_t startTime,
+                                               uint64_t endTime,
+                                               size_t limit) const {
+  std::vector<std::shared_ptr<const Segment>> segments;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments = segments_;
+  }
+
+  std::vector<ArchivedMessage> messages;
+  for (const auto& segment : segments) {
+    if (messages.size() >= limit) {
+      break;
+    }
+    segment->read(chatType, chatId, beforeId, startTime, endTime, limit,
+                  &messages, blocksDecoded_);
+  }
+  reads_.inc();
+  return messages;
+}
+
+}  // namespace StarryChat
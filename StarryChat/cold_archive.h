@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "cold_segment_format.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+// 段文件中的一条消息，字段与 messages 表的列一一对应
+struct ArchivedMessage {
+  uint64_t id{0};
+  uint64_t senderId{0};
+  uint8_t chatType{0};
+  uint64_t chatId{0};
+  uint8_t type{0};
+  uint8_t status{0};
+  uint64_t timestamp{0};
+  uint64_t replyToId{0};
+  std::optional<std::string> content;
+  std::optional<std::string> systemCode;
+};
+
+/**
+ * 顺序写出一个段文件（格式见 cold_segment_format.h）
+ * 先写到同目录下随机命名、以 O_EXCL 创建的临时文件，finish 时 fsync
+ * 后以 link 发布到 path，目标已存在时失败而不覆盖，多个节点同时导出
+ * 同一分区也只会有一份生效。中途失败或未 finish 时删除临时文件，目录
+ * 中只会出现完整的段文件。
+ */
+class ColdSegmentWriter {
+ public:
+  explicit ColdSegmentWriter(std::string path);
+  ~ColdSegmentWriter();
+
+  ColdSegmentWriter(const ColdSegmentWriter&) = delete;
+  ColdSegmentWriter& operator=(const ColdSegmentWriter&) = delete;
+
+  // 目标文件已存在时失败，段文件一经写出不再覆盖
+  bool open();
+
+  /**
+   * 追加一条消息，必须按 (chatType, chatId, timestamp, id) 顺序
+   */
+  bool append(const ArchivedMessage& message);
+
+  bool finish();
+
+  uint64_t messages() const { return messages_; }
+
+ private:
+  bool flushBlock();
+  bool write(const void* data, size_t size);
+
+  std::string path_;
+  std::string tmpPath_;
+  std::FILE* file_{nullptr};
+  uint64_t offset_{0};
+  uint64_t messages_{0};
+  bool failed_{false};
+  std::optional<std::tuple<uint8_t, uint64_t, uint64_t, uint64_t>> last_;
+
+  std::vector<ArchivedMessage> block_;
+  std::vector<coldseg::BlockIndex> index_;
+  uint64_t minTimestamp_{UINT64_MAX};
+  uint64_t maxTimestamp_{0};
+};
+
+/**
+ * 冷历史存储
+ * 超出保留期的月份分区导出为目录中的 messages-<分区名>.seg 后从数据库
+ * 删除。段文件以只读方式 mmap，按稀疏索引定位聊天的数据块，只解压
+ * 需要的块。GetMessages 在数据库中取不够一页时接着读这里。
+ */
+class ColdArchive {
+ public:
+  static ColdArchive& getInstance();
+
+  ColdArchive(const ColdArchive&) = delete;
+  ColdArchive& operator=(const ColdArchive&) = delete;
+  ColdArchive(ColdArchive&&) = delete;
+  ColdArchive& operator=(ColdArchive&&) = delete;
+
+  // 分区对应的段文件路径
+  static std::string segmentPath(const std::string& directory,
+                                 const std::string& partition);
+
+  /**
+   * 重新扫描目录并映射其中的段文件，替换已加载的集合
+   * 正在进行的读取继续使用旧集合
+   */
+  bool load(const std::string& directory);
+
+  /**
+   * 目录的修改时间在上次 load 之后变化（其他节点写出了新段文件）时
+   * 重新加载；已有线程在加载时直接返回
+   */
+  void refresh();
+
+  bool empty() const;
+
+  /**
+   * 读取聊天在冷存储中 id < beforeId 且时间戳在 [startTime, endTime]
+   * 内的消息（参数为 0 表示不限），按时间从新到旧最多 limit 条
+   */
+  std::vector<ArchivedMessage> read(uint8_t chatType,
+                                    uint64_t chatId,
+                                    uint64_t beforeId,
+                                    uint64_t startTime,
+                                    uint64_t endTime,
+                                    size_t limit) const;
+
+ private:
+  class Segment;
+
+  ColdArchive();
+  ~ColdArchive() = default;
+
+  bool loadLocked(const std::string& directory);
+
+  mutable std::mutex mutex_;
+  // 按时间从新到旧排列
+  std::vector<std::shared_ptr<const Segment>> segments_;
+  std::string directory_;
+  std::filesystem::file_time_type loadedAt_;
+  // 串行化加载，较早的扫描结果不会覆盖较新的
+  std::mutex loadMutex_;
+
+  Gauge& segmentCount_;
+  Counter& reads_;
+  Counter& blocksDecoded_;
+};
+
+}  // namespace StarryChat
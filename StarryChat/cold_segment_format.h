@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+namespace StarryChat {
+
+/**
+ * 冷历史段文件格式（主机字节序，小端）
+ *
+ *   char[8] "SCSEG001" | 数据块... | 块索引 | 文件尾
+ *
+ * 段文件写完后不再修改。消息按 (chat_type, chat_id, timestamp, id) 排序，
+ * 每个数据块只包含同一个聊天的最多 kBlockMessages 条消息，整体用 zstd
+ * 压缩，解压后按列存放：
+ *   varint count
+ *   ids         首个为 varint，其余为与前一条之差的 zigzag varint
+ *   timestamps  首个为 varint，其余为与前一条之差的 varint（非递减）
+ *   senderIds   varint
+ *   replyToIds  varint，0 表示没有回复
+ *   types       u8 * count
+ *   statuses    u8 * count
+ *   contents    varint (长度 + 1) | bytes，0 表示 NULL
+ *   systemCodes 同 contents
+ *
+ * 块索引为稀疏索引，每个数据块一项（BlockIndex），与数据块顺序相同，
+ * 可按 (chatType, chatId) 二分查找。文件尾（Footer）位于文件末尾。
+ */
+namespace coldseg {
+
+constexpr char kMagic[8] = {'S', 'C', 'S', 'E', 'G', '0', '0', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kBlockMessages = 256;
+// 单个数据块解压后的上限，超出视为损坏
+constexpr uint64_t kMaxBlockSize = 64 * 1024 * 1024;
+
+struct BlockIndex {
+  uint64_t chatId;
+  uint64_t minId;
+  uint64_t maxId;
+  uint64_t minTimestamp;
+  uint64_t maxTimestamp;
+  uint64_t offset;  // 压缩块在文件中的偏移
+  uint32_t size;    // 压缩块字节数
+  uint32_t count;   // 消息条数
+  uint8_t chatType;
+  uint8_t reserved[7];
+};
+static_assert(sizeof(BlockIndex) == 64);
+
+struct Footer {
+  uint64_t indexOffset;
+  uint64_t minTimestamp;
+  uint64_t maxTimestamp;
+  uint32_t blockCount;
+  uint32_t version;
+  char magic[8];
+};
+static_assert(sizeof(Footer) == 40);
+
+}  // namespace coldseg
+
+}  // namespace StarryChat
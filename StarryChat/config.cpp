@@ -48,6 +48,37 @@ bool Config::loadConfig(const std::string& configFilePath) {
   }
   serverThreads_ = configFile_["server"]["threads"].as<int>();
 
+  // 节点ID用于跨节点推送路由，多节点部署时必须唯一
+  if (configFile_["server"]["nodeId"]) {
+    serverNodeId_ = configFile_["server"]["nodeId"].as<std::string>();
+  } else {
+    char hostname[256] = {};
+    gethostname(hostname, sizeof(hostname) - 1);
+    serverNodeId_ = std::string(hostname) + ":" + std::to_string(serverPort_);
+  }
+
+  // 准入控制配置为可选项
+  auto admission = configFile_["server"]["admission"];
+  if (admission["enabled"]) {
+    admissionEnabled_ = admission["enabled"].as<bool>();
+  }
+  if (admission["maxInflight"]) {
+    admissionMaxInflight_ = admission["maxInflight"].as<int>();
+  }
+  if (admission["normalShare"]) {
+    admissionNormalShare_ = admission["normalShare"].as<double>();
+  }
+  if (admission["bulkShare"]) {
+    admissionBulkShare_ = admission["bulkShare"].as<double>();
+  }
+  if (admission["targetLatencyMs"]) {
+    admissionTargetLatencyMs_ = admission["targetLatencyMs"].as<int>();
+  }
+  if (admission["bulkTargetLatencyMs"]) {
+    admissionBulkTargetLatencyMs_ =
+        admission["bulkTargetLatencyMs"].as<int>();
+  }
+
   if (!configFile_["database"]["mariadb"]["host"]) {
     LOG_ERROR << "config file not set database mariadb host";
     return false;
@@ -87,6 +118,47 @@ bool Config::loadConfig(const std::string& configFilePath) {
   }
   mariaDBPoolSize_ = configFile_["database"]["mariadb"]["poolSize"].as<int>();
 
+  // 只读从库为可选项，如 replicas: ["db-replica-1:3306"]
+  auto mariadb = configFile_["database"]["mariadb"];
+  if (auto replicas = mariadb["replicas"]) {
+    for (const auto& item : replicas) {
+      mariaDBReplicas_.push_back(item.as<std::string>());
+    }
+  }
+  if (mariadb["readYourWritesSeconds"]) {
+    mariaDBReadYourWritesSeconds_ = mariadb["readYourWritesSeconds"].as<int>();
+  }
+  if (mariadb["replicaMaxLagSeconds"]) {
+    mariaDBReplicaMaxLagSeconds_ = mariadb["replicaMaxLagSeconds"].as<int>();
+  }
+  if (mariadb["replicaProbeSeconds"]) {
+    mariaDBReplicaProbeSeconds_ = mariadb["replicaProbeSeconds"].as<int>();
+  }
+
+  // messages 表按月分区维护为可选项
+  auto partitions = mariadb["messagePartitions"];
+  if (partitions["enabled"]) {
+    messagePartitionsEnabled_ = partitions["enabled"].as<bool>();
+  }
+  if (partitions["monthsAhead"]) {
+    messagePartitionsMonthsAhead_ = partitions["monthsAhead"].as<int>();
+  }
+  if (partitions["retentionMonths"]) {
+    messagePartitionsRetentionMonths_ =
+        partitions["retentionMonths"].as<int>();
+  }
+  if (partitions["archive"]) {
+    messagePartitionsArchive_ = partitions["archive"].as<bool>();
+  }
+  if (partitions["maintenanceHours"]) {
+    messagePartitionsMaintenanceHours_ =
+        partitions["maintenanceHours"].as<int>();
+  }
+  if (partitions["segmentDirectory"]) {
+    messagePartitionsSegmentDirectory_ =
+        partitions["segmentDirectory"].as<std::string>();
+  }
+
   if (!configFile_["database"]["redis"]["host"]) {
     LOG_ERROR << "config file not set database redis host";
     return false;
@@ -118,6 +190,191 @@ bool Config::loadConfig(const std::string& configFilePath) {
   }
   redisPoolSize_ = configFile_["database"]["redis"]["poolSize"].as<int>();
 
+  // 部署模式为可选项，默认单机
+  if (configFile_["database"]["redis"]["mode"]) {
+    redisMode_ = configFile_["database"]["redis"]["mode"].as<std::string>();
+  }
+
+  // 登录限流配置为可选项
+  auto login = configFile_["security"]["login"];
+  if (login["bucketCapacity"]) {
+    loginBucketCapacity_ = login["bucketCapacity"].as<int>();
+  }
+  if (login["refillPerMinute"]) {
+    loginRefillPerMinute_ = login["refillPerMinute"].as<int>();
+  }
+  if (login["failureWindow"]) {
+    loginFailureWindow_ = login["failureWindow"].as<int>();
+  }
+  if (login["maxFailures"]) {
+    loginMaxFailures_ = login["maxFailures"].as<int>();
+  }
+  if (login["lockoutSeconds"]) {
+    loginLockoutSeconds_ = login["lockoutSeconds"].as<int>();
+  }
+  if (login["syncInterval"]) {
+    loginSyncInterval_ = login["syncInterval"].as<int>();
+  }
+  if (login["flushInterval"]) {
+    loginFlushInterval_ = login["flushInterval"].as<int>();
+  }
+
+  // 用户名过滤器配置为可选项
+  auto usernameFilter = configFile_["cache"]["usernameFilter"];
+  if (usernameFilter["expectedItems"]) {
+    usernameFilterExpectedItems_ =
+        usernameFilter["expectedItems"].as<size_t>();
+  }
+  if (usernameFilter["falsePositiveRate"]) {
+    usernameFilterFalsePositiveRate_ =
+        usernameFilter["falsePositiveRate"].as<double>();
+  }
+  if (usernameFilter["scanBatch"]) {
+    usernameFilterScanBatch_ = usernameFilter["scanBatch"].as<int>();
+  }
+  if (usernameFilter["rebuildInterval"]) {
+    usernameFilterRebuildInterval_ =
+        usernameFilter["rebuildInterval"].as<int>();
+  }
+
+  // 好友缓存配置为可选项
+  auto friends = configFile_["cache"]["friends"];
+  if (friends["capacity"]) {
+    friendCacheCapacity_ = friends["capacity"].as<size_t>();
+  }
+  if (friends["ttlSeconds"]) {
+    friendCacheTtlSeconds_ = friends["ttlSeconds"].as<int>();
+  }
+
+  // 消息缓存压缩配置为可选项
+  auto messages = configFile_["cache"]["messages"];
+  if (messages["compression"]) {
+    messageCacheCompression_ = messages["compression"].as<bool>();
+  }
+  if (messages["minSize"]) {
+    messageCacheMinSize_ = messages["minSize"].as<size_t>();
+  }
+  if (messages["level"]) {
+    messageCacheLevel_ = messages["level"].as<int>();
+  }
+  if (messages["dictionary"]) {
+    messageCacheDictionary_ = messages["dictionary"].as<std::string>();
+  }
+
+  // 熔断与降级配置为可选项
+  auto breaker = configFile_["resilience"]["breaker"];
+  if (breaker["windowSeconds"]) {
+    breakerWindowSeconds_ = breaker["windowSeconds"].as<int>();
+  }
+  if (breaker["minCalls"]) {
+    breakerMinCalls_ = breaker["minCalls"].as<int>();
+  }
+  if (breaker["failureRate"]) {
+    breakerFailureRate_ = breaker["failureRate"].as<double>();
+  }
+  if (breaker["slowCallRate"]) {
+    breakerSlowCallRate_ = breaker["slowCallRate"].as<double>();
+  }
+  if (breaker["openSeconds"]) {
+    breakerOpenSeconds_ = breaker["openSeconds"].as<int>();
+  }
+  if (breaker["halfOpenProbes"]) {
+    breakerHalfOpenProbes_ = breaker["halfOpenProbes"].as<int>();
+  }
+  if (breaker["mariadbSlowCallMs"]) {
+    mariaDBSlowCallMs_ = breaker["mariadbSlowCallMs"].as<int>();
+  }
+  if (breaker["redisSlowCallMs"]) {
+    redisSlowCallMs_ = breaker["redisSlowCallMs"].as<int>();
+  }
+  if (configFile_["resilience"]["spoolCapacity"]) {
+    messageSpoolCapacity_ =
+        configFile_["resilience"]["spoolCapacity"].as<size_t>();
+  }
+
+  // 推送配置为可选项
+  auto push = configFile_["push"];
+  if (push["maxWaitMs"]) {
+    pushMaxWaitMs_ = push["maxWaitMs"].as<int>();
+  }
+  if (push["highWatermark"]) {
+    pushHighWatermark_ = push["highWatermark"].as<size_t>();
+  }
+  if (push["lowWatermark"]) {
+    pushLowWatermark_ = push["lowWatermark"].as<size_t>();
+  }
+  if (push["slowConsumerPolicy"]) {
+    pushSlowConsumerPolicy_ =
+        to_lower(push["slowConsumerPolicy"].as<std::string>());
+  }
+  if (push["idleSeconds"]) {
+    pushIdleSeconds_ = push["idleSeconds"].as<int>();
+  }
+  if (push["subscriber"]) {
+    pushSubscriberEnabled_ = push["subscriber"].as<bool>();
+  }
+  if (push["subscriberPollMs"]) {
+    pushSubscriberPollMs_ = push["subscriberPollMs"].as<int>();
+  }
+  if (push["presenceTtlSeconds"]) {
+    pushPresenceTtlSeconds_ = push["presenceTtlSeconds"].as<int>();
+  }
+
+  // 消息全文搜索配置为可选项
+  auto search = configFile_["search"];
+  if (search["enabled"]) {
+    searchEnabled_ = search["enabled"].as<bool>();
+  }
+  if (search["directory"]) {
+    searchDirectory_ = search["directory"].as<std::string>();
+  }
+  if (search["flushPostings"]) {
+    searchFlushPostings_ = search["flushPostings"].as<size_t>();
+  }
+  if (search["maxSegments"]) {
+    searchMaxSegments_ = search["maxSegments"].as<size_t>();
+  }
+  if (search["catchUpSeconds"]) {
+    searchCatchUpSeconds_ = search["catchUpSeconds"].as<int>();
+  }
+  if (search["catchUpBatch"]) {
+    searchCatchUpBatch_ = search["catchUpBatch"].as<int>();
+  }
+
+  // 指标导出配置为可选项
+  auto metrics = configFile_["metrics"];
+  if (metrics["enabled"]) {
+    metricsEnabled_ = metrics["enabled"].as<bool>();
+  }
+  if (metrics["port"]) {
+    metricsPort_ = metrics["port"].as<int>();
+  }
+
+  // 集群配置为可选项，未启用时所有聊天室都在本节点处理
+  auto cluster = configFile_["cluster"];
+  if (cluster["enabled"]) {
+    clusterEnabled_ = cluster["enabled"].as<bool>();
+  }
+  if (cluster["advertiseHost"]) {
+    clusterAdvertiseHost_ = cluster["advertiseHost"].as<std::string>();
+  } else {
+    char hostname[256] = {};
+    gethostname(hostname, sizeof(hostname) - 1);
+    clusterAdvertiseHost_ = hostname;
+  }
+  if (cluster["leaseSeconds"]) {
+    clusterLeaseSeconds_ = cluster["leaseSeconds"].as<int>();
+  }
+  if (cluster["virtualNodes"]) {
+    clusterVirtualNodes_ = cluster["virtualNodes"].as<int>();
+  }
+  if (cluster["forwardTimeoutMs"]) {
+    clusterForwardTimeoutMs_ = cluster["forwardTimeoutMs"].as<int>();
+  }
+  if (cluster["hotTimelineSize"]) {
+    clusterHotTimelineSize_ = cluster["hotTimelineSize"].as<size_t>();
+  }
+
   if (!configFile_["logging"]["basename"]) {
     LOG_ERROR << "config file not set logging basename";
     return false;
@@ -153,6 +410,7 @@ bool Config::loadConfig(const std::string& configFilePath) {
       {"debug", starry::LogLevel::DEBUG},
       {"info", starry::LogLevel::INFO},
       {"warn", starry::LogLevel::WARN},
+      {"error", starry::LogLevel::ERROR},
       {"fatal", starry::LogLevel::FATAL}};
 
   if (st_to_level.find(logger_level) == st_to_level.end()) {
@@ -161,6 +419,29 @@ bool Config::loadConfig(const std::string& configFilePath) {
     loggingLevel_ = st_to_level[logger_level];
   }
 
+  // 模块日志级别为可选项，如 modules: {message: warn, user: debug}
+  if (auto modules = configFile_["logging"]["modules"]) {
+    for (const auto& item : modules) {
+      std::string module = to_lower(item.first.as<std::string>());
+      std::string level = to_lower(item.second.as<std::string>());
+      if (st_to_level.find(level) == st_to_level.end()) {
+        LOG_ERROR << "Invalid logging level for module " << module << ": "
+                  << level;
+        return false;
+      }
+      loggingModuleLevels_[module] = st_to_level[level];
+    }
+  }
+
+  // 二进制日志为可选项
+  auto binary = configFile_["logging"]["binary"];
+  if (binary["enabled"]) {
+    loggingBinaryEnabled_ = binary["enabled"].as<bool>();
+  }
+  if (binary["basename"]) {
+    loggingBinaryBaseName_ = binary["basename"].as<std::string>();
+  }
+
   return valiConfig();
 }
 
@@ -177,6 +458,107 @@ bool Config::valiConfig() {
     return false;
   }
 
+  // 验证准入控制配置
+  if (admissionMaxInflight_ < 0 || admissionNormalShare_ <= 0 ||
+      admissionNormalShare_ > 1 || admissionBulkShare_ <= 0 ||
+      admissionBulkShare_ > 1 || admissionTargetLatencyMs_ <= 0 ||
+      admissionBulkTargetLatencyMs_ <= 0) {
+    LOG_ERROR << "Invalid server admission config";
+    return false;
+  }
+
+  // 验证从库配置，地址必须为 host:port
+  for (const auto& replica : mariaDBReplicas_) {
+    auto colon = replica.rfind(':');
+    if (colon == std::string::npos || colon == 0 ||
+        colon + 1 == replica.size()) {
+      LOG_ERROR << "Invalid database mariadb replica address: " << replica;
+      return false;
+    }
+  }
+  if (mariaDBReadYourWritesSeconds_ < 0 || mariaDBReplicaMaxLagSeconds_ < 0 ||
+      mariaDBReplicaProbeSeconds_ <= 0) {
+    LOG_ERROR << "Invalid database mariadb replica config";
+    return false;
+  }
+
+  // 验证消息分区配置，保留期至少包含当前月
+  if (messagePartitionsMonthsAhead_ < 1 ||
+      messagePartitionsRetentionMonths_ < 0 ||
+      messagePartitionsMaintenanceHours_ <= 0) {
+    LOG_ERROR << "Invalid database mariadb messagePartitions config";
+    return false;
+  }
+
+  // 验证 Redis 部署模式，集群只有 0 号库
+  if ((redisMode_ != "standalone" && redisMode_ != "cluster") ||
+      (redisMode_ == "cluster" && redisDB_ != 0)) {
+    LOG_ERROR << "Invalid database redis mode config";
+    return false;
+  }
+
+  // 验证登录限流配置
+  if (loginBucketCapacity_ <= 0 || loginMaxFailures_ <= 0 ||
+      loginFlushInterval_ <= 0) {
+    LOG_ERROR << "Invalid security login config";
+    return false;
+  }
+
+  // 验证用户名过滤器配置
+  if (usernameFilterFalsePositiveRate_ <= 0 ||
+      usernameFilterFalsePositiveRate_ >= 1 || usernameFilterScanBatch_ <= 0 ||
+      usernameFilterRebuildInterval_ <= 0) {
+    LOG_ERROR << "Invalid cache usernameFilter config";
+    return false;
+  }
+
+  // 验证熔断配置
+  if (breakerWindowSeconds_ <= 0 || breakerMinCalls_ <= 0 ||
+      breakerFailureRate_ <= 0 || breakerFailureRate_ > 1 ||
+      breakerSlowCallRate_ <= 0 || breakerSlowCallRate_ > 1 ||
+      breakerOpenSeconds_ <= 0 || breakerHalfOpenProbes_ <= 0 ||
+      mariaDBSlowCallMs_ <= 0 || redisSlowCallMs_ <= 0) {
+    LOG_ERROR << "Invalid resilience breaker config";
+    return false;
+  }
+
+  // 验证推送配置，空闲回收时间必须长于一次订阅的等待时间
+  if (pushMaxWaitMs_ <= 0 || pushHighWatermark_ == 0 ||
+      pushLowWatermark_ >= pushHighWatermark_ ||
+      (pushSlowConsumerPolicy_ != "resync" &&
+       pushSlowConsumerPolicy_ != "disconnect") ||
+      pushIdleSeconds_ * 1000 <= pushMaxWaitMs_ ||
+      pushSubscriberPollMs_ <= 0 || pushPresenceTtlSeconds_ < 3) {
+    LOG_ERROR << "Invalid push config";
+    return false;
+  }
+
+  // 验证搜索配置
+  if (searchEnabled_ &&
+      (searchDirectory_.empty() || searchFlushPostings_ == 0 ||
+       searchMaxSegments_ < 2 || searchCatchUpSeconds_ <= 0 ||
+       searchCatchUpBatch_ <= 0)) {
+    LOG_ERROR << "Invalid search config";
+    return false;
+  }
+
+  // 验证指标端口
+  if (metricsEnabled_ &&
+      (metricsPort_ <= 0 || metricsPort_ > 65535 ||
+       metricsPort_ == serverPort_)) {
+    LOG_ERROR << "Invalid metrics port: " << metricsPort_;
+    return false;
+  }
+
+  // 验证集群配置
+  if (clusterEnabled_ &&
+      (clusterAdvertiseHost_.empty() || clusterLeaseSeconds_ < 3 ||
+       clusterVirtualNodes_ <= 0 || clusterForwardTimeoutMs_ <= 0 ||
+       clusterHotTimelineSize_ == 0)) {
+    LOG_ERROR << "Invalid cluster config";
+    return false;
+  }
+
   return true;
 }
 
@@ -192,6 +574,34 @@ int Config::getServerThreads() const {
   return serverThreads_;
 }
 
+std::string Config::getServerNodeId() const {
+  return serverNodeId_;
+}
+
+bool Config::getAdmissionEnabled() const {
+  return admissionEnabled_;
+}
+
+int Config::getAdmissionMaxInflight() const {
+  return admissionMaxInflight_ > 0 ? admissionMaxInflight_ : serverThreads_;
+}
+
+double Config::getAdmissionNormalShare() const {
+  return admissionNormalShare_;
+}
+
+double Config::getAdmissionBulkShare() const {
+  return admissionBulkShare_;
+}
+
+int Config::getAdmissionTargetLatencyMs() const {
+  return admissionTargetLatencyMs_;
+}
+
+int Config::getAdmissionBulkTargetLatencyMs() const {
+  return admissionBulkTargetLatencyMs_;
+}
+
 std::string Config::getMariaDBHost() const {
   return mariaDBHost_;
 }
@@ -216,6 +626,46 @@ int Config::getMariaDBPoolSize() const {
   return mariaDBPoolSize_;
 }
 
+const std::vector<std::string>& Config::getMariaDBReplicas() const {
+  return mariaDBReplicas_;
+}
+
+int Config::getMariaDBReadYourWritesSeconds() const {
+  return mariaDBReadYourWritesSeconds_;
+}
+
+int Config::getMariaDBReplicaMaxLagSeconds() const {
+  return mariaDBReplicaMaxLagSeconds_;
+}
+
+int Config::getMariaDBReplicaProbeSeconds() const {
+  return mariaDBReplicaProbeSeconds_;
+}
+
+bool Config::getMessagePartitionsEnabled() const {
+  return messagePartitionsEnabled_;
+}
+
+int Config::getMessagePartitionsMonthsAhead() const {
+  return messagePartitionsMonthsAhead_;
+}
+
+int Config::getMessagePartitionsRetentionMonths() const {
+  return messagePartitionsRetentionMonths_;
+}
+
+bool Config::getMessagePartitionsArchive() const {
+  return messagePartitionsArchive_;
+}
+
+int Config::getMessagePartitionsMaintenanceHours() const {
+  return messagePartitionsMaintenanceHours_;
+}
+
+std::string Config::getMessagePartitionsSegmentDirectory() const {
+  return messagePartitionsSegmentDirectory_;
+}
+
 std::string Config::getRedisHost() const {
   return redisHost_;
 }
@@ -236,6 +686,202 @@ int Config::getRedisPoolSize() const {
   return redisPoolSize_;
 }
 
+std::string Config::getRedisMode() const {
+  return redisMode_;
+}
+
+int Config::getLoginBucketCapacity() const {
+  return loginBucketCapacity_;
+}
+
+int Config::getLoginRefillPerMinute() const {
+  return loginRefillPerMinute_;
+}
+
+int Config::getLoginFailureWindow() const {
+  return loginFailureWindow_;
+}
+
+int Config::getLoginMaxFailures() const {
+  return loginMaxFailures_;
+}
+
+int Config::getLoginLockoutSeconds() const {
+  return loginLockoutSeconds_;
+}
+
+int Config::getLoginSyncInterval() const {
+  return loginSyncInterval_;
+}
+
+int Config::getLoginFlushInterval() const {
+  return loginFlushInterval_;
+}
+
+size_t Config::getUsernameFilterExpectedItems() const {
+  return usernameFilterExpectedItems_;
+}
+
+double Config::getUsernameFilterFalsePositiveRate() const {
+  return usernameFilterFalsePositiveRate_;
+}
+
+int Config::getUsernameFilterScanBatch() const {
+  return usernameFilterScanBatch_;
+}
+
+int Config::getUsernameFilterRebuildInterval() const {
+  return usernameFilterRebuildInterval_;
+}
+
+size_t Config::getFriendCacheCapacity() const {
+  return friendCacheCapacity_;
+}
+
+int Config::getFriendCacheTtlSeconds() const {
+  return friendCacheTtlSeconds_;
+}
+
+bool Config::getMessageCacheCompression() const {
+  return messageCacheCompression_;
+}
+
+size_t Config::getMessageCacheMinSize() const {
+  return messageCacheMinSize_;
+}
+
+int Config::getMessageCacheLevel() const {
+  return messageCacheLevel_;
+}
+
+std::string Config::getMessageCacheDictionary() const {
+  return messageCacheDictionary_;
+}
+
+int Config::getBreakerWindowSeconds() const {
+  return breakerWindowSeconds_;
+}
+
+int Config::getBreakerMinCalls() const {
+  return breakerMinCalls_;
+}
+
+double Config::getBreakerFailureRate() const {
+  return breakerFailureRate_;
+}
+
+double Config::getBreakerSlowCallRate() const {
+  return breakerSlowCallRate_;
+}
+
+int Config::getBreakerOpenSeconds() const {
+  return breakerOpenSeconds_;
+}
+
+int Config::getBreakerHalfOpenProbes() const {
+  return breakerHalfOpenProbes_;
+}
+
+int Config::getMariaDBSlowCallMs() const {
+  return mariaDBSlowCallMs_;
+}
+
+int Config::getRedisSlowCallMs() const {
+  return redisSlowCallMs_;
+}
+
+size_t Config::getMessageSpoolCapacity() const {
+  return messageSpoolCapacity_;
+}
+
+int Config::getPushMaxWaitMs() const {
+  return pushMaxWaitMs_;
+}
+
+size_t Config::getPushHighWatermark() const {
+  return pushHighWatermark_;
+}
+
+size_t Config::getPushLowWatermark() const {
+  return pushLowWatermark_;
+}
+
+std::string Config::getPushSlowConsumerPolicy() const {
+  return pushSlowConsumerPolicy_;
+}
+
+int Config::getPushIdleSeconds() const {
+  return pushIdleSeconds_;
+}
+
+bool Config::getPushSubscriberEnabled() const {
+  return pushSubscriberEnabled_;
+}
+
+int Config::getPushSubscriberPollMs() const {
+  return pushSubscriberPollMs_;
+}
+
+int Config::getPushPresenceTtlSeconds() const {
+  return pushPresenceTtlSeconds_;
+}
+
+bool Config::getSearchEnabled() const {
+  return searchEnabled_;
+}
+
+std::string Config::getSearchDirectory() const {
+  return searchDirectory_;
+}
+
+size_t Config::getSearchFlushPostings() const {
+  return searchFlushPostings_;
+}
+
+size_t Config::getSearchMaxSegments() const {
+  return searchMaxSegments_;
+}
+
+int Config::getSearchCatchUpSeconds() const {
+  return searchCatchUpSeconds_;
+}
+
+int Config::getSearchCatchUpBatch() const {
+  return searchCatchUpBatch_;
+}
+
+bool Config::getMetricsEnabled() const {
+  return metricsEnabled_;
+}
+
+int Config::getMetricsPort() const {
+  return metricsPort_;
+}
+
+bool Config::getClusterEnabled() const {
+  return clusterEnabled_;
+}
+
+std::string Config::getClusterAdvertiseHost() const {
+  return clusterAdvertiseHost_;
+}
+
+int Config::getClusterLeaseSeconds() const {
+  return clusterLeaseSeconds_;
+}
+
+int Config::getClusterVirtualNodes() const {
+  return clusterVirtualNodes_;
+}
+
+int Config::getClusterForwardTimeoutMs() const {
+  return clusterForwardTimeoutMs_;
+}
+
+size_t Config::getClusterHotTimelineSize() const {
+  return clusterHotTimelineSize_;
+}
+
 std::string Config::getLoggingBaseName() const {
   return loggingBaseName_;
 }
@@ -251,3 +897,16 @@ off_t Config::getLoggingRollSize() const {
 int64_t Config::getLoggingRefreshInterval() const {
   return loggingRefreshInterval_;
 }
+
+const std::map<std::string, starry::LogLevel>& Config::getLoggingModuleLevels()
+    const {
+  return loggingModuleLevels_;
+}
+
+bool Config::getLoggingBinaryEnabled() const {
+  return loggingBinaryEnabled_;
+}
+
+std::string Config::getLoggingBinaryBaseName() const {
+  return loggingBinaryBaseName_;
+}
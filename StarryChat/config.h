@@ -4,7 +4,9 @@
 #include <yaml-cpp/node/node.h>
 #include <yaml-cpp/yaml.h>
 #include <cstdint>
+#include <map>
 #include <string>
+#include <vector>
 #include "logging.h"
 
 namespace StarryChat {
@@ -22,6 +24,15 @@ class Config {
   std::string getServerHost() const;
   int getServerPort() const;
   int getServerThreads() const;
+  std::string getServerNodeId() const;
+
+  // Server - 准入控制
+  bool getAdmissionEnabled() const;
+  int getAdmissionMaxInflight() const;
+  double getAdmissionNormalShare() const;
+  double getAdmissionBulkShare() const;
+  int getAdmissionTargetLatencyMs() const;
+  int getAdmissionBulkTargetLatencyMs() const;
 
   // Database -- MariaDB
   std::string getMariaDBHost() const;
@@ -30,6 +41,16 @@ class Config {
   std::string getMariaDBPassword() const;
   std::string getMariaDBDatabase() const;
   int getMariaDBPoolSize() const;
+  const std::vector<std::string>& getMariaDBReplicas() const;
+  int getMariaDBReadYourWritesSeconds() const;
+  int getMariaDBReplicaMaxLagSeconds() const;
+  int getMariaDBReplicaProbeSeconds() const;
+  bool getMessagePartitionsEnabled() const;
+  int getMessagePartitionsMonthsAhead() const;
+  int getMessagePartitionsRetentionMonths() const;
+  bool getMessagePartitionsArchive() const;
+  int getMessagePartitionsMaintenanceHours() const;
+  std::string getMessagePartitionsSegmentDirectory() const;
 
   // Database - Redis
   std::string getRedisHost() const;
@@ -37,12 +58,82 @@ class Config {
   std::string getRedisPassword() const;
   int getRedisDB() const;
   int getRedisPoolSize() const;
+  std::string getRedisMode() const;
+
+  // Security - 登录限流
+  int getLoginBucketCapacity() const;
+  int getLoginRefillPerMinute() const;
+  int getLoginFailureWindow() const;
+  int getLoginMaxFailures() const;
+  int getLoginLockoutSeconds() const;
+  int getLoginSyncInterval() const;
+  int getLoginFlushInterval() const;
+
+  // Cache - 用户名过滤器
+  size_t getUsernameFilterExpectedItems() const;
+  double getUsernameFilterFalsePositiveRate() const;
+  int getUsernameFilterScanBatch() const;
+  int getUsernameFilterRebuildInterval() const;
+
+  // Cache - 好友邻接表
+  size_t getFriendCacheCapacity() const;
+  int getFriendCacheTtlSeconds() const;
+
+  // Cache - 消息缓存压缩
+  bool getMessageCacheCompression() const;
+  size_t getMessageCacheMinSize() const;
+  int getMessageCacheLevel() const;
+  std::string getMessageCacheDictionary() const;
+
+  // Resilience - 熔断与降级
+  int getBreakerWindowSeconds() const;
+  int getBreakerMinCalls() const;
+  double getBreakerFailureRate() const;
+  double getBreakerSlowCallRate() const;
+  int getBreakerOpenSeconds() const;
+  int getBreakerHalfOpenProbes() const;
+  int getMariaDBSlowCallMs() const;
+  int getRedisSlowCallMs() const;
+  size_t getMessageSpoolCapacity() const;
+
+  // Push - 新消息推送
+  int getPushMaxWaitMs() const;
+  size_t getPushHighWatermark() const;
+  size_t getPushLowWatermark() const;
+  std::string getPushSlowConsumerPolicy() const;
+  int getPushIdleSeconds() const;
+  bool getPushSubscriberEnabled() const;
+  int getPushSubscriberPollMs() const;
+  int getPushPresenceTtlSeconds() const;
+
+  // Search - 消息全文搜索
+  bool getSearchEnabled() const;
+  std::string getSearchDirectory() const;
+  size_t getSearchFlushPostings() const;
+  size_t getSearchMaxSegments() const;
+  int getSearchCatchUpSeconds() const;
+  int getSearchCatchUpBatch() const;
+
+  // Metrics
+  bool getMetricsEnabled() const;
+  int getMetricsPort() const;
+
+  // Cluster - 聊天室归属和请求转发
+  bool getClusterEnabled() const;
+  std::string getClusterAdvertiseHost() const;
+  int getClusterLeaseSeconds() const;
+  int getClusterVirtualNodes() const;
+  int getClusterForwardTimeoutMs() const;
+  size_t getClusterHotTimelineSize() const;
 
   // Logging
   std::string getLoggingBaseName() const;
   starry::LogLevel getLoggingLevel() const;
   int64_t getLoggingRollSize() const;
   int64_t getLoggingRefreshInterval() const;
+  const std::map<std::string, starry::LogLevel>& getLoggingModuleLevels() const;
+  bool getLoggingBinaryEnabled() const;
+  std::string getLoggingBinaryBaseName() const;
 
  private:
   Config() = default;
@@ -56,6 +147,15 @@ class Config {
   std::string serverHost_;
   int serverPort_;
   int serverThreads_;
+  std::string serverNodeId_;  // 可选，默认为 主机名:端口
+
+  // Server - 准入控制（可选配置，maxInflight 为 0 时取 IO 线程数）
+  bool admissionEnabled_{false};
+  int admissionMaxInflight_{0};
+  double admissionNormalShare_{0.75};
+  double admissionBulkShare_{0.5};
+  int admissionTargetLatencyMs_{50};
+  int admissionBulkTargetLatencyMs_{200};
 
   // Database -- MariaDB
   std::string mariaDBHost_;
@@ -65,18 +165,102 @@ class Config {
   std::string mariaDBDatabase_;
   int mariaDBPoolSize_;
 
+  // 只读从库（可选配置，为空时所有连接使用主库）
+  std::vector<std::string> mariaDBReplicas_;
+  int mariaDBReadYourWritesSeconds_{5};
+  int mariaDBReplicaMaxLagSeconds_{10};
+  int mariaDBReplicaProbeSeconds_{5};
+
+  // messages 表按月分区（可选配置，默认不维护分区）
+  bool messagePartitionsEnabled_{false};
+  int messagePartitionsMonthsAhead_{3};
+  int messagePartitionsRetentionMonths_{0};
+  bool messagePartitionsArchive_{true};
+  int messagePartitionsMaintenanceHours_{24};
+  std::string messagePartitionsSegmentDirectory_;
+
   // Database - Redis
   std::string redisHost_;
   int redisPort_;
   std::string redisPassword_;
   int redisDB_;
   int redisPoolSize_;
+  std::string redisMode_{"standalone"};  // standalone 或 cluster
+
+  // Security - 登录限流（可选配置，未设置时使用默认值）
+  int loginBucketCapacity_{10};
+  int loginRefillPerMinute_{6};
+  int loginFailureWindow_{300};
+  int loginMaxFailures_{5};
+  int loginLockoutSeconds_{900};
+  int loginSyncInterval_{10};
+  int loginFlushInterval_{5};
+
+  // Cache - 用户名过滤器（可选配置）
+  size_t usernameFilterExpectedItems_{1000000};
+  double usernameFilterFalsePositiveRate_{0.01};
+  int usernameFilterScanBatch_{10000};
+  int usernameFilterRebuildInterval_{3600};
+
+  // Cache - 好友邻接表（可选配置）
+  size_t friendCacheCapacity_{100000};
+  int friendCacheTtlSeconds_{60};
+
+  // Cache - 消息缓存压缩（可选配置）
+  bool messageCacheCompression_{false};
+  size_t messageCacheMinSize_{128};
+  int messageCacheLevel_{3};
+  std::string messageCacheDictionary_;
+
+  // Resilience - 熔断与降级（可选配置）
+  int breakerWindowSeconds_{10};
+  int breakerMinCalls_{20};
+  double breakerFailureRate_{0.5};
+  double breakerSlowCallRate_{0.8};
+  int breakerOpenSeconds_{5};
+  int breakerHalfOpenProbes_{3};
+  int mariaDBSlowCallMs_{1000};
+  int redisSlowCallMs_{100};
+  size_t messageSpoolCapacity_{10000};
+
+  // Push - 新消息推送（可选配置）
+  int pushMaxWaitMs_{25000};
+  size_t pushHighWatermark_{256};
+  size_t pushLowWatermark_{64};
+  std::string pushSlowConsumerPolicy_{"resync"};
+  int pushIdleSeconds_{90};
+  bool pushSubscriberEnabled_{true};
+  int pushSubscriberPollMs_{5};
+  int pushPresenceTtlSeconds_{60};
+
+  // Search - 消息全文搜索（可选配置）
+  bool searchEnabled_{false};
+  std::string searchDirectory_{"search"};
+  size_t searchFlushPostings_{200000};
+  size_t searchMaxSegments_{8};
+  int searchCatchUpSeconds_{5};
+  int searchCatchUpBatch_{1000};
+
+  // Metrics（可选配置）
+  bool metricsEnabled_{true};
+  int metricsPort_{9100};
+
+  // Cluster（可选配置，advertiseHost 默认为主机名）
+  bool clusterEnabled_{false};
+  std::string clusterAdvertiseHost_;
+  int clusterLeaseSeconds_{10};
+  int clusterVirtualNodes_{64};
+  int clusterForwardTimeoutMs_{3000};
+  size_t clusterHotTimelineSize_{200};
 
   // Logging
   std::string loggingBaseName_;
   starry::LogLevel loggingLevel_;
   off_t loggingRollSize_;
   int64_t loggingRefreshInterval_;
+  std::map<std::string, starry::LogLevel> loggingModuleLevels_;
+  bool loggingBinaryEnabled_{false};
+  std::string loggingBinaryBaseName_{"StarryChat.bin"};
 };
 
 }  // namespace StarryChat
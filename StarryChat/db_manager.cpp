@@ -1,14 +1,121 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
 #include "config.h"
 #include "db_manager.h"
+#include "deadline.h"
 #include "logging.h"
+#include "mariadb_store.h"
 
 namespace StarryChat {
 
+namespace {
+
+// 由SQL生成低基数的语句标签：动词 + 表名，如 "select users"
+std::string statementLabel(const std::string& sql) {
+  std::istringstream iss(sql);
+  std::string word;
+  std::string verb;
+  std::string table;
+  bool expectTable = false;
+
+  while (iss >> word) {
+    std::transform(word.begin(), word.end(), word.begin(),
+                   [](unsigned char ch) { return std::tolower(ch); });
+    if (verb.empty()) {
+      verb = word;
+      expectTable = (verb == "update");
+      continue;
+    }
+    if (expectTable) {
+      table = word;
+      break;
+    }
+    if (word == "from" || word == "into") {
+      expectTable = true;
+    }
+  }
+
+  table.erase(std::remove_if(table.begin(), table.end(),
+                             [](unsigned char ch) {
+                               return !std::isalnum(ch) && ch != '_';
+                             }),
+              table.end());
+  return table.empty() ? verb : verb + " " + table;
+}
+
+// 按完整SQL缓存语句的耗时直方图，避免每次执行都解析标签
+Histogram& statementLatency(const std::string& sql) {
+  thread_local std::unordered_map<std::string, Histogram*> cache;
+  auto it = cache.find(sql);
+  if (it != cache.end()) {
+    return *it->second;
+  }
+
+  auto& histogram = DBManager::queryLatency(statementLabel(sql));
+  cache.emplace(sql, &histogram);
+  return histogram;
+}
+
+constexpr int kStatementTimeout = 1969;  // ER_STATEMENT_TIMEOUT
+
+// 语句超时由当前请求的截止时间换算而来（见 DBManager::connect），
+// 说明客户端给的时间不够，而不是数据库不可用
+bool isDeadlineTimeout(const sql::SQLException& e) {
+  return e.getErrorCode() == kStatementTimeout &&
+         RequestDeadline::remaining().has_value();
+}
+
+// 设置会话的语句超时（MariaDB max_statement_time，单位秒，0 表示不限）
+void setStatementTimeout(sql::Connection& conn,
+                         std::chrono::milliseconds timeout) {
+  std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+  stmt->execute("SET SESSION max_statement_time = " +
+                std::to_string(timeout.count() / 1000.0));
+}
+
+}  // namespace
+
+thread_local DBManager::ConnectionOrigin DBManager::failedOrigin_;
+
+Histogram& DBManager::queryLatency(const std::string& statement) {
+  // 线程内缓存，热路径上不访问注册表的锁
+  thread_local std::unordered_map<std::string, Histogram*> cache;
+  auto it = cache.find(statement);
+  if (it != cache.end()) {
+    return *it->second;
+  }
+
+  auto& histogram = MetricsRegistry::getInstance().histogram(
+      "starrychat_db_query_latency_seconds", "Database statement latency",
+      {{"statement", statement}});
+  cache.emplace(statement, &histogram);
+  return histogram;
+}
+
 DBManager& DBManager::getInstance() {
   static DBManager instance;
   return instance;
 }
 
+DBManager::~DBManager() {
+  stopProbe();
+}
+
+DBManager::Replica::Replica(std::string name, sql::Properties props)
+    : name(std::move(name)),
+      props(std::move(props)),
+      lag(MetricsRegistry::getInstance().gauge(
+          "starrychat_db_replica_lag_seconds",
+          "Replication lag reported by the replica's last probe",
+          {{"replica", this->name}})),
+      up(MetricsRegistry::getInstance().gauge(
+          "starrychat_db_replica_healthy",
+          "Whether the replica receives read-only connections",
+          {{"replica", this->name}})) {}
+
 bool DBManager::initialize() {
   std::lock_guard<std::mutex> lock(mutex_);
 
@@ -33,8 +140,37 @@ bool DBManager::initialize() {
     connectionProps_["pool_idle_timeout"] = "300";  // 5分钟
     connectionProps_["pool_queue_timeout"] = "30";  // 30秒
 
+    // 数据库熔断参数
+    CircuitBreakerOptions breakerOptions;
+    breakerOptions.windowSeconds = config.getBreakerWindowSeconds();
+    breakerOptions.minCalls = config.getBreakerMinCalls();
+    breakerOptions.failureRate = config.getBreakerFailureRate();
+    breakerOptions.slowCallMs = config.getMariaDBSlowCallMs();
+    breakerOptions.slowCallRate = config.getBreakerSlowCallRate();
+    breakerOptions.openSeconds = config.getBreakerOpenSeconds();
+    breakerOptions.halfOpenProbes = config.getBreakerHalfOpenProbes();
+    breaker_.configure(breakerOptions);
+
+    // 从库使用主库的账号和库名，各自一个连接池
+    readYourWrites_ =
+        std::chrono::seconds(config.getMariaDBReadYourWritesSeconds());
+    maxReplicaLag_ =
+        std::chrono::seconds(config.getMariaDBReplicaMaxLagSeconds());
+    probeInterval_ =
+        std::chrono::seconds(config.getMariaDBReplicaProbeSeconds());
+    replicas_.clear();
+    for (const auto& address : config.getMariaDBReplicas()) {
+      auto colon = address.rfind(':');
+      sql::Properties props = connectionProps_;
+      props["hostName"] = address.substr(0, colon);
+      props["port"] = address.substr(colon + 1);
+      replicas_.push_back(
+          std::make_unique<Replica>(address, std::move(props)));
+    }
+
     // 获取MariaDB驱动实例
     driver_ = sql::mariadb::get_driver_instance();
+    store_ = std::make_unique<MariaDBStore>();
 
     initialized_ = true;
 
@@ -45,6 +181,16 @@ bool DBManager::initialize() {
       return false;
     }
 
+    // 先探测一次，启动后只读连接即可路由到从库
+    if (!replicas_.empty()) {
+      for (auto& replica : replicas_) {
+        probeReplica(*replica);
+      }
+      probing_ = true;
+      probeThread_ = std::thread([this] { runProbe(); });
+      LOG_INFO << "Database read replicas configured: " << replicas_.size();
+    }
+
     LOG_INFO << "Database connection initialized successfully";
 
     return true;
@@ -60,16 +206,54 @@ bool DBManager::initialize() {
   }
 }
 
-std::shared_ptr<sql::Connection> DBManager::getConnection() {
+bool DBManager::initialize(std::unique_ptr<DBStore> store) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (initialized_ || !store) {
+    return initialized_;
+  }
+
+  store_ = std::move(store);
+  initialized_ = true;
+  return true;
+}
+
+std::shared_ptr<sql::Connection> DBManager::getConnection(DBAccess access,
+                                                         uint64_t userId) {
   if (!initialized_) {
     LOG_ERROR << "Database not initialized. Call initialize() first.";
     return nullptr;
   }
 
+  // 注入内存存储时没有数据库连接
+  if (!driver_) {
+    return nullptr;
+  }
+
+  static auto& connectErrors = MetricsRegistry::getInstance().counter(
+      "starrychat_db_connect_errors_total", "Database connect failures");
+
+  // 客户端已放弃等待，不再占用连接；由处理器的异常分支应答
+  if (RequestDeadline::exceeded(DeadlineStage::kDB)) {
+    throw DeadlineExceeded("Request deadline exceeded before database call");
+  }
+
+  if (access == DBAccess::kReadOnly) {
+    if (auto conn = replicaConnection(userId)) {
+      return conn;
+    }
+  }
+
+  // 熔断打开时不再尝试连接，调用方快速失败
+  if (!breaker_.allow()) {
+    throw BackendUnavailable("Database circuit breaker is open");
+  }
+
   try {
-    // 使用智能指针管理连接生命周期
-    return std::shared_ptr<sql::Connection>(driver_->connect(connectionProps_));
+    return connect(connectionProps_, ConnectionOrigin{&breaker_, nullptr});
   } catch (sql::SQLException& e) {
+    connectErrors.inc();
+    breaker_.recordFailure();
     LOG_ERROR << "Error getting database connection: " << e.what()
               << ", Error code: " << e.getErrorCode()
               << ", SQL state: " << e.getSQLState();
@@ -77,11 +261,236 @@ std::shared_ptr<sql::Connection> DBManager::getConnection() {
   }
 }
 
+std::shared_ptr<sql::Connection> DBManager::connect(
+    const sql::Properties& props,
+    ConnectionOrigin origin) {
+  static auto& connectLatency = MetricsRegistry::getInstance().histogram(
+      "starrychat_db_connect_latency_seconds", "Database connect latency");
+
+  std::unique_ptr<sql::Connection> conn;
+  {
+    ScopedTimer timer(connectLatency);
+    conn.reset(driver_->connect(props));
+  }
+
+  // 剩余时间作为语句超时；连接归还连接池前恢复默认值，
+  // 避免影响之后没有截止时间的请求
+  auto remaining = RequestDeadline::remaining();
+  if (remaining) {
+    setStatementTimeout(*conn,
+                        std::max(*remaining, std::chrono::milliseconds(1)));
+  }
+
+  return std::shared_ptr<sql::Connection>(
+      conn.release(), ConnectionRelease{origin, remaining.has_value()});
+}
+
+void DBManager::ConnectionRelease::operator()(sql::Connection* raw) const {
+  if (resetTimeout) {
+    try {
+      setStatementTimeout(*raw, std::chrono::milliseconds(0));
+    } catch (sql::SQLException& e) {
+      LOG_WARN << "Failed to reset statement timeout: " << e.what();
+    }
+  }
+  delete raw;
+}
+
+std::shared_ptr<sql::Connection> DBManager::replicaConnection(
+    uint64_t userId) {
+  static auto& replicaReads = MetricsRegistry::getInstance().counter(
+      "starrychat_db_replica_reads_total",
+      "Read-only connections served by a replica");
+  static auto& primaryReads = MetricsRegistry::getInstance().counter(
+      "starrychat_db_replica_fallbacks_total",
+      "Read-only connections sent to the primary instead of a replica",
+      {{"reason", "no_replica"}});
+  static auto& readYourWrites = MetricsRegistry::getInstance().counter(
+      "starrychat_db_replica_fallbacks_total",
+      "Read-only connections sent to the primary instead of a replica",
+      {{"reason", "read_your_writes"}});
+
+  if (replicas_.empty()) {
+    return nullptr;
+  }
+
+  // 用户刚写入的数据可能还没有复制到从库
+  if (userId != 0 && wroteRecently(userId)) {
+    readYourWrites.inc();
+    return nullptr;
+  }
+
+  // 从轮询位置开始找第一个健康的从库
+  size_t start = nextReplica_.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < replicas_.size(); ++i) {
+    auto& replica = *replicas_[(start + i) % replicas_.size()];
+    if (!replica.healthy.load(std::memory_order_relaxed)) {
+      continue;
+    }
+
+    try {
+      auto conn = connect(replica.props, ConnectionOrigin{nullptr, &replica});
+      replicaReads.inc();
+      return conn;
+    } catch (sql::SQLException& e) {
+      removeReplica(replica, e.what());
+    }
+  }
+
+  primaryReads.inc();
+  return nullptr;
+}
+
+void DBManager::removeReplica(Replica& replica, const char* reason) {
+  if (replica.healthy.exchange(false)) {
+    LOG_WARN << "Replica " << replica.name
+             << " removed from reads until the next probe: " << reason;
+  }
+  replica.up.set(0);
+}
+
+void DBManager::noteWrite(uint64_t userId) {
+  if (replicas_.empty() || userId == 0) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(writesMutex_);
+  recentWrites_[userId] = now;
+
+  // 写入频繁时顺带清理过期记录，避免无限增长
+  if (recentWrites_.size() > 100000) {
+    std::erase_if(recentWrites_, [&](const auto& entry) {
+      return now - entry.second >= readYourWrites_;
+    });
+  }
+}
+
+bool DBManager::wroteRecently(uint64_t userId) {
+  std::lock_guard<std::mutex> lock(writesMutex_);
+  auto it = recentWrites_.find(userId);
+  if (it == recentWrites_.end()) {
+    return false;
+  }
+  if (std::chrono::steady_clock::now() - it->second < readYourWrites_) {
+    return true;
+  }
+  recentWrites_.erase(it);
+  return false;
+}
+
+void DBManager::runProbe() {
+  while (probing_) {
+    {
+      std::unique_lock<std::mutex> lock(probeMutex_);
+      probeWake_.wait_for(lock, probeInterval_, [this] { return !probing_; });
+    }
+    if (!probing_) {
+      break;
+    }
+
+    for (auto& replica : replicas_) {
+      probeReplica(*replica);
+    }
+  }
+}
+
+void DBManager::stopProbe() {
+  if (!probing_.exchange(false)) {
+    return;
+  }
+  probeWake_.notify_all();
+  if (probeThread_.joinable()) {
+    probeThread_.join();
+  }
+}
+
+void DBManager::probeReplica(Replica& replica) {
+  // 复制中断（Seconds_Behind_Master 为 NULL）、延迟超限或不可达时摘除
+  bool healthy = false;
+  try {
+    std::unique_ptr<sql::Connection> conn(driver_->connect(replica.props));
+    std::unique_ptr<sql::Statement> stmt(conn->createStatement());
+    std::unique_ptr<sql::ResultSet> rs(
+        stmt->executeQuery("SHOW SLAVE STATUS"));
+    if (rs->next() && !rs->isNull("Seconds_Behind_Master")) {
+      int lag = rs->getInt("Seconds_Behind_Master");
+      replica.lag.set(lag);
+      healthy = lag <= maxReplicaLag_.count();
+    }
+  } catch (sql::SQLException& e) {
+    LOG_WARN << "Replica " << replica.name << " probe failed: " << e.what();
+  }
+
+  if (replica.healthy.exchange(healthy) != healthy) {
+    if (healthy) {
+      LOG_INFO << "Replica " << replica.name << " is serving reads";
+    } else {
+      LOG_WARN << "Replica " << replica.name
+               << " removed from reads, lag " << replica.lag.value() << "s";
+    }
+  }
+  replica.up.set(healthy ? 1 : 0);
+}
+
+// 连接中断、服务端不可达、锁等待超时和语句超时
+bool DBManager::isAvailabilityError(const sql::SQLException& e) {
+  if (isDeadlineTimeout(e)) {
+    return false;
+  }
+
+  switch (e.getErrorCode()) {
+    case 1205:  // ER_LOCK_WAIT_TIMEOUT
+    case kStatementTimeout:
+    case 2002:  // CR_CONNECTION_ERROR
+    case 2003:  // CR_CONN_HOST_ERROR
+    case 2006:  // CR_SERVER_GONE_ERROR
+    case 2013:  // CR_SERVER_LOST
+      return true;
+    default:
+      return std::string(e.getSQLState()).rfind("08", 0) == 0;
+  }
+}
+
+void DBManager::reportError(const sql::SQLException& e) {
+  // 其他途径的错误（没有经过 TimedStatement）来自主库
+  auto origin = std::exchange(failedOrigin_, ConnectionOrigin{});
+  if (isDeadlineTimeout(e)) {
+    RequestDeadline::abandon(DeadlineStage::kDB);
+    return;
+  }
+  if (!isAvailabilityError(e)) {
+    return;
+  }
+
+  auto& manager = getInstance();
+  if (origin.replica) {
+    manager.removeReplica(*origin.replica, e.what());
+  } else {
+    manager.breaker_.recordFailure();
+  }
+}
+
+DBManager::ConnectionOrigin DBManager::originOf(
+    const std::shared_ptr<sql::Connection>& conn) {
+  auto* release = std::get_deleter<ConnectionRelease>(conn);
+  return release ? release->origin : ConnectionOrigin{};
+}
+
+bool DBManager::servedByReplica(const std::shared_ptr<sql::Connection>& conn) {
+  return originOf(conn).replica != nullptr;
+}
+
 void DBManager::shutdown() {
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (initialized_) {
+    stopProbe();
+    replicas_.clear();
+
     // 断开所有连接 - mariadb-connector-c++会处理连接池的关闭
+    store_.reset();
+    driver_ = nullptr;
     initialized_ = false;
     LOG_INFO << "Database connections shut down";
   }
@@ -95,9 +504,11 @@ std::unique_ptr<sql::ResultSet> DBManager::executeQuery(
   }
 
   try {
+    ScopedTimer timer(queryLatency(statementLabel(sql)));
     std::unique_ptr<sql::Statement> stmt(conn->createStatement());
     return std::unique_ptr<sql::ResultSet>(stmt->executeQuery(sql));
   } catch (sql::SQLException& e) {
+    reportError(e);
     LOG_ERROR << "Query execution error: " << e.what() << ", SQL: " << sql;
     return nullptr;
   }
@@ -110,14 +521,67 @@ int DBManager::executeUpdate(const std::string& sql) {
   }
 
   try {
+    ScopedTimer timer(queryLatency(statementLabel(sql)));
     std::unique_ptr<sql::Statement> stmt(conn->createStatement());
     return stmt->executeUpdate(sql);
   } catch (sql::SQLException& e) {
+    reportError(e);
     LOG_ERROR << "Update execution error: " << e.what() << ", SQL: " << sql;
     return -1;
   }
 }
 
+TimedStatement::TimedStatement(const std::shared_ptr<sql::Connection>& conn,
+                               const std::string& sql)
+    : stmt_(conn->prepareStatement(sql)),
+      latency_(statementLatency(sql)),
+      origin_(DBManager::originOf(conn)) {}
+
+TimedStatement::TimedStatement(const std::shared_ptr<sql::Connection>& conn,
+                               const std::string& sql,
+                               int autoGeneratedKeys)
+    : stmt_(conn->prepareStatement(sql, autoGeneratedKeys)),
+      latency_(statementLatency(sql)),
+      origin_(DBManager::originOf(conn)) {}
+
+// 截止时间换算的语句超时按 DeadlineExceeded 抛出，处理器按超时应答，
+// 也不会经 reportError 计入熔断；其他失败由调用方经 reportError 按连接的
+// 来源上报
+template <typename Func>
+auto TimedStatement::run(Func func) {
+  auto start = std::chrono::steady_clock::now();
+  try {
+    auto result = func();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    latency_.record(elapsed.count());
+    if (origin_.breaker) {
+      origin_.breaker->recordSuccess(elapsed);
+    }
+    return result;
+  } catch (sql::SQLException& e) {
+    DBManager::failedOrigin_ = origin_;
+    latency_.recordSince(start);
+    if (isDeadlineTimeout(e)) {
+      RequestDeadline::abandon(DeadlineStage::kDB);
+      throw DeadlineExceeded("Statement timed out at request deadline");
+    }
+    throw;
+  }
+}
+
+sql::ResultSet* TimedStatement::executeQuery() {
+  return run([this] { return stmt_->executeQuery(); });
+}
+
+int TimedStatement::executeUpdate() {
+  return run([this] { return stmt_->executeUpdate(); });
+}
+
+bool TimedStatement::execute() {
+  return run([this] { return stmt_->execute(); });
+}
+
 std::unique_ptr<sql::PreparedStatement> DBManager::prepareStatement(
     const std::string& sql,
     bool returnGeneratedKeys) {
@@ -135,6 +599,7 @@ std::unique_ptr<sql::PreparedStatement> DBManager::prepareStatement(
           conn->prepareStatement(sql));
     }
   } catch (sql::SQLException& e) {
+    reportError(e);
     LOG_ERROR << "Prepare statement error: " << e.what() << ", SQL: " << sql;
     return nullptr;
   }
@@ -1,15 +1,29 @@
 #pragma once
 
 #include <mariadb/conncpp.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "circuit_breaker.h"
+#include "db_store.h"
+#include "metrics.h"
 
 namespace StarryChat {
 
+// 连接用途：只读连接可以路由到从库
+enum class DBAccess { kReadWrite, kReadOnly };
+
 /**
  * 数据库管理类 - 负责管理MariaDB连接
  * 使用单例模式设计，提供连接池管理
+ * 配置了从库时主库和每个从库各有一个连接池，只读连接轮询分配到
+ * 健康且延迟不超过上限的从库；后台线程定期探测各从库的复制延迟。
  */
 class DBManager {
  public:
@@ -33,12 +47,62 @@ class DBManager {
    */
   bool initialize();
 
+  /**
+   * 使用指定的存储实现初始化，不创建数据库连接
+   * 用于基准测试注入内存替身，此时 getConnection 返回空指针
+   * @return 初始化是否成功
+   */
+  bool initialize(std::unique_ptr<DBStore> store);
+
+  /**
+   * 获取热路径操作的存储实现
+   * 必须在初始化成功后调用
+   */
+  DBStore& store() { return *store_; }
+
   /**
    * 获取数据库连接
-   * 从连接池获取一个可用连接
+   * 从连接池获取一个可用连接；熔断打开时抛出 BackendUnavailable
+   * kReadOnly 时优先使用从库；userId 在最近写入窗口内、没有可用从库
+   * 或从库连接失败时回到主库
+   * @param access 连接用途
+   * @param userId 发起读取的用户，用于保证读到自己的写入，0 表示不限
    * @return 数据库连接的智能指针
    */
-  std::shared_ptr<sql::Connection> getConnection();
+  std::shared_ptr<sql::Connection> getConnection(
+      DBAccess access = DBAccess::kReadWrite,
+      uint64_t userId = 0);
+
+  /**
+   * 记录用户的写入，之后 readYourWritesSeconds 内该用户的只读连接使用主库
+   */
+  void noteWrite(uint64_t userId);
+
+  /**
+   * 数据库是否处于熔断（降级）状态
+   * 降级时读请求只使用 Redis，发送的消息暂存到本地队列
+   */
+  bool degraded() const { return breaker_.isOpen(); }
+
+  /**
+   * 上报 SQL 异常，连接中断、锁等待超时等可用性错误计入熔断统计
+   * 约束冲突等业务错误不计入；请求截止时间换算的语句超时计入
+   * starrychat_deadline_exceeded_total{stage="db"}
+   * 出错的语句在从库连接上执行时（由 TimedStatement 记录），摘除该从库
+   * 而不计入主库的熔断
+   */
+  static void reportError(const sql::SQLException& e);
+
+  /**
+   * 连接是否来自从库
+   * 从库的结果可能落后于其他用户刚提交的写入，不应回填各节点共享的缓存
+   */
+  static bool servedByReplica(const std::shared_ptr<sql::Connection>& conn);
+
+  /**
+   * 是否为连接中断、锁等待超时等数据库不可用的错误，重试可能成功
+   */
+  static bool isAvailabilityError(const sql::SQLException& e);
 
   /**
    * 关闭数据库连接池
@@ -81,6 +145,8 @@ class DBManager {
     if (!conn)
       return false;
 
+    ScopedTimer timer(queryLatency("transaction"));
+
     try {
       conn->setAutoCommit(false);
 
@@ -94,26 +160,133 @@ class DBManager {
         return false;
       }
     } catch (sql::SQLException& e) {
+      reportError(e);
       conn->rollback();
       // 记录错误
       return false;
     }
   }
 
+  /**
+   * 获取语句的执行耗时直方图
+   * @param statement 语句标签，如 "select users"
+   */
+  static Histogram& queryLatency(const std::string& statement);
+
  private:
+  struct Replica {
+    Replica(std::string name, sql::Properties props);
+
+    std::string name;  // host:port
+    sql::Properties props;
+    std::atomic<bool> healthy{false};
+    Gauge& lag;
+    Gauge& up;
+  };
+
+  // 连接来自主库还是哪个从库
+  struct ConnectionOrigin {
+    CircuitBreaker* breaker{nullptr};  // 主库连接的熔断器
+    Replica* replica{nullptr};
+  };
+
+  // 连接的删除器：归还前恢复语句超时，并记录连接的来源
+  struct ConnectionRelease {
+    ConnectionOrigin origin;
+    bool resetTimeout;
+
+    void operator()(sql::Connection* raw) const;
+  };
+
+  static ConnectionOrigin originOf(
+      const std::shared_ptr<sql::Connection>& conn);
+
+  // 本线程最近一次失败语句所在连接的来源，由 reportError 取走
+  static thread_local ConnectionOrigin failedOrigin_;
+
+  friend class TimedStatement;
+
   /**
    * 私有构造函数，实现单例模式
    */
   DBManager() = default;
-  ~DBManager() = default;
+  ~DBManager();
+
+  // 建立连接并按当前请求的截止时间设置语句超时
+  std::shared_ptr<sql::Connection> connect(const sql::Properties& props,
+                                           ConnectionOrigin origin);
+
+  // 可用从库的连接，没有时返回 nullptr
+  std::shared_ptr<sql::Connection> replicaConnection(uint64_t userId);
+  bool wroteRecently(uint64_t userId);
+  // 下一次探测成功前不再使用该从库
+  void removeReplica(Replica& replica, const char* reason);
+
+  void runProbe();
+  void stopProbe();
+  void probeReplica(Replica& replica);
 
   // MariaDB驱动和连接属性
   sql::Driver* driver_{nullptr};
   sql::Properties connectionProps_;
 
+  // 从库
+  std::vector<std::unique_ptr<Replica>> replicas_;
+  std::atomic<size_t> nextReplica_{0};
+  std::chrono::seconds readYourWrites_{5};
+  std::chrono::seconds maxReplicaLag_{10};
+  std::chrono::seconds probeInterval_{5};
+
+  std::mutex writesMutex_;
+  std::unordered_map<uint64_t, std::chrono::steady_clock::time_point>
+      recentWrites_;
+
+  std::thread probeThread_;
+  std::atomic<bool> probing_{false};
+  std::mutex probeMutex_;
+  std::condition_variable probeWake_;
+
+  std::unique_ptr<DBStore> store_;
+  CircuitBreaker breaker_{"mariadb"};
+
   // 连接池状态
   bool initialized_{false};
   std::mutex mutex_;
 };
 
+/**
+ * 计时的预处理语句
+ * 执行耗时按语句标签（动词 + 表名）记入 starrychat_db_query_latency_seconds，
+ * 主库连接上的耗时同时反馈给熔断器，用于发现变慢的数据库。
+ * 直接使用连接的代码通过它准备语句，绑定参数等经 -> 访问底层语句，
+ * 执行必须调用这里的 executeQuery / executeUpdate / execute。
+ * 由请求截止时间换算的语句超时转换为 DeadlineExceeded。
+ */
+class TimedStatement {
+ public:
+  TimedStatement(const std::shared_ptr<sql::Connection>& conn,
+                 const std::string& sql);
+  // autoGeneratedKeys 为 sql::Statement::RETURN_GENERATED_KEYS 等
+  TimedStatement(const std::shared_ptr<sql::Connection>& conn,
+                 const std::string& sql,
+                 int autoGeneratedKeys);
+
+  TimedStatement(const TimedStatement&) = delete;
+  TimedStatement& operator=(const TimedStatement&) = delete;
+
+  sql::PreparedStatement* operator->() const { return stmt_.get(); }
+
+  sql::ResultSet* executeQuery();
+  int executeUpdate();
+  bool execute();
+
+ private:
+  template <typename Func>
+  auto run(Func func);
+
+  std::unique_ptr<sql::PreparedStatement> stmt_;
+  Histogram& latency_;
+  DBManager::ConnectionOrigin origin_;
+};
+
 }  // namespace StarryChat
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include "message.pb.h"
+#include "user.h"
+
+namespace StarryChat {
+
+/**
+ * 热路径数据库操作接口
+ * 覆盖登录和发送消息每次请求都会执行的语句，其余查询仍直接使用连接。
+ * 默认实现为 MariaDBStore，基准测试可通过 DBManager 注入内存替身。
+ * 数据库错误以 sql::SQLException 或 std::exception 抛出，由调用方处理。
+ */
+class DBStore {
+ public:
+  virtual ~DBStore() = default;
+
+  /**
+   * 查询用户，返回的对象包含密码哈希和盐
+   * @return 用户不存在时返回 nullopt
+   */
+  virtual std::optional<User> findUserById(uint64_t userId) = 0;
+  virtual std::optional<User> findUserByUsername(
+      const std::string& username) = 0;
+
+  /**
+   * 登录成功后更新在线状态、登录时间并清零失败次数
+   */
+  virtual void recordLogin(uint64_t userId, uint64_t loginTime) = 0;
+
+  /**
+   * 写入消息及其提及的用户
+   * @return 新消息ID，写入失败返回 0
+   */
+  virtual uint64_t insertMessage(const starrychat::Message& message) = 0;
+};
+
+}  // namespace StarryChat
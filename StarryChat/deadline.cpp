@@ -0,0 +1,72 @@
+#include "deadline.h"
+
+#include <google/protobuf/descriptor.h>
+#include <algorithm>
+#include <string>
+#include "metrics.h"
+
+namespace StarryChat {
+
+namespace {
+
+thread_local std::optional<RequestDeadline::Clock::time_point> t_deadline;
+
+Counter& abandonedWork(const std::string& stage) {
+  return MetricsRegistry::getInstance().counter(
+      "starrychat_deadline_exceeded_total",
+      "Work skipped because the client deadline had passed",
+      {{"stage", stage}});
+}
+
+}  // namespace
+
+RequestDeadline::RequestDeadline(const google::protobuf::Message& request)
+    : previous_(t_deadline) {
+  using google::protobuf::FieldDescriptor;
+
+  t_deadline.reset();
+  const auto* field = request.GetDescriptor()->FindFieldByName("timeout_ms");
+  if (!field || field->cpp_type() != FieldDescriptor::CPPTYPE_UINT32) {
+    return;
+  }
+
+  uint32_t timeoutMs = request.GetReflection()->GetUInt32(request, field);
+  if (timeoutMs > 0) {
+    t_deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+  }
+}
+
+RequestDeadline::~RequestDeadline() {
+  t_deadline = previous_;
+}
+
+bool RequestDeadline::expired() const {
+  return exceeded(DeadlineStage::kHandler);
+}
+
+std::optional<std::chrono::milliseconds> RequestDeadline::remaining() {
+  if (!t_deadline) {
+    return std::nullopt;
+  }
+
+  auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      *t_deadline - Clock::now());
+  return std::max(left, std::chrono::milliseconds(0));
+}
+
+bool RequestDeadline::exceeded(DeadlineStage stage) {
+  if (!t_deadline || Clock::now() < *t_deadline) {
+    return false;
+  }
+
+  abandon(stage);
+  return true;
+}
+
+void RequestDeadline::abandon(DeadlineStage stage) {
+  static Counter* counters[] = {&abandonedWork("handler"),
+                                &abandonedWork("db"), &abandonedWork("redis")};
+  counters[static_cast<int>(stage)]->inc();
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <google/protobuf/message.h>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include "common.pb.h"
+
+namespace StarryChat {
+
+// 因超时而被跳过的环节，用作指标标签
+enum class DeadlineStage { kHandler, kDB, kRedis };
+
+/**
+ * 请求截止时间
+ * 客户端在请求的 timeout_ms 字段中给出超时（相对时间，不受时钟偏差影响），
+ * 服务端从处理器开始执行时计时。处理器在 IO 线程上同步执行，
+ * 当前请求的截止时间保存在线程局部变量中，DBManager 和 RedisManager
+ * 无需改动调用参数即可读取。
+ */
+class RequestDeadline {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * 从请求读取 timeout_ms 并设为当前线程的截止时间，析构时恢复
+   * 请求没有该字段或值为 0 时不设截止时间
+   */
+  explicit RequestDeadline(const google::protobuf::Message& request);
+  ~RequestDeadline();
+
+  RequestDeadline(const RequestDeadline&) = delete;
+  RequestDeadline& operator=(const RequestDeadline&) = delete;
+
+  /**
+   * 处理器在昂贵的步骤之前调用，已超时时计入放弃的工作
+   */
+  bool expired() const;
+
+  /**
+   * 当前线程的剩余时间，没有截止时间时返回 nullopt，已超时返回 0
+   */
+  static std::optional<std::chrono::milliseconds> remaining();
+
+  /**
+   * 当前线程的请求是否已超时，超时时按 stage 计入放弃的工作
+   */
+  static bool exceeded(DeadlineStage stage);
+
+  /**
+   * 已确认因超时放弃的工作按 stage 计数，如截止时间换算的语句超时
+   */
+  static void abandon(DeadlineStage stage);
+
+ private:
+  std::optional<Clock::time_point> previous_;
+};
+
+/**
+ * 客户端已放弃等待的调用
+ */
+class DeadlineExceeded : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * 将响应标记为超时失败
+ * 响应中没有的字段跳过，与 replyError 一致
+ */
+template <typename Response>
+void setDeadlineExceeded(Response* response) {
+  if constexpr (requires { response->set_success(false); }) {
+    response->set_success(false);
+  }
+  if constexpr (requires { response->set_error_message(""); }) {
+    response->set_error_message("Deadline exceeded");
+  }
+  if constexpr (requires {
+                  response->set_error_code(
+                      starrychat::ERROR_CODE_DEADLINE_EXCEEDED);
+                }) {
+    response->set_error_code(starrychat::ERROR_CODE_DEADLINE_EXCEEDED);
+  }
+}
+
+}  // namespace StarryChat
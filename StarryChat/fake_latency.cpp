@@ -0,0 +1,34 @@
+#include "fake_latency.h"
+
+namespace StarryChat {
+
+namespace {
+
+// splitmix64：由序号直接得到伪随机数，不需要每线程保存生成器状态
+uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+void FakeLatency::roundTrip() {
+  auto delay = options_.base;
+  if (options_.jitter.count() > 0) {
+    uint64_t n = sequence_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t range = static_cast<uint64_t>(options_.jitter.count()) + 1;
+    delay += std::chrono::microseconds(mix(options_.seed ^ n) % range);
+  }
+
+  if (delay.count() <= 0) {
+    return;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + delay;
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
+}  // namespace StarryChat
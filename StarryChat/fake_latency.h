@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace StarryChat {
+
+/**
+ * 内存替身存储的注入延迟配置
+ * 每次往返等待 base + [0, jitter] 微秒，抖动由 seed 决定的伪随机序列产生，
+ * 相同配置下多次运行得到相同的延迟序列。
+ */
+struct FakeLatencyOptions {
+  std::chrono::microseconds base{0};
+  std::chrono::microseconds jitter{0};
+  uint64_t seed{1};
+};
+
+/**
+ * 模拟一次网络往返的延迟
+ * 使用忙等而不是 sleep：sleep 的唤醒误差通常在几十微秒以上，
+ * 会掩盖被测代码本身的耗时差异。
+ */
+class FakeLatency {
+ public:
+  explicit FakeLatency(const FakeLatencyOptions& options = {})
+      : options_(options) {}
+
+  void roundTrip();
+
+  const FakeLatencyOptions& options() const { return options_; }
+
+ private:
+  FakeLatencyOptions options_;
+  std::atomic<uint64_t> sequence_{0};
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,190 @@
+#include "friend_cache.h"
+
+#include <algorithm>
+#include <mariadb/conncpp.hpp>
+#include <string>
+#include "config.h"
+#include "db_manager.h"
+#include "logging.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 好友为空时写入的占位成员，用于区分"没有好友"和"缓存未命中"
+const std::string kEmptyMarker = "0";
+
+// 版本号比好友集合的 TTL 长，回填期间不会过期
+constexpr auto kFriendSetTtl = std::chrono::hours(24);
+constexpr auto kVersionTtl = std::chrono::hours(48);
+
+}  // namespace
+
+FriendCache& FriendCache::getInstance() {
+  static FriendCache instance;
+  return instance;
+}
+
+std::optional<FriendCache::FriendList> FriendCache::getFriendIds(
+    uint64_t userId) {
+  if (auto friends = getLocal(userId)) {
+    return friends;
+  }
+
+  auto friends = loadFromRedis(userId);
+  if (!friends) {
+    friends = loadFromDatabase(userId);
+  }
+
+  if (friends) {
+    putLocal(userId, *friends);
+  }
+  return friends;
+}
+
+void FriendCache::invalidate(uint64_t userId) {
+  {
+    auto& shard = shardFor(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(userId);
+    if (it != shard.entries.end()) {
+      shard.lru.erase(it->second.lruIt);
+      shard.entries.erase(it);
+    }
+  }
+
+  // 先递增版本号再删除，正在回填的读者能发现变更
+  auto& redis = RedisManager::getInstance();
+  auto versionKey = RedisKeys::userFriendVersion(userId);
+  redis.incr(versionKey);
+  redis.expire(versionKey, kVersionTtl);
+  redis.del(RedisKeys::userFriendIds(userId));
+}
+
+std::optional<FriendCache::FriendList> FriendCache::getLocal(uint64_t userId) {
+  auto ttl =
+      std::chrono::seconds(Config::getInstance().getFriendCacheTtlSeconds());
+  auto now = std::chrono::steady_clock::now();
+
+  auto& shard = shardFor(userId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(userId);
+  if (it == shard.entries.end()) {
+    return std::nullopt;
+  }
+
+  // 其他节点的变更只会使 Redis 失效，L1 依靠较短的TTL收敛
+  if (now - it->second.loadedAt > ttl) {
+    shard.lru.erase(it->second.lruIt);
+    shard.entries.erase(it);
+    return std::nullopt;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruIt);
+  return it->second.friends;
+}
+
+void FriendCache::putLocal(uint64_t userId, FriendList friends) {
+  size_t capacity = std::max<size_t>(
+      1, Config::getInstance().getFriendCacheCapacity() / kShardCount);
+
+  auto& shard = shardFor(userId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(userId);
+  if (it != shard.entries.end()) {
+    shard.lru.erase(it->second.lruIt);
+    shard.entries.erase(it);
+  }
+
+  // 淘汰最久未使用的条目
+  while (shard.entries.size() >= capacity && !shard.lru.empty()) {
+    shard.entries.erase(shard.lru.back());
+    shard.lru.pop_back();
+  }
+
+  shard.lru.push_front(userId);
+  shard.entries[userId] = Entry{std::move(friends),
+                                std::chrono::steady_clock::now(),
+                                shard.lru.begin()};
+}
+
+std::optional<FriendCache::FriendList> FriendCache::loadFromRedis(
+    uint64_t userId) {
+  auto members =
+      RedisManager::getInstance().smembers(RedisKeys::userFriendIds(userId));
+  if (!members || members->empty()) {
+    return std::nullopt;
+  }
+
+  auto friends = std::make_shared<std::vector<uint64_t>>();
+  friends->reserve(members->size());
+  for (const auto& member : *members) {
+    if (member != kEmptyMarker) {
+      friends->push_back(std::stoull(member));
+    }
+  }
+  std::sort(friends->begin(), friends->end());
+
+  return FriendList(std::move(friends));
+}
+
+std::optional<FriendCache::FriendList> FriendCache::loadFromDatabase(
+    uint64_t userId) {
+  auto& redis = RedisManager::getInstance();
+  auto versionKey = RedisKeys::userFriendVersion(userId);
+  auto version = redis.get(versionKey);
+
+  try {
+    auto conn =
+        DBManager::getInstance().getConnection(DBAccess::kReadOnly, userId);
+    if (!conn) {
+      return std::nullopt;
+    }
+
+    // 主键 (user_id, friend_id) 保证结果有序
+    TimedStatement stmt(conn,
+                        "SELECT friend_id FROM friendships WHERE user_id = ? "
+                        "ORDER BY friend_id");
+    stmt->setUInt64(1, userId);
+
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+
+    auto friends = std::make_shared<std::vector<uint64_t>>();
+    std::vector<std::string> members;
+    while (rs->next()) {
+      uint64_t friendId = rs->getUInt64("friend_id");
+      friends->push_back(friendId);
+      members.push_back(std::to_string(friendId));
+    }
+
+    // 从库的结果可能缺少对方刚提交的变更，只放入本节点的 L1
+    if (DBManager::servedByReplica(conn)) {
+      return FriendList(std::move(friends));
+    }
+
+    // 回填 Redis 集合
+    if (members.empty()) {
+      members.push_back(kEmptyMarker);
+    }
+    auto key = RedisKeys::userFriendIds(userId);
+    redis.sadd(key, members);
+    redis.expire(key, kFriendSetTtl);
+
+    // 查询到回填之间发生过失效时，回填的集合可能是变更前的结果
+    // 在回填之后比较：之后才递增的失效会在递增后删除集合
+    if (redis.get(versionKey) != version) {
+      redis.del(key);
+    }
+
+    return FriendList(std::move(friends));
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "FriendCache loadFromDatabase SQL error: " << e.what();
+    return std::nullopt;
+  }
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace StarryChat {
+
+/**
+ * 好友邻接表缓存
+ * L1 为进程内按用户分片的 LRU，保存按ID排序的好友列表；
+ * L2 为 Redis 集合 user:friend_ids:{id}；均未命中时查询 friendships 表。
+ * 失效时递增 user:friend_ver:{id}，回填前后版本号不同说明查询期间发生了
+ * 变更，回填的集合可能过时，随即删除。从库读出的列表只放入 L1。
+ */
+class FriendCache {
+ public:
+  using FriendList = std::shared_ptr<const std::vector<uint64_t>>;
+
+  static FriendCache& getInstance();
+
+  FriendCache(const FriendCache&) = delete;
+  FriendCache& operator=(const FriendCache&) = delete;
+  FriendCache(FriendCache&&) = delete;
+  FriendCache& operator=(FriendCache&&) = delete;
+
+  /**
+   * 获取用户的好友ID列表（升序）
+   * @return 查询失败时返回 nullopt
+   */
+  std::optional<FriendList> getFriendIds(uint64_t userId);
+
+  /**
+   * 好友关系变更后使 L1 和 L2 缓存失效
+   */
+  void invalidate(uint64_t userId);
+
+ private:
+  FriendCache() = default;
+  ~FriendCache() = default;
+
+  struct Entry {
+    FriendList friends;
+    std::chrono::steady_clock::time_point loadedAt;
+    std::list<uint64_t>::iterator lruIt;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::list<uint64_t> lru;  // 头部为最近使用
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& shardFor(uint64_t userId) { return shards_[userId % kShardCount]; }
+
+  std::optional<FriendList> getLocal(uint64_t userId);
+  void putLocal(uint64_t userId, FriendList friends);
+  std::optional<FriendList> loadFromRedis(uint64_t userId);
+  std::optional<FriendList> loadFromDatabase(uint64_t userId);
+
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace StarryChat
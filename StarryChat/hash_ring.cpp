@@ -0,0 +1,59 @@
+#include "hash_ring.h"
+
+#include <algorithm>
+
+namespace StarryChat {
+
+namespace {
+
+uint64_t mix(uint64_t z) {
+  // splitmix64 终结函数，打散连续的聊天ID
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+uint64_t hashPoint(const std::string& node, int replica) {
+  // FNV-1a，与编译器和标准库实现无关，各节点计算结果一致
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char ch : node) {
+    hash ^= ch;
+    hash *= 1099511628211ULL;
+  }
+  return mix(hash + static_cast<uint64_t>(replica) * 0x9e3779b97f4a7c15ULL);
+}
+
+}  // namespace
+
+HashRing::HashRing(std::vector<std::string> nodes, int virtualNodes)
+    : nodes_(std::move(nodes)) {
+  std::sort(nodes_.begin(), nodes_.end());
+  nodes_.erase(std::unique(nodes_.begin(), nodes_.end()), nodes_.end());
+
+  points_.reserve(nodes_.size() * virtualNodes);
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    for (int replica = 0; replica < virtualNodes; ++replica) {
+      points_.emplace_back(hashPoint(nodes_[i], replica), i);
+    }
+  }
+  std::sort(points_.begin(), points_.end());
+}
+
+const std::string* HashRing::owner(uint64_t key) const {
+  if (points_.empty()) {
+    return nullptr;
+  }
+
+  uint64_t hash = mix(key + 0x9e3779b97f4a7c15ULL);
+  auto it = std::lower_bound(
+      points_.begin(), points_.end(), hash,
+      [](const std::pair<uint64_t, size_t>& point, uint64_t value) {
+        return point.first < value;
+      });
+  if (it == points_.end()) {
+    it = points_.begin();
+  }
+  return &nodes_[it->second];
+}
+
+}  // namespace StarryChat
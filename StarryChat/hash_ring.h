@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace StarryChat {
+
+/**
+ * 一致性哈希环
+ * 每个节点在环上放置 virtualNodes 个虚拟节点，键顺时针找到的第一个
+ * 虚拟节点即为所属节点。节点加入或离开时只有约 1/N 的键换主。
+ * 哈希只依赖节点ID和键本身，所有节点看到相同的成员列表时结果一致。
+ * 构造后不可修改，成员变化时整体重建。
+ */
+class HashRing {
+ public:
+  HashRing(std::vector<std::string> nodes, int virtualNodes);
+
+  bool empty() const { return points_.empty(); }
+  const std::vector<std::string>& nodes() const { return nodes_; }
+
+  /**
+   * 键的所属节点，环为空时返回 nullptr
+   */
+  const std::string* owner(uint64_t key) const;
+
+ private:
+  std::vector<std::string> nodes_;  // 按节点ID排序
+  std::vector<std::pair<uint64_t, size_t>> points_;  // 虚拟节点哈希 -> 节点下标
+};
+
+}  // namespace StarryChat
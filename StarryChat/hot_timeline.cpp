@@ -0,0 +1,112 @@
+#include "hot_timeline.h"
+
+#include <algorithm>
+
+namespace StarryChat {
+
+HotTimelines& HotTimelines::getInstance() {
+  static HotTimelines instance;
+  return instance;
+}
+
+HotTimelines::HotTimelines()
+    : hits_(MetricsRegistry::getInstance().counter(
+          "starrychat_hot_timeline_hits_total",
+          "GetMessages served from an owned room's in-memory timeline")),
+      misses_(MetricsRegistry::getInstance().counter(
+          "starrychat_hot_timeline_misses_total",
+          "GetMessages on an owned room that fell back to Redis")),
+      roomCount_(MetricsRegistry::getInstance().gauge(
+          "starrychat_hot_timeline_rooms",
+          "Owned rooms with an in-memory timeline")) {}
+
+void HotTimelines::configure(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = std::max<size_t>(capacity, 1);
+  rooms_.clear();
+  roomCount_.set(0);
+}
+
+std::unique_lock<std::mutex> HotTimelines::serialize(uint64_t chatRoomId) {
+  return std::unique_lock<std::mutex>(sendLocks_[chatRoomId % kLockStripes]);
+}
+
+HotTimelines::Room& HotTimelines::room(uint64_t chatRoomId) {
+  auto it = rooms_.find(chatRoomId);
+  if (it != rooms_.end()) {
+    return it->second;
+  }
+
+  // 超出上限时随意淘汰一个，被淘汰的聊天室下次读取时重新预热
+  if (rooms_.size() >= kMaxRooms) {
+    rooms_.erase(rooms_.begin());
+  }
+  auto& created = rooms_[chatRoomId];
+  roomCount_.set(static_cast<int64_t>(rooms_.size()));
+  return created;
+}
+
+void HotTimelines::insert(Room& room, uint64_t messageId) {
+  // 发送已串行化，通常追加在末尾；暂存消息回写等情况下按ID插入
+  if (room.ids.empty() || messageId > room.ids.back()) {
+    room.ids.push_back(messageId);
+  } else {
+    auto it = std::lower_bound(room.ids.begin(), room.ids.end(), messageId);
+    if (it != room.ids.end() && *it == messageId) {
+      return;
+    }
+    room.ids.insert(it, messageId);
+  }
+
+  // 只保留最新的 capacity_ 条
+  while (room.ids.size() > capacity_) {
+    room.ids.pop_front();
+  }
+}
+
+void HotTimelines::append(uint64_t chatRoomId, uint64_t messageId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  insert(room(chatRoomId), messageId);
+}
+
+void HotTimelines::seed(uint64_t chatRoomId,
+                        const std::vector<uint64_t>& newestFirst) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& target = room(chatRoomId);
+  for (auto it = newestFirst.rbegin(); it != newestFirst.rend(); ++it) {
+    insert(target, *it);
+  }
+  target.warm = true;
+}
+
+std::optional<std::vector<uint64_t>> HotTimelines::recent(uint64_t chatRoomId,
+                                                          size_t limit,
+                                                          uint64_t beforeId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = rooms_.find(chatRoomId);
+  if (it == rooms_.end() || !it->second.warm) {
+    misses_.inc();
+    return std::nullopt;
+  }
+
+  const auto& ids = it->second.ids;
+  auto end = beforeId > 0 ? std::lower_bound(ids.begin(), ids.end(), beforeId)
+                          : ids.end();
+  if (static_cast<size_t>(end - ids.begin()) < limit) {
+    misses_.inc();
+    return std::nullopt;
+  }
+
+  std::vector<uint64_t> result(std::make_reverse_iterator(end),
+                               std::make_reverse_iterator(end - limit));
+  hits_.inc();
+  return result;
+}
+
+void HotTimelines::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  rooms_.clear();
+  roomCount_.set(0);
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "metrics.h"
+
+namespace StarryChat {
+
+/**
+ * 本节点所属聊天室的发送串行化和内存时间线
+ * 所属节点上同一聊天室的发送依次落库并追加到内存时间线，
+ * 消息ID即该聊天室内的顺序；最近 capacity 条消息ID保存在内存中，
+ * GetMessages 无需读取 Redis 时间线。
+ * 时间线在第一次读取时从 Redis 预热，之后由发送追加；
+ * 集群成员变化（换主）时全部清空，接手的节点重新预热。
+ */
+class HotTimelines {
+ public:
+  static HotTimelines& getInstance();
+
+  HotTimelines(const HotTimelines&) = delete;
+  HotTimelines& operator=(const HotTimelines&) = delete;
+  HotTimelines(HotTimelines&&) = delete;
+  HotTimelines& operator=(HotTimelines&&) = delete;
+
+  void configure(size_t capacity);
+  size_t capacity() const { return capacity_; }
+
+  /**
+   * 串行化聊天室的发送，持有返回的锁直到消息追加到内存时间线
+   */
+  std::unique_lock<std::mutex> serialize(uint64_t chatRoomId);
+
+  void append(uint64_t chatRoomId, uint64_t messageId);
+
+  /**
+   * 用 Redis 时间线（从新到旧）预热，与预热前追加的消息合并
+   */
+  void seed(uint64_t chatRoomId, const std::vector<uint64_t>& newestFirst);
+
+  /**
+   * beforeId 之前（为 0 时从最新开始）的最多 limit 条消息ID，从新到旧
+   * 未预热或内存中不足 limit 条时返回 nullopt，调用方改读 Redis
+   */
+  std::optional<std::vector<uint64_t>> recent(uint64_t chatRoomId,
+                                              size_t limit,
+                                              uint64_t beforeId);
+
+  /**
+   * 换主时丢弃所有时间线
+   */
+  void clear();
+
+ private:
+  struct Room {
+    std::deque<uint64_t> ids;  // 从旧到新
+    bool warm{false};
+  };
+
+  static constexpr size_t kLockStripes = 64;
+  static constexpr size_t kMaxRooms = 10000;
+
+  HotTimelines();
+  ~HotTimelines() = default;
+
+  // 调用方持有 mutex_
+  Room& room(uint64_t chatRoomId);
+  void insert(Room& room, uint64_t messageId);
+
+  std::array<std::mutex, kLockStripes> sendLocks_;
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, Room> rooms_;
+  size_t capacity_{200};
+
+  Counter& hits_;
+  Counter& misses_;
+  Gauge& roomCount_;
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,41 @@
+#include "log_control.h"
+
+namespace StarryChat {
+
+namespace {
+
+constexpr const char* kModuleNames[LogControl::kModuleCount] = {
+    "user", "chat", "message", "security", "storage"};
+
+}  // namespace
+
+LogControl& LogControl::getInstance() {
+  static LogControl instance;
+  return instance;
+}
+
+LogControl::LogControl() {
+  setAllLevels(starry::LogLevel::INFO);
+}
+
+void LogControl::setLevel(LogModule module, starry::LogLevel level) {
+  levels_[static_cast<size_t>(module)].store(static_cast<int>(level),
+                                             std::memory_order_relaxed);
+}
+
+void LogControl::setAllLevels(starry::LogLevel level) {
+  for (auto& moduleLevel : levels_) {
+    moduleLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+}
+
+std::optional<LogModule> LogControl::parseModule(const std::string& name) {
+  for (size_t i = 0; i < kModuleCount; ++i) {
+    if (name == kModuleNames[i]) {
+      return static_cast<LogModule>(i);
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "binary_log.h"
+#include "logging.h"
+
+/**
+ * 编译期最低日志级别（0=TRACE ... 5=FATAL），由 CMake 选项
+ * STARRYCHAT_LOG_MIN_LEVEL 设置。低于该级别的 MLOG/SLOG 调用在编译期被消除。
+ */
+#ifndef STARRYCHAT_LOG_MIN_LEVEL
+#define STARRYCHAT_LOG_MIN_LEVEL 0
+#endif
+
+namespace StarryChat {
+
+/**
+ * 日志模块，每个模块可单独设置运行时级别
+ */
+enum class LogModule { kUser, kChat, kMessage, kSecurity, kStorage, kCount };
+
+/**
+ * 模块日志级别控制
+ */
+class LogControl {
+ public:
+  static constexpr size_t kModuleCount = static_cast<size_t>(LogModule::kCount);
+
+  static LogControl& getInstance();
+
+  LogControl(const LogControl&) = delete;
+  LogControl& operator=(const LogControl&) = delete;
+  LogControl(LogControl&&) = delete;
+  LogControl& operator=(LogControl&&) = delete;
+
+  void setLevel(LogModule module, starry::LogLevel level);
+  void setAllLevels(starry::LogLevel level);
+
+  bool enabled(LogModule module, starry::LogLevel level) const {
+    return static_cast<int>(level) >=
+           levels_[static_cast<size_t>(module)].load(std::memory_order_relaxed);
+  }
+
+  static std::optional<LogModule> parseModule(const std::string& name);
+
+ private:
+  LogControl();
+  ~LogControl() = default;
+
+  std::array<std::atomic<int>, kModuleCount> levels_;
+};
+
+inline bool logEnabled(LogModule module, starry::LogLevel level) {
+  return static_cast<int>(level) >= STARRYCHAT_LOG_MIN_LEVEL &&
+         LogControl::getInstance().enabled(module, level);
+}
+
+/**
+ * 调用点状态，用于按次数采样或按秒限流
+ */
+class LogSite {
+ public:
+  // 每 n 次调用输出一次
+  bool everyN(uint64_t n) {
+    return n <= 1 || count_.fetch_add(1, std::memory_order_relaxed) % n == 0;
+  }
+
+  // 每秒最多输出 limit 次
+  bool perSecond(uint32_t limit) {
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    int64_t window = window_.load(std::memory_order_relaxed);
+    if (window != now &&
+        window_.compare_exchange_strong(window, now,
+                                        std::memory_order_relaxed)) {
+      count_.store(0, std::memory_order_relaxed);
+    }
+    return count_.fetch_add(1, std::memory_order_relaxed) < limit;
+  }
+
+ private:
+  std::atomic<uint64_t> count_{0};
+  std::atomic<int64_t> window_{0};
+};
+
+namespace detail {
+
+inline void formatArgs(std::ostringstream& os, std::string_view fmt) {
+  os << fmt;
+}
+
+template <typename T, typename... Args>
+void formatArgs(std::ostringstream& os,
+                std::string_view fmt,
+                const T& arg,
+                const Args&... args) {
+  auto pos = fmt.find("{}");
+  if (pos == std::string_view::npos) {
+    os << fmt;
+    return;
+  }
+  os << fmt.substr(0, pos) << arg;
+  formatArgs(os, fmt.substr(pos + 2), args...);
+}
+
+}  // namespace detail
+
+/**
+ * 以 {} 作为占位符格式化文本，供 SLOG 在文本模式下使用
+ */
+template <typename... Args>
+std::string formatLog(std::string_view fmt, const Args&... args) {
+  std::ostringstream os;
+  detail::formatArgs(os, fmt, args...);
+  return os.str();
+}
+
+}  // namespace StarryChat
+
+// 按模块过滤的日志宏，例如 MLOG_DEBUG(kLogModule) << "...";
+#define MLOG(module, level)                                          \
+  if (!StarryChat::logEnabled(module, starry::LogLevel::level)) { \
+  } else                                                             \
+    LOG_##level
+
+#define MLOG_TRACE(module) MLOG(module, TRACE)
+#define MLOG_DEBUG(module) MLOG(module, DEBUG)
+#define MLOG_INFO(module) MLOG(module, INFO)
+#define MLOG_WARN(module) MLOG(module, WARN)
+#define MLOG_ERROR(module) MLOG(module, ERROR)
+
+#define STARRYCHAT_LOG_SITE()               \
+  ([]() -> StarryChat::LogSite& {           \
+    static StarryChat::LogSite site;        \
+    return site;                            \
+  }())
+
+// 每 n 次调用输出一次
+#define MLOG_EVERY_N(module, level, n)                                \
+  if (!StarryChat::logEnabled(module, starry::LogLevel::level) ||  \
+      !STARRYCHAT_LOG_SITE().everyN(n)) {                             \
+  } else                                                              \
+    LOG_##level
+
+// 每秒最多输出 limit 次，超出部分丢弃
+#define MLOG_RATE_LIMITED(module, level, limit)                       \
+  if (!StarryChat::logEnabled(module, starry::LogLevel::level) ||  \
+      !STARRYCHAT_LOG_SITE().perSecond(limit)) {                      \
+  } else                                                              \
+    LOG_##level
+
+/**
+ * 结构化日志：格式串以 {} 为占位符。
+ * 启用二进制日志时只写入格式串ID和原始参数，由 starrychat_logdecode 离线还原；
+ * 否则格式化为文本输出到普通日志。
+ */
+#define SLOG(module, level, fmt, ...)                                       \
+  do {                                                                      \
+    if (StarryChat::logEnabled(module, starry::LogLevel::level)) {          \
+      static const uint32_t slogFormatId_ =                                 \
+          StarryChat::BinaryLog::getInstance().registerFormat(              \
+              __FILE__, __LINE__, fmt);                                     \
+      if (StarryChat::BinaryLog::getInstance().isEnabled()) {               \
+        StarryChat::BinaryLog::getInstance().write(                         \
+            slogFormatId_, starry::LogLevel::level __VA_OPT__(, ) __VA_ARGS__); \
+      } else {                                                              \
+        LOG_##level << StarryChat::formatLog(fmt __VA_OPT__(, ) __VA_ARGS__); \
+      }                                                                     \
+    }                                                                       \
+  } while (0)
@@ -0,0 +1,307 @@
+#include "login_rate_limiter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <functional>
+#include <mariadb/conncpp.hpp>
+#include <stdexcept>
+#include <vector>
+#include "config.h"
+#include "db_manager.h"
+#include "log_control.h"
+#include "logging.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+
+namespace StarryChat {
+
+namespace {
+
+constexpr LogModule kLogModule = LogModule::kSecurity;
+
+std::string userKey(const std::string& username) {
+  return "user:" + username;
+}
+
+std::string sourceKey(const std::string& source) {
+  return "ip:" + source;
+}
+
+}  // namespace
+
+LoginRateLimiter& LoginRateLimiter::getInstance() {
+  static LoginRateLimiter instance;
+  return instance;
+}
+
+LoginRateLimiter::Shard& LoginRateLimiter::shardFor(const std::string& key) {
+  return shards_[std::hash<std::string>{}(key) % kShardCount];
+}
+
+bool LoginRateLimiter::isLocked(const Entry& entry, Clock::time_point now) {
+  return now < entry.lockedUntil;
+}
+
+bool LoginRateLimiter::refill(Entry& entry, Clock::time_point now) {
+  auto& config = Config::getInstance();
+  double capacity = config.getLoginBucketCapacity();
+  double refillPerSecond = config.getLoginRefillPerMinute() / 60.0;
+
+  if (entry.tokens < 0) {
+    entry.tokens = capacity;
+    entry.lastRefill = now;
+  }
+
+  // 按经过的时间补充令牌
+  double elapsed =
+      std::chrono::duration<double>(now - entry.lastRefill).count();
+  entry.tokens = std::min(capacity, entry.tokens + elapsed * refillPerSecond);
+  entry.lastRefill = now;
+  return entry.tokens >= 1.0;
+}
+
+void LoginRateLimiter::addFailure(Entry& entry, Clock::time_point now) {
+  auto& config = Config::getInstance();
+  auto window = std::chrono::seconds(config.getLoginFailureWindow());
+
+  // 移除滑动窗口之外的失败记录
+  while (!entry.failures.empty() && now - entry.failures.front() > window) {
+    entry.failures.pop_front();
+  }
+  entry.failures.push_back(now);
+
+  if (entry.failures.size() >=
+      static_cast<size_t>(config.getLoginMaxFailures())) {
+    entry.lockedUntil =
+        now + std::chrono::seconds(config.getLoginLockoutSeconds());
+    entry.lockDirty = true;
+    entry.failures.clear();
+  }
+}
+
+bool LoginRateLimiter::allowAttempt(const std::string& username,
+                                    const std::string& source) {
+  auto now = Clock::now();
+  auto syncInterval =
+      std::chrono::seconds(Config::getInstance().getLoginSyncInterval());
+
+  std::vector<std::string> keys{userKey(username)};
+  if (!source.empty()) {
+    keys.push_back(sourceKey(source));
+  }
+
+  // 1. 本地锁定检查，并找出需要到 Redis 确认的键
+  std::vector<std::string> remoteKeys;
+  for (const auto& key : keys) {
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& entry = shard.entries[key];
+    entry.lastSeen = now;
+
+    if (isLocked(entry, now)) {
+      return false;
+    }
+
+    if (now - entry.lastRemoteCheck >= syncInterval) {
+      entry.lastRemoteCheck = now;
+      remoteKeys.push_back(key);
+    }
+  }
+
+  // 2. 惰性同步其他节点产生的锁定（Redis 调用不持有分片锁）
+  auto& redis = RedisManager::getInstance();
+  for (const auto& key : remoteKeys) {
+    auto lockedUntil = redis.get(RedisKeys::loginLock(key));
+    if (!lockedUntil) {
+      continue;
+    }
+
+    // 无法解析的值视为未锁定
+    int64_t until = 0;
+    const auto& text = *lockedUntil;
+    auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), until);
+    if (ec != std::errc() || end != text.data() + text.size()) {
+      continue;
+    }
+
+    int64_t remaining = until - std::time(nullptr);
+    if (remaining <= 0) {
+      continue;
+    }
+
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& entry = shard.entries[key];
+    entry.lockedUntil = now + std::chrono::seconds(remaining);
+    MLOG_RATE_LIMITED(kLogModule, WARN, 10)
+        << "Login locked by remote node for " << key;
+    return false;
+  }
+
+  // 3. 令牌桶限流：每个键都有令牌时才一起扣除，被限流的来源地址
+  // 不会耗尽它尝试的用户名的令牌。两个键可能落在同一分片，按地址顺序
+  // 锁住去重后的分片
+  std::vector<Shard*> shards;
+  for (const auto& key : keys) {
+    shards.push_back(&shardFor(key));
+  }
+  std::sort(shards.begin(), shards.end());
+  shards.erase(std::unique(shards.begin(), shards.end()), shards.end());
+  std::vector<std::unique_lock<std::mutex>> locks;
+  for (auto* shard : shards) {
+    locks.emplace_back(shard->mutex);
+  }
+
+  for (const auto& key : keys) {
+    if (!refill(shardFor(key).entries[key], now)) {
+      MLOG_RATE_LIMITED(kLogModule, WARN, 10)
+          << "Login rate limited for " << key;
+      return false;
+    }
+  }
+  for (const auto& key : keys) {
+    shardFor(key).entries[key].tokens -= 1.0;
+  }
+
+  return true;
+}
+
+void LoginRateLimiter::recordFailure(const std::string& username,
+                                     const std::string& source,
+                                     uint64_t userId) {
+  auto now = Clock::now();
+
+  std::vector<std::string> keys{userKey(username)};
+  if (!source.empty()) {
+    keys.push_back(sourceKey(source));
+  }
+
+  for (const auto& key : keys) {
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& entry = shard.entries[key];
+    entry.lastSeen = now;
+    addFailure(entry, now);
+  }
+
+  if (userId > 0) {
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    ++pendingAttempts_[userId];
+  }
+}
+
+void LoginRateLimiter::recordSuccess(const std::string& username,
+                                     uint64_t userId) {
+  std::string key = userKey(username);
+  {
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+      it->second.failures.clear();
+    }
+  }
+
+  // 登录成功时数据库会清零 login_attempts，未回写的增量不再需要
+  std::lock_guard<std::mutex> lock(pendingMutex_);
+  pendingAttempts_.erase(userId);
+}
+
+void LoginRateLimiter::flush() {
+  auto& config = Config::getInstance();
+  auto now = Clock::now();
+  auto idleTimeout =
+      std::chrono::seconds(std::max(config.getLoginFailureWindow(),
+                                    config.getLoginLockoutSeconds()));
+
+  // 1. 收集新产生的锁定，并清理不活跃条目
+  std::vector<std::pair<std::string, int64_t>> newLocks;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+      auto& entry = it->second;
+
+      if (entry.lockDirty && now < entry.lockedUntil) {
+        newLocks.emplace_back(
+            it->first, std::chrono::duration_cast<std::chrono::seconds>(
+                           entry.lockedUntil - now)
+                           .count());
+      }
+      entry.lockDirty = false;
+
+      if (now - entry.lastSeen > idleTimeout && now >= entry.lockedUntil) {
+        it = shard.entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // 2. 同步锁定到 Redis，值为锁定结束的Unix时间戳
+  auto& redis = RedisManager::getInstance();
+  for (const auto& [key, seconds] : newLocks) {
+    if (seconds <= 0) {
+      continue;
+    }
+    redis.set(RedisKeys::loginLock(key),
+              std::to_string(std::time(nullptr) + seconds),
+              std::chrono::seconds(seconds));
+  }
+
+  // 3. 批量回写失败次数
+  std::unordered_map<uint64_t, uint32_t> pending;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    pending.swap(pendingAttempts_);
+  }
+
+  if (pending.empty()) {
+    return;
+  }
+
+  // UPDATE users SET login_attempts = login_attempts + CASE id WHEN ? THEN ?
+  // ... END WHERE id IN (?, ...)
+  std::string query =
+      "UPDATE users SET login_attempts = login_attempts + CASE id";
+  std::string inList;
+  for (size_t i = 0; i < pending.size(); ++i) {
+    query += " WHEN ? THEN ?";
+    inList += (i == 0 ? "?" : ", ?");
+  }
+  query += " END WHERE id IN (" + inList + ")";
+
+  try {
+    auto conn = DBManager::getInstance().getConnection();
+    if (!conn) {
+      throw std::runtime_error("Database connection failed");
+    }
+
+    TimedStatement stmt(conn, query);
+
+    int paramIndex = 1;
+    for (const auto& [userId, attempts] : pending) {
+      stmt->setUInt64(paramIndex++, userId);
+      stmt->setUInt(paramIndex++, attempts);
+    }
+    for (const auto& [userId, attempts] : pending) {
+      (void)attempts;
+      stmt->setUInt64(paramIndex++, userId);
+    }
+
+    stmt.executeUpdate();
+    MLOG_DEBUG(kLogModule) << "Flushed login attempts for " << pending.size()
+                           << " users";
+  } catch (std::exception& e) {
+    LOG_ERROR << "LoginRateLimiter flush error: " << e.what();
+
+    // 回写失败，合并回待写队列等待下次重试
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    for (const auto& [userId, attempts] : pending) {
+      pendingAttempts_[userId] += attempts;
+    }
+  }
+}
+
+}  // namespace StarryChat
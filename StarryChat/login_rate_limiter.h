@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace StarryChat {
+
+/**
+ * 登录限流器 - 在进程内拦截暴力破解/撞库请求
+ * 按用户名和来源地址分别维护令牌桶和滑动窗口失败计数，
+ * 被拒绝的请求不会触达数据库，也不会进行密码哈希计算。
+ * 锁定状态惰性同步到 Redis，失败次数批量回写数据库。
+ */
+class LoginRateLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static LoginRateLimiter& getInstance();
+
+  LoginRateLimiter(const LoginRateLimiter&) = delete;
+  LoginRateLimiter& operator=(const LoginRateLimiter&) = delete;
+  LoginRateLimiter(LoginRateLimiter&&) = delete;
+  LoginRateLimiter& operator=(LoginRateLimiter&&) = delete;
+
+  /**
+   * 检查是否允许本次登录尝试，并消耗一个令牌
+   * @param username 登录用户名
+   * @param source 来源地址（为空时只按用户名限流）
+   * @return 是否允许继续处理
+   */
+  bool allowAttempt(const std::string& username, const std::string& source);
+
+  /**
+   * 记录一次失败的登录
+   * @param userId 用户ID，用户不存在时为0（不回写数据库）
+   */
+  void recordFailure(const std::string& username,
+                     const std::string& source,
+                     uint64_t userId);
+
+  /**
+   * 记录一次成功的登录，清除该用户名的失败状态
+   */
+  void recordSuccess(const std::string& username, uint64_t userId);
+
+  /**
+   * 批量回写失败次数到数据库，并把锁定状态同步到 Redis
+   * 同时清理长时间不活跃的条目，由后台线程周期调用
+   */
+  void flush();
+
+ private:
+  LoginRateLimiter() = default;
+  ~LoginRateLimiter() = default;
+
+  struct Entry {
+    double tokens{-1};  // 小于0表示尚未初始化
+    Clock::time_point lastRefill;
+    std::deque<Clock::time_point> failures;  // 滑动窗口内的失败时间
+    Clock::time_point lockedUntil;
+    Clock::time_point lastRemoteCheck;
+    bool lockDirty{false};  // 本地新产生的锁定，待同步到 Redis
+    Clock::time_point lastSeen;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& shardFor(const std::string& key);
+
+  // 需要持有分片锁调用
+  bool isLocked(const Entry& entry, Clock::time_point now);
+  // 按经过的时间补充令牌，返回是否至少有一个令牌（不扣除）
+  bool refill(Entry& entry, Clock::time_point now);
+  void addFailure(Entry& entry, Clock::time_point now);
+
+  std::array<Shard, kShardCount> shards_;
+
+  // 待回写数据库的失败次数（userId -> 增量）
+  std::mutex pendingMutex_;
+  std::unordered_map<uint64_t, uint32_t> pendingAttempts_;
+};
+
+}  // namespace StarryChat
@@ -1,55 +1,80 @@
 #include <signal.h>
+#include <algorithm>
 #include <memory>
+#include "admission_control.h"
 #include "async_logging.h"
+#include "binary_log.h"
 #include "chat_service_impl.h"
+#include "cluster_membership.h"
+#include "cluster_peers.h"
+#include "cold_archive.h"
 #include "config.h"
 #include "db_manager.h"
 #include "eventloop.h"
+#include "hot_timeline.h"
 #include "inet_address.h"
+#include "log_control.h"
 #include "logging.h"
+#include "login_rate_limiter.h"
+#include "message_cache_codec.h"
+#include "message_partitions.h"
+#include "message_search.h"
 #include "message_service_impl.h"
+#include "message_spool.h"
+#include "metrics_server.h"
+#include "node_router.h"
+#include "push_registry.h"
+#include "push_subscriber.h"
+#include "redis_keys.h"
 #include "redis_manager.h"
 #include "rpc_server.h"
 #include "user_service_impl.h"
+#include "username_filter.h"
 
 // 用户心跳检测线程
 void startHeartbeatCheckerThread() {
   std::thread([] {
     LOG_INFO << "Starting user heartbeat checker thread";
     auto& redis = StarryChat::RedisManager::getInstance();
+    namespace RedisKeys = StarryChat::RedisKeys;
 
     while (true) {
       try {
         // 获取所有在线用户
-        auto onlineUsers = redis.smembers("users:online");
+        auto onlineUsers = redis.smembers(RedisKeys::kUsersOnline);
         if (onlineUsers && !onlineUsers->empty()) {
           LOG_INFO << "Checking heartbeats for " << onlineUsers->size()
                    << " online users";
 
           for (const auto& userId : *onlineUsers) {
             // 检查心跳是否存在
-            std::string heartbeatKey = "user:heartbeat:" + userId;
+            auto heartbeatKey = RedisKeys::userHeartbeat(userId);
             if (!redis.exists(heartbeatKey)) {
               // 心跳过期，用户可能断线
               LOG_INFO << "User " << userId
                        << " heartbeat expired, marking as offline";
 
               // 更新状态为离线
-              redis.hset("user:status", userId,
+              redis.hset(RedisKeys::kUserStatus, userId,
                          std::to_string(static_cast<int>(
                              starrychat::USER_STATUS_OFFLINE)));
 
               // 从在线用户集合中移除
-              redis.srem("users:online", userId);
+              redis.srem(RedisKeys::kUsersOnline, userId);
+
+              // 结束该用户在本节点的推送订阅
+              StarryChat::PushRegistry::getInstance().detachUser(
+                  std::stoull(userId));
 
               // 发布状态变更通知
               std::string notification = userId + ":" +
                                          std::to_string(static_cast<int>(
                                              starrychat::USER_STATUS_OFFLINE));
-              redis.publish("user:status:changed", notification);
+              redis.publish(RedisKeys::kUserStatusChangedChannel,
+                            notification);
 
               // 更新用户信息缓存
-              std::string userKey = "user:" + userId;
+              auto userKey = RedisKeys::user(userId);
               redis.hset(userKey, "status",
                          std::to_string(static_cast<int>(
                              starrychat::USER_STATUS_OFFLINE)));
@@ -58,16 +83,16 @@ void startHeartbeatCheckerThread() {
               auto& dbManager = StarryChat::DBManager::getInstance();
               if (auto conn = dbManager.getConnection()) {
                 try {
-                  std::unique_ptr<sql::PreparedStatement> stmt(
-                      conn->prepareStatement(
-                          "UPDATE users SET status = ? WHERE id = ?"));
+                  StarryChat::TimedStatement stmt(
+                      conn, "UPDATE users SET status = ? WHERE id = ?");
                   stmt->setInt(
                       1, static_cast<int>(starrychat::USER_STATUS_OFFLINE));
                   stmt->setUInt64(2, std::stoull(userId));
-                  stmt->executeUpdate();
+                  stmt.executeUpdate();
                   LOG_INFO << "Updated database status to offline for user "
                            << userId;
                 } catch (sql::SQLException& e) {
+                  StarryChat::DBManager::reportError(e);
                   LOG_ERROR << "SQL error in heartbeat checker: " << e.what();
                 }
               }
@@ -86,6 +111,133 @@ void startHeartbeatCheckerThread() {
   LOG_INFO << "Heartbeat checker thread started";
 }
 
+// 登录失败次数回写线程
+void startLoginAttemptFlusherThread() {
+  std::thread([] {
+    auto interval = std::chrono::seconds(
+        StarryChat::Config::getInstance().getLoginFlushInterval());
+
+    while (true) {
+      std::this_thread::sleep_for(interval);
+      StarryChat::LoginRateLimiter::getInstance().flush();
+    }
+  }).detach();
+
+  LOG_INFO << "Login attempt flusher thread started";
+}
+
+// 用户名过滤器构建线程，启动时构建一次，之后周期性重建
+void startUsernameFilterThread() {
+  std::thread([] {
+    auto& filter = StarryChat::UsernameFilter::getInstance();
+    auto interval = std::chrono::seconds(
+        StarryChat::Config::getInstance().getUsernameFilterRebuildInterval());
+
+    while (true) {
+      if (!filter.rebuild()) {
+        LOG_ERROR << "Failed to rebuild username filter";
+      }
+      filter.waitForRebuild(interval);
+    }
+  }).detach();
+
+  LOG_INFO << "Username filter thread started";
+}
+
+// 暂存消息回写线程，数据库熔断恢复后把暂存的消息落库
+void startMessageSpoolFlusherThread(StarryChat::MessageServiceImpl* service) {
+  std::thread([service] {
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      service->flushSpool();
+    }
+  }).detach();
+
+  LOG_INFO << "Message spool flusher thread started";
+}
+
+// messages 分区维护线程，启动时执行一次，之后周期性建分区和清理旧分区
+void startMessagePartitionThread() {
+  std::thread([] {
+    auto& config = StarryChat::Config::getInstance();
+    auto& partitions = StarryChat::MessagePartitions::getInstance();
+    auto interval =
+        std::chrono::hours(config.getMessagePartitionsMaintenanceHours());
+
+    while (true) {
+      auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+      if (!partitions.maintain(static_cast<uint64_t>(now))) {
+        LOG_ERROR << "Failed to maintain message partitions";
+      }
+      // 其他节点导出的段文件在这里加载
+      auto directory = config.getMessagePartitionsSegmentDirectory();
+      if (!directory.empty()) {
+        StarryChat::ColdArchive::getInstance().load(directory);
+      }
+      std::this_thread::sleep_for(interval);
+    }
+  }).detach();
+
+  LOG_INFO << "Message partition thread started";
+}
+
+// 消息搜索索引线程，从数据库补齐其他节点写入的消息，并写出和合并段文件
+void startMessageSearchThread() {
+  std::thread([] {
+    auto& config = StarryChat::Config::getInstance();
+    auto& index = StarryChat::MessageSearchIndex::getInstance();
+    auto interval = std::chrono::seconds(config.getSearchCatchUpSeconds());
+
+    while (true) {
+      index.catchUp(config.getSearchCatchUpBatch());
+      index.maintain();
+      std::this_thread::sleep_for(interval);
+    }
+  }).detach();
+
+  LOG_INFO << "Message search thread started";
+}
+
+// 加入集群：群聊按一致性哈希归属到节点，成员变化时换主
+void startCluster(const StarryChat::Config& config) {
+  StarryChat::HotTimelines::getInstance().configure(
+      config.getClusterHotTimelineSize());
+  StarryChat::ClusterPeers::getInstance().start(
+      std::chrono::milliseconds(config.getClusterForwardTimeoutMs()));
+
+  StarryChat::ClusterOptions options;
+  options.nodeId = config.getServerNodeId();
+  options.address = config.getClusterAdvertiseHost() + ":" +
+                    std::to_string(config.getServerPort());
+  options.lease = std::chrono::seconds(config.getClusterLeaseSeconds());
+  options.virtualNodes = config.getClusterVirtualNodes();
+
+  auto& membership = StarryChat::ClusterMembership::getInstance();
+  membership.configure(options);
+  membership.setChangeListener([](const StarryChat::HashRing& ring) {
+    // 换主后内存时间线可能缺少其他节点处理的消息，全部重新预热
+    StarryChat::HotTimelines::getInstance().clear();
+    StarryChat::ClusterPeers::getInstance().retain(ring.nodes());
+  });
+  membership.start();
+}
+
+// 推送订阅到期检查线程，应答等待超时的订阅并回收断线会话的邮箱
+void startPushExpiryThread() {
+  std::thread([] {
+    auto& registry = StarryChat::PushRegistry::getInstance();
+
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      registry.expire();
+    }
+  }).detach();
+
+  LOG_INFO << "Push expiry thread started";
+}
+
 // 全局事件循环指针，用于信号处理
 starry::EventLoop* g_loop = nullptr;
 
@@ -118,6 +270,29 @@ int main() {
   starry::Logger::setOutput(
       [&asyncLog](const char* msg, int len) { asyncLog->append(msg, len); });
 
+  // 模块日志级别默认与全局一致；starry 全局级别取最低值，由模块级别进一步过滤
+  auto& logControl = StarryChat::LogControl::getInstance();
+  logControl.setAllLevels(config.getLoggingLevel());
+  auto minLogLevel = config.getLoggingLevel();
+  for (const auto& [name, level] : config.getLoggingModuleLevels()) {
+    auto module = StarryChat::LogControl::parseModule(name);
+    if (!module) {
+      LOG_WARN << "Unknown log module: " << name;
+      continue;
+    }
+    logControl.setLevel(*module, level);
+    minLogLevel = std::min(minLogLevel, level);
+  }
+  starry::Logger::setLogLevel(minLogLevel);
+
+  // 二进制结构化日志
+  auto& binaryLog = StarryChat::BinaryLog::getInstance();
+  if (config.getLoggingBinaryEnabled()) {
+    binaryLog.start(config.getLoggingBinaryBaseName(),
+                    config.getLoggingRollSize(),
+                    config.getLoggingRefreshInterval());
+  }
+
   LOG_INFO << "Starting StarryChat server...";
 
   LOG_INFO << "Config loaded, server will listen on port "
@@ -139,9 +314,95 @@ int main() {
   }
   LOG_INFO << "Redis connection initialized";
 
+  // 初始化消息缓存压缩，字典不可用时保持不压缩
+  StarryChat::MessageCacheCodec::Options codecOptions;
+  codecOptions.enabled = config.getMessageCacheCompression();
+  codecOptions.minSize = config.getMessageCacheMinSize();
+  codecOptions.level = config.getMessageCacheLevel();
+  if (!StarryChat::MessageCacheCodec::getInstance().initializeFromFile(
+          codecOptions, config.getMessageCacheDictionary())) {
+    LOG_WARN << "Message cache dictionary unavailable, compression disabled";
+  }
+
+  // 准入控制，需在服务处理第一个请求之前完成配置
+  StarryChat::AdmissionOptions admissionOptions;
+  admissionOptions.enabled = config.getAdmissionEnabled();
+  admissionOptions.maxInflight = config.getAdmissionMaxInflight();
+  admissionOptions.normalShare = config.getAdmissionNormalShare();
+  admissionOptions.bulkShare = config.getAdmissionBulkShare();
+  admissionOptions.targetLatencyMs = config.getAdmissionTargetLatencyMs();
+  admissionOptions.bulkTargetLatencyMs =
+      config.getAdmissionBulkTargetLatencyMs();
+  StarryChat::AdmissionController::getInstance().configure(admissionOptions);
+
+  // 数据库熔断期间暂存消息的上限
+  StarryChat::MessageSpool::getInstance().setCapacity(
+      config.getMessageSpoolCapacity());
+
+  // messages 按月分区的维护参数
+  StarryChat::MessagePartitionOptions partitionOptions;
+  partitionOptions.enabled = config.getMessagePartitionsEnabled();
+  partitionOptions.monthsAhead = config.getMessagePartitionsMonthsAhead();
+  partitionOptions.retentionMonths =
+      config.getMessagePartitionsRetentionMonths();
+  partitionOptions.archive = config.getMessagePartitionsArchive();
+  partitionOptions.segmentDirectory =
+      config.getMessagePartitionsSegmentDirectory();
+  partitionOptions.lockTtl =
+      std::chrono::hours(config.getMessagePartitionsMaintenanceHours());
+  StarryChat::MessagePartitions::getInstance().configure(partitionOptions);
+  if (!partitionOptions.segmentDirectory.empty()) {
+    StarryChat::ColdArchive::getInstance().load(
+        partitionOptions.segmentDirectory);
+  }
+
+  // 消息全文搜索索引
+  if (config.getSearchEnabled()) {
+    StarryChat::MessageSearchOptions searchOptions;
+    searchOptions.directory = config.getSearchDirectory();
+    searchOptions.flushPostings = config.getSearchFlushPostings();
+    searchOptions.maxSegments = config.getSearchMaxSegments();
+    if (!StarryChat::MessageSearchIndex::getInstance().open(searchOptions)) {
+      LOG_ERROR << "Failed to open message search index";
+    }
+  }
+
+  // 推送队列水位、慢消费者策略和断线回收时间
+  StarryChat::PushOptions pushOptions;
+  pushOptions.highWatermark = config.getPushHighWatermark();
+  pushOptions.lowWatermark = config.getPushLowWatermark();
+  pushOptions.policy = config.getPushSlowConsumerPolicy() == "disconnect"
+                           ? StarryChat::SlowConsumerPolicy::kDisconnect
+                           : StarryChat::SlowConsumerPolicy::kResync;
+  pushOptions.idleTimeout = std::chrono::seconds(config.getPushIdleSeconds());
+  StarryChat::PushRegistry::getInstance().configure(pushOptions);
+
+  // 转发其他节点发出的推送，多节点部署时需要开启
+  StarryChat::NodeRouter::getInstance().configure(
+      config.getServerNodeId(),
+      std::chrono::seconds(config.getPushPresenceTtlSeconds()));
+  if (config.getPushSubscriberEnabled()) {
+    // 其他节点注册的用户名经订阅同步到用户名过滤器
+    StarryChat::UsernameFilter::getInstance().requireSubscription();
+    StarryChat::PushSubscriber::getInstance().start(
+        std::chrono::milliseconds(config.getPushSubscriberPollMs()));
+  }
+
   // 在启动服务器后，启动心跳检测线程
   startHeartbeatCheckerThread();
 
+  // 启动登录失败次数批量回写线程
+  startLoginAttemptFlusherThread();
+
+  // 启动用户名过滤器构建线程
+  startUsernameFilterThread();
+  if (config.getMessagePartitionsEnabled()) {
+    startMessagePartitionThread();
+  }
+  if (StarryChat::MessageSearchIndex::getInstance().enabled()) {
+    startMessageSearchThread();
+  }
+
   // 创建事件循环
   starry::EventLoop loop;
   g_loop = &loop;
@@ -169,17 +430,40 @@ int main() {
   rpcServer.registerService(&chatService);
   rpcServer.registerService(&messageService);
 
+  // 启动暂存消息回写线程
+  startMessageSpoolFlusherThread(&messageService);
+
+  // 启动推送订阅到期检查线程
+  startPushExpiryThread();
+
   // 启动服务器
   rpcServer.start();
   LOG_INFO << "StarryChat server started on port " << config.getServerPort();
 
+  // 服务器可以接收转发的请求后再加入集群
+  if (config.getClusterEnabled()) {
+    startCluster(config);
+  }
+
+  // 指标端口与 RPC 共用主事件循环
+  std::unique_ptr<StarryChat::MetricsServer> metricsServer;
+  if (config.getMetricsEnabled()) {
+    metricsServer = std::make_unique<StarryChat::MetricsServer>(
+        &loop, starry::InetAddress(config.getMetricsPort()));
+    metricsServer->start();
+    LOG_INFO << "Metrics endpoint started on port " << config.getMetricsPort();
+  }
+
   // 运行事件循环
   loop.loop();
 
   // 清理资源
   LOG_INFO << "Shutting down StarryChat server...";
+  StarryChat::ClusterMembership::getInstance().stop();
+  StarryChat::PushSubscriber::getInstance().stop();
   dbManager.shutdown();
   redisManager.shutdown();
+  binaryLog.stop();
   asyncLog->stop();
 
   LOG_INFO << "StarryChat server stopped";
@@ -0,0 +1,145 @@
+#include "mariadb_store.h"
+
+#include <mariadb/conncpp.hpp>
+#include <memory>
+#include <stdexcept>
+#include "db_manager.h"
+
+namespace StarryChat {
+
+namespace {
+
+std::shared_ptr<sql::Connection> acquireConnection() {
+  auto conn = DBManager::getInstance().getConnection();
+  if (!conn) {
+    throw std::runtime_error("Database connection failed");
+  }
+  return conn;
+}
+
+// 从 users 表的一行创建用户对象，包含密码验证信息
+std::optional<User> loginUserFromResultSet(sql::ResultSet& rs) {
+  if (!rs.next()) {
+    return std::nullopt;
+  }
+
+  User user(rs.getUInt64("id"), std::string(rs.getString("username")));
+  user.setNickname(std::string(rs.getString("nickname")));
+  user.setEmail(std::string(rs.getString("email")));
+  user.setStatus(static_cast<starrychat::UserStatus>(rs.getInt("status")));
+
+  if (!rs.isNull("avatar_url")) {
+    user.setAvatarUrl(std::string(rs.getString("avatar_url")));
+  }
+
+  if (!rs.isNull("last_login_time")) {
+    user.setLastLoginTime(rs.getUInt64("last_login_time"));
+  }
+
+  user.setPasswordHashAndSalt(std::string(rs.getString("password_hash")),
+                              std::string(rs.getString("salt")));
+  return user;
+}
+
+}  // namespace
+
+std::optional<User> MariaDBStore::findUserById(uint64_t userId) {
+  auto conn = acquireConnection();
+
+  TimedStatement stmt(conn, "SELECT * FROM users WHERE id = ?");
+  stmt->setUInt64(1, userId);
+
+  std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+  return loginUserFromResultSet(*rs);
+}
+
+std::optional<User> MariaDBStore::findUserByUsername(
+    const std::string& username) {
+  auto conn = acquireConnection();
+
+  TimedStatement stmt(conn, "SELECT * FROM users WHERE username = ?");
+  stmt->setString(1, username);
+
+  std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+  return loginUserFromResultSet(*rs);
+}
+
+void MariaDBStore::recordLogin(uint64_t userId, uint64_t loginTime) {
+  auto conn = acquireConnection();
+
+  TimedStatement stmt(conn,
+                      "UPDATE users SET status = ?, last_login_time = ?, "
+                      "login_attempts = 0 WHERE id = ?");
+  stmt->setInt(1, static_cast<int>(starrychat::USER_STATUS_ONLINE));
+  stmt->setUInt64(2, loginTime);
+  stmt->setUInt64(3, userId);
+  stmt.executeUpdate();
+}
+
+uint64_t MariaDBStore::insertMessage(const starrychat::Message& message) {
+  auto conn = acquireConnection();
+
+  // 准备SQL
+  std::string query =
+      "INSERT INTO messages (sender_id, chat_type, chat_id, type, content, "
+      "system_code, timestamp, status, reply_to_id) "
+      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+  TimedStatement stmt(conn, query, sql::Statement::RETURN_GENERATED_KEYS);
+
+  stmt->setUInt64(1, message.sender_id());
+  stmt->setInt(2, message.chat_type());
+  stmt->setUInt64(3, message.chat_id());
+  stmt->setInt(4, message.type());
+
+  // 设置内容
+  if (message.type() == starrychat::MESSAGE_TYPE_TEXT && message.has_text()) {
+    stmt->setString(5, message.text().text());
+    stmt->setNull(6, sql::DataType::VARCHAR);
+  } else if (message.type() == starrychat::MESSAGE_TYPE_SYSTEM &&
+             message.has_system()) {
+    stmt->setString(5, message.system().text());
+    stmt->setString(6, message.system().code());
+  } else {
+    stmt->setNull(5, sql::DataType::VARCHAR);
+    stmt->setNull(6, sql::DataType::VARCHAR);
+  }
+
+  stmt->setUInt64(7, message.timestamp());
+  stmt->setInt(8, message.status());
+
+  if (message.reply_to_id() > 0) {
+    stmt->setUInt64(9, message.reply_to_id());
+  } else {
+    stmt->setNull(9, sql::DataType::BIGINT);
+  }
+
+  // 发送者随后的历史消息查询需要读到这条消息
+  DBManager::getInstance().noteWrite(message.sender_id());
+  if (stmt.executeUpdate() <= 0) {
+    return 0;
+  }
+
+  std::unique_ptr<sql::ResultSet> rs(stmt->getGeneratedKeys());
+  if (!rs->next()) {
+    return 0;
+  }
+  uint64_t messageId = rs->getUInt64(1);
+
+  // 处理提及用户
+  if (message.mention_user_ids_size() > 0) {
+    TimedStatement mentionStmt(conn,
+                               "INSERT INTO message_mentions (message_id, "
+                               "user_id) VALUES (?, ?)");
+
+    for (int i = 0; i < message.mention_user_ids_size(); i++) {
+      mentionStmt->setUInt64(1, messageId);
+      mentionStmt->setUInt64(2, message.mention_user_ids(i));
+      mentionStmt.executeUpdate();
+    }
+  }
+
+  return messageId;
+}
+
+}  // namespace StarryChat
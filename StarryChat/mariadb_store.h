@@ -0,0 +1,18 @@
+#pragma once
+
+#include "db_store.h"
+
+namespace StarryChat {
+
+/**
+ * 基于 DBManager 连接的 MariaDB 实现
+ */
+class MariaDBStore : public DBStore {
+ public:
+  std::optional<User> findUserById(uint64_t userId) override;
+  std::optional<User> findUserByUsername(const std::string& username) override;
+  void recordLogin(uint64_t userId, uint64_t loginTime) override;
+  uint64_t insertMessage(const starrychat::Message& message) override;
+};
+
+}  // namespace StarryChat
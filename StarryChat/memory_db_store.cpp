@@ -0,0 +1,87 @@
+#include "memory_db_store.h"
+
+namespace StarryChat {
+
+MemoryDBStore::MemoryDBStore(const FakeLatencyOptions& latency)
+    : latency_(latency) {}
+
+uint64_t MemoryDBStore::addUser(const std::string& username,
+                                const std::string& password) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  UserRow row;
+  row.id = users_.size() + 1;
+  row.username = username;
+  row.nickname = username;
+
+  User user(row.id, username);
+  user.setPassword(password);
+  row.passwordHash = user.getPasswordHash();
+  row.salt = user.getSalt();
+
+  usernameIndex_[username] = row.id;
+  uint64_t userId = row.id;
+  users_.emplace(userId, std::move(row));
+  return userId;
+}
+
+std::optional<User> MemoryDBStore::userFromRow(uint64_t userId) const {
+  auto it = users_.find(userId);
+  if (it == users_.end()) {
+    return std::nullopt;
+  }
+
+  const auto& row = it->second;
+  User user(row.id, row.username);
+  user.setNickname(row.nickname);
+  user.setStatus(row.status);
+  user.setLastLoginTime(row.lastLoginTime);
+  user.setPasswordHashAndSalt(row.passwordHash, row.salt);
+  return user;
+}
+
+std::optional<User> MemoryDBStore::findUserById(uint64_t userId) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+  return userFromRow(userId);
+}
+
+std::optional<User> MemoryDBStore::findUserByUsername(
+    const std::string& username) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = usernameIndex_.find(username);
+  if (it == usernameIndex_.end()) {
+    return std::nullopt;
+  }
+  return userFromRow(it->second);
+}
+
+void MemoryDBStore::recordLogin(uint64_t userId, uint64_t loginTime) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = users_.find(userId);
+  if (it != users_.end()) {
+    it->second.status = starrychat::USER_STATUS_ONLINE;
+    it->second.lastLoginTime = loginTime;
+  }
+}
+
+uint64_t MemoryDBStore::insertMessage(const starrychat::Message& message) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  messages_.push_back(message);
+  uint64_t messageId = messages_.size();
+  messages_.back().set_id(messageId);
+  return messageId;
+}
+
+size_t MemoryDBStore::messageCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return messages_.size();
+}
+
+}  // namespace StarryChat
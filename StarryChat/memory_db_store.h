@@ -0,0 +1,54 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "db_store.h"
+#include "fake_latency.h"
+
+namespace StarryChat {
+
+/**
+ * 进程内的数据库替身
+ * 用于对服务逻辑做确定性的微基准测试；每次调用计为一次往返并注入延迟。
+ */
+class MemoryDBStore : public DBStore {
+ public:
+  explicit MemoryDBStore(const FakeLatencyOptions& latency = {});
+
+  /**
+   * 添加用户，密码按正式流程加盐哈希
+   * @return 新用户ID
+   */
+  uint64_t addUser(const std::string& username, const std::string& password);
+
+  std::optional<User> findUserById(uint64_t userId) override;
+  std::optional<User> findUserByUsername(const std::string& username) override;
+  void recordLogin(uint64_t userId, uint64_t loginTime) override;
+  uint64_t insertMessage(const starrychat::Message& message) override;
+
+  size_t messageCount();
+
+ private:
+  struct UserRow {
+    uint64_t id{0};
+    std::string username;
+    std::string nickname;
+    starrychat::UserStatus status{starrychat::USER_STATUS_OFFLINE};
+    uint64_t lastLoginTime{0};
+    std::string passwordHash;
+    std::string salt;
+  };
+
+  // 调用方持有 mutex_
+  std::optional<User> userFromRow(uint64_t userId) const;
+
+  FakeLatency latency_;
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, UserRow> users_;
+  std::unordered_map<std::string, uint64_t> usernameIndex_;
+  std::vector<starrychat::Message> messages_;  // 下标 + 1 即消息ID
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,628 @@
+#include "memory_redis_store.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace StarryChat {
+
+namespace {
+
+// 按 Redis 规则把闭区间 [start, stop]（支持负下标）转换为半开区间
+std::pair<size_t, size_t> normalizeRange(long start, long stop, size_t size) {
+  long n = static_cast<long>(size);
+  if (start < 0) {
+    start += n;
+  }
+  if (stop < 0) {
+    stop += n;
+  }
+  start = std::max(start, 0L);
+  stop = std::min(stop, n - 1);
+  if (start > stop) {
+    return {0, 0};
+  }
+  return {static_cast<size_t>(start), static_cast<size_t>(stop) + 1};
+}
+
+// 按键删除；C++20 的 erase 不支持异构键，先查找再按迭代器删除
+template <typename Map>
+void eraseFrom(Map& map, std::string_view key) {
+  auto it = map.find(key);
+  if (it != map.end()) {
+    map.erase(it);
+  }
+}
+
+}  // namespace
+
+template <typename T>
+T& MemoryRedisStore::slot(KeyMap<T>& map, std::string_view key) {
+  auto it = map.find(key);
+  if (it == map.end()) {
+    it = map.emplace(std::string(key), T{}).first;
+  }
+  return it->second;
+}
+
+MemoryRedisStore::MemoryRedisStore(const FakeLatencyOptions& latency)
+    : latency_(latency) {}
+
+void MemoryRedisStore::expireIfNeeded(std::string_view key) {
+  auto it = expireAt_.find(key);
+  if (it != expireAt_.end() && Clock::now() >= it->second) {
+    eraseKey(key);
+  }
+}
+
+void MemoryRedisStore::eraseKey(std::string_view key) {
+  eraseFrom(strings_, key);
+  eraseFrom(hashes_, key);
+  eraseFrom(lists_, key);
+  eraseFrom(sets_, key);
+  eraseFrom(sortedSets_, key);
+  eraseFrom(expireAt_, key);
+}
+
+bool MemoryRedisStore::containsKey(std::string_view key) const {
+  return strings_.contains(key) || hashes_.contains(key) ||
+         lists_.contains(key) || sets_.contains(key) ||
+         sortedSets_.contains(key);
+}
+
+MemoryRedisStore::SortedSet* MemoryRedisStore::findSortedSet(
+    std::string_view key) {
+  expireIfNeeded(key);
+  auto it = sortedSets_.find(key);
+  return it == sortedSets_.end() ? nullptr : &it->second;
+}
+
+long long MemoryRedisStore::addToCounter(std::string_view key,
+                                         long long delta) {
+  expireIfNeeded(key);
+  auto& value = slot(strings_, key);
+  long long current = 0;
+  if (!value.empty()) {
+    size_t pos = 0;
+    current = std::stoll(value, &pos);
+    if (pos != value.size()) {
+      throw std::runtime_error("value is not an integer");
+    }
+  }
+  current += delta;
+  value = std::to_string(current);
+  return current;
+}
+
+// 字符串操作
+void MemoryRedisStore::set(std::string_view key,
+                           std::string_view value,
+                           std::chrono::seconds ttl) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // SET 会覆盖旧值和旧的过期时间
+  eraseKey(key);
+  slot(strings_, key) = value;
+  if (ttl.count() > 0) {
+    slot(expireAt_, key) = Clock::now() + ttl;
+  }
+}
+
+std::optional<std::string> MemoryRedisStore::get(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = strings_.find(key);
+  if (it == strings_.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+bool MemoryRedisStore::setIfAbsent(std::string_view key,
+                                   std::string_view value,
+                                   std::chrono::seconds ttl) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  if (containsKey(key)) {
+    return false;
+  }
+  slot(strings_, key) = value;
+  if (ttl.count() > 0) {
+    slot(expireAt_, key) = Clock::now() + ttl;
+  }
+  return true;
+}
+
+void MemoryRedisStore::del(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+  eraseKey(key);
+}
+
+// 哈希表操作
+void MemoryRedisStore::hset(std::string_view key,
+                            std::string_view field,
+                            std::string_view value) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  slot(hashes_, key)[std::string(field)] = value;
+}
+
+void MemoryRedisStore::hsetWithExpire(
+    std::string_view key,
+    const std::vector<std::pair<std::string, std::string>>& fields,
+    std::chrono::seconds ttl) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto& hash = slot(hashes_, key);
+  for (const auto& [field, value] : fields) {
+    hash[field] = value;
+  }
+  if (ttl.count() > 0) {
+    slot(expireAt_, key) = Clock::now() + ttl;
+  }
+}
+
+std::optional<std::string> MemoryRedisStore::hget(std::string_view key,
+                                                  std::string_view field) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = hashes_.find(key);
+  if (it == hashes_.end()) {
+    return std::nullopt;
+  }
+  auto fieldIt = it->second.find(std::string(field));
+  if (fieldIt == it->second.end()) {
+    return std::nullopt;
+  }
+  return fieldIt->second;
+}
+
+void MemoryRedisStore::hdel(std::string_view key, std::string_view field) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = hashes_.find(key);
+  if (it != hashes_.end()) {
+    it->second.erase(std::string(field));
+    if (it->second.empty()) {
+      eraseKey(key);
+    }
+  }
+}
+
+void MemoryRedisStore::hsetBatch(const std::vector<std::string>& keys,
+                                 std::string_view field,
+                                 std::string_view value,
+                                 std::chrono::seconds ttl) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (const auto& key : keys) {
+    expireIfNeeded(key);
+    slot(hashes_, key)[std::string(field)] = value;
+    if (ttl.count() > 0) {
+      slot(expireAt_, key) = Clock::now() + ttl;
+    }
+  }
+}
+
+void MemoryRedisStore::hdelBatch(const std::vector<std::string>& keys,
+                                 std::string_view field) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (const auto& key : keys) {
+    expireIfNeeded(key);
+    auto it = hashes_.find(key);
+    if (it != hashes_.end()) {
+      it->second.erase(std::string(field));
+      if (it->second.empty()) {
+        eraseKey(key);
+      }
+    }
+  }
+}
+
+void MemoryRedisStore::hsetWithExpireBatch(
+    const std::vector<std::string>& keys,
+    const std::vector<FieldList>& fields,
+    std::chrono::seconds ttl) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (fields[i].empty()) {
+      continue;
+    }
+    expireIfNeeded(keys[i]);
+    auto& hash = slot(hashes_, keys[i]);
+    for (const auto& [field, value] : fields[i]) {
+      hash[field] = value;
+    }
+    if (ttl.count() > 0) {
+      slot(expireAt_, keys[i]) = Clock::now() + ttl;
+    }
+  }
+}
+
+RedisStore::FieldMap MemoryRedisStore::hgetall(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = hashes_.find(key);
+  return it == hashes_.end() ? FieldMap{} : it->second;
+}
+
+std::vector<RedisStore::FieldMap> MemoryRedisStore::hgetallBatch(
+    const std::vector<std::string>& keys) {
+  std::vector<FieldMap> result(keys.size());
+  if (keys.empty()) {
+    return result;
+  }
+
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    expireIfNeeded(keys[i]);
+    auto it = hashes_.find(keys[i]);
+    if (it != hashes_.end()) {
+      result[i] = it->second;
+    }
+  }
+  return result;
+}
+
+std::vector<std::optional<std::string>> MemoryRedisStore::hmget(
+    std::string_view key,
+    const std::vector<std::string>& fields) {
+  std::vector<std::optional<std::string>> result(fields.size());
+  if (fields.empty()) {
+    return result;
+  }
+
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = hashes_.find(key);
+  if (it == hashes_.end()) {
+    return result;
+  }
+  for (size_t i = 0; i < fields.size(); ++i) {
+    auto fieldIt = it->second.find(fields[i]);
+    if (fieldIt != it->second.end()) {
+      result[i] = fieldIt->second;
+    }
+  }
+  return result;
+}
+
+// 列表操作
+void MemoryRedisStore::lpush(std::string_view key, std::string_view value) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  slot(lists_, key).emplace_front(value);
+}
+
+void MemoryRedisStore::rpush(std::string_view key, std::string_view value) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  slot(lists_, key).emplace_back(value);
+}
+
+std::optional<std::string> MemoryRedisStore::lpop(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = lists_.find(key);
+  if (it == lists_.end()) {
+    return std::nullopt;
+  }
+  std::string value = std::move(it->second.front());
+  it->second.pop_front();
+  if (it->second.empty()) {
+    eraseKey(key);
+  }
+  return value;
+}
+
+std::optional<std::string> MemoryRedisStore::rpop(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = lists_.find(key);
+  if (it == lists_.end()) {
+    return std::nullopt;
+  }
+  std::string value = std::move(it->second.back());
+  it->second.pop_back();
+  if (it->second.empty()) {
+    eraseKey(key);
+  }
+  return value;
+}
+
+std::vector<std::string> MemoryRedisStore::lrange(std::string_view key,
+                                                  long start,
+                                                  long stop) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = lists_.find(key);
+  if (it == lists_.end()) {
+    return {};
+  }
+  auto [first, last] = normalizeRange(start, stop, it->second.size());
+  return std::vector<std::string>(it->second.begin() + first,
+                                  it->second.begin() + last);
+}
+
+// 集合操作
+void MemoryRedisStore::sadd(std::string_view key, std::string_view member) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  slot(sets_, key).emplace(member);
+}
+
+void MemoryRedisStore::sadd(std::string_view key,
+                            const std::vector<std::string>& members) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto& set = slot(sets_, key);
+  set.insert(members.begin(), members.end());
+}
+
+void MemoryRedisStore::srem(std::string_view key, std::string_view member) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = sets_.find(key);
+  if (it != sets_.end()) {
+    it->second.erase(std::string(member));
+    if (it->second.empty()) {
+      eraseKey(key);
+    }
+  }
+}
+
+std::unordered_set<std::string> MemoryRedisStore::smembers(
+    std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto it = sets_.find(key);
+  return it == sets_.end() ? std::unordered_set<std::string>{} : it->second;
+}
+
+// 有序集合操作
+void MemoryRedisStore::zadd(std::string_view key,
+                            std::string_view member,
+                            double score) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  auto& zset = slot(sortedSets_, key);
+  std::string name(member);
+  auto scoreIt = zset.scores.find(name);
+  if (scoreIt != zset.scores.end()) {
+    auto old = std::lower_bound(zset.ordered.begin(), zset.ordered.end(),
+                                std::make_pair(scoreIt->second, name));
+    zset.ordered.erase(old);
+    scoreIt->second = score;
+  } else {
+    zset.scores.emplace(name, score);
+  }
+
+  // 时间线按时间戳追加，插入位置通常在末尾
+  auto entry = std::make_pair(score, std::move(name));
+  zset.ordered.insert(
+      std::lower_bound(zset.ordered.begin(), zset.ordered.end(), entry),
+      std::move(entry));
+}
+
+void MemoryRedisStore::zrem(std::string_view key, std::string_view member) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto* zset = findSortedSet(key);
+  if (!zset) {
+    return;
+  }
+  std::string name(member);
+  auto scoreIt = zset->scores.find(name);
+  if (scoreIt == zset->scores.end()) {
+    return;
+  }
+
+  auto it = std::lower_bound(zset->ordered.begin(), zset->ordered.end(),
+                             std::make_pair(scoreIt->second, name));
+  zset->ordered.erase(it);
+  zset->scores.erase(scoreIt);
+  if (zset->ordered.empty()) {
+    eraseKey(key);
+  }
+}
+
+std::vector<std::string> MemoryRedisStore::zrange(std::string_view key,
+                                                  long start,
+                                                  long stop) {
+  std::vector<std::string> result;
+  for (auto& [member, score] : zrangeWithScores(key, start, stop)) {
+    result.push_back(std::move(member));
+  }
+  return result;
+}
+
+std::vector<std::pair<std::string, double>> MemoryRedisStore::zrangeWithScores(
+    std::string_view key,
+    long start,
+    long stop) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<std::pair<std::string, double>> result;
+  auto* zset = findSortedSet(key);
+  if (!zset) {
+    return result;
+  }
+
+  auto [first, last] = normalizeRange(start, stop, zset->ordered.size());
+  for (size_t i = first; i < last; ++i) {
+    result.emplace_back(zset->ordered[i].second, zset->ordered[i].first);
+  }
+  return result;
+}
+
+std::vector<std::string> MemoryRedisStore::zrevrange(std::string_view key,
+                                                     long start,
+                                                     long stop) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<std::string> result;
+  auto* zset = findSortedSet(key);
+  if (!zset) {
+    return result;
+  }
+
+  size_t size = zset->ordered.size();
+  auto [first, last] = normalizeRange(start, stop, size);
+  for (size_t i = first; i < last; ++i) {
+    result.push_back(zset->ordered[size - 1 - i].second);
+  }
+  return result;
+}
+
+std::optional<long long> MemoryRedisStore::zrevrank(std::string_view key,
+                                                    std::string_view member) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto* zset = findSortedSet(key);
+  if (!zset) {
+    return std::nullopt;
+  }
+  std::string name(member);
+  auto scoreIt = zset->scores.find(name);
+  if (scoreIt == zset->scores.end()) {
+    return std::nullopt;
+  }
+
+  auto it = std::lower_bound(zset->ordered.begin(), zset->ordered.end(),
+                             std::make_pair(scoreIt->second, name));
+  return static_cast<long long>(zset->ordered.end() - it) - 1;
+}
+
+void MemoryRedisStore::zremrangebyrank(std::string_view key,
+                                       long start,
+                                       long stop) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto* zset = findSortedSet(key);
+  if (!zset) {
+    return;
+  }
+
+  auto [first, last] = normalizeRange(start, stop, zset->ordered.size());
+  for (size_t i = first; i < last; ++i) {
+    zset->scores.erase(zset->ordered[i].second);
+  }
+  zset->ordered.erase(zset->ordered.begin() + first,
+                      zset->ordered.begin() + last);
+  if (zset->ordered.empty()) {
+    eraseKey(key);
+  }
+}
+
+// 发布/订阅
+void MemoryRedisStore::publish(std::string_view /*channel*/,
+                               std::string_view /*message*/) {
+  latency_.roundTrip();
+  published_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::unique_ptr<RedisSubscription> MemoryRedisStore::subscribe(
+    RedisSubscription::Handler /*handler*/,
+    std::chrono::milliseconds /*pollTimeout*/) {
+  return nullptr;
+}
+
+// 其他操作
+bool MemoryRedisStore::expire(std::string_view key, std::chrono::seconds ttl) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  if (!containsKey(key)) {
+    return false;
+  }
+  if (ttl.count() > 0) {
+    slot(expireAt_, key) = Clock::now() + ttl;
+  } else {
+    eraseKey(key);
+  }
+  return true;
+}
+
+bool MemoryRedisStore::exists(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  expireIfNeeded(key);
+  return containsKey(key);
+}
+
+void MemoryRedisStore::flushdb() {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  strings_.clear();
+  hashes_.clear();
+  lists_.clear();
+  sets_.clear();
+  sortedSets_.clear();
+  expireAt_.clear();
+}
+
+long long MemoryRedisStore::incr(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+  return addToCounter(key, 1);
+}
+
+long long MemoryRedisStore::decr(std::string_view key) {
+  latency_.roundTrip();
+  std::lock_guard<std::mutex> lock(mutex_);
+  return addToCounter(key, -1);
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include "fake_latency.h"
+#include "redis_store.h"
+
+namespace StarryChat {
+
+/**
+ * 进程内的 Redis 替身
+ * 用于在单机上对服务逻辑做确定性的微基准测试，不依赖 Redis 服务。
+ * 按 Redis 语义实现 RedisManager 用到的命令（负下标、TTL、有序集合排序），
+ * 不检查键类型；每条命令或每个 pipeline 计为一次往返并注入延迟。
+ */
+class MemoryRedisStore : public RedisStore {
+ public:
+  explicit MemoryRedisStore(const FakeLatencyOptions& latency = {});
+
+  void set(std::string_view key,
+           std::string_view value,
+           std::chrono::seconds ttl) override;
+  std::optional<std::string> get(std::string_view key) override;
+  void del(std::string_view key) override;
+  bool setIfAbsent(std::string_view key,
+                   std::string_view value,
+                   std::chrono::seconds ttl) override;
+
+  void hset(std::string_view key,
+            std::string_view field,
+            std::string_view value) override;
+  void hsetWithExpire(
+      std::string_view key,
+      const std::vector<std::pair<std::string, std::string>>& fields,
+      std::chrono::seconds ttl) override;
+  std::optional<std::string> hget(std::string_view key,
+                                  std::string_view field) override;
+  void hdel(std::string_view key, std::string_view field) override;
+  void hsetBatch(const std::vector<std::string>& keys,
+                 std::string_view field,
+                 std::string_view value,
+                 std::chrono::seconds ttl) override;
+  void hdelBatch(const std::vector<std::string>& keys,
+                 std::string_view field) override;
+  void hsetWithExpireBatch(const std::vector<std::string>& keys,
+                           const std::vector<FieldList>& fields,
+                           std::chrono::seconds ttl) override;
+  FieldMap hgetall(std::string_view key) override;
+  std::vector<FieldMap> hgetallBatch(
+      const std::vector<std::string>& keys) override;
+  std::vector<std::optional<std::string>> hmget(
+      std::string_view key,
+      const std::vector<std::string>& fields) override;
+
+  void lpush(std::string_view key, std::string_view value) override;
+  void rpush(std::string_view key, std::string_view value) override;
+  std::optional<std::string> lpop(std::string_view key) override;
+  std::optional<std::string> rpop(std::string_view key) override;
+  std::vector<std::string> lrange(std::string_view key,
+                                  long start,
+                                  long stop) override;
+
+  void sadd(std::string_view key, std::string_view member) override;
+  void sadd(std::string_view key,
+            const std::vector<std::string>& members) override;
+  void srem(std::string_view key, std::string_view member) override;
+  std::unordered_set<std::string> smembers(std::string_view key) override;
+
+  void zadd(std::string_view key,
+            std::string_view member,
+            double score) override;
+  void zrem(std::string_view key, std::string_view member) override;
+  std::vector<std::string> zrange(std::string_view key,
+                                  long start,
+                                  long stop) override;
+  std::vector<std::pair<std::string, double>> zrangeWithScores(
+      std::string_view key,
+      long start,
+      long stop) override;
+  std::vector<std::string> zrevrange(std::string_view key,
+                                     long start,
+                                     long stop) override;
+  std::optional<long long> zrevrank(std::string_view key,
+                                    std::string_view member) override;
+  void zremrangebyrank(std::string_view key, long start, long stop) override;
+
+  void publish(std::string_view channel, std::string_view message) override;
+  // 替身只统计发布次数，不投递订阅消息
+  std::unique_ptr<RedisSubscription> subscribe(
+      RedisSubscription::Handler handler,
+      std::chrono::milliseconds pollTimeout) override;
+
+  bool expire(std::string_view key, std::chrono::seconds ttl) override;
+  bool exists(std::string_view key) override;
+  void flushdb() override;
+  long long incr(std::string_view key) override;
+  long long decr(std::string_view key) override;
+
+  // 累计发布的消息数，没有订阅方，仅用于校验
+  uint64_t publishedCount() const {
+    return published_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // 键可以直接用 std::string_view 查找，读命令不构造临时字符串
+  struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+  template <typename T>
+  using KeyMap = std::unordered_map<std::string, T, KeyHash, std::equal_to<>>;
+
+  // 按 (score, member) 升序保存，与 Redis 的排序规则一致
+  struct SortedSet {
+    std::unordered_map<std::string, double> scores;
+    std::vector<std::pair<double, std::string>> ordered;
+  };
+
+  // 查找键，不存在时插入默认值
+  template <typename T>
+  static T& slot(KeyMap<T>& map, std::string_view key);
+
+  // 以下辅助函数要求调用方持有 mutex_
+  void expireIfNeeded(std::string_view key);
+  void eraseKey(std::string_view key);
+  bool containsKey(std::string_view key) const;
+  SortedSet* findSortedSet(std::string_view key);
+  long long addToCounter(std::string_view key, long long delta);
+
+  FakeLatency latency_;
+
+  std::mutex mutex_;
+  KeyMap<std::string> strings_;
+  KeyMap<FieldMap> hashes_;
+  KeyMap<std::deque<std::string>> lists_;
+  KeyMap<std::unordered_set<std::string>> sets_;
+  KeyMap<SortedSet> sortedSets_;
+  KeyMap<Clock::time_point> expireAt_;
+
+  std::atomic<uint64_t> published_{0};
+};
+
+}  // namespace StarryChat
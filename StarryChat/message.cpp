@@ -65,31 +65,35 @@ void Message::setSystemMessage(
 // Protobuf 转换方法
 starrychat::Message Message::toProto() const {
   starrychat::Message proto;
+  toProto(&proto);
+  return proto;
+}
 
+void Message::toProto(starrychat::Message* proto) const {
   // 基本字段
-  proto.set_id(id_);
-  proto.set_sender_id(senderId_);
-  proto.set_chat_type(chatType_);
-  proto.set_chat_id(chatId_);
-  proto.set_type(type_);
-  proto.set_timestamp(timestamp_);
-  proto.set_status(status_);
+  proto->set_id(id_);
+  proto->set_sender_id(senderId_);
+  proto->set_chat_type(chatType_);
+  proto->set_chat_id(chatId_);
+  proto->set_type(type_);
+  proto->set_timestamp(timestamp_);
+  proto->set_status(status_);
 
   // 关联信息
   if (replyToId_ > 0) {
-    proto.set_reply_to_id(replyToId_);
+    proto->set_reply_to_id(replyToId_);
   }
 
   for (const auto& userId : mentionUserIds_) {
-    proto.add_mention_user_ids(userId);
+    proto->add_mention_user_ids(userId);
   }
 
   // 内容 - 根据消息类型
   if (isTextMessage()) {
-    auto* text = proto.mutable_text();
+    auto* text = proto->mutable_text();
     text->set_text(textContent_);
   } else if (isSystemMessage()) {
-    auto* system = proto.mutable_system();
+    auto* system = proto->mutable_system();
     system->set_text(textContent_);
     system->set_code(systemCode_);
 
@@ -97,8 +101,6 @@ starrychat::Message Message::toProto() const {
       (*system->mutable_params())[key] = value;
     }
   }
-
-  return proto;
 }
 
 Message Message::fromProto(const starrychat::Message& proto) {
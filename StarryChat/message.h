@@ -74,6 +74,8 @@ class Message {
 
   // Protobuf序列化/反序列化
   starrychat::Message toProto() const;
+  // 填充到调用方提供的空对象（如响应中的字段），避免临时对象和拷贝
+  void toProto(starrychat::Message* proto) const;
   static Message fromProto(const starrychat::Message& proto);
 
   // 创建特定类型消息的便捷方法
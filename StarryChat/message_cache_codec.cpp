@@ -0,0 +1,183 @@
+#include "message_cache_codec.h"
+
+#include <zstd.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include "logging.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 版本字节的取值范围：字段号为 0 的 protobuf 标签
+constexpr uint8_t kMaxFormatByte = 0x07;
+
+struct CCtxDeleter {
+  void operator()(ZSTD_CCtx* ctx) const { ZSTD_freeCCtx(ctx); }
+};
+
+struct DCtxDeleter {
+  void operator()(ZSTD_DCtx* ctx) const { ZSTD_freeDCtx(ctx); }
+};
+
+// 每个线程复用一个压缩/解压上下文，避免每条消息重新分配
+ZSTD_CCtx* threadCCtx() {
+  thread_local std::unique_ptr<ZSTD_CCtx, CCtxDeleter> ctx(ZSTD_createCCtx());
+  return ctx.get();
+}
+
+ZSTD_DCtx* threadDCtx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, DCtxDeleter> ctx(ZSTD_createDCtx());
+  return ctx.get();
+}
+
+Counter& cacheBytes(const std::string& stage) {
+  return MetricsRegistry::getInstance().counter(
+      "starrychat_message_cache_bytes_total",
+      "Message cache payload bytes before and after compression",
+      {{"stage", stage}});
+}
+
+}  // namespace
+
+MessageCacheCodec& MessageCacheCodec::getInstance() {
+  static MessageCacheCodec instance;
+  return instance;
+}
+
+MessageCacheCodec::~MessageCacheCodec() {
+  reset();
+}
+
+void MessageCacheCodec::reset() {
+  ZSTD_freeCDict(cdict_);
+  ZSTD_freeDDict(ddict_);
+  cdict_ = nullptr;
+  ddict_ = nullptr;
+  dictId_ = 0;
+}
+
+void MessageCacheCodec::initialize(const Options& options,
+                                   std::string_view dictionary) {
+  reset();
+  options_ = options;
+
+  if (!dictionary.empty()) {
+    cdict_ = ZSTD_createCDict(dictionary.data(), dictionary.size(),
+                              options_.level);
+    ddict_ = ZSTD_createDDict(dictionary.data(), dictionary.size());
+    dictId_ = ddict_ ? ZSTD_getDictID_fromDDict(ddict_) : 0;
+  }
+
+  LOG_INFO << "Message cache compression "
+           << (options_.enabled ? "enabled" : "disabled")
+           << ", min size " << options_.minSize << ", level "
+           << options_.level << ", dictionary ID " << dictId_;
+}
+
+bool MessageCacheCodec::initializeFromFile(const Options& options,
+                                           const std::string& dictionaryPath) {
+  if (dictionaryPath.empty()) {
+    initialize(options);
+    return true;
+  }
+
+  std::ifstream file(dictionaryPath, std::ios::binary);
+  if (!file) {
+    LOG_ERROR << "Failed to open message cache dictionary: "
+              << dictionaryPath;
+    Options disabled = options;
+    disabled.enabled = false;
+    initialize(disabled);
+    return false;
+  }
+
+  std::string dictionary((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  initialize(options, dictionary);
+  return true;
+}
+
+bool MessageCacheCodec::encode(std::string_view serialized,
+                               std::string* out) const {
+  if (!options_.enabled || serialized.size() < options_.minSize) {
+    return false;
+  }
+
+  static auto& rawBytes = cacheBytes("raw");
+  static auto& storedBytes = cacheBytes("stored");
+  rawBytes.inc(serialized.size());
+
+  size_t bound = ZSTD_compressBound(serialized.size());
+  out->resize(1 + bound);
+  (*out)[0] = static_cast<char>(kFormatZstd);
+
+  size_t written;
+  if (cdict_) {
+    written = ZSTD_compress_usingCDict(threadCCtx(), out->data() + 1, bound,
+                                       serialized.data(), serialized.size(),
+                                       cdict_);
+  } else {
+    written = ZSTD_compressCCtx(threadCCtx(), out->data() + 1, bound,
+                                serialized.data(), serialized.size(),
+                                options_.level);
+  }
+
+  // 压缩失败或没有收益时缓存原始数据
+  if (ZSTD_isError(written) || written + 1 >= serialized.size()) {
+    storedBytes.inc(serialized.size());
+    return false;
+  }
+
+  out->resize(written + 1);
+  storedBytes.inc(out->size());
+  return true;
+}
+
+bool MessageCacheCodec::decode(std::string_view payload,
+                               starrychat::Message* message) const {
+  // 首字节不是版本号，按原始 protobuf 解析
+  if (payload.empty() || static_cast<uint8_t>(payload[0]) > kMaxFormatByte) {
+    return message->ParseFromArray(payload.data(),
+                                   static_cast<int>(payload.size()));
+  }
+
+  if (static_cast<uint8_t>(payload[0]) != kFormatZstd) {
+    return false;
+  }
+
+  std::string_view frame = payload.substr(1);
+  unsigned long long size =
+      ZSTD_getFrameContentSize(frame.data(), frame.size());
+  if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN ||
+      size > kMaxDecodedSize) {
+    return false;
+  }
+
+  // 字典更换后旧字典压缩的值无法解码，按缓存未命中处理
+  unsigned frameDictId = ZSTD_getDictID_fromFrame(frame.data(), frame.size());
+  if (frameDictId != 0 && frameDictId != dictId_) {
+    return false;
+  }
+
+  thread_local std::string buffer;
+  buffer.resize(size);
+
+  size_t decoded;
+  if (frameDictId != 0) {
+    decoded = ZSTD_decompress_usingDDict(threadDCtx(), buffer.data(), size,
+                                         frame.data(), frame.size(), ddict_);
+  } else {
+    decoded = ZSTD_decompressDCtx(threadDCtx(), buffer.data(), size,
+                                  frame.data(), frame.size());
+  }
+
+  if (ZSTD_isError(decoded) || decoded != size) {
+    return false;
+  }
+  return message->ParseFromArray(buffer.data(), static_cast<int>(decoded));
+}
+
+}  // namespace StarryChat
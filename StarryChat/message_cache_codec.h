@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "message.pb.h"
+
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+namespace StarryChat {
+
+/**
+ * 缓存消息的编解码
+ * 序列化后的消息达到阈值时用 zstd（可选训练字典）压缩，值的格式为
+ * [版本字节][zstd 帧]。protobuf 首字节是字段标签，字段号不能为 0，
+ * 所以 0x00-0x07 不会出现在原始消息开头，可用作版本号；
+ * 其余值（包括启用压缩前写入的缓存）按原始 protobuf 读取。
+ */
+class MessageCacheCodec {
+ public:
+  // 压缩值的版本字节
+  static constexpr uint8_t kFormatZstd = 0x01;
+  // 解压后允许的最大长度，防止异常数据占用大量内存
+  static constexpr size_t kMaxDecodedSize = 1 << 20;
+
+  struct Options {
+    bool enabled{false};
+    size_t minSize{128};  // 序列化后小于该字节数的消息保持原样
+    int level{3};
+  };
+
+  static MessageCacheCodec& getInstance();
+
+  MessageCacheCodec(const MessageCacheCodec&) = delete;
+  MessageCacheCodec& operator=(const MessageCacheCodec&) = delete;
+  MessageCacheCodec(MessageCacheCodec&&) = delete;
+  MessageCacheCodec& operator=(MessageCacheCodec&&) = delete;
+
+  /**
+   * 设置压缩参数和字典，应在处理请求之前调用
+   * @param dictionary 字典内容，为空时不使用字典
+   */
+  void initialize(const Options& options, std::string_view dictionary = {});
+
+  /**
+   * 从文件加载字典并初始化，路径为空时不使用字典
+   * @return 字典文件无法读取时返回 false，此时不启用压缩
+   */
+  bool initializeFromFile(const Options& options,
+                          const std::string& dictionaryPath);
+
+  /**
+   * 编码已序列化的消息
+   * @return 需要压缩时写入 out 并返回 true；返回 false 表示直接缓存原始数据
+   */
+  bool encode(std::string_view serialized, std::string* out) const;
+
+  /**
+   * 解码缓存值并直接解析到 message
+   * @return 格式无法识别、字典不匹配或解析失败时返回 false
+   */
+  bool decode(std::string_view payload, starrychat::Message* message) const;
+
+ private:
+  MessageCacheCodec() = default;
+  ~MessageCacheCodec();
+
+  void reset();
+
+  Options options_;
+  ZSTD_CDict_s* cdict_{nullptr};
+  ZSTD_DDict_s* ddict_{nullptr};
+  unsigned dictId_{0};
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,371 @@
+#include "message_partitions.h"
+
+#include <mariadb/conncpp.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include "cold_archive.h"
+#include "db_manager.h"
+#include "logging.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 分区名拼接进 DDL，只允许小写字母、数字和下划线
+bool validPartitionName(const std::string& name) {
+  return !name.empty() && name.size() <= 64 &&
+         std::all_of(name.begin(), name.end(), [](unsigned char ch) {
+           return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') ||
+                  ch == '_';
+         });
+}
+
+std::chrono::year_month_day toDate(uint64_t timestamp) {
+  using namespace std::chrono;
+  return year_month_day(floor<days>(sys_seconds(seconds(timestamp))));
+}
+
+uint64_t toTimestamp(std::chrono::sys_days day) {
+  using namespace std::chrono;
+  auto seconds = duration_cast<std::chrono::seconds>(day.time_since_epoch());
+  return seconds.count() > 0 ? static_cast<uint64_t>(seconds.count()) : 0;
+}
+
+}  // namespace
+
+MessagePartitions& MessagePartitions::getInstance() {
+  static MessagePartitions instance;
+  return instance;
+}
+
+MessagePartitions::MessagePartitions()
+    : partitionCount_(MetricsRegistry::getInstance().gauge(
+          "starrychat_message_partitions", "Partitions of the messages table")),
+      created_(MetricsRegistry::getInstance().counter(
+          "starrychat_message_partitions_created_total",
+          "Monthly message partitions split off p_future")),
+      removed_(MetricsRegistry::getInstance().counter(
+          "starrychat_message_partitions_removed_total",
+          "Message partitions archived or dropped")),
+      exported_(MetricsRegistry::getInstance().counter(
+          "starrychat_message_partitions_exported_messages_total",
+          "Messages exported to cold archive segments")) {}
+
+void MessagePartitions::configure(const MessagePartitionOptions& options) {
+  options_ = options;
+}
+
+uint64_t MessagePartitions::monthStart(uint64_t timestamp) {
+  auto date = toDate(timestamp);
+  return toTimestamp(date.year() / date.month() / 1);
+}
+
+uint64_t MessagePartitions::addMonths(uint64_t monthStart, int months) {
+  auto date = toDate(monthStart);
+  auto target = date.year() / date.month() + std::chrono::months(months);
+  return toTimestamp(target / 1);
+}
+
+std::string MessagePartitions::partitionName(uint64_t monthStart) {
+  auto date = toDate(monthStart);
+  char name[16];
+  std::snprintf(name, sizeof(name), "p%04d%02u", static_cast<int>(date.year()),
+                static_cast<unsigned>(date.month()));
+  return name;
+}
+
+std::optional<std::vector<MessagePartitions::Partition>>
+MessagePartitions::list() {
+  try {
+    auto conn = DBManager::getInstance().getConnection();
+    if (!conn) {
+      return std::nullopt;
+    }
+
+    std::unique_ptr<sql::Statement> stmt(conn->createStatement());
+    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery(
+        "SELECT PARTITION_NAME, PARTITION_DESCRIPTION, TABLE_ROWS "
+        "FROM information_schema.PARTITIONS "
+        "WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'messages' "
+        "AND PARTITION_NAME IS NOT NULL "
+        "ORDER BY PARTITION_ORDINAL_POSITION"));
+
+    std::vector<Partition> partitions;
+    while (rs->next()) {
+      Partition partition;
+      partition.name = std::string(rs->getString("PARTITION_NAME"));
+      std::string description(rs->getString("PARTITION_DESCRIPTION"));
+      if (description != "MAXVALUE") {
+        partition.lessThan = std::stoull(description);
+      }
+      partition.rows = rs->getUInt64("TABLE_ROWS");
+      partitions.push_back(std::move(partition));
+    }
+
+    // 至少两个分区且第一个有上界时，按月窗口查询才有意义
+    uint64_t floor = std::numeric_limits<uint64_t>::max();
+    if (options_.enabled && partitions.size() >= 2 &&
+        partitions.front().lessThan) {
+      floor = *partitions.front().lessThan;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      floor_ = floor;
+    }
+    partitionCount_.set(static_cast<int64_t>(partitions.size()));
+    return partitions;
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "Failed to list message partitions: " << e.what();
+    return std::nullopt;
+  } catch (std::exception& e) {
+    LOG_ERROR << "Failed to list message partitions: " << e.what();
+    return std::nullopt;
+  }
+}
+
+uint64_t MessagePartitions::floor() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return floor_;
+}
+
+bool MessagePartitions::maintain(uint64_t now) {
+  auto& redis = RedisManager::getInstance();
+  std::string token = std::to_string(std::random_device{}()) + "-" +
+                      std::to_string(std::random_device{}());
+  auto acquired =
+      redis.setIfAbsent(RedisKeys::kMessagePartitionsLock, token,
+                        options_.lockTtl);
+  if (!acquired) {
+    LOG_WARN << "Skipping message partition maintenance, Redis unavailable";
+    return false;
+  }
+  if (!*acquired) {
+    LOG_INFO << "Message partition maintenance is running on another node";
+    return list().has_value();
+  }
+
+  bool ok = maintainLocked(now);
+
+  // 维护超过锁的有效期时锁可能已被其他节点取得，只释放自己的
+  if (redis.get(RedisKeys::kMessagePartitionsLock) == token) {
+    redis.del(RedisKeys::kMessagePartitionsLock);
+  }
+  return ok;
+}
+
+bool MessagePartitions::maintainLocked(uint64_t now) {
+  auto partitions = list();
+  if (!partitions) {
+    return false;
+  }
+  if (partitions->empty() || partitions->back().name != kFuturePartition) {
+    LOG_WARN << "messages is not partitioned by month, see "
+                "sql/partition_messages.sql";
+    return false;
+  }
+
+  bool ok = ensureFuture(*partitions, now);
+  if (options_.retentionMonths > 0) {
+    ok = expire(*partitions, now) && ok;
+  }
+
+  // 刷新窗口下界和分区数
+  list();
+  return ok;
+}
+
+bool MessagePartitions::ensureFuture(const std::vector<Partition>& partitions,
+                                     uint64_t now) {
+  // 从最高的有界分区接着往后建，保证月份连续
+  uint64_t next = monthStart(now);
+  for (const auto& partition : partitions) {
+    if (partition.lessThan) {
+      next = *partition.lessThan;
+    }
+  }
+  uint64_t until = addMonths(monthStart(now), options_.monthsAhead + 1);
+  if (next >= until) {
+    return true;
+  }
+
+  // p_future 中通常没有数据，拆分只改元数据
+  std::string sql = "ALTER TABLE messages REORGANIZE PARTITION p_future INTO (";
+  int count = 0;
+  while (next < until) {
+    uint64_t start = monthStart(next);
+    uint64_t end = addMonths(start, 1);
+    sql += "PARTITION " + partitionName(start) + " VALUES LESS THAN (" +
+           std::to_string(end) + "), ";
+    next = end;
+    ++count;
+  }
+  sql += "PARTITION p_future VALUES LESS THAN MAXVALUE)";
+
+  if (!execute(sql)) {
+    return false;
+  }
+  created_.inc(count);
+  LOG_INFO << "Created " << count << " message partitions";
+  return true;
+}
+
+bool MessagePartitions::expire(const std::vector<Partition>& partitions,
+                               uint64_t now) {
+  uint64_t cutoff = addMonths(monthStart(now), -options_.retentionMonths);
+
+  bool ok = true;
+  for (const auto& partition : partitions) {
+    if (!partition.lessThan || *partition.lessThan > cutoff) {
+      continue;
+    }
+    bool removed;
+    if (!options_.segmentDirectory.empty()) {
+      removed = exportSegment(partition.name);
+    } else {
+      removed = options_.archive ? archive(partition.name)
+                                 : drop(partition.name);
+    }
+    ok = removed && ok;
+  }
+  return ok;
+}
+
+bool MessagePartitions::archive(const std::string& partition) {
+  if (!validPartitionName(partition) || partition == kFuturePartition) {
+    LOG_ERROR << "Invalid message partition: " << partition;
+    return false;
+  }
+
+  // 交换要求归档表与分区结构相同且不分区
+  std::string table = "messages_archive_" + partition;
+  if (!execute("CREATE TABLE " + table + " LIKE messages") ||
+      !execute("ALTER TABLE " + table + " REMOVE PARTITIONING") ||
+      !execute("ALTER TABLE messages EXCHANGE PARTITION " + partition +
+               " WITH TABLE " + table)) {
+    return false;
+  }
+  if (!drop(partition)) {
+    return false;
+  }
+
+  LOG_INFO << "Archived message partition " << partition << " to " << table;
+  return true;
+}
+
+bool MessagePartitions::exportSegment(const std::string& partition) {
+  if (!validPartitionName(partition) || partition == kFuturePartition) {
+    LOG_ERROR << "Invalid message partition: " << partition;
+    return false;
+  }
+  if (options_.segmentDirectory.empty()) {
+    LOG_ERROR << "Cold archive segment directory is not configured";
+    return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(options_.segmentDirectory, ec);
+  std::string path = ColdArchive::segmentPath(options_.segmentDirectory,
+                                              partition);
+
+  if (std::filesystem::exists(path, ec)) {
+    LOG_WARN << "Cold archive segment " << path
+             << " already exists, dropping partition";
+  } else {
+    ColdSegmentWriter writer(path);
+    if (!writer.open()) {
+      return false;
+    }
+
+    try {
+      auto conn = DBManager::getInstance().getConnection();
+      if (!conn) {
+        return false;
+      }
+
+      // 按 idx_chat 的顺序流式读取，不把整个分区读进内存
+      std::unique_ptr<sql::Statement> stmt(conn->createStatement());
+      stmt->setFetchSize(1000);
+      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery(
+          "SELECT id, sender_id, chat_type, chat_id, type, content, "
+          "system_code, timestamp, status, reply_to_id FROM messages "
+          "PARTITION (" +
+          partition + ") ORDER BY chat_type, chat_id, timestamp, id"));
+
+      while (rs->next()) {
+        ArchivedMessage message;
+        message.id = rs->getUInt64("id");
+        message.senderId = rs->getUInt64("sender_id");
+        message.chatType = static_cast<uint8_t>(rs->getInt("chat_type"));
+        message.chatId = rs->getUInt64("chat_id");
+        message.type = static_cast<uint8_t>(rs->getInt("type"));
+        message.timestamp = rs->getUInt64("timestamp");
+        message.status = static_cast<uint8_t>(rs->getInt("status"));
+        message.replyToId = rs->getUInt64("reply_to_id");
+        if (!rs->isNull("content")) {
+          message.content = std::string(rs->getString("content"));
+        }
+        if (!rs->isNull("system_code")) {
+          message.systemCode = std::string(rs->getString("system_code"));
+        }
+        if (!writer.append(message)) {
+          return false;
+        }
+      }
+    } catch (sql::SQLException& e) {
+      DBManager::reportError(e);
+      LOG_ERROR << "Failed to export message partition " << partition << ": "
+                << e.what();
+      return false;
+    }
+
+    if (!writer.finish()) {
+      return false;
+    }
+    exported_.inc(writer.messages());
+    LOG_INFO << "Exported " << writer.messages() << " messages of partition "
+             << partition << " to " << path;
+  }
+
+  // 先让本节点读到段文件再删除分区，两边都有的消息由 GetMessages 按 id 去重
+  ColdArchive::getInstance().load(options_.segmentDirectory);
+  return drop(partition);
+}
+
+bool MessagePartitions::drop(const std::string& partition) {
+  if (!validPartitionName(partition) || partition == kFuturePartition) {
+    LOG_ERROR << "Invalid message partition: " << partition;
+    return false;
+  }
+
+  if (!execute("ALTER TABLE messages DROP PARTITION " + partition)) {
+    return false;
+  }
+  removed_.inc();
+  LOG_INFO << "Dropped message partition " << partition;
+  return true;
+}
+
+bool MessagePartitions::execute(const std::string& sql) {
+  try {
+    auto conn = DBManager::getInstance().getConnection();
+    if (!conn) {
+      return false;
+    }
+    std::unique_ptr<sql::Statement> stmt(conn->createStatement());
+    stmt->execute(sql);
+    return true;
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "Message partition DDL failed: " << e.what()
+              << ", SQL: " << sql;
+    return false;
+  }
+}
+
+}  // namespace StarryChat
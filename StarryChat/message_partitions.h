@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "metrics.h"
+
+namespace StarryChat {
+
+struct MessagePartitionOptions {
+  bool enabled{false};
+  int monthsAhead{3};       // 提前建好的月份数
+  int retentionMonths{0};   // 保留的月份数，0 表示不清理
+  bool archive{true};       // 清理前先把分区交换到归档表
+  std::string segmentDirectory;  // 非空时清理前导出为冷历史段文件
+  // 维护锁的有效期，应长于一次维护（含导出）的耗时
+  std::chrono::seconds lockTtl{std::chrono::hours(1)};
+};
+
+/**
+ * messages 表的按月分区
+ * 表按 timestamp（UTC 秒）RANGE 分区：pYYYYMM 存放该月的消息，
+ * p_future（MAXVALUE）兜底。维护时从 p_future 拆出未来的月份，
+ * 超出保留期的分区用 EXCHANGE PARTITION 换到归档表（只改元数据）
+ * 或直接 DROP PARTITION，两者都不逐行删除；配置了段文件目录时先导出
+ * 为冷历史段文件（见 ColdArchive）再删除。
+ * GetMessages 按月份窗口从新到旧查询，每个窗口只访问对应的分区。
+ */
+class MessagePartitions {
+ public:
+  struct Partition {
+    std::string name;
+    std::optional<uint64_t> lessThan;  // 为空表示 MAXVALUE
+    uint64_t rows{0};                  // information_schema 的估计值
+  };
+
+  static constexpr std::string_view kFuturePartition = "p_future";
+
+  static MessagePartitions& getInstance();
+
+  MessagePartitions(const MessagePartitions&) = delete;
+  MessagePartitions& operator=(const MessagePartitions&) = delete;
+  MessagePartitions(MessagePartitions&&) = delete;
+  MessagePartitions& operator=(MessagePartitions&&) = delete;
+
+  void configure(const MessagePartitionOptions& options);
+
+  // timestamp 所在月份的起点（UTC）
+  static uint64_t monthStart(uint64_t timestamp);
+  // 月份起点加减 months 个月
+  static uint64_t addMonths(uint64_t monthStart, int months);
+  // 月份起点对应的分区名，如 p202610
+  static std::string partitionName(uint64_t monthStart);
+
+  /**
+   * 从 information_schema 重新读取分区列表
+   */
+  std::optional<std::vector<Partition>> list();
+
+  /**
+   * 低于该时间戳的消息都在同一个（最早的）分区中，按月窗口查询到此为止
+   * 未分区或只有 p_future 时返回 uint64_t 最大值，查询不分窗口
+   */
+  uint64_t floor() const;
+
+  /**
+   * 建好到 now 之后 monthsAhead 个月为止的分区，再按保留期清理旧分区
+   * 各节点都会调用，持有 Redis 中的维护锁（SET NX）的节点才执行，
+   * 其他节点只刷新分区列表
+   */
+  bool maintain(uint64_t now);
+
+  /**
+   * 把分区交换到新建的归档表 messages_archive_<分区名>，再删除空分区
+   * 归档表已存在时失败，不会覆盖已归档的数据
+   */
+  bool archive(const std::string& partition);
+
+  /**
+   * 把分区按 (聊天, 时间) 顺序导出为段文件目录中的 messages-<分区名>.seg，
+   * 加载到 ColdArchive 后删除分区
+   * 段文件已存在时视为上次已导出，直接删除分区
+   */
+  bool exportSegment(const std::string& partition);
+
+  /**
+   * 删除分区及其中的消息
+   */
+  bool drop(const std::string& partition);
+
+ private:
+  MessagePartitions();
+  ~MessagePartitions() = default;
+
+  bool maintainLocked(uint64_t now);
+  bool ensureFuture(const std::vector<Partition>& partitions, uint64_t now);
+  bool expire(const std::vector<Partition>& partitions, uint64_t now);
+  bool execute(const std::string& sql);
+
+  MessagePartitionOptions options_;
+
+  mutable std::mutex mutex_;
+  uint64_t floor_{std::numeric_limits<uint64_t>::max()};
+
+  Gauge& partitionCount_;
+  Counter& created_;
+  Counter& removed_;
+  Counter& exported_;
+};
+
+}  // namespace StarryChat
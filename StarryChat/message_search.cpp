@@ -0,0 +1,1056 @@
+#include "message_search.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mariadb/conncpp.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <queue>
+#include <tuple>
+#include "db_manager.h"
+#include "logging.h"
+#include "message.pb.h"
+#include "search_segment_format.h"
+#include "varint.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 超过该长度的词（如链接、长串数字）不建索引
+constexpr size_t kMaxTokenBytes = 64;
+
+// 每次补齐从水位之前这么多个 id 起重新读取。自增 id 不按提交顺序可见，
+// 较小的 id 可能在较大的 id 读到之后才提交
+constexpr uint64_t kCatchUpRescan = 1000;
+
+enum class CharClass { kSeparator, kWord, kCjk };
+
+// 解码一个 UTF-8 字符，返回字节数；非法字节按单字节的 U+FFFD 处理
+size_t decodeUtf8(std::string_view text, size_t pos, uint32_t* cp) {
+  auto byte = [&](size_t i) { return static_cast<uint8_t>(text[pos + i]); };
+  uint8_t lead = byte(0);
+  size_t length = lead < 0x80           ? 1
+                  : (lead >> 5) == 0x06 ? 2
+                  : (lead >> 4) == 0x0e ? 3
+                  : (lead >> 3) == 0x1e ? 4
+                                        : 0;
+  if (length == 0 || pos + length > text.size()) {
+    *cp = 0xfffd;
+    return 1;
+  }
+
+  uint32_t value = length == 1 ? lead : lead & (0xff >> (length + 1));
+  for (size_t i = 1; i < length; ++i) {
+    if ((byte(i) & 0xc0) != 0x80) {
+      *cp = 0xfffd;
+      return 1;
+    }
+    value = (value << 6) | (byte(i) & 0x3f);
+  }
+  *cp = value;
+  return length;
+}
+
+CharClass classify(uint32_t cp) {
+  if (cp < 0x80) {
+    return std::isalnum(static_cast<int>(cp)) ? CharClass::kWord
+                                              : CharClass::kSeparator;
+  }
+  // 汉字、假名和谚文
+  if ((cp >= 0x3040 && cp <= 0x30ff) || (cp >= 0x3400 && cp <= 0x4dbf) ||
+      (cp >= 0x4e00 && cp <= 0x9fff) || (cp >= 0xac00 && cp <= 0xd7af) ||
+      (cp >= 0xf900 && cp <= 0xfaff) || (cp >= 0x20000 && cp <= 0x2ffff)) {
+    return CharClass::kCjk;
+  }
+  // 标点、符号、全角形式和表情
+  if ((cp >= 0x80 && cp <= 0xbf) || (cp >= 0x2000 && cp <= 0x2bff) ||
+      (cp >= 0x3000 && cp <= 0x303f) || (cp >= 0xfe30 && cp <= 0xfe4f) ||
+      (cp >= 0xff00 && cp <= 0xffef) || (cp >= 0x1f000 && cp <= 0x1faff) ||
+      cp == 0xfffd) {
+    return CharClass::kSeparator;
+  }
+  return CharClass::kWord;
+}
+
+std::string toLower(std::string_view text) {
+  std::string lower(text);
+  for (auto& ch : lower) {
+    if (ch >= 'A' && ch <= 'Z') {
+      ch = static_cast<char>(ch - 'A' + 'a');
+    }
+  }
+  return lower;
+}
+
+// 把文本切为同一类别的连续片段，分隔符不回调
+template <typename Callback>
+void forEachRun(std::string_view text, Callback&& callback) {
+  CharClass current = CharClass::kSeparator;
+  size_t start = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    uint32_t cp;
+    size_t length = decodeUtf8(text, pos, &cp);
+    CharClass cls = classify(cp);
+    if (cls != current) {
+      if (current != CharClass::kSeparator) {
+        callback(current, text.substr(start, pos - start));
+      }
+      current = cls;
+      start = pos;
+    }
+    pos += length;
+  }
+  if (current != CharClass::kSeparator) {
+    callback(current, text.substr(start));
+  }
+}
+
+/**
+ * 顺序写出一个段文件，先写 <path>.tmp，finish 时 fsync 后改名
+ * 词项必须按 (chatType, chatId, token) 递增的顺序加入
+ */
+class SegmentWriter {
+ public:
+  explicit SegmentWriter(std::string path)
+      : path_(std::move(path)), tmpPath_(path_ + ".tmp") {}
+
+  ~SegmentWriter() {
+    if (file_) {
+      std::fclose(file_);
+      std::remove(tmpPath_.c_str());
+    }
+  }
+
+  SegmentWriter(const SegmentWriter&) = delete;
+  SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+  bool open() {
+    file_ = std::fopen(tmpPath_.c_str(), "wb");
+    if (!file_) {
+      LOG_ERROR << "Failed to create " << tmpPath_ << ": "
+                << std::strerror(errno);
+      return false;
+    }
+    return write(searchseg::kMagic, sizeof(searchseg::kMagic));
+  }
+
+  // ids 已排序且去重
+  bool add(uint8_t chatType,
+           uint64_t chatId,
+           std::string_view token,
+           const std::vector<uint64_t>& ids) {
+    if (ids.empty() || token.empty()) {
+      return true;
+    }
+    auto key = std::make_tuple(chatType, chatId, token);
+    if (!entries_.empty() && key <= lastKey()) {
+      LOG_ERROR << "Search segment terms out of order in " << path_;
+      return false;
+    }
+    if (token.size() > UINT16_MAX ||
+        tokens_.size() + token.size() > UINT32_MAX) {
+      LOG_ERROR << "Search segment token table too large in " << path_;
+      return false;
+    }
+
+    buffer_.clear();
+    blockData_.clear();
+    putVarint(buffer_, ids.size());
+    putVarint(buffer_, (ids.size() + searchseg::kPostingsBlock - 1) /
+                           searchseg::kPostingsBlock);
+    uint64_t previousFirst = 0;
+    for (size_t begin = 0; begin < ids.size();
+         begin += searchseg::kPostingsBlock) {
+      size_t end = std::min<size_t>(ids.size(),
+                                    begin + searchseg::kPostingsBlock);
+      size_t start = blockData_.size();
+      for (size_t i = begin + 1; i < end; ++i) {
+        putVarint(blockData_, ids[i] - ids[i - 1]);
+      }
+      putVarint(buffer_, ids[begin] - previousFirst);
+      putVarint(buffer_, blockData_.size() - start);
+      previousFirst = ids[begin];
+    }
+    buffer_ += blockData_;
+
+    searchseg::TermEntry entry{};
+    entry.chatType = chatType;
+    entry.chatId = chatId;
+    entry.postingsOffset = offset_;
+    entry.postingsSize = static_cast<uint32_t>(buffer_.size());
+    entry.tokenOffset = static_cast<uint32_t>(tokens_.size());
+    entry.tokenLength = static_cast<uint16_t>(token.size());
+    entries_.push_back(entry);
+    tokens_ += token;
+    return write(buffer_.data(), buffer_.size());
+  }
+
+  bool finish(uint64_t watermark) {
+    if (!file_) {
+      return false;
+    }
+
+    searchseg::Footer footer{};
+    footer.tokensOffset = offset_;
+    if (!write(tokens_.data(), tokens_.size())) {
+      return false;
+    }
+    footer.termsOffset = offset_;
+    footer.watermark = watermark;
+    footer.termCount = static_cast<uint32_t>(entries_.size());
+    footer.version = searchseg::kVersion;
+    std::memcpy(footer.magic, searchseg::kMagic, sizeof(footer.magic));
+    if (!write(entries_.data(),
+               entries_.size() * sizeof(searchseg::TermEntry)) ||
+        !write(&footer, sizeof(footer))) {
+      return false;
+    }
+
+    bool ok = std::fflush(file_) == 0 && ::fsync(fileno(file_)) == 0;
+    ok = std::fclose(file_) == 0 && ok;
+    file_ = nullptr;
+    if (!ok || std::rename(tmpPath_.c_str(), path_.c_str()) != 0) {
+      LOG_ERROR << "Failed to finish " << path_ << ": "
+                << std::strerror(errno);
+      std::remove(tmpPath_.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::tuple<uint8_t, uint64_t, std::string_view> lastKey() const {
+    const auto& last = entries_.back();
+    return {last.chatType, last.chatId,
+            std::string_view(tokens_).substr(last.tokenOffset,
+                                             last.tokenLength)};
+  }
+
+  bool write(const void* data, size_t size) {
+    if (std::fwrite(data, 1, size, file_) != size) {
+      LOG_ERROR << "Failed to write " << tmpPath_ << ": "
+                << std::strerror(errno);
+      return false;
+    }
+    offset_ += size;
+    return true;
+  }
+
+  std::string path_;
+  std::string tmpPath_;
+  std::FILE* file_{nullptr};
+  uint64_t offset_{0};
+  std::string buffer_;
+  std::string blockData_;
+  std::string tokens_;
+  std::vector<searchseg::TermEntry> entries_;
+};
+
+// 段文件倒排表中的一块
+struct PostingBlock {
+  uint64_t firstId;
+  const char* data;
+  uint64_t size;
+  uint32_t count;  // 块内 id 数
+};
+
+// 解析倒排表的跳表，格式错误时返回 false
+bool parseBlocks(std::string_view postings, std::vector<PostingBlock>* blocks) {
+  const char* p = postings.data();
+  const char* end = p + postings.size();
+  uint64_t count;
+  uint64_t blockCount;
+  if (!getVarint(p, end, &count) || !getVarint(p, end, &blockCount) ||
+      count > static_cast<uint64_t>(end - p) ||
+      blockCount != (count + searchseg::kPostingsBlock - 1) /
+                        searchseg::kPostingsBlock) {
+    return false;
+  }
+
+  blocks->clear();
+  blocks->reserve(blockCount);
+  uint64_t firstId = 0;
+  for (uint64_t i = 0; i < blockCount; ++i) {
+    uint64_t delta;
+    uint64_t size;
+    if (!getVarint(p, end, &delta) || !getVarint(p, end, &size) ||
+        (i > 0 && delta == 0)) {
+      return false;
+    }
+    firstId += delta;
+    uint64_t n = i + 1 < blockCount ? searchseg::kPostingsBlock
+                                    : count - i * searchseg::kPostingsBlock;
+    blocks->push_back(
+        PostingBlock{firstId, nullptr, size, static_cast<uint32_t>(n)});
+  }
+  for (auto& block : *blocks) {
+    if (block.size > static_cast<uint64_t>(end - p)) {
+      return false;
+    }
+    block.data = p;
+    p += block.size;
+  }
+  return p == end;
+}
+
+// 解码一块追加到 ids
+bool decodeBlock(const PostingBlock& block, std::vector<uint64_t>* ids) {
+  const char* p = block.data;
+  const char* end = p + block.size;
+  uint64_t id = block.firstId;
+  ids->push_back(id);
+  uint64_t delta;
+  for (uint32_t i = 1; i < block.count; ++i) {
+    if (!getVarint(p, end, &delta) || delta == 0) {
+      return false;
+    }
+    id += delta;
+    ids->push_back(id);
+  }
+  return p == end;
+}
+
+/**
+ * 从新到旧遍历一个倒排表，seek 的目标只能递减
+ * 段文件中的倒排表按跳表定位，跳过的块不解码
+ */
+class PostingCursor {
+ public:
+  // 内存表中的倒排表，ids 升序且去重
+  explicit PostingCursor(std::vector<uint64_t> ids)
+      : ids_(std::move(ids)), available_(ids_.size()) {}
+
+  // 段文件中的倒排表
+  explicit PostingCursor(std::vector<PostingBlock> blocks)
+      : blocks_(std::move(blocks)), block_(blocks_.size()) {}
+
+  // 移到不大于 target 的最大 id 并返回，没有时返回 0
+  uint64_t seek(uint64_t target) {
+    while (true) {
+      if (available_ > 0 && ids_.front() <= target) {
+        available_ = std::upper_bound(ids_.begin(),
+                                      ids_.begin() + available_, target) -
+                     ids_.begin();
+        return ids_[available_ - 1];
+      }
+
+      // 当前块之前首个 id 不大于 target 的最后一块
+      auto next = std::upper_bound(
+          blocks_.begin(), blocks_.begin() + block_, target,
+          [](uint64_t id, const PostingBlock& block) {
+            return id < block.firstId;
+          });
+      block_ = static_cast<size_t>(next - blocks_.begin());
+      available_ = 0;
+      if (block_ == 0) {
+        return 0;
+      }
+      --block_;
+      ids_.clear();
+      if (!decodeBlock(blocks_[block_], &ids_)) {
+        corrupt_ = true;
+        block_ = 0;
+        return 0;
+      }
+      available_ = ids_.size();
+    }
+  }
+
+  bool corrupt() const { return corrupt_; }
+
+ private:
+  std::vector<PostingBlock> blocks_;
+  size_t block_{0};  // 已解码到的块，之前的块尚未解码
+  std::vector<uint64_t> ids_;
+  size_t available_{0};  // ids_ 中前 available_ 个尚未越过
+  bool corrupt_{false};
+};
+
+}  // namespace
+
+/**
+ * 一个只读映射的段文件
+ */
+class MessageSearchIndex::Segment {
+ public:
+  static std::shared_ptr<const Segment> open(const std::string& path);
+
+  ~Segment() { ::munmap(const_cast<char*>(base_), size_); }
+
+  Segment(const Segment&) = delete;
+  Segment& operator=(const Segment&) = delete;
+
+  const std::string& path() const { return path_; }
+  uint64_t watermark() const { return footer_.watermark; }
+  uint32_t termCount() const { return footer_.termCount; }
+
+  searchseg::TermEntry entry(uint32_t i) const {
+    searchseg::TermEntry entry;
+    std::memcpy(&entry,
+                base_ + footer_.termsOffset + i * sizeof(searchseg::TermEntry),
+                sizeof(entry));
+    return entry;
+  }
+
+  std::string_view token(const searchseg::TermEntry& entry) const {
+    uint64_t tokensSize = footer_.termsOffset - footer_.tokensOffset;
+    if (uint64_t{entry.tokenOffset} + entry.tokenLength > tokensSize) {
+      return {};
+    }
+    return std::string_view(base_ + footer_.tokensOffset + entry.tokenOffset,
+                            entry.tokenLength);
+  }
+
+  // 查找词项的目录项
+  bool find(uint8_t chatType,
+            uint64_t chatId,
+            std::string_view token,
+            searchseg::TermEntry* found) const {
+    auto key = std::make_tuple(chatType, chatId, token);
+    uint32_t low = 0;
+    uint32_t high = footer_.termCount;
+    while (low < high) {
+      uint32_t mid = low + (high - low) / 2;
+      auto e = entry(mid);
+      if (std::make_tuple(e.chatType, e.chatId, this->token(e)) < key) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    if (low == footer_.termCount) {
+      return false;
+    }
+    *found = entry(low);
+    return std::make_tuple(found->chatType, found->chatId,
+                           this->token(*found)) == key;
+  }
+
+  // 倒排表的各块，格式错误时返回 false
+  bool blocks(const searchseg::TermEntry& entry,
+              std::vector<PostingBlock>* blocks) const {
+    if (entry.postingsOffset + entry.postingsSize > footer_.tokensOffset) {
+      return false;
+    }
+    return parseBlocks(
+        std::string_view(base_ + entry.postingsOffset, entry.postingsSize),
+        blocks);
+  }
+
+  // 解码整个倒排表追加到 ids
+  bool postings(const searchseg::TermEntry& entry,
+                std::vector<uint64_t>* ids) const {
+    std::vector<PostingBlock> blocks;
+    if (!this->blocks(entry, &blocks)) {
+      return false;
+    }
+    for (const auto& block : blocks) {
+      if (!decodeBlock(block, ids)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  Segment(std::string path, const char* base, size_t size)
+      : path_(std::move(path)), base_(base), size_(size) {}
+
+  std::string path_;
+  const char* base_;
+  size_t size_;
+  searchseg::Footer footer_{};
+};
+
+std::shared_ptr<const MessageSearchIndex::Segment>
+MessageSearchIndex::Segment::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR << "Failed to open " << path << ": " << std::strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) <
+          sizeof(searchseg::kMagic) + sizeof(searchseg::Footer)) {
+    LOG_ERROR << "Invalid search segment " << path;
+    ::close(fd);
+    return nullptr;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    LOG_ERROR << "Failed to map " << path << ": " << std::strerror(errno);
+    return nullptr;
+  }
+
+  std::shared_ptr<Segment> segment(
+      new Segment(path, static_cast<const char*>(base), size));
+  auto& footer = segment->footer_;
+  std::memcpy(&footer, segment->base_ + size - sizeof(footer), sizeof(footer));
+  if (std::memcmp(segment->base_, searchseg::kMagic,
+                  sizeof(searchseg::kMagic)) != 0 ||
+      std::memcmp(footer.magic, searchseg::kMagic, sizeof(footer.magic)) !=
+          0 ||
+      footer.version != searchseg::kVersion ||
+      footer.tokensOffset > footer.termsOffset ||
+      footer.termsOffset +
+              uint64_t{footer.termCount} * sizeof(searchseg::TermEntry) +
+              sizeof(footer) !=
+          size) {
+    LOG_ERROR << "Corrupt search segment " << path;
+    return nullptr;
+  }
+  return segment;
+}
+
+MessageSearchIndex& MessageSearchIndex::getInstance() {
+  static MessageSearchIndex instance;
+  return instance;
+}
+
+MessageSearchIndex::MessageSearchIndex()
+    : memTable_(std::make_shared<MemTable>()),
+      segmentCount_(MetricsRegistry::getInstance().gauge(
+          "starrychat_search_segments", "Message search index segment files")),
+      memPostings_(MetricsRegistry::getInstance().gauge(
+          "starrychat_search_memtable_postings",
+          "Postings in the in-memory search table")),
+      indexed_(MetricsRegistry::getInstance().counter(
+          "starrychat_search_indexed_messages_total",
+          "Messages added to the search index")),
+      flushes_(MetricsRegistry::getInstance().counter(
+          "starrychat_search_flushes_total",
+          "In-memory search tables written as segments")),
+      merges_(MetricsRegistry::getInstance().counter(
+          "starrychat_search_merges_total", "Search segment merges")) {}
+
+bool MessageSearchIndex::open(const MessageSearchOptions& options) {
+  std::error_code ec;
+  std::filesystem::create_directories(options.directory, ec);
+  std::filesystem::directory_iterator it(options.directory, ec);
+  if (ec) {
+    LOG_ERROR << "Failed to open search directory " << options.directory
+              << ": " << ec.message();
+    return false;
+  }
+
+  std::vector<std::shared_ptr<const Segment>> segments;
+  uint64_t watermark = 0;
+  uint64_t sequence = 0;
+  bool corrupt = false;
+  for (const auto& file : it) {
+    auto path = file.path();
+    if (path.extension() == ".tmp") {
+      // 崩溃时未写完的段文件
+      std::filesystem::remove(path, ec);
+      continue;
+    }
+    if (path.extension() != ".idx") {
+      continue;
+    }
+
+    auto segment = Segment::open(path.string());
+    if (!segment) {
+      corrupt = true;
+      continue;
+    }
+    unsigned long long number = 0;
+    std::sscanf(path.stem().c_str(), "search-%llu", &number);
+    sequence = std::max<uint64_t>(sequence, number);
+    watermark = std::max(watermark, segment->watermark());
+    segments.push_back(std::move(segment));
+  }
+
+  // 文件名中的序号补齐了位数，按名称排序即按写出顺序
+  std::sort(segments.begin(), segments.end(),
+            [](const auto& a, const auto& b) { return a->path() < b->path(); });
+  if (corrupt) {
+    // 损坏的段文件中的消息只能从头补齐
+    LOG_WARN << "Search index will be rebuilt from the database";
+    watermark = 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+  segments_ = std::move(segments);
+  watermark_ = watermark;
+  nextSequence_ = sequence + 1;
+  enabled_ = true;
+  segmentCount_.set(static_cast<int64_t>(segments_.size()));
+  LOG_INFO << "Opened search index with " << segments_.size()
+           << " segments, caught up to message " << watermark_;
+  return true;
+}
+
+bool MessageSearchIndex::enabled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return enabled_;
+}
+
+std::vector<std::string> MessageSearchIndex::tokenize(std::string_view text) {
+  return terms(text, true);
+}
+
+std::vector<std::string> MessageSearchIndex::queryTerms(
+    std::string_view query) {
+  return terms(query, false);
+}
+
+std::vector<std::string> MessageSearchIndex::terms(std::string_view text,
+                                                   bool unigrams) {
+  std::vector<std::string> tokens;
+  forEachRun(text, [&tokens, unigrams](CharClass cls, std::string_view run) {
+    if (cls == CharClass::kWord) {
+      if (run.size() <= kMaxTokenBytes) {
+        tokens.push_back(toLower(run));
+      }
+      return;
+    }
+
+    // 中日韩文字没有空格分词，取相邻两字；索引时每个字也作为词项，
+    // 只有一个字的查询才能命中
+    std::vector<size_t> starts;
+    for (size_t pos = 0; pos < run.size();) {
+      uint32_t cp;
+      starts.push_back(pos);
+      pos += decodeUtf8(run, pos, &cp);
+    }
+    starts.push_back(run.size());
+    if (starts.size() == 2) {
+      tokens.emplace_back(run);
+      return;
+    }
+    for (size_t i = 0; i + 2 < starts.size(); ++i) {
+      tokens.emplace_back(run.substr(starts[i], starts[i + 2] - starts[i]));
+    }
+    if (unigrams) {
+      for (size_t i = 0; i + 1 < starts.size(); ++i) {
+        tokens.emplace_back(run.substr(starts[i], starts[i + 1] - starts[i]));
+      }
+    }
+  });
+
+  std::sort(tokens.begin(), tokens.end());
+  tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+  return tokens;
+}
+
+std::vector<std::string> MessageSearchIndex::phrases(std::string_view query) {
+  // 相邻的词和中日韩片段合并为一个部分，例如 "iPhone手机"
+  std::vector<std::string> phrases;
+  size_t end = std::string_view::npos;
+  forEachRun(query, [&](CharClass, std::string_view run) {
+    size_t start = static_cast<size_t>(run.data() - query.data());
+    if (start == end && !phrases.empty()) {
+      phrases.back() += toLower(run);
+    } else {
+      phrases.push_back(toLower(run));
+    }
+    end = start + run.size();
+  });
+  return phrases;
+}
+
+bool MessageSearchIndex::matches(std::string_view text,
+                                 const std::vector<std::string>& phrases) {
+  std::string lower = toLower(text);
+  return std::all_of(phrases.begin(), phrases.end(),
+                     [&lower](const std::string& phrase) {
+                       return lower.find(phrase) != std::string::npos;
+                     });
+}
+
+void MessageSearchIndex::add(uint8_t chatType,
+                             uint64_t chatId,
+                             uint64_t messageId,
+                             std::string_view text) {
+  if (!enabled()) {
+    return;
+  }
+  auto tokens = tokenize(text);
+  if (tokens.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!enabled_) {
+    return;
+  }
+  auto& terms = (*memTable_)[ChatKey(chatType, chatId)];
+  for (auto& token : tokens) {
+    terms[std::move(token)].push_back(messageId);
+  }
+  postings_ += tokens.size();
+  memPostings_.set(static_cast<int64_t>(postings_));
+  indexed_.inc();
+}
+
+std::vector<uint64_t> MessageSearchIndex::candidates(
+    uint8_t chatType,
+    uint64_t chatId,
+    const std::vector<std::string>& terms,
+    uint64_t beforeId,
+    size_t limit) const {
+  if (terms.empty() || limit == 0) {
+    return {};
+  }
+
+  ChatKey key(chatType, chatId);
+  std::vector<std::vector<uint64_t>> memory(terms.size());
+  std::vector<std::shared_ptr<const Segment>> segments;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_) {
+      return {};
+    }
+    segments = segments_;
+
+    const MemTable* tables[] = {memTable_.get(), flushing_.get()};
+    for (const MemTable* table : tables) {
+      if (!table) {
+        continue;
+      }
+      auto chat = table->find(key);
+      if (chat == table->end()) {
+        continue;
+      }
+      for (size_t i = 0; i < terms.size(); ++i) {
+        auto term = chat->second.find(terms[i]);
+        if (term != chat->second.end()) {
+          memory[i].insert(memory[i].end(), term->second.begin(),
+                           term->second.end());
+        }
+      }
+    }
+  }
+
+  // 每个词项在内存表和各段文件中各有一个倒排表。同一条消息可能由本
+  // 节点和补齐各加入一次，补齐的消息也不一定比已有的新，内存表的要排序
+  std::vector<std::vector<PostingCursor>> cursors(terms.size());
+  for (size_t i = 0; i < terms.size(); ++i) {
+    if (!memory[i].empty()) {
+      std::sort(memory[i].begin(), memory[i].end());
+      memory[i].erase(std::unique(memory[i].begin(), memory[i].end()),
+                      memory[i].end());
+      cursors[i].emplace_back(std::move(memory[i]));
+    }
+  }
+  searchseg::TermEntry entry;
+  std::vector<PostingBlock> blocks;
+  for (const auto& segment : segments) {
+    for (size_t i = 0; i < terms.size(); ++i) {
+      if (!segment->find(chatType, chatId, terms[i], &entry)) {
+        continue;
+      }
+      if (!segment->blocks(entry, &blocks)) {
+        LOG_ERROR << "Corrupt postings in " << segment->path();
+        continue;
+      }
+      cursors[i].emplace_back(std::move(blocks));
+    }
+  }
+
+  // 词项在各来源中不大于 target 的最大 id
+  auto seek = [&cursors](size_t term, uint64_t target) {
+    uint64_t found = 0;
+    for (auto& cursor : cursors[term]) {
+      found = std::max(found, cursor.seek(target));
+    }
+    return found;
+  };
+
+  // 各词项轮流把目标降到自己不大于目标的最大 id，全部一致时得到一个
+  // 候选。目标只减不增，取够 limit 个即停，倒排表只解码走到的块
+  std::vector<uint64_t> result;
+  uint64_t target = beforeId > 0 ? beforeId - 1 : UINT64_MAX;
+  while (result.size() < limit && target > 0) {
+    size_t agreed = 0;
+    for (size_t i = 0; agreed < terms.size() && target > 0;
+         i = (i + 1) % terms.size()) {
+      uint64_t found = seek(i, target);
+      agreed = found == target ? agreed + 1 : 1;
+      target = found;
+    }
+    if (target == 0) {
+      break;
+    }
+    result.push_back(target--);
+  }
+
+  for (const auto& term : cursors) {
+    for (const auto& cursor : term) {
+      if (cursor.corrupt()) {
+        LOG_ERROR << "Corrupt postings block in search index for chat "
+                  << chatId;
+      }
+    }
+  }
+  return result;
+}
+
+size_t MessageSearchIndex::catchUp(int batchSize) {
+  uint64_t lastId;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_) {
+      return 0;
+    }
+    lastId = watermark_;
+  }
+
+  size_t total = 0;
+  try {
+    auto conn = DBManager::getInstance().getConnection(DBAccess::kReadOnly);
+    if (!conn) {
+      return 0;
+    }
+
+    // 按主键分页读取，首次启动时即从头建立索引。水位之前的一段重新
+    // 读取，补上晚提交的消息，其中本轮之前已加入的跳过
+    TimedStatement stmt(conn,
+                        "SELECT id, chat_type, chat_id, content "
+                        "FROM messages WHERE id > ? AND type = ? "
+                        "ORDER BY id LIMIT ?");
+
+    uint64_t from = lastId > kCatchUpRescan ? lastId - kCatchUpRescan : 0;
+    while (true) {
+      stmt->setUInt64(1, from);
+      stmt->setInt(2, static_cast<int>(starrychat::MESSAGE_TYPE_TEXT));
+      stmt->setInt(3, batchSize);
+
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+      int rows = 0;
+      while (rs->next()) {
+        from = rs->getUInt64("id");
+        lastId = std::max(lastId, from);
+        ++rows;
+        if (!caughtUp_.insert(from).second) {
+          continue;
+        }
+        if (!rs->isNull("content")) {
+          add(static_cast<uint8_t>(rs->getInt("chat_type")),
+              rs->getUInt64("chat_id"), from,
+              std::string(rs->getString("content")));
+        }
+        ++total;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        watermark_ = lastId;
+      }
+      if (rows < batchSize) {
+        break;
+      }
+      // 补齐大量历史时按阈值分批写出，避免内存表无限增长
+      maintain();
+    }
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "Failed to catch up search index: " << e.what();
+  }
+
+  // 只需记住下次重新读取的范围内已加入的 id
+  if (lastId > kCatchUpRescan) {
+    caughtUp_.erase(caughtUp_.begin(),
+                    caughtUp_.upper_bound(lastId - kCatchUpRescan));
+  }
+  return total;
+}
+
+void MessageSearchIndex::maintain() {
+  size_t postings;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_) {
+      return;
+    }
+    postings = postings_;
+  }
+  if (postings >= options_.flushPostings && !flush()) {
+    LOG_ERROR << "Failed to flush search index";
+  }
+
+  size_t segments;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments = segments_.size();
+  }
+  if (segments > options_.maxSegments && !merge()) {
+    LOG_ERROR << "Failed to merge search segments";
+  }
+}
+
+std::string MessageSearchIndex::nextSegmentPath() {
+  char name[32];
+  std::snprintf(name, sizeof(name), "search-%020" PRIu64 ".idx",
+                nextSequence_++);
+  return (std::filesystem::path(options_.directory) / name).string();
+}
+
+bool MessageSearchIndex::flush() {
+  std::shared_ptr<const MemTable> table;
+  uint64_t watermark;
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (postings_ == 0) {
+      return true;
+    }
+    table = memTable_;
+    flushing_ = table;
+    memTable_ = std::make_shared<MemTable>();
+    postings_ = 0;
+    watermark = watermark_;
+    path = nextSegmentPath();
+  }
+
+  SegmentWriter writer(path);
+  bool ok = writer.open();
+  std::vector<uint64_t> ids;
+  for (auto chat = table->begin(); ok && chat != table->end(); ++chat) {
+    for (const auto& [token, postings] : chat->second) {
+      ids = postings;
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+      if (!writer.add(chat->first.first, chat->first.second, token, ids)) {
+        ok = false;
+        break;
+      }
+    }
+  }
+  ok = ok && writer.finish(watermark);
+  auto segment = ok ? Segment::open(path) : nullptr;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool flushed = segment != nullptr;
+  if (flushed) {
+    segments_.push_back(std::move(segment));
+    flushes_.inc();
+  } else {
+    // 写出失败时放回内存表，下次维护再试
+    for (const auto& [key, terms] : *table) {
+      auto& target = (*memTable_)[key];
+      for (const auto& [token, postings] : terms) {
+        auto& list = target[token];
+        list.insert(list.end(), postings.begin(), postings.end());
+        postings_ += postings.size();
+      }
+    }
+  }
+  flushing_.reset();
+  segmentCount_.set(static_cast<int64_t>(segments_.size()));
+  memPostings_.set(static_cast<int64_t>(postings_));
+  return flushed;
+}
+
+bool MessageSearchIndex::merge() {
+  std::vector<std::shared_ptr<const Segment>> inputs;
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (segments_.size() < 2) {
+      return true;
+    }
+    inputs = segments_;
+    path = nextSegmentPath();
+  }
+
+  // 各段的词项目录都有序，多路归并后同一词项的倒排表取并集
+  struct Cursor {
+    const Segment* segment;
+    uint32_t next;
+    searchseg::TermEntry entry;
+    std::string_view token;
+
+    auto key() const {
+      return std::make_tuple(entry.chatType, entry.chatId, token);
+    }
+  };
+  auto greater = [](const Cursor& a, const Cursor& b) {
+    return a.key() > b.key();
+  };
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(
+      greater);
+  auto push = [&heap](const Segment* segment, uint32_t next) {
+    if (next < segment->termCount()) {
+      auto entry = segment->entry(next);
+      heap.push(Cursor{segment, next, entry, segment->token(entry)});
+    }
+  };
+
+  uint64_t watermark = 0;
+  for (const auto& segment : inputs) {
+    watermark = std::max(watermark, segment->watermark());
+    push(segment.get(), 0);
+  }
+
+  SegmentWriter writer(path);
+  if (!writer.open()) {
+    return false;
+  }
+  std::vector<uint64_t> ids;
+  while (!heap.empty()) {
+    auto key = heap.top().key();
+    ids.clear();
+    while (!heap.empty() && heap.top().key() == key) {
+      Cursor cursor = heap.top();
+      heap.pop();
+      if (!cursor.segment->postings(cursor.entry, &ids)) {
+        LOG_ERROR << "Corrupt postings in " << cursor.segment->path();
+        return false;
+      }
+      push(cursor.segment, cursor.next + 1);
+    }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    if (!writer.add(std::get<0>(key), std::get<1>(key), std::get<2>(key),
+                    ids)) {
+      return false;
+    }
+  }
+  if (!writer.finish(watermark)) {
+    return false;
+  }
+  auto merged = Segment::open(path);
+  if (!merged) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto merging = [&inputs](const auto& segment) {
+      return std::find(inputs.begin(), inputs.end(), segment) != inputs.end();
+    };
+    segments_.erase(
+        std::remove_if(segments_.begin(), segments_.end(), merging),
+        segments_.end());
+    segments_.insert(segments_.begin(), std::move(merged));
+    segmentCount_.set(static_cast<int64_t>(segments_.size()));
+  }
+
+  // 正在进行的查询仍持有旧段的映射，删除文件不影响它们
+  std::error_code ec;
+  for (const auto& segment : inputs) {
+    std::filesystem::remove(segment->path(), ec);
+  }
+  merges_.inc();
+  LOG_INFO << "Merged " << inputs.size() << " search segments into " << path;
+  return true;
+}
+
+}  // namespace StarryChat
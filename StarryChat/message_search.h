@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "metrics.h"
+
+namespace StarryChat {
+
+struct MessageSearchOptions {
+  std::string directory;         // 段文件目录
+  size_t flushPostings{200000};  // 内存表的倒排项达到该数量后写出
+  size_t maxSegments{8};         // 段文件超过该数量时合并
+};
+
+/**
+ * 消息全文搜索索引
+ * 按聊天建立倒排索引：文本消息分词后，每个 (聊天, 词项) 对应一个按消息
+ * id 递增的倒排表。新消息先进入内存表，倒排项达到 flushPostings 后写为
+ * 目录中的段文件（格式见 search_segment_format.h），段文件以只读方式
+ * mmap，数量超过 maxSegments 时在后台合并为一个。
+ *
+ * 分词：连续的字母和数字为一个词（ASCII 转小写）；连续的中日韩文字切为
+ * 相邻两字的二元组，索引时每个字另作为一个词项，查询时只有单独一个字
+ * 才用单字词项。
+ * 查询从新到旧求各词项倒排表的交集，结果是候选消息，调用方用 matches
+ * 核对原文。
+ *
+ * 本节点发送的消息即时加入索引，其他节点写入的消息由 catchUp 按 id
+ * 从数据库补齐；段文件记录补齐的位置，重启后从该位置继续。
+ */
+class MessageSearchIndex {
+ public:
+  static MessageSearchIndex& getInstance();
+
+  MessageSearchIndex(const MessageSearchIndex&) = delete;
+  MessageSearchIndex& operator=(const MessageSearchIndex&) = delete;
+  MessageSearchIndex(MessageSearchIndex&&) = delete;
+  MessageSearchIndex& operator=(MessageSearchIndex&&) = delete;
+
+  /**
+   * 加载目录中的段文件，之后才接受索引和查询
+   */
+  bool open(const MessageSearchOptions& options);
+
+  bool enabled() const;
+
+  // 建立索引用的文本去重词项（含中日韩单字）
+  static std::vector<std::string> tokenize(std::string_view text);
+  // 查询的去重词项
+  static std::vector<std::string> queryTerms(std::string_view query);
+  // 查询按空白和标点切分的各部分（ASCII 转小写）
+  static std::vector<std::string> phrases(std::string_view query);
+  // 文本是否包含查询的每一部分
+  static bool matches(std::string_view text,
+                      const std::vector<std::string>& phrases);
+
+  void add(uint8_t chatType,
+           uint64_t chatId,
+           uint64_t messageId,
+           std::string_view text);
+
+  /**
+   * 聊天中包含全部词项且 id < beforeId（0 表示不限）的消息 id，从新到旧
+   * 最多 limit 个。倒排表从新到旧遍历，取够即停
+   */
+  std::vector<uint64_t> candidates(uint8_t chatType,
+                                   uint64_t chatId,
+                                   const std::vector<std::string>& terms,
+                                   uint64_t beforeId,
+                                   size_t limit) const;
+
+  /**
+   * 从数据库读取上次补齐位置之后的文本消息加入索引，直到没有更多
+   * 补齐位置之前的一段也重新读取，补上晚于较大 id 提交的消息
+   * @return 本次加入的消息数，读取失败时返回已加入的部分
+   */
+  size_t catchUp(int batchSize);
+
+  /**
+   * 内存表达到阈值时写出段文件，段文件过多时合并
+   * 只由后台线程调用
+   */
+  void maintain();
+
+ private:
+  class Segment;
+  using ChatKey = std::pair<uint8_t, uint64_t>;
+  using MemTable =
+      std::map<ChatKey,
+               std::map<std::string, std::vector<uint64_t>, std::less<>>>;
+
+  MessageSearchIndex();
+  ~MessageSearchIndex() = default;
+
+  static std::vector<std::string> terms(std::string_view text, bool unigrams);
+
+  bool flush();
+  bool merge();
+  std::string nextSegmentPath();
+
+  MessageSearchOptions options_;
+
+  mutable std::mutex mutex_;
+  bool enabled_{false};
+  std::shared_ptr<MemTable> memTable_;
+  // 正在写出的内存表，写完之前仍参与查询
+  std::shared_ptr<const MemTable> flushing_;
+  size_t postings_{0};
+  uint64_t watermark_{0};
+  uint64_t nextSequence_{1};
+  // 补齐重新读取的范围内已加入的消息 id，只由补齐线程访问
+  std::set<uint64_t> caughtUp_;
+  std::vector<std::shared_ptr<const Segment>> segments_;
+
+  Gauge& segmentCount_;
+  Gauge& memPostings_;
+  Counter& indexed_;
+  Counter& flushes_;
+  Counter& merges_;
+};
+
+}  // namespace StarryChat
@@ -2,13 +2,146 @@
 
 #include <chrono>
 #include <mariadb/conncpp.hpp>
+#include <unordered_map>
+#include "admission_control.h"
+#include "circuit_breaker.h"
+#include "cluster_membership.h"
+#include "cluster_peers.h"
+#include "cold_archive.h"
+#include "config.h"
 #include "db_manager.h"
+#include "deadline.h"
+#include "hot_timeline.h"
+#include "log_control.h"
 #include "logging.h"
 #include "message.h"
+#include "message_cache_codec.h"
+#include "message_partitions.h"
+#include "message_search.h"
+#include "message_spool.h"
+#include "metrics.h"
+#include "node_router.h"
+#include "push_registry.h"
+#include "redis_keys.h"
 #include "redis_manager.h"
+#include "rpc_errors.h"
 
 namespace StarryChat {
 
+namespace {
+
+constexpr LogModule kLogModule = LogModule::kMessage;
+
+// 单次推送应答的最大消息数
+constexpr size_t kMaxPushBatch = 100;
+
+// 单次搜索应答的最大消息数
+constexpr int kMaxSearchResults = 100;
+
+bool ownedGroupChat(starrychat::ChatType chatType, uint64_t chatId) {
+  return chatType == starrychat::CHAT_TYPE_GROUP &&
+         ClusterMembership::getInstance().ownsLocally(chatId);
+}
+
+/**
+ * 群聊请求交给哈希环上的所属节点处理，所属节点的应答原样返回给客户端
+ * 返回 false 表示应在本节点处理：私聊、本节点所属，或只读请求无法转发
+ * （请求已被转发过、已超时或所属节点尚未连接）。
+ * 发送必须在所属节点串行化并追加到其内存时间线，kReadWrite 请求
+ * 无法转发时直接应答不可用或超时。forwarded 只用于防止节点间循环转发，
+ * 请求方自行设置也不能让非所属节点处理发送。
+ */
+template <typename Request, typename Response>
+bool forwardToOwner(const Request& request,
+                    const Response* responsePrototype,
+                    ClusterPeers::StubMethod<Request, Response> method,
+                    const starry::RpcDoneCallback& done,
+                    DBAccess access) {
+  if (request.chat_type() != starrychat::CHAT_TYPE_GROUP) {
+    return false;
+  }
+  auto owner = ClusterMembership::getInstance().remoteOwner(request.chat_id());
+  if (!owner) {
+    return false;
+  }
+
+  bool readOnly = access == DBAccess::kReadOnly;
+  auto unavailable = [&] {
+    if (readOnly) {
+      return false;
+    }
+    auto response = responsePrototype->New();
+    setUnavailable(response);
+    done(response);
+    return true;
+  };
+
+  // 换主期间转发到了非所属节点，不再继续转发
+  if (request.forwarded()) {
+    return unavailable();
+  }
+
+  // 所属节点沿用客户端剩余的超时
+  auto& peers = ClusterPeers::getInstance();
+  auto timeout = peers.timeout();
+  Request forwarded = request;
+  forwarded.set_forwarded(true);
+  if (auto remaining = RequestDeadline::remaining()) {
+    if (remaining->count() == 0) {
+      if (readOnly) {
+        return false;
+      }
+      auto response = responsePrototype->New();
+      setDeadlineExceeded(response);
+      done(response);
+      return true;
+    }
+    timeout = std::min(timeout, *remaining);
+    forwarded.set_timeout_ms(static_cast<uint32_t>(remaining->count()));
+  }
+
+  bool sent = peers.forward<Request, Response>(
+      *owner, method, forwarded, timeout,
+      [responsePrototype, done](const std::shared_ptr<Response>& reply) {
+        auto response = responsePrototype->New();
+        if (reply) {
+          response->CopyFrom(*reply);
+        } else {
+          setUnavailable(response);
+        }
+        done(response);
+      });
+  return sent || unavailable();
+}
+
+// messages 表的一行转换为消息对象
+void readMessageRow(sql::ResultSet& rs, Message* message) {
+  message->setId(rs.getUInt64("id"));
+  message->setSenderId(rs.getUInt64("sender_id"));
+  message->setChatType(
+      static_cast<starrychat::ChatType>(rs.getInt("chat_type")));
+  message->setChatId(rs.getUInt64("chat_id"));
+  message->setType(static_cast<starrychat::MessageType>(rs.getInt("type")));
+  message->setTimestamp(rs.getUInt64("timestamp"));
+  message->setStatus(
+      static_cast<starrychat::MessageStatus>(rs.getInt("status")));
+
+  // 根据消息类型设置内容
+  if (message->isTextMessage()) {
+    message->setText(std::string(rs.getString("content")));
+  } else if (message->isSystemMessage()) {
+    message->setSystemMessage(std::string(rs.getString("content")),
+                              std::string(rs.getString("system_code")), {});
+  }
+
+  // 处理回复和提及
+  if (rs.getUInt64("reply_to_id") > 0) {
+    message->setReplyToId(rs.getUInt64("reply_to_id"));
+  }
+}
+
+}  // namespace
+
 std::shared_ptr<sql::Connection> MessageServiceImpl::getConnection() {
   return DBManager::getInstance().getConnection();
 }
@@ -17,7 +150,25 @@ std::shared_ptr<sql::Connection> MessageServiceImpl::getConnection() {
 void MessageServiceImpl::GetMessages(
     const starrychat::GetMessagesRequestPtr& request,
     const starrychat::GetMessagesResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("MessageService", "GetMessages");
+  static RpcAdmission admission("MessageService", "GetMessages",
+                                 RpcPriority::kBulk);
+  auto measured = metrics.wrap(rawDone);
+  RequestDeadline deadline(*request);
+
+  // 转发的请求由所属节点做准入控制，本节点不占用名额
+  if (forwardToOwner(*request, responsePrototype,
+                     &starrychat::MessageService::Stub::GetMessages, measured,
+                     DBAccess::kReadOnly)) {
+    return;
+  }
+
+  auto done = admission.admit(*responsePrototype, measured);
+  if (!done) {
+    return;
+  }
+
   auto response = responsePrototype->New();
 
   try {
@@ -30,9 +181,9 @@ void MessageServiceImpl::GetMessages(
       return;
     }
 
-    LOG_INFO << "Fetching messages for chat type: "
-             << static_cast<int>(request->chat_type())
-             << ", chat ID: " << request->chat_id();
+    MLOG_DEBUG(kLogModule) << "Fetching messages for chat type: "
+                           << static_cast<int>(request->chat_type())
+                           << ", chat ID: " << request->chat_id();
 
     // 首先尝试从Redis缓存获取消息ID列表
     auto messageIds = getRecentMessageIds(
@@ -41,118 +192,110 @@ void MessageServiceImpl::GetMessages(
 
     // 标记是否从缓存获取了消息
     bool useCache = !messageIds.empty();
+    // 数据库熔断时只返回缓存中已有的消息
+    bool degraded = DBManager::getInstance().degraded();
 
     // 如果成功从缓存获取了消息ID列表
     if (useCache) {
-      LOG_INFO << "Found " << messageIds.size() << " message IDs in cache";
+      MLOG_DEBUG(kLogModule) << "Found " << messageIds.size()
+                             << " message IDs in cache";
 
-      // 尝试从缓存获取消息数据
+      // 尝试从缓存获取消息数据，直接解析到响应中
       for (uint64_t messageId : messageIds) {
-        auto cachedMessage = getMessageFromCache(messageId);
-        if (cachedMessage) {
-          *response->add_messages() = *cachedMessage;
-        } else {
+        if (!getMessageFromCache(messageId, response->add_messages())) {
+          response->mutable_messages()->RemoveLast();
+          if (degraded) {
+            continue;
+          }
           // 如果有任何一条消息未命中缓存，切换到数据库查询所有消息
-          LOG_INFO << "Cache miss for message ID: " << messageId
-                   << ", falling back to database";
+          MLOG_DEBUG(kLogModule) << "Cache miss for message ID: " << messageId
+                                 << ", falling back to database";
           useCache = false;
           break;
         }
       }
+      if (response->messages_size() == 0) {
+        useCache = false;
+      }
     }
 
     // 如果缓存未命中或不完整，从数据库查询
     if (!useCache) {
-      LOG_INFO << "Querying messages from database";
-      auto conn = getConnection();
-      if (!conn) {
-        response->set_success(false);
-        response->set_error_message("Database connection failed");
+      if (degraded) {
+        setUnavailable(response);
         done(response);
         return;
       }
 
-      std::string query =
-          "SELECT * FROM messages WHERE chat_type = ? AND chat_id = ?";
-      std::vector<std::string> conditions;
-
-      // 添加时间范围条件
-      if (request->start_time() > 0) {
-        conditions.push_back(" timestamp >= ?");
-      }
-      if (request->end_time() > 0) {
-        conditions.push_back(" timestamp <= ?");
-      }
-      if (request->before_msg_id() > 0) {
-        conditions.push_back(" id < ?");
+      // 客户端已超时，不再扫描历史消息
+      if (deadline.expired()) {
+        setDeadlineExceeded(response);
+        done(response);
+        return;
       }
 
-      // 组合条件
-      for (const auto& condition : conditions) {
-        query += " AND" + condition;
+      MLOG_DEBUG(kLogModule) << "Querying messages from database";
+      auto conn = DBManager::getInstance().getConnection(DBAccess::kReadOnly,
+                                                         request->user_id());
+      if (!conn) {
+        response->set_success(false);
+        response->set_error_message("Database connection failed");
+        done(response);
+        return;
       }
 
-      // 添加排序和限制
-      query += " ORDER BY timestamp DESC LIMIT ?";
-
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement(query));
-      int paramIndex = 1;
-
-      stmt->setInt(paramIndex++, static_cast<int>(request->chat_type()));
-      stmt->setUInt64(paramIndex++, request->chat_id());
-
-      if (request->start_time() > 0) {
-        stmt->setUInt64(paramIndex++, request->start_time());
-      }
-      if (request->end_time() > 0) {
-        stmt->setUInt64(paramIndex++, request->end_time());
-      }
+      // 按月份窗口从新到旧查询，每个窗口只访问对应的分区；取够 limit 条
+      // 或窗口到达最早的分区时结束，窗口跨度逐次翻倍
+      int limit = request->limit() > 0 ? request->limit() : 20;
+      uint64_t floor = MessagePartitions::getInstance().floor();
+      uint64_t upper = request->end_time() > 0 ? request->end_time() + 1 : 0;
       if (request->before_msg_id() > 0) {
-        stmt->setUInt64(paramIndex++, request->before_msg_id());
+        // 游标消息通常仍在缓存中，用它的时间戳定位第一个窗口
+        starrychat::Message cursor;
+        if (getMessageFromCache(request->before_msg_id(), &cursor) &&
+            (upper == 0 || cursor.timestamp() < upper)) {
+          upper = cursor.timestamp() + 1;
+        }
       }
-
-      // 设置限制
-      stmt->setInt(paramIndex, request->limit() > 0 ? request->limit() : 20);
-
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+      uint64_t lower =
+          MessagePartitions::monthStart(upper > 0 ? upper - 1 : now);
+      int span = 1;
 
       // 清空之前的结果，避免重复
       response->clear_messages();
 
-      // 处理结果
-      while (rs->next()) {
-        Message message;
-        message.setId(rs->getUInt64("id"));
-        message.setSenderId(rs->getUInt64("sender_id"));
-        message.setChatType(
-            static_cast<starrychat::ChatType>(rs->getInt("chat_type")));
-        message.setChatId(rs->getUInt64("chat_id"));
-        message.setType(
-            static_cast<starrychat::MessageType>(rs->getInt("type")));
-        message.setTimestamp(rs->getUInt64("timestamp"));
-        message.setStatus(
-            static_cast<starrychat::MessageStatus>(rs->getInt("status")));
-
-        // 根据消息类型设置内容
-        if (message.isTextMessage()) {
-          message.setText(std::string(rs->getString("content")));
-        } else if (message.isSystemMessage()) {
-          message.setSystemMessage(std::string(rs->getString("content")),
-                                   std::string(rs->getString("system_code")),
-                                   {});
+      while (true) {
+        // 剩余范围都在最早的分区或开始时间之前，一次查完
+        bool last = lower <= floor || lower <= request->start_time();
+        queryMessagesFromDB(conn, *request, last ? 0 : lower, upper,
+                            limit - response->messages_size(), response);
+        if (last || response->messages_size() >= limit) {
+          break;
         }
+        upper = lower;
+        span *= 2;
+        lower = MessagePartitions::addMonths(lower, -span);
+      }
 
-        // 处理回复和提及
-        if (rs->getUInt64("reply_to_id") > 0) {
-          message.setReplyToId(rs->getUInt64("reply_to_id"));
+      // 数据库中的历史不够一页时接着读冷历史段文件。游标取已返回的最小
+      // id，导出分区与删除分区之间两边都有的消息不会重复返回。其他节点
+      // 刚导出并删除的分区要先加载它的段文件
+      if (response->messages_size() < limit) {
+        ColdArchive::getInstance().refresh();
+      }
+      if (response->messages_size() < limit &&
+          !ColdArchive::getInstance().empty()) {
+        uint64_t beforeId = request->before_msg_id();
+        for (const auto& message : response->messages()) {
+          if (beforeId == 0 || message.id() < beforeId) {
+            beforeId = message.id();
+          }
         }
-
-        // 添加到响应
-        *response->add_messages() = message.toProto();
-
-        // 缓存消息
-        cacheMessage(message.toProto());
+        queryMessagesFromArchive(*request, beforeId,
+                                 limit - response->messages_size(), response);
       }
 
       // 确保消息按时间倒序排列
@@ -170,17 +313,25 @@ void MessageServiceImpl::GetMessages(
     // 获取消息时自动重置该用户的未读计数
     resetUnreadCount(request->user_id(), request->chat_type(),
                      request->chat_id());
-    LOG_INFO << "Reset unread count for user " << request->user_id()
-             << " in chat type " << static_cast<int>(request->chat_type())
-             << ", chat ID " << request->chat_id();
+    MLOG_DEBUG(kLogModule) << "Reset unread count for user "
+                           << request->user_id() << " in chat type "
+                           << static_cast<int>(request->chat_type())
+                           << ", chat ID " << request->chat_id();
 
-    LOG_INFO << "Successfully retrieved " << response->messages_size()
-             << " messages";
+    MLOG_DEBUG(kLogModule) << "Successfully retrieved "
+                           << response->messages_size() << " messages";
 
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "GetMessages SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error: " + std::string(e.what()));
+  } catch (BackendUnavailable&) {
+    response->clear_messages();
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    response->clear_messages();
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "GetMessages error: " << e.what();
     response->set_success(false);
@@ -194,7 +345,25 @@ void MessageServiceImpl::GetMessages(
 void MessageServiceImpl::SendMessage(
     const starrychat::SendMessageRequestPtr& request,
     const starrychat::SendMessageResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("MessageService", "SendMessage");
+  static RpcAdmission admission("MessageService", "SendMessage",
+                                 RpcPriority::kNormal);
+  auto measured = metrics.wrap(rawDone);
+  RequestDeadline deadline(*request);
+
+  // 转发的请求由所属节点做准入控制，本节点不占用名额
+  if (forwardToOwner(*request, responsePrototype,
+                     &starrychat::MessageService::Stub::SendMessage, measured,
+                     DBAccess::kReadWrite)) {
+    return;
+  }
+
+  auto done = admission.admit(*responsePrototype, measured);
+  if (!done) {
+    return;
+  }
+
   auto response = responsePrototype->New();
 
   try {
@@ -207,10 +376,6 @@ void MessageServiceImpl::SendMessage(
       return;
     }
 
-    LOG_INFO << "Sending message from user " << request->sender_id()
-             << " to chat type " << static_cast<int>(request->chat_type())
-             << ", chat ID " << request->chat_id();
-
     // 创建消息对象
     Message message(request->sender_id(), request->chat_type(),
                     request->chat_id());
@@ -228,7 +393,6 @@ void MessageServiceImpl::SendMessage(
       case starrychat::MESSAGE_TYPE_TEXT:
         message.setType(starrychat::MESSAGE_TYPE_TEXT);
         message.setText(request->text().text());
-        LOG_INFO << "Text message content: " << request->text().text();
         break;
 
       // 其他消息类型处理可以在这里添加
@@ -248,49 +412,77 @@ void MessageServiceImpl::SendMessage(
       message.addMentionUserId(request->mention_user_ids(i));
     }
 
-    // 保存消息到数据库
-    uint64_t messageId = saveMessageToDatabase(message.toProto());
+    // 只生成一次 proto，直接放在响应中，缓存、发布和响应共用
+    auto* proto = response->mutable_message();
+    message.toProto(proto);
 
-    if (messageId > 0) {
-      message.setId(messageId);
-
-      // 缓存消息
-      cacheMessage(message.toProto());
-
-      // 更新消息时间线
-      updateMessageTimeline(message.getChatType(), message.getChatId(),
-                            messageId, message.getTimestamp());
+    // 客户端已超时，消息尚未落库，放弃发送
+    if (deadline.expired()) {
+      setDeadlineExceeded(response);
+      done(response);
+      return;
+    }
 
-      // 发布消息通知
-      publishMessageNotification(message.toProto());
+    // 数据库熔断期间先暂存，恢复后由后台线程落库并分发；
+    // 聊天还有未回写的暂存消息时也排在它们之后，保持发送顺序
+    auto& spool = MessageSpool::getInstance();
+    if (DBManager::getInstance().degraded() ||
+        spool.pending(request->chat_type(), request->chat_id())) {
+      proto->set_status(starrychat::MESSAGE_STATUS_SENDING);
+      if (spool.push(*proto)) {
+        response->set_success(true);
+      } else {
+        response->clear_message();
+        setUnavailable(response);
+      }
+      done(response);
+      return;
+    }
 
-      // 更新最后一条消息信息
-      updateLastMessage(message.getChatType(), message.getChatId(),
-                        message.toProto());
+    // 所属节点上同一群聊的发送依次落库并追加到内存时间线，
+    // 消息ID即聊天室内的顺序；缓存、通知等分发不必持锁
+    uint64_t messageId = 0;
+    {
+      std::unique_lock<std::mutex> roomLock;
+      bool owned = ownedGroupChat(request->chat_type(), request->chat_id());
+      if (owned) {
+        roomLock = HotTimelines::getInstance().serialize(request->chat_id());
+      }
 
-      // 增加其他用户的未读消息计数
-      auto members = getChatMembers(message.getChatType(), message.getChatId());
-      for (uint64_t memberId : members) {
-        if (memberId != message.getSenderId()) {
-          incrementUnreadCount(memberId, message.getChatType(),
-                               message.getChatId());
-        }
+      // 保存消息到数据库
+      messageId = saveMessageToDatabase(*proto);
+      if (messageId > 0 && owned) {
+        HotTimelines::getInstance().append(request->chat_id(), messageId);
       }
+    }
+
+    if (messageId > 0) {
+      proto->set_id(messageId);
+      distributeMessage(*proto);
 
       // 设置响应
       response->set_success(true);
-      *response->mutable_message() = message.toProto();
 
-      LOG_INFO << "Message sent successfully. ID: " << messageId;
+      SLOG(kLogModule, DEBUG, "Message {} sent by user {} to chat {}:{}",
+           messageId, request->sender_id(),
+           static_cast<int>(request->chat_type()), request->chat_id());
     } else {
+      response->clear_message();
       response->set_success(false);
       response->set_error_message("Failed to save message");
       LOG_ERROR << "Failed to save message to database";
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "SendMessage SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error: " + std::string(e.what()));
+  } catch (BackendUnavailable&) {
+    response->clear_message();
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    response->clear_message();
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "SendMessage error: " << e.what();
     response->set_success(false);
@@ -304,7 +496,16 @@ void MessageServiceImpl::SendMessage(
 void MessageServiceImpl::UpdateMessageStatus(
     const starrychat::UpdateMessageStatusRequestPtr& request,
     const starrychat::UpdateMessageStatusResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("MessageService", "UpdateMessageStatus");
+  static RpcAdmission admission("MessageService", "UpdateMessageStatus",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -316,12 +517,23 @@ void MessageServiceImpl::UpdateMessageStatus(
       return;
     }
 
-    // 验证消息存在并且用户有权更新
-    std::unique_ptr<sql::PreparedStatement> checkStmt(conn->prepareStatement(
-        "SELECT chat_type, chat_id, sender_id FROM messages WHERE id = ?"));
+    // 验证消息存在并且用户有权更新。表按时间戳分区，缓存中有这条消息
+    // 时带上时间戳只查一个分区，否则要查遍各月份分区
+    auto cachedMessage = getMessageFromCache(request->message_id());
+    uint64_t timestamp = cachedMessage ? cachedMessage->timestamp() : 0;
+    std::string checkQuery =
+        "SELECT chat_type, chat_id, sender_id, timestamp "
+        "FROM messages WHERE id = ?";
+    if (timestamp > 0) {
+      checkQuery += " AND timestamp = ?";
+    }
+    TimedStatement checkStmt(conn, checkQuery);
     checkStmt->setUInt64(1, request->message_id());
+    if (timestamp > 0) {
+      checkStmt->setUInt64(2, timestamp);
+    }
 
-    std::unique_ptr<sql::ResultSet> checkRs(checkStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> checkRs(checkStmt.executeQuery());
     if (!checkRs->next()) {
       response->set_success(false);
       response->set_error_message("Message not found");
@@ -333,6 +545,7 @@ void MessageServiceImpl::UpdateMessageStatus(
         static_cast<starrychat::ChatType>(checkRs->getInt("chat_type"));
     uint64_t chatId = checkRs->getUInt64("chat_id");
     uint64_t senderId = checkRs->getUInt64("sender_id");
+    timestamp = checkRs->getUInt64("timestamp");
 
     // 验证用户是否为聊天成员
     if (!isValidChatMember(request->user_id(), chatType, chatId)) {
@@ -343,17 +556,18 @@ void MessageServiceImpl::UpdateMessageStatus(
     }
 
     // 更新消息状态
-    if (updateMessageStatusInDB(request->message_id(), request->status())) {
+    DBManager::getInstance().noteWrite(request->user_id());
+    if (updateMessageStatusInDB(request->message_id(), timestamp,
+                                request->status())) {
       // 更新缓存中的消息状态
-      auto cachedMessage = getMessageFromCache(request->message_id());
       if (cachedMessage) {
-        starrychat::Message updatedMessage = *cachedMessage;
-        updatedMessage.set_status(request->status());
-        cacheMessage(updatedMessage);
+        cachedMessage->set_status(request->status());
+        cacheMessage(*cachedMessage);
       }
 
       // 发布状态变更通知
-      publishStatusChangeNotification(request->message_id(), request->status());
+      publishStatusChangeNotification(request->message_id(), chatType, chatId,
+                                      request->status());
 
       // 如果是标记为已读，并且当前用户是接收方（非发送方），则减少未读计数
       if (request->status() == starrychat::MESSAGE_STATUS_READ &&
@@ -363,8 +577,9 @@ void MessageServiceImpl::UpdateMessageStatus(
       }
 
       response->set_success(true);
-      LOG_INFO << "Updated status for message " << request->message_id()
-               << " to " << static_cast<int>(request->status());
+      MLOG_DEBUG(kLogModule) << "Updated status for message "
+                             << request->message_id() << " to "
+                             << static_cast<int>(request->status());
     } else {
       response->set_success(false);
       response->set_error_message("Failed to update message status");
@@ -372,9 +587,14 @@ void MessageServiceImpl::UpdateMessageStatus(
                 << request->message_id();
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "UpdateMessageStatus SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error: " + std::string(e.what()));
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "UpdateMessageStatus error: " << e.what();
     response->set_success(false);
@@ -388,7 +608,25 @@ void MessageServiceImpl::UpdateMessageStatus(
 void MessageServiceImpl::RecallMessage(
     const starrychat::RecallMessageRequestPtr& request,
     const starrychat::RecallMessageResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("MessageService", "RecallMessage");
+  static RpcAdmission admission("MessageService", "RecallMessage",
+                                 RpcPriority::kNormal);
+  auto measured = metrics.wrap(rawDone);
+  RequestDeadline deadline(*request);
+
+  // 撤回通知和发送一样要在所属节点落库并追加到内存时间线
+  if (forwardToOwner(*request, responsePrototype,
+                     &starrychat::MessageService::Stub::RecallMessage,
+                     measured, DBAccess::kReadWrite)) {
+    return;
+  }
+
+  auto done = admission.admit(*responsePrototype, measured);
+  if (!done) {
+    return;
+  }
+
   auto response = responsePrototype->New();
 
   try {
@@ -400,13 +638,21 @@ void MessageServiceImpl::RecallMessage(
       return;
     }
 
-    // 验证消息存在并且用户有权撤回
-    std::unique_ptr<sql::PreparedStatement> checkStmt(
-        conn->prepareStatement("SELECT sender_id, chat_type, chat_id, "
-                               "timestamp FROM messages WHERE id = ?"));
+    // 验证消息存在并且用户有权撤回，缓存中有时间戳时只查一个分区
+    auto cachedMessage = getMessageFromCache(request->message_id());
+    std::string checkQuery =
+        "SELECT sender_id, chat_type, chat_id, timestamp "
+        "FROM messages WHERE id = ?";
+    if (cachedMessage && cachedMessage->timestamp() > 0) {
+      checkQuery += " AND timestamp = ?";
+    }
+    TimedStatement checkStmt(conn, checkQuery);
     checkStmt->setUInt64(1, request->message_id());
+    if (cachedMessage && cachedMessage->timestamp() > 0) {
+      checkStmt->setUInt64(2, cachedMessage->timestamp());
+    }
 
-    std::unique_ptr<sql::ResultSet> checkRs(checkStmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> checkRs(checkStmt.executeQuery());
     if (!checkRs->next()) {
       response->set_success(false);
       response->set_error_message("Message not found");
@@ -424,6 +670,27 @@ void MessageServiceImpl::RecallMessage(
         static_cast<starrychat::ChatType>(checkRs->getInt("chat_type"));
     uint64_t chatId = checkRs->getUInt64("chat_id");
 
+    // 请求带的聊天要与消息所在聊天一致，否则转发依据不可信
+    if (request->chat_type() != starrychat::CHAT_TYPE_UNKNOWN &&
+        (request->chat_type() != chatType || request->chat_id() != chatId)) {
+      response->set_success(false);
+      response->set_error_message("Message not found");
+      done(response);
+      return;
+    }
+
+    // 未带聊天的旧客户端，查到所在群聊后再交给所属节点
+    if (request->chat_type() == starrychat::CHAT_TYPE_UNKNOWN) {
+      auto routed = *request;
+      routed.set_chat_type(chatType);
+      routed.set_chat_id(chatId);
+      if (forwardToOwner(routed, responsePrototype,
+                         &starrychat::MessageService::Stub::RecallMessage,
+                         done, DBAccess::kReadWrite)) {
+        return;
+      }
+    }
+
     // 检查是否为消息发送者
     if (senderId != request->user_id()) {
       response->set_success(false);
@@ -442,59 +709,63 @@ void MessageServiceImpl::RecallMessage(
     }
 
     // 更新消息状态为已撤回
-    if (updateMessageStatusInDB(request->message_id(),
+    DBManager::getInstance().noteWrite(request->user_id());
+    if (updateMessageStatusInDB(request->message_id(), timestamp,
                                 starrychat::MESSAGE_STATUS_RECALLED)) {
       // 更新缓存中的消息状态
-      auto cachedMessage = getMessageFromCache(request->message_id());
       if (cachedMessage) {
-        starrychat::Message updatedMessage = *cachedMessage;
-        updatedMessage.set_status(starrychat::MESSAGE_STATUS_RECALLED);
-        cacheMessage(updatedMessage);
+        cachedMessage->set_status(starrychat::MESSAGE_STATUS_RECALLED);
+        cacheMessage(*cachedMessage);
       }
 
-      // 创建撤回通知消息
+      // 创建撤回通知消息，内容指明被撤回的消息
       Message recallNotice(request->user_id(), chatType, chatId);
       recallNotice.setType(starrychat::MESSAGE_TYPE_RECALL);
       recallNotice.setTimestamp(currentTime);
       recallNotice.setStatus(starrychat::MESSAGE_STATUS_SENT);
-
-      // 设置撤回内容
-      starrychat::RecallContent recallContent;
-      recallContent.set_recalled_msg_id(request->message_id());
-
-      // 保存撤回通知
-      uint64_t noticeId = saveMessageToDatabase(recallNotice.toProto());
+      starrychat::Message noticeProto = recallNotice.toProto();
+      noticeProto.mutable_recall()->set_recalled_msg_id(
+          request->message_id());
+
+      // 与发送相同：所属节点上落库和追加内存时间线在房间锁内完成
+      uint64_t noticeId = 0;
+      {
+        std::unique_lock<std::mutex> roomLock;
+        bool owned = ownedGroupChat(chatType, chatId);
+        if (owned) {
+          roomLock = HotTimelines::getInstance().serialize(chatId);
+        }
+        noticeId = saveMessageToDatabase(noticeProto);
+        if (noticeId > 0 && owned) {
+          HotTimelines::getInstance().append(chatId, noticeId);
+        }
+      }
       if (noticeId > 0) {
-        recallNotice.setId(noticeId);
-
-        // 缓存通知消息
-        cacheMessage(recallNotice.toProto());
-
-        // 更新消息时间线
-        updateMessageTimeline(recallNotice.getChatType(),
-                              recallNotice.getChatId(), noticeId,
-                              recallNotice.getTimestamp());
-
-        // 发布通知
-        publishMessageNotification(recallNotice.toProto());
+        noticeProto.set_id(noticeId);
+        distributeMessage(noticeProto);
       }
 
       // 发布撤回通知
-      publishStatusChangeNotification(request->message_id(),
+      publishStatusChangeNotification(request->message_id(), chatType, chatId,
                                       starrychat::MESSAGE_STATUS_RECALLED);
 
       response->set_success(true);
-      LOG_INFO << "Message " << request->message_id() << " recalled by user "
-               << request->user_id();
+      MLOG_INFO(kLogModule) << "Message " << request->message_id()
+                            << " recalled by user " << request->user_id();
     } else {
       response->set_success(false);
       response->set_error_message("Failed to recall message");
       LOG_ERROR << "Failed to recall message " << request->message_id();
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "RecallMessage SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error: " + std::string(e.what()));
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "RecallMessage error: " << e.what();
     response->set_success(false);
@@ -504,6 +775,187 @@ void MessageServiceImpl::RecallMessage(
   done(response);
 }
 
+// 订阅新消息推送
+void MessageServiceImpl::Subscribe(
+    const starrychat::SubscribeRequestPtr& request,
+    const starrychat::SubscribeResponse* responsePrototype,
+    const starry::RpcDoneCallback& rawDone) {
+  // 挂起时间就是调用耗时，不参与准入控制和自适应限流，否则会占满并发名额
+  static RpcMethodMetrics metrics("MessageService", "Subscribe");
+  auto done = metrics.wrap(rawDone);
+
+  try {
+    if (!validateSession(request->session_token(), request->user_id())) {
+      auto response = responsePrototype->New();
+      response->set_success(false);
+      response->set_error_message("Invalid session");
+      done(response);
+      return;
+    }
+  } catch (std::exception& e) {
+    LOG_ERROR << "Subscribe error: " << e.what();
+    replyError(*responsePrototype, done, starrychat::ERROR_CODE_UNAVAILABLE,
+               "Session check failed");
+    return;
+  }
+
+  // 等待时间取客户端期望与服务端上限的较小值，并在客户端超时前应答
+  auto& config = Config::getInstance();
+  uint32_t waitMs = static_cast<uint32_t>(config.getPushMaxWaitMs());
+  if (request->wait_ms() > 0) {
+    waitMs = std::min(waitMs, request->wait_ms());
+  }
+  if (request->timeout_ms() > 0) {
+    waitMs = std::min(waitMs, request->timeout_ms() * 4 / 5);
+  }
+
+  size_t maxMessages = request->max_messages() > 0
+                           ? std::min<size_t>(request->max_messages(),
+                                              kMaxPushBatch)
+                           : kMaxPushBatch;
+
+  PushRegistry::getInstance().subscribe(
+      request->user_id(), request->session_token(), maxMessages,
+      std::chrono::milliseconds(waitMs),
+      [responsePrototype, done](PushBatch batch) {
+        auto response = responsePrototype->New();
+        response->set_success(true);
+        response->set_resync_needed(batch.resyncNeeded);
+        response->set_closed(batch.closed);
+        for (auto& message : batch.messages) {
+          *response->add_messages() = std::move(message);
+        }
+        for (auto& update : batch.statusUpdates) {
+          *response->add_status_updates() = std::move(update);
+        }
+        done(response);
+      });
+}
+
+// 搜索聊天中的文本消息
+void MessageServiceImpl::SearchMessages(
+    const starrychat::SearchMessagesRequestPtr& request,
+    const starrychat::SearchMessagesResponse* responsePrototype,
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("MessageService", "SearchMessages");
+  static RpcAdmission admission("MessageService", "SearchMessages",
+                                 RpcPriority::kBulk);
+  auto measured = metrics.wrap(rawDone);
+  RequestDeadline deadline(*request);
+
+  // 转发的请求由所属节点做准入控制，本节点不占用名额
+  if (forwardToOwner(*request, responsePrototype,
+                     &starrychat::MessageService::Stub::SearchMessages,
+                     measured, DBAccess::kReadOnly)) {
+    return;
+  }
+
+  auto done = admission.admit(*responsePrototype, measured);
+  if (!done) {
+    return;
+  }
+
+  auto response = responsePrototype->New();
+
+  try {
+    auto& index = MessageSearchIndex::getInstance();
+    if (!index.enabled()) {
+      response->set_success(false);
+      response->set_error_message("Search is not enabled");
+      done(response);
+      return;
+    }
+
+    if (!isValidChatMember(request->user_id(), request->chat_type(),
+                           request->chat_id())) {
+      response->set_success(false);
+      response->set_error_message("Not a member of this chat");
+      done(response);
+      return;
+    }
+
+    auto terms = MessageSearchIndex::queryTerms(request->query());
+    if (terms.empty()) {
+      response->set_success(false);
+      response->set_error_message("Empty search query");
+      done(response);
+      return;
+    }
+    auto phrases = MessageSearchIndex::phrases(request->query());
+
+    int limit = request->limit() > 0
+                    ? std::min(request->limit(), kMaxSearchResults)
+                    : 20;
+    // 索引只保证包含全部词项，从游标起每次向索引取一批候选并读取原文
+    // 核对，凑够一页即停；撤回的消息不返回
+    uint64_t cursor = request->cursor();
+    size_t checked = 0;
+    bool more = true;
+    while (more && response->messages_size() < limit) {
+      if (deadline.expired()) {
+        setDeadlineExceeded(response);
+        done(response);
+        return;
+      }
+
+      auto batch = index.candidates(
+          static_cast<uint8_t>(request->chat_type()), request->chat_id(),
+          terms, cursor, static_cast<size_t>(limit));
+      // 不满一批说明游标之后已没有候选
+      more = batch.size() == static_cast<size_t>(limit);
+      auto messages = loadMessages(batch, request->user_id());
+
+      size_t next = 0;
+      for (size_t i = 0; i < batch.size(); ++i) {
+        ++checked;
+        cursor = batch[i];
+        if (next == messages.size() || messages[next].id() != batch[i]) {
+          continue;
+        }
+        auto& message = messages[next++];
+        if (message.type() == starrychat::MESSAGE_TYPE_TEXT &&
+            message.status() != starrychat::MESSAGE_STATUS_RECALLED &&
+            MessageSearchIndex::matches(message.text().text(), phrases)) {
+          *response->add_messages() = std::move(message);
+          if (response->messages_size() >= limit) {
+            more = more || i + 1 < batch.size();
+            break;
+          }
+        }
+      }
+    }
+
+    response->set_success(true);
+    response->set_has_more(more);
+    if (checked > 0) {
+      response->set_next_cursor(cursor);
+    }
+    MLOG_DEBUG(kLogModule) << "Search in chat " << request->chat_id()
+                           << " matched " << response->messages_size()
+                           << " of " << checked << " candidates";
+
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "SearchMessages SQL error: " << e.what();
+    response->clear_messages();
+    response->set_success(false);
+    response->set_error_message("Database error: " + std::string(e.what()));
+  } catch (BackendUnavailable&) {
+    response->clear_messages();
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    response->clear_messages();
+    setDeadlineExceeded(response);
+  } catch (std::exception& e) {
+    LOG_ERROR << "SearchMessages error: " << e.what();
+    response->clear_messages();
+    response->set_success(false);
+    response->set_error_message("Internal error: " + std::string(e.what()));
+  }
+
+  done(response);
+}
+
 // 验证用户是否为聊天成员
 bool MessageServiceImpl::isValidChatMember(uint64_t userId,
                                            starrychat::ChatType chatType,
@@ -514,8 +966,7 @@ bool MessageServiceImpl::isValidChatMember(uint64_t userId,
 
     if (chatType == starrychat::CHAT_TYPE_PRIVATE) {
       // 私聊检查 - 检查用户是否是私聊的参与者
-      std::string privateKey =
-          "private_chat:" + std::to_string(chatId) + ":members";
+      auto privateKey = RedisKeys::privateChatMembers(chatId);
       auto members = redis.smembers(privateKey);
       if (members && !members->empty()) {
         std::string userIdStr = std::to_string(userId);
@@ -524,7 +975,7 @@ bool MessageServiceImpl::isValidChatMember(uint64_t userId,
       }
     } else if (chatType == starrychat::CHAT_TYPE_GROUP) {
       // 群聊检查 - 检查用户是否是群聊成员
-      std::string groupKey = "chat_room:" + std::to_string(chatId) + ":members";
+      auto groupKey = RedisKeys::chatRoomMembers(chatId);
       auto members = redis.smembers(groupKey);
       if (members && !members->empty()) {
         std::string userIdStr = std::to_string(userId);
@@ -541,37 +992,37 @@ bool MessageServiceImpl::isValidChatMember(uint64_t userId,
 
     if (chatType == starrychat::CHAT_TYPE_PRIVATE) {
       // 私聊检查
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("SELECT 1 FROM private_chats WHERE id = ? AND "
-                                 "(user1_id = ? OR user2_id = ?)"));
+      TimedStatement stmt(conn,
+                          "SELECT 1 FROM private_chats WHERE id = ? AND "
+                          "(user1_id = ? OR user2_id = ?)");
       stmt->setUInt64(1, chatId);
       stmt->setUInt64(2, userId);
       stmt->setUInt64(3, userId);
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
       bool result = rs->next();
 
       // 缓存结果
       if (result) {
-        redis.sadd("private_chat:" + std::to_string(chatId) + ":members",
+        redis.sadd(RedisKeys::privateChatMembers(chatId),
                    std::to_string(userId));
       }
 
       return result;
     } else if (chatType == starrychat::CHAT_TYPE_GROUP) {
       // 群聊检查
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("SELECT 1 FROM chat_room_members WHERE "
-                                 "chat_room_id = ? AND user_id = ?"));
+      TimedStatement stmt(conn,
+                          "SELECT 1 FROM chat_room_members WHERE "
+                          "chat_room_id = ? AND user_id = ?");
       stmt->setUInt64(1, chatId);
       stmt->setUInt64(2, userId);
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
       bool result = rs->next();
 
       // 缓存结果
       if (result) {
-        redis.sadd("chat_room:" + std::to_string(chatId) + ":members",
+        redis.sadd(RedisKeys::chatRoomMembers(chatId),
                    std::to_string(userId));
       }
 
@@ -579,6 +1030,11 @@ bool MessageServiceImpl::isValidChatMember(uint64_t userId,
     }
 
     return false;
+  } catch (BackendUnavailable&) {
+    // 缓存未命中且数据库已熔断，无法判断成员关系，交给处理器返回不可用
+    throw;
+  } catch (DeadlineExceeded&) {
+    throw;
   } catch (std::exception& e) {
     LOG_ERROR << "isValidChatMember error: " << e.what();
     return false;
@@ -589,84 +1045,125 @@ bool MessageServiceImpl::isValidChatMember(uint64_t userId,
 uint64_t MessageServiceImpl::saveMessageToDatabase(
     const starrychat::Message& message) {
   try {
-    auto conn = getConnection();
-    if (!conn) {
-      return 0;
-    }
-
-    // 准备SQL
-    std::string query =
-        "INSERT INTO messages (sender_id, chat_type, chat_id, type, content, "
-        "system_code, timestamp, status, reply_to_id) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
-
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement(query, sql::Statement::RETURN_GENERATED_KEYS));
-
-    stmt->setUInt64(1, message.sender_id());
-    stmt->setInt(2, message.chat_type());
-    stmt->setUInt64(3, message.chat_id());
-    stmt->setInt(4, message.type());
-
-    // 设置内容
-    if (message.type() == starrychat::MESSAGE_TYPE_TEXT && message.has_text()) {
-      stmt->setString(5, message.text().text());
-      stmt->setNull(6, sql::DataType::VARCHAR);
-    } else if (message.type() == starrychat::MESSAGE_TYPE_SYSTEM &&
-               message.has_system()) {
-      stmt->setString(5, message.system().text());
-      stmt->setString(6, message.system().code());
-    } else {
-      stmt->setNull(5, sql::DataType::VARCHAR);
-      stmt->setNull(6, sql::DataType::VARCHAR);
-    }
+    return DBManager::getInstance().store().insertMessage(message);
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "saveMessageToDatabase SQL error: " << e.what();
+    return 0;
+  } catch (std::exception& e) {
+    LOG_ERROR << "saveMessageToDatabase error: " << e.what();
+    return 0;
+  }
+}
 
-    stmt->setUInt64(7, message.timestamp());
-    stmt->setInt(8, message.status());
+// 消息落库后更新缓存、时间线和未读数并发布通知
+void MessageServiceImpl::distributeMessage(const starrychat::Message& message) {
+  // 缓存和通知使用同一份序列化结果
+  std::string serialized = message.SerializeAsString();
+  cacheSerializedMessage(message.id(), serialized);
+
+  // 更新消息时间线，所属节点的内存时间线已由调用方在落库时追加
+  updateMessageTimeline(message.chat_type(), message.chat_id(), message.id(),
+                        message.timestamp());
+
+  // 文本消息加入本节点的搜索索引
+  if (message.type() == starrychat::MESSAGE_TYPE_TEXT) {
+    MessageSearchIndex::getInstance().add(
+        static_cast<uint8_t>(message.chat_type()), message.chat_id(),
+        message.id(), message.text().text());
+  }
 
-    if (message.reply_to_id() > 0) {
-      stmt->setUInt64(9, message.reply_to_id());
-    } else {
-      stmt->setNull(9, sql::DataType::BIGINT);
+  // 发布消息通知
+  publishMessageNotification(message, serialized);
+
+  // 更新最后一条消息信息
+  updateLastMessage(message.chat_type(), message.chat_id(), message);
+
+  // 增加其他用户的未读消息计数
+  auto members = getChatMembers(message.chat_type(), message.chat_id());
+  for (uint64_t memberId : members) {
+    if (memberId != message.sender_id()) {
+      incrementUnreadCount(memberId, message.chat_type(), message.chat_id());
     }
+  }
+}
 
-    if (stmt->executeUpdate() > 0) {
-      std::unique_ptr<sql::ResultSet> rs(stmt->getGeneratedKeys());
-      if (rs->next()) {
-        uint64_t messageId = rs->getUInt64(1);
-
-        // 处理提及用户
-        if (message.mention_user_ids_size() > 0) {
-          std::string mentionQuery =
-              "INSERT INTO message_mentions (message_id, user_id) VALUES (?, "
-              "?)";
-          std::unique_ptr<sql::PreparedStatement> mentionStmt(
-              conn->prepareStatement(mentionQuery));
-
-          for (int i = 0; i < message.mention_user_ids_size(); i++) {
-            mentionStmt->setUInt64(1, messageId);
-            mentionStmt->setUInt64(2, message.mention_user_ids(i));
-            mentionStmt->executeUpdate();
-          }
-        }
+// 将熔断期间暂存的消息写入数据库
+size_t MessageServiceImpl::flushSpool(size_t batchSize) {
+  static auto& deadLettered = MetricsRegistry::getInstance().counter(
+      "starrychat_message_spool_dead_lettered_total",
+      "Spooled messages dropped because the database rejected them");
+
+  auto& spool = MessageSpool::getInstance();
+  if (spool.size() == 0 || DBManager::getInstance().degraded()) {
+    return 0;
+  }
 
-        return messageId;
+  auto pending = spool.take(batchSize);
+  size_t handled = 0;
+  size_t flushed = 0;
+  for (auto& message : pending) {
+    // 与 SendMessage 一样在所属节点上串行化聊天室的落库和时间线追加
+    std::unique_lock<std::mutex> roomLock;
+    bool owned = ownedGroupChat(message.chat_type(), message.chat_id());
+    if (owned) {
+      roomLock = HotTimelines::getInstance().serialize(message.chat_id());
+    }
+
+    message.set_status(starrychat::MESSAGE_STATUS_SENT);
+    uint64_t messageId = 0;
+    try {
+      messageId = DBManager::getInstance().store().insertMessage(message);
+    } catch (sql::SQLException& e) {
+      DBManager::reportError(e);
+      if (!DBManager::isAvailabilityError(e)) {
+        // 约束冲突、数据过长等重试也不会成功，丢弃以免堵住后面的消息
+        LOG_ERROR << "Dropping spooled message from user "
+                  << message.sender_id() << " to chat "
+                  << static_cast<int>(message.chat_type()) << ":"
+                  << message.chat_id() << ": " << e.what();
+        deadLettered.inc();
+        spool.release(message);
+        ++handled;
+        continue;
       }
+      LOG_WARN << "flushSpool SQL error: " << e.what();
+    } catch (std::exception& e) {
+      // 熔断、取连接失败等，数据库仍不可用
+      LOG_WARN << "flushSpool error: " << e.what();
     }
 
-    return 0;
-  } catch (sql::SQLException& e) {
-    LOG_ERROR << "saveMessageToDatabase SQL error: " << e.what();
-    return 0;
-  } catch (std::exception& e) {
-    LOG_ERROR << "saveMessageToDatabase error: " << e.what();
-    return 0;
+    if (messageId == 0) {
+      // 剩余消息按原顺序放回，等下一轮
+      message.set_status(starrychat::MESSAGE_STATUS_SENDING);
+      break;
+    }
+
+    message.set_id(messageId);
+    if (owned) {
+      HotTimelines::getInstance().append(message.chat_id(), messageId);
+      roomLock.unlock();
+    }
+    distributeMessage(message);
+    spool.release(message);
+    ++handled;
+    ++flushed;
+  }
+
+  if (handled < pending.size()) {
+    pending.erase(pending.begin(), pending.begin() + handled);
+    spool.restore(std::move(pending));
+  }
+  if (flushed > 0) {
+    LOG_INFO << "Flushed " << flushed << " spooled messages to database";
   }
+  return flushed;
 }
 
 // 更新数据库中的消息状态
 bool MessageServiceImpl::updateMessageStatusInDB(
     uint64_t messageId,
+    uint64_t timestamp,
     starrychat::MessageStatus status) {
   try {
     auto conn = getConnection();
@@ -674,13 +1171,21 @@ bool MessageServiceImpl::updateMessageStatusInDB(
       return false;
     }
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("UPDATE messages SET status = ? WHERE id = ?"));
+    // 带上时间戳时只更新一个分区
+    std::string query = "UPDATE messages SET status = ? WHERE id = ?";
+    if (timestamp > 0) {
+      query += " AND timestamp = ?";
+    }
+    TimedStatement stmt(conn, query);
     stmt->setInt(1, static_cast<int>(status));
     stmt->setUInt64(2, messageId);
+    if (timestamp > 0) {
+      stmt->setUInt64(3, timestamp);
+    }
 
-    return stmt->executeUpdate() > 0;
+    return stmt.executeUpdate() > 0;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "updateMessageStatusInDB SQL error: " << e.what();
     return false;
   } catch (std::exception& e) {
@@ -689,25 +1194,209 @@ bool MessageServiceImpl::updateMessageStatusInDB(
   }
 }
 
+void MessageServiceImpl::queryMessagesFromDB(
+    const std::shared_ptr<sql::Connection>& conn,
+    const starrychat::GetMessagesRequest& request,
+    uint64_t lower,
+    uint64_t upper,
+    int limit,
+    starrychat::GetMessagesResponse* response) {
+  std::string query =
+      "SELECT * FROM messages WHERE chat_type = ? AND chat_id = ?";
+  std::vector<std::string> conditions;
+
+  // 添加时间范围条件，窗口边界用于分区裁剪
+  if (request.start_time() > 0) {
+    conditions.push_back(" timestamp >= ?");
+  }
+  if (request.end_time() > 0) {
+    conditions.push_back(" timestamp <= ?");
+  }
+  if (lower > 0) {
+    conditions.push_back(" timestamp >= ?");
+  }
+  if (upper > 0) {
+    conditions.push_back(" timestamp < ?");
+  }
+  if (request.before_msg_id() > 0) {
+    conditions.push_back(" id < ?");
+  }
+
+  // 组合条件
+  for (const auto& condition : conditions) {
+    query += " AND" + condition;
+  }
+
+  // 添加排序和限制
+  query += " ORDER BY timestamp DESC LIMIT ?";
+
+  TimedStatement stmt(conn, query);
+  int paramIndex = 1;
+
+  stmt->setInt(paramIndex++, static_cast<int>(request.chat_type()));
+  stmt->setUInt64(paramIndex++, request.chat_id());
+
+  if (request.start_time() > 0) {
+    stmt->setUInt64(paramIndex++, request.start_time());
+  }
+  if (request.end_time() > 0) {
+    stmt->setUInt64(paramIndex++, request.end_time());
+  }
+  if (lower > 0) {
+    stmt->setUInt64(paramIndex++, lower);
+  }
+  if (upper > 0) {
+    stmt->setUInt64(paramIndex++, upper);
+  }
+  if (request.before_msg_id() > 0) {
+    stmt->setUInt64(paramIndex++, request.before_msg_id());
+  }
+
+  // 设置限制
+  stmt->setInt(paramIndex, limit);
+
+  std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+
+  // 处理结果；从库上读到的行可能落后于撤回等变更，不回填共享缓存
+  bool fromReplica = DBManager::servedByReplica(conn);
+  while (rs->next()) {
+    Message message;
+    readMessageRow(*rs, &message);
+
+    // 直接填充到响应，并缓存同一个对象
+    auto* proto = response->add_messages();
+    message.toProto(proto);
+    if (!fromReplica) {
+      cacheMessage(*proto);
+    }
+  }
+}
+
+void MessageServiceImpl::queryMessagesFromArchive(
+    const starrychat::GetMessagesRequest& request,
+    uint64_t beforeId,
+    int limit,
+    starrychat::GetMessagesResponse* response) {
+  auto archived = ColdArchive::getInstance().read(
+      static_cast<uint8_t>(request.chat_type()), request.chat_id(), beforeId,
+      request.start_time(), request.end_time(), static_cast<size_t>(limit));
+
+  for (const auto& row : archived) {
+    Message message;
+    message.setId(row.id);
+    message.setSenderId(row.senderId);
+    message.setChatType(static_cast<starrychat::ChatType>(row.chatType));
+    message.setChatId(row.chatId);
+    message.setType(static_cast<starrychat::MessageType>(row.type));
+    message.setTimestamp(row.timestamp);
+    message.setStatus(static_cast<starrychat::MessageStatus>(row.status));
+
+    if (message.isTextMessage()) {
+      message.setText(row.content.value_or(""));
+    } else if (message.isSystemMessage()) {
+      message.setSystemMessage(row.content.value_or(""),
+                               row.systemCode.value_or(""), {});
+    }
+    if (row.replyToId > 0) {
+      message.setReplyToId(row.replyToId);
+    }
+
+    // 冷历史很少被再次读取，不写入缓存
+    message.toProto(response->add_messages());
+  }
+}
+
+std::vector<starrychat::Message> MessageServiceImpl::loadMessages(
+    const std::vector<uint64_t>& messageIds,
+    uint64_t userId) {
+  std::unordered_map<uint64_t, starrychat::Message> found;
+  std::vector<uint64_t> missing;
+  for (uint64_t messageId : messageIds) {
+    starrychat::Message message;
+    if (getMessageFromCache(messageId, &message)) {
+      found.emplace(messageId, std::move(message));
+    } else {
+      missing.push_back(messageId);
+    }
+  }
+
+  // 缓存未命中的消息一次查询
+  if (!missing.empty()) {
+    auto conn =
+        DBManager::getInstance().getConnection(DBAccess::kReadOnly, userId);
+    if (!conn) {
+      throw std::runtime_error("Database connection failed");
+    }
+
+    std::string query = "SELECT * FROM messages WHERE id IN (?";
+    for (size_t i = 1; i < missing.size(); ++i) {
+      query += ", ?";
+    }
+    query += ")";
+
+    TimedStatement stmt(conn, query);
+    for (size_t i = 0; i < missing.size(); ++i) {
+      stmt->setUInt64(static_cast<int>(i + 1), missing[i]);
+    }
+
+    // 从库上的状态可能落后于刚发生的撤回等变更，不回填共享缓存
+    bool fromReplica = DBManager::servedByReplica(conn);
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+    while (rs->next()) {
+      Message message;
+      readMessageRow(*rs, &message);
+      starrychat::Message proto;
+      message.toProto(&proto);
+      if (!fromReplica) {
+        cacheMessage(proto);
+      }
+      found.emplace(proto.id(), std::move(proto));
+    }
+  }
+
+  std::vector<starrychat::Message> messages;
+  messages.reserve(found.size());
+  for (uint64_t messageId : messageIds) {
+    auto it = found.find(messageId);
+    if (it != found.end()) {
+      messages.push_back(std::move(it->second));
+    }
+  }
+  return messages;
+}
+
 // 缓存消息
 void MessageServiceImpl::cacheMessage(const starrychat::Message& message) {
+  // 将消息序列化为字符串
+  std::string serialized;
+  if (!message.SerializeToString(&serialized)) {
+    LOG_ERROR << "Failed to serialize message " << message.id();
+    return;
+  }
+
+  cacheSerializedMessage(message.id(), serialized);
+}
+
+// 缓存已序列化的消息
+void MessageServiceImpl::cacheSerializedMessage(uint64_t messageId,
+                                                const std::string& serialized) {
   try {
     auto& redis = RedisManager::getInstance();
 
     // 消息键
-    std::string messageKey = "message:" + std::to_string(message.id());
+    auto messageKey = RedisKeys::message(messageId);
 
-    // 将消息序列化为字符串
-    std::string serialized;
-    if (!message.SerializeToString(&serialized)) {
-      LOG_ERROR << "Failed to serialize message " << message.id();
-      return;
+    // 达到阈值的消息压缩后缓存
+    std::string compressed;
+    std::string_view payload = serialized;
+    if (MessageCacheCodec::getInstance().encode(serialized, &compressed)) {
+      payload = compressed;
     }
 
     // 存储消息，使用较长的过期时间（7天）
-    redis.set(messageKey, serialized, std::chrono::hours(24 * 7));
+    redis.set(messageKey, payload, std::chrono::hours(24 * 7));
 
-    LOG_INFO << "Cached message " << message.id();
+    MLOG_DEBUG(kLogModule) << "Cached message " << messageId;
   } catch (std::exception& e) {
     LOG_ERROR << "cacheMessage error: " << e.what();
   }
@@ -716,32 +1405,41 @@ void MessageServiceImpl::cacheMessage(const starrychat::Message& message) {
 // 从缓存获取消息
 std::optional<starrychat::Message> MessageServiceImpl::getMessageFromCache(
     uint64_t messageId) {
+  starrychat::Message message;
+  if (!getMessageFromCache(messageId, &message)) {
+    return std::nullopt;
+  }
+  return message;
+}
+
+// 从缓存获取消息，直接解析到调用方提供的对象
+bool MessageServiceImpl::getMessageFromCache(uint64_t messageId,
+                                             starrychat::Message* message) {
   try {
     auto& redis = RedisManager::getInstance();
 
     // 消息键
-    std::string messageKey = "message:" + std::to_string(messageId);
+    auto messageKey = RedisKeys::message(messageId);
 
     // 获取缓存消息
     auto serialized = redis.get(messageKey);
     if (!serialized) {
-      return std::nullopt;
+      return false;
     }
 
-    // 解析消息
-    starrychat::Message message;
-    if (!message.ParseFromString(*serialized)) {
+    // 解码（必要时解压）并解析消息
+    if (!MessageCacheCodec::getInstance().decode(*serialized, message)) {
       LOG_ERROR << "Failed to parse cached message " << messageId;
-      return std::nullopt;
+      return false;
     }
 
     // 刷新缓存过期时间
     redis.expire(messageKey, std::chrono::hours(24 * 7));
 
-    return message;
+    return true;
   } catch (std::exception& e) {
     LOG_ERROR << "getMessageFromCache error: " << e.what();
-    return std::nullopt;
+    return false;
   }
 }
 
@@ -751,12 +1449,12 @@ void MessageServiceImpl::invalidateMessageCache(uint64_t messageId) {
     auto& redis = RedisManager::getInstance();
 
     // 消息键
-    std::string messageKey = "message:" + std::to_string(messageId);
+    auto messageKey = RedisKeys::message(messageId);
 
     // 删除缓存
     redis.del(messageKey);
 
-    LOG_INFO << "Invalidated cache for message " << messageId;
+    MLOG_DEBUG(kLogModule) << "Invalidated cache for message " << messageId;
   } catch (std::exception& e) {
     LOG_ERROR << "invalidateMessageCache error: " << e.what();
   }
@@ -771,27 +1469,21 @@ void MessageServiceImpl::updateMessageTimeline(starrychat::ChatType chatType,
     auto& redis = RedisManager::getInstance();
 
     // 时间线键
-    std::string timelineKey =
-        "timeline:" + std::to_string(static_cast<int>(chatType)) + ":" +
-        std::to_string(chatId);
+    auto timelineKey = RedisKeys::timeline(chatType, chatId);
 
     // 添加消息ID到有序集合，以时间戳为分数
     redis.zadd(timelineKey, std::to_string(messageId),
                static_cast<double>(timestamp));
 
-    // 限制时间线大小（保留最近的1000条消息）
-    // 使用Redis命令直接执行
-    auto redis_ptr = redis.getRedis();
-    if (redis_ptr) {
-      // 删除旧消息，保留最新的1000条
-      redis_ptr->zremrangebyrank(timelineKey, 0, -1001);
-    }
+    // 限制时间线大小，删除旧消息，保留最新的1000条
+    redis.zremrangebyrank(timelineKey, 0, -1001);
 
     // 设置较长的过期时间（30天）
     redis.expire(timelineKey, std::chrono::hours(24 * 30));
 
-    LOG_INFO << "Updated message timeline for chat type "
-             << static_cast<int>(chatType) << ", chat ID " << chatId;
+    MLOG_DEBUG(kLogModule) << "Updated message timeline for chat type "
+                           << static_cast<int>(chatType) << ", chat ID "
+                           << chatId;
   } catch (std::exception& e) {
     LOG_ERROR << "updateMessageTimeline error: " << e.what();
   }
@@ -806,47 +1498,61 @@ std::vector<uint64_t> MessageServiceImpl::getRecentMessageIds(
     uint64_t beforeMsgId) {
   std::vector<uint64_t> result;
 
+  // 本节点所属的群聊优先读取内存时间线
+  auto& hot = HotTimelines::getInstance();
+  bool owned = ownedGroupChat(chatType, chatId);
+  if (owned) {
+    if (auto ids = hot.recent(chatId, limit, beforeMsgId)) {
+      return std::move(*ids);
+    }
+  }
+
   try {
     auto& redis = RedisManager::getInstance();
 
     // 时间线键
-    std::string timelineKey =
-        "timeline:" + std::to_string(static_cast<int>(chatType)) + ":" +
-        std::to_string(chatId);
+    auto timelineKey = RedisKeys::timeline(chatType, chatId);
 
     // 获取消息ID列表
-    auto redis_ptr = redis.getRedis();
-    if (!redis_ptr) {
-      return result;
-    }
-
-    std::vector<std::string> ids;
+    std::optional<std::vector<std::string>> ids;
 
     if (beforeMsgId > 0) {
       // 获取指定消息ID之前的消息
       // 替代方案：使用zrevrange获取所有消息，然后手动过滤
 
       // 1. 首先获取beforeMsgId的排名（rank）
-      auto rank = redis_ptr->zrevrank(timelineKey, std::to_string(beforeMsgId));
+      auto rank = redis.zrevrank(timelineKey, std::to_string(beforeMsgId));
 
       if (rank) {
         // 2. 获取从rank+1开始的limit条消息（这些消息的时间戳比beforeMsgId旧）
-        redis_ptr->zrevrange(timelineKey,
-                             *rank + 1,      // 从指定消息之后开始
-                             *rank + limit,  // 获取limit条消息
-                             std::back_inserter(ids));
+        ids = redis.zrevrange(timelineKey,
+                              *rank + 1,       // 从指定消息之后开始
+                              *rank + limit);  // 获取limit条消息
       }
     } else {
-      // 获取最新的消息ID列表
-      redis_ptr->zrevrange(timelineKey, 0, limit - 1, std::back_inserter(ids));
+      // 获取最新的消息ID列表，所属节点多取一些用于预热内存时间线
+      long count = owned ? std::max<long>(limit, hot.capacity()) : limit;
+      ids = redis.zrevrange(timelineKey, 0, count - 1);
+    }
+
+    if (!ids) {
+      return result;
     }
 
     // 转换为uint64_t
-    for (const auto& id : ids) {
+    for (const auto& id : *ids) {
       result.push_back(std::stoull(id));
     }
 
-    LOG_INFO << "Retrieved " << result.size() << " message IDs from cache";
+    if (owned && beforeMsgId == 0) {
+      hot.seed(chatId, result);
+      if (result.size() > static_cast<size_t>(limit)) {
+        result.resize(limit);
+      }
+    }
+
+    MLOG_DEBUG(kLogModule) << "Retrieved " << result.size()
+                           << " message IDs from cache";
   } catch (std::exception& e) {
     LOG_ERROR << "getRecentMessageIds error: " << e.what();
   }
@@ -854,36 +1560,28 @@ std::vector<uint64_t> MessageServiceImpl::getRecentMessageIds(
   return result;
 }
 
-// 发布消息通知
+// 发布消息通知，复用调用方已序列化的消息
 void MessageServiceImpl::publishMessageNotification(
-    const starrychat::Message& message) {
+    const starrychat::Message& message,
+    const std::string& serialized) {
   try {
     auto& redis = RedisManager::getInstance();
 
-    // 序列化消息
-    std::string serialized;
-    if (!message.SerializeToString(&serialized)) {
-      LOG_ERROR << "Failed to serialize message for notification";
-      return;
-    }
-
     // 发布新消息通知
-    std::string channel =
-        "chat:message:" +
-        std::to_string(static_cast<int>(message.chat_type())) + ":" +
-        std::to_string(message.chat_id());
+    auto channel =
+        RedisKeys::chatMessageChannel(message.chat_type(), message.chat_id());
     redis.publish(channel, serialized);
 
-    // 发送个人通知
+    // 推送给在本节点订阅的成员，其他节点上的成员按节点批量转发
     auto members = getChatMembers(message.chat_type(), message.chat_id());
-    for (uint64_t memberId : members) {
-      if (memberId != message.sender_id()) {
-        std::string userChannel = "user:message:" + std::to_string(memberId);
-        redis.publish(userChannel, serialized);
-      }
-    }
-
-    LOG_INFO << "Published message notification for message " << message.id();
+    members.erase(
+        std::remove(members.begin(), members.end(), message.sender_id()),
+        members.end());
+    PushRegistry::getInstance().deliver(members, message);
+    NodeRouter::getInstance().route(members, message);
+
+    MLOG_DEBUG(kLogModule) << "Published message notification for message "
+                           << message.id();
   } catch (std::exception& e) {
     LOG_ERROR << "publishMessageNotification error: " << e.what();
   }
@@ -892,53 +1590,32 @@ void MessageServiceImpl::publishMessageNotification(
 // 发布状态变更通知
 void MessageServiceImpl::publishStatusChangeNotification(
     uint64_t messageId,
+    starrychat::ChatType chatType,
+    uint64_t chatId,
     starrychat::MessageStatus status) {
   try {
     auto& redis = RedisManager::getInstance();
 
-    // 获取消息信息
-    auto cachedMessage = getMessageFromCache(messageId);
-    if (!cachedMessage) {
-      auto conn = getConnection();
-      if (!conn) {
-        return;
-      }
-
-      std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-          "SELECT chat_type, chat_id FROM messages WHERE id = ?"));
-      stmt->setUInt64(1, messageId);
-
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
-      if (!rs->next()) {
-        return;
-      }
-
-      starrychat::ChatType chatType =
-          static_cast<starrychat::ChatType>(rs->getInt("chat_type"));
-      uint64_t chatId = rs->getUInt64("chat_id");
-
-      // 发布状态变更通知
-      std::string channel =
-          "chat:message:status:" + std::to_string(static_cast<int>(chatType)) +
-          ":" + std::to_string(chatId);
-      std::string message = std::to_string(messageId) + ":" +
-                            std::to_string(static_cast<int>(status));
-
-      redis.publish(channel, message);
-    } else {
-      // 发布状态变更通知
-      std::string channel =
-          "chat:message:status:" +
-          std::to_string(static_cast<int>(cachedMessage->chat_type())) + ":" +
-          std::to_string(cachedMessage->chat_id());
-      std::string message = std::to_string(messageId) + ":" +
-                            std::to_string(static_cast<int>(status));
-
-      redis.publish(channel, message);
-    }
-
-    LOG_INFO << "Published status change notification for message " << messageId
-             << " to status " << static_cast<int>(status);
+    // 发布状态变更通知
+    auto channel = RedisKeys::chatMessageStatusChannel(chatType, chatId);
+    RedisKey message(messageId, ":", status);
+
+    redis.publish(channel, message);
+
+    // 推送给订阅的成员，同一消息未取走的状态会被合并
+    starrychat::MessageStatusUpdate update;
+    update.set_message_id(messageId);
+    update.set_chat_type(chatType);
+    update.set_chat_id(chatId);
+    update.set_status(status);
+    auto members = getChatMembers(chatType, chatId);
+    PushRegistry::getInstance().deliverStatus(members, update);
+    NodeRouter::getInstance().route(members, update);
+
+    MLOG_DEBUG(kLogModule)
+        << "Published status change notification for message "
+        << messageId << " to status "
+        << static_cast<int>(status);
   } catch (std::exception& e) {
     LOG_ERROR << "publishStatusChangeNotification error: " << e.what();
   }
@@ -952,16 +1629,14 @@ void MessageServiceImpl::incrementUnreadCount(uint64_t userId,
     auto& redis = RedisManager::getInstance();
 
     // 未读计数键
-    std::string unreadKey = "unread:" + std::to_string(userId) + ":" +
-                            std::to_string(static_cast<int>(chatType)) + ":" +
-                            std::to_string(chatId);
+    auto unreadKey = RedisKeys::unread(userId, chatType, chatId);
 
     // 增加未读计数
     redis.incr(unreadKey);
 
-    LOG_INFO << "Incremented unread count for user " << userId
-             << " in chat type " << static_cast<int>(chatType) << ", chat ID "
-             << chatId;
+    MLOG_DEBUG(kLogModule) << "Incremented unread count for user " << userId
+                           << " in chat type " << static_cast<int>(chatType)
+                           << ", chat ID " << chatId;
   } catch (std::exception& e) {
     LOG_ERROR << "incrementUnreadCount error: " << e.what();
   }
@@ -975,15 +1650,14 @@ void MessageServiceImpl::resetUnreadCount(uint64_t userId,
     auto& redis = RedisManager::getInstance();
 
     // 未读计数键
-    std::string unreadKey = "unread:" + std::to_string(userId) + ":" +
-                            std::to_string(static_cast<int>(chatType)) + ":" +
-                            std::to_string(chatId);
+    auto unreadKey = RedisKeys::unread(userId, chatType, chatId);
 
     // 重置未读计数
     redis.set(unreadKey, "0");
 
-    LOG_INFO << "Reset unread count for user " << userId << " in chat type "
-             << static_cast<int>(chatType) << ", chat ID " << chatId;
+    MLOG_DEBUG(kLogModule) << "Reset unread count for user " << userId
+                           << " in chat type " << static_cast<int>(chatType)
+                           << ", chat ID " << chatId;
   } catch (std::exception& e) {
     LOG_ERROR << "resetUnreadCount error: " << e.what();
   }
@@ -997,9 +1671,7 @@ uint64_t MessageServiceImpl::getUnreadCount(uint64_t userId,
     auto& redis = RedisManager::getInstance();
 
     // 未读计数键
-    std::string unreadKey = "unread:" + std::to_string(userId) + ":" +
-                            std::to_string(static_cast<int>(chatType)) + ":" +
-                            std::to_string(chatId);
+    auto unreadKey = RedisKeys::unread(userId, chatType, chatId);
 
     // 获取未读计数
     auto countStr = redis.get(unreadKey);
@@ -1024,7 +1696,7 @@ std::vector<uint64_t> MessageServiceImpl::getChatMembers(
 
     // 尝试从缓存获取成员列表
     if (chatType == starrychat::CHAT_TYPE_PRIVATE) {
-      std::string key = "private_chat:" + std::to_string(chatId) + ":members";
+      auto key = RedisKeys::privateChatMembers(chatId);
       auto memberStrings = redis.smembers(key);
 
       if (memberStrings && !memberStrings->empty()) {
@@ -1034,7 +1706,7 @@ std::vector<uint64_t> MessageServiceImpl::getChatMembers(
         return members;
       }
     } else if (chatType == starrychat::CHAT_TYPE_GROUP) {
-      std::string key = "chat_room:" + std::to_string(chatId) + ":members";
+      auto key = RedisKeys::chatRoomMembers(chatId);
       auto memberStrings = redis.smembers(key);
 
       if (memberStrings && !memberStrings->empty()) {
@@ -1053,11 +1725,12 @@ std::vector<uint64_t> MessageServiceImpl::getChatMembers(
 
     if (chatType == starrychat::CHAT_TYPE_PRIVATE) {
       // 私聊成员
-      std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-          "SELECT user1_id, user2_id FROM private_chats WHERE id = ?"));
+      TimedStatement stmt(conn,
+                          "SELECT user1_id, user2_id FROM private_chats "
+                          "WHERE id = ?");
       stmt->setUInt64(1, chatId);
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
       if (rs->next()) {
         uint64_t user1Id = rs->getUInt64("user1_id");
         uint64_t user2Id = rs->getUInt64("user2_id");
@@ -1066,19 +1739,20 @@ std::vector<uint64_t> MessageServiceImpl::getChatMembers(
         members.push_back(user2Id);
 
         // 缓存结果
-        std::string key = "private_chat:" + std::to_string(chatId) + ":members";
+        auto key = RedisKeys::privateChatMembers(chatId);
         redis.sadd(key, std::to_string(user1Id));
         redis.sadd(key, std::to_string(user2Id));
         redis.expire(key, std::chrono::hours(24));
       }
     } else if (chatType == starrychat::CHAT_TYPE_GROUP) {
       // 群聊成员
-      std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-          "SELECT user_id FROM chat_room_members WHERE chat_room_id = ?"));
+      TimedStatement stmt(conn,
+                          "SELECT user_id FROM chat_room_members "
+                          "WHERE chat_room_id = ?");
       stmt->setUInt64(1, chatId);
 
-      std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
-      std::string key = "chat_room:" + std::to_string(chatId) + ":members";
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+      auto key = RedisKeys::chatRoomMembers(chatId);
 
       while (rs->next()) {
         uint64_t userId = rs->getUInt64("user_id");
@@ -1091,6 +1765,7 @@ std::vector<uint64_t> MessageServiceImpl::getChatMembers(
       redis.expire(key, std::chrono::hours(24));
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "getChatMembers SQL error: " << e.what();
   } catch (std::exception& e) {
     LOG_ERROR << "getChatMembers error: " << e.what();
@@ -1107,9 +1782,7 @@ std::string MessageServiceImpl::getLastMessagePreview(
     auto& redis = RedisManager::getInstance();
 
     // 尝试从缓存获取最后一条消息
-    std::string lastMessageKey =
-        "chat:last_message:" + std::to_string(static_cast<int>(chatType)) +
-        ":" + std::to_string(chatId);
+    auto lastMessageKey = RedisKeys::chatLastMessage(chatType, chatId);
 
     auto preview = redis.get(lastMessageKey);
     if (preview) {
@@ -1122,14 +1795,14 @@ std::string MessageServiceImpl::getLastMessagePreview(
       return "";
     }
 
-    std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-        "SELECT type, content, system_code FROM messages "
-        "WHERE chat_type = ? AND chat_id = ? "
-        "ORDER BY timestamp DESC LIMIT 1"));
+    TimedStatement stmt(conn,
+                        "SELECT type, content, system_code FROM messages "
+                        "WHERE chat_type = ? AND chat_id = ? "
+                        "ORDER BY timestamp DESC LIMIT 1");
     stmt->setInt(1, static_cast<int>(chatType));
     stmt->setUInt64(2, chatId);
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     if (rs->next()) {
       starrychat::MessageType msgType =
           static_cast<starrychat::MessageType>(rs->getInt("type"));
@@ -1167,6 +1840,7 @@ std::string MessageServiceImpl::getLastMessagePreview(
       return previewText;
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "getLastMessagePreview SQL error: " << e.what();
   } catch (std::exception& e) {
     LOG_ERROR << "getLastMessagePreview error: " << e.what();
@@ -1208,20 +1882,17 @@ void MessageServiceImpl::updateLastMessage(starrychat::ChatType chatType,
     }
 
     // 更新最后一条消息预览
-    std::string lastMessageKey =
-        "chat:last_message:" + std::to_string(static_cast<int>(chatType)) +
-        ":" + std::to_string(chatId);
+    auto lastMessageKey = RedisKeys::chatLastMessage(chatType, chatId);
     redis.set(lastMessageKey, previewText, std::chrono::hours(24));
 
     // 更新最后一条消息时间
-    std::string lastActiveKey =
-        "chat:last_active:" + std::to_string(static_cast<int>(chatType)) + ":" +
-        std::to_string(chatId);
+    auto lastActiveKey = RedisKeys::chatLastActive(chatType, chatId);
     redis.set(lastActiveKey, std::to_string(message.timestamp()),
               std::chrono::hours(24));
 
-    LOG_INFO << "Updated last message for chat type "
-             << static_cast<int>(chatType) << ", chat ID " << chatId;
+    MLOG_DEBUG(kLogModule) << "Updated last message for chat type "
+                           << static_cast<int>(chatType) << ", chat ID "
+                           << chatId;
   } catch (std::exception& e) {
     LOG_ERROR << "updateLastMessage error: " << e.what();
   }
@@ -1233,7 +1904,7 @@ bool MessageServiceImpl::validateSession(const std::string& token,
   auto& redis = RedisManager::getInstance();
 
   // 检查会话token是否存在
-  auto sessionUserId = redis.get("session:" + token);
+  auto sessionUserId = redis.get(RedisKeys::session(token));
   if (!sessionUserId) {
     return false;
   }
@@ -36,6 +36,22 @@ class MessageServiceImpl : public starrychat::MessageService {
                      const starrychat::RecallMessageResponse* responsePrototype,
                      const starry::RpcDoneCallback& done) override;
 
+  void Subscribe(const starrychat::SubscribeRequestPtr& request,
+                 const starrychat::SubscribeResponse* responsePrototype,
+                 const starry::RpcDoneCallback& done) override;
+
+  void SearchMessages(
+      const starrychat::SearchMessagesRequestPtr& request,
+      const starrychat::SearchMessagesResponse* responsePrototype,
+      const starry::RpcDoneCallback& done) override;
+
+  /**
+   * 将数据库熔断期间暂存的消息按顺序落库并分发
+   * 由后台线程定期调用，数据库仍不可用时不做任何事
+   * @return 本次成功落库的消息数
+   */
+  size_t flushSpool(size_t batchSize = 100);
+
  private:
   // 获取数据库连接
   std::shared_ptr<sql::Connection> getConnection();
@@ -50,12 +66,39 @@ class MessageServiceImpl : public starrychat::MessageService {
 
   // 数据库操作方法
   uint64_t saveMessageToDatabase(const starrychat::Message& message);
+  // 落库后的缓存、Redis 时间线、通知和未读数更新
+  // 所属节点的内存时间线由调用方在聊天室的发送锁内追加
+  void distributeMessage(const starrychat::Message& message);
+  // timestamp 用于分区裁剪，为 0 时查遍各分区
   bool updateMessageStatusInDB(uint64_t messageId,
+                               uint64_t timestamp,
                                starrychat::MessageStatus status);
+  // 查询 [lower, upper) 时间范围内的历史消息追加到响应，边界为 0 表示不限
+  void queryMessagesFromDB(const std::shared_ptr<sql::Connection>& conn,
+                           const starrychat::GetMessagesRequest& request,
+                           uint64_t lower,
+                           uint64_t upper,
+                           int limit,
+                           starrychat::GetMessagesResponse* response);
+  // 从冷历史段文件读取 id < beforeId 的消息追加到响应
+  void queryMessagesFromArchive(const starrychat::GetMessagesRequest& request,
+                                uint64_t beforeId,
+                                int limit,
+                                starrychat::GetMessagesResponse* response);
+  // 按 id 读取消息，先查缓存，未命中的从数据库一次读取；
+  // 返回顺序与 messageIds 相同，不存在的消息跳过
+  std::vector<starrychat::Message> loadMessages(
+      const std::vector<uint64_t>& messageIds,
+      uint64_t userId);
 
   // Redis缓存方法
   void cacheMessage(const starrychat::Message& message);
+  // 已序列化的消息直接写入缓存，避免重复序列化
+  void cacheSerializedMessage(uint64_t messageId,
+                              const std::string& serialized);
   std::optional<starrychat::Message> getMessageFromCache(uint64_t messageId);
+  // 直接解析到调用方提供的对象（如响应中新增的元素），未命中返回 false
+  bool getMessageFromCache(uint64_t messageId, starrychat::Message* message);
   void invalidateMessageCache(uint64_t messageId);
   void updateMessageTimeline(starrychat::ChatType chatType,
                              uint64_t chatId,
@@ -67,8 +110,11 @@ class MessageServiceImpl : public starrychat::MessageService {
                                             uint64_t beforeMsgId = 0);
 
   // 通知方法
-  void publishMessageNotification(const starrychat::Message& message);
+  void publishMessageNotification(const starrychat::Message& message,
+                                  const std::string& serialized);
   void publishStatusChangeNotification(uint64_t messageId,
+                                       starrychat::ChatType chatType,
+                                       uint64_t chatId,
                                        starrychat::MessageStatus status);
 
   // 未读消息管理
@@ -0,0 +1,81 @@
+#include "message_spool.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace StarryChat {
+
+MessageSpool& MessageSpool::getInstance() {
+  static MessageSpool instance;
+  return instance;
+}
+
+MessageSpool::MessageSpool()
+    : depth_(MetricsRegistry::getInstance().gauge(
+          "starrychat_message_spool_depth",
+          "Messages waiting in the local spool for the database")),
+      rejected_(MetricsRegistry::getInstance().counter(
+          "starrychat_message_spool_rejected_total",
+          "Messages rejected because the local spool was full")) {}
+
+void MessageSpool::setCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+}
+
+bool MessageSpool::push(const starrychat::Message& message) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (queue_.size() >= capacity_) {
+    rejected_.inc();
+    return false;
+  }
+
+  queue_.push_back(message);
+  ++chats_[{message.chat_type(), message.chat_id()}];
+  idle_.store(false, std::memory_order_release);
+  depth_.set(static_cast<int64_t>(queue_.size()));
+  return true;
+}
+
+std::vector<starrychat::Message> MessageSpool::take(size_t max) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t count = std::min(max, queue_.size());
+
+  std::vector<starrychat::Message> messages(
+      std::make_move_iterator(queue_.begin()),
+      std::make_move_iterator(queue_.begin() + count));
+  queue_.erase(queue_.begin(), queue_.begin() + count);
+  depth_.set(static_cast<int64_t>(queue_.size()));
+  return messages;
+}
+
+void MessageSpool::restore(std::vector<starrychat::Message> messages) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.insert(queue_.begin(), std::make_move_iterator(messages.begin()),
+                std::make_move_iterator(messages.end()));
+  depth_.set(static_cast<int64_t>(queue_.size()));
+}
+
+void MessageSpool::release(const starrychat::Message& message) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = chats_.find({message.chat_type(), message.chat_id()});
+  if (it != chats_.end() && --it->second == 0) {
+    chats_.erase(it);
+    idle_.store(chats_.empty(), std::memory_order_release);
+  }
+}
+
+bool MessageSpool::pending(int chatType, uint64_t chatId) const {
+  if (idle_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return chats_.count({chatType, chatId}) > 0;
+}
+
+size_t MessageSpool::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+}  // namespace StarryChat
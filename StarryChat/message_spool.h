@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "message.pb.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+/**
+ * 待落库消息的本地队列
+ * 数据库熔断期间 SendMessage 把消息暂存在这里并立即应答（状态为发送中），
+ * 数据库恢复后由后台线程按发送顺序写入数据库并完成缓存、时间线和通知。
+ * 队列只在内存中，进程退出时未落库的消息会丢失，容量用尽时拒绝发送。
+ * 聊天还有暂存（含正在回写）的消息时，之后的发送也要进入队列，
+ * 否则会先于暂存的消息落库，拿到更小的消息ID。
+ */
+class MessageSpool {
+ public:
+  static MessageSpool& getInstance();
+
+  MessageSpool(const MessageSpool&) = delete;
+  MessageSpool& operator=(const MessageSpool&) = delete;
+  MessageSpool(MessageSpool&&) = delete;
+  MessageSpool& operator=(MessageSpool&&) = delete;
+
+  void setCapacity(size_t capacity);
+
+  /**
+   * 暂存一条消息
+   * @return 队列已满时返回 false
+   */
+  bool push(const starrychat::Message& message);
+
+  /**
+   * 按发送顺序取出最多 max 条消息
+   * 取出的消息在 release 之前仍计入所属聊天的 pending
+   */
+  std::vector<starrychat::Message> take(size_t max);
+
+  /**
+   * 把未能落库的消息放回队首，保持原有顺序
+   */
+  void restore(std::vector<starrychat::Message> messages);
+
+  /**
+   * 取出的消息已落库或已丢弃
+   */
+  void release(const starrychat::Message& message);
+
+  /**
+   * 聊天是否还有未完成回写的暂存消息
+   */
+  bool pending(int chatType, uint64_t chatId) const;
+
+  size_t size() const;
+
+ private:
+  MessageSpool();
+  ~MessageSpool() = default;
+
+  mutable std::mutex mutex_;
+  std::deque<starrychat::Message> queue_;
+  // 各聊天在队列中和正在回写的消息数
+  std::map<std::pair<int, uint64_t>, size_t> chats_;
+  // chats_ 是否为空，队列空闲时发送路径不必加锁
+  std::atomic<bool> idle_{true};
+  size_t capacity_{10000};
+
+  Gauge& depth_;
+  Counter& rejected_;
+};
+
+}  // namespace StarryChat
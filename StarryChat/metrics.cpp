@@ -0,0 +1,286 @@
+#include "metrics.h"
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <bit>
+#include <cstdio>
+
+namespace StarryChat {
+
+namespace {
+
+std::string formatLabels(const MetricsRegistry::Labels& labels) {
+  std::string result;
+  for (const auto& [key, value] : labels) {
+    if (!result.empty()) {
+      result += ",";
+    }
+    result += key + "=\"";
+    for (char ch : value) {
+      if (ch == '\\' || ch == '"') {
+        result += '\\';
+        result += ch;
+      } else if (ch == '\n') {
+        result += "\\n";
+      } else {
+        result += ch;
+      }
+    }
+    result += "\"";
+  }
+  return result;
+}
+
+// 拼接 name{labels,extra}
+std::string seriesName(const std::string& name,
+                       const std::string& labels,
+                       const std::string& extra = "") {
+  std::string all = labels;
+  if (!extra.empty()) {
+    all += (all.empty() ? "" : ",") + extra;
+  }
+  return all.empty() ? name : name + "{" + all + "}";
+}
+
+std::string formatSeconds(uint64_t micros) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.6f", micros / 1e6);
+  return buf;
+}
+
+}  // namespace
+
+size_t metricShardIndex() {
+  static std::atomic<size_t> nextIndex{0};
+  thread_local size_t index =
+      nextIndex.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+  return index;
+}
+
+// Counter 实现
+
+uint64_t Counter::value() const {
+  uint64_t total = 0;
+  for (const auto& cell : cells_) {
+    total += cell.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+// Histogram 实现
+
+int Histogram::bucketIndex(uint64_t micros) {
+  if (micros < static_cast<uint64_t>(kLinearBuckets)) {
+    return static_cast<int>(micros);
+  }
+
+  int exponent = std::bit_width(micros) - 1;
+  if (exponent >= kMaxExponent) {
+    return kBucketCount - 1;
+  }
+
+  int sub = static_cast<int>(micros >> (exponent - kSubBucketBits)) &
+            (kSubBuckets - 1);
+  return kLinearBuckets +
+         (exponent - kSubBucketBits - 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(int index) {
+  if (index < kLinearBuckets) {
+    return static_cast<uint64_t>(index);
+  }
+
+  int offset = index - kLinearBuckets;
+  int exponent = offset / kSubBuckets + kSubBucketBits + 1;
+  int sub = offset % kSubBuckets;
+  uint64_t width = 1ULL << (exponent - kSubBucketBits);
+  uint64_t lower = static_cast<uint64_t>(kSubBuckets + sub) * width;
+  return lower + width - 1;
+}
+
+void Histogram::record(uint64_t micros) {
+  auto& shard = shards_[metricShardIndex()];
+  shard.buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snap;
+  for (const auto& shard : shards_) {
+    for (int i = 0; i < kBucketCount; ++i) {
+      snap.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+    snap.count += shard.count.load(std::memory_order_relaxed);
+    snap.sum += shard.sum.load(std::memory_order_relaxed);
+  }
+  return snap;
+}
+
+uint64_t Histogram::Snapshot::quantile(double q) const {
+  // 各分片分别读取，桶计数之和可能与 count 略有出入，以桶计数为准
+  uint64_t total = 0;
+  for (uint64_t n : buckets) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(q * total);
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return bucketUpperBound(i);
+    }
+  }
+  return bucketUpperBound(kBucketCount - 1);
+}
+
+// MetricsRegistry 实现
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+  static MetricsRegistry instance;
+  return instance;
+}
+
+MetricsRegistry::Series& MetricsRegistry::findOrCreate(
+    const std::string& name,
+    const std::string& help,
+    Type type,
+    const Labels& labels) {
+  std::string formatted = formatLabels(labels);
+
+  auto& family = families_[name];
+  if (family.series.empty()) {
+    family.help = help;
+    family.type = type;
+  }
+
+  for (auto& series : family.series) {
+    if (series.labels == formatted) {
+      return series;
+    }
+  }
+
+  Series series;
+  series.labels = std::move(formatted);
+  switch (type) {
+    case Type::kCounter:
+      series.counter = std::make_unique<Counter>();
+      break;
+    case Type::kGauge:
+      series.gauge = std::make_unique<Gauge>();
+      break;
+    case Type::kHistogram:
+      series.histogram = std::make_unique<Histogram>();
+      break;
+  }
+  family.series.push_back(std::move(series));
+  return family.series.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name,
+                                  const std::string& help,
+                                  const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return *findOrCreate(name, help, Type::kCounter, labels).counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name,
+                              const std::string& help,
+                              const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return *findOrCreate(name, help, Type::kGauge, labels).gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name,
+                                      const std::string& help,
+                                      const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return *findOrCreate(name, help, Type::kHistogram, labels).histogram;
+}
+
+std::string MetricsRegistry::render() const {
+  static const std::pair<double, const char*> kQuantiles[] = {
+      {0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::string out;
+  for (const auto& [name, family] : families_) {
+    const char* type = family.type == Type::kCounter ? "counter"
+                       : family.type == Type::kGauge ? "gauge"
+                                                     : "summary";
+    out += "# HELP " + name + " " + family.help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+
+    for (const auto& series : family.series) {
+      switch (family.type) {
+        case Type::kCounter:
+          out += seriesName(name, series.labels) + " " +
+                 std::to_string(series.counter->value()) + "\n";
+          break;
+        case Type::kGauge:
+          out += seriesName(name, series.labels) + " " +
+                 std::to_string(series.gauge->value()) + "\n";
+          break;
+        case Type::kHistogram: {
+          auto snap = series.histogram->snapshot();
+          for (const auto& [q, label] : kQuantiles) {
+            out += seriesName(name, series.labels,
+                              std::string("quantile=\"") + label + "\"") +
+                   " " + formatSeconds(snap.quantile(q)) + "\n";
+          }
+          out += seriesName(name + "_sum", series.labels) + " " +
+                 formatSeconds(snap.sum) + "\n";
+          out += seriesName(name + "_count", series.labels) + " " +
+                 std::to_string(snap.count) + "\n";
+          break;
+        }
+      }
+    }
+  }
+  return out;
+}
+
+// RpcMethodMetrics 实现
+
+RpcMethodMetrics::RpcMethodMetrics(const std::string& service,
+                                   const std::string& method)
+    : calls_(MetricsRegistry::getInstance().counter(
+          "starrychat_rpc_calls_total",
+          "Total RPC calls",
+          {{"service", service}, {"method", method}})),
+      errors_(MetricsRegistry::getInstance().counter(
+          "starrychat_rpc_errors_total",
+          "RPC calls that returned success=false",
+          {{"service", service}, {"method", method}})),
+      latency_(MetricsRegistry::getInstance().histogram(
+          "starrychat_rpc_latency_seconds",
+          "RPC handler latency",
+          {{"service", service}, {"method", method}})) {}
+
+starry::RpcDoneCallback RpcMethodMetrics::wrap(
+    const starry::RpcDoneCallback& done) {
+  calls_.inc();
+  auto start = std::chrono::steady_clock::now();
+
+  return [this, done, start](google::protobuf::Message* response) {
+    latency_.recordSince(start);
+
+    if (response) {
+      const auto* field = response->GetDescriptor()->FindFieldByName("success");
+      if (field &&
+          field->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_BOOL &&
+          !response->GetReflection()->GetBool(*response, field)) {
+        errors_.inc();
+      }
+    }
+
+    done(response);
+  };
+}
+
+}  // namespace StarryChat
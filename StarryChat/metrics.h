@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "service.h"
+
+namespace StarryChat {
+
+/**
+ * 指标分片数量
+ * 每个线程固定落在一个分片上，更新时只做 relaxed 原子加，不加锁
+ */
+constexpr size_t kMetricShards = 8;
+
+// 当前线程对应的分片下标
+size_t metricShardIndex();
+
+/**
+ * 单调递增计数器
+ */
+class Counter {
+ public:
+  void inc(uint64_t n = 1) {
+    cells_[metricShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const;
+
+ private:
+  struct alignas(64) Cell {
+    std::atomic<uint64_t> value{0};
+  };
+
+  std::array<Cell, kMetricShards> cells_;
+};
+
+/**
+ * 瞬时值
+ */
+class Gauge {
+ public:
+  void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+  void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+/**
+ * 延迟直方图（微秒）
+ * HDR 风格的对数-线性分桶：每个2的幂区间再均分为8个子桶，相对误差约12.5%，
+ * 覆盖 0 到约 2^40 微秒。
+ */
+class Histogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kLinearBuckets = 2 * kSubBuckets;
+  static constexpr int kMaxExponent = 40;
+  static constexpr int kBucketCount =
+      kLinearBuckets + (kMaxExponent - kSubBucketBits - 1) * kSubBuckets;
+
+  void record(uint64_t micros);
+
+  void recordSince(std::chrono::steady_clock::time_point start) {
+    record(std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count());
+  }
+
+  struct Snapshot {
+    std::array<uint64_t, kBucketCount> buckets{};
+    uint64_t count{0};
+    uint64_t sum{0};
+
+    // 返回分位数所在桶的上界（微秒）
+    uint64_t quantile(double q) const;
+  };
+
+  Snapshot snapshot() const;
+
+  static int bucketIndex(uint64_t micros);
+  static uint64_t bucketUpperBound(int index);
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+  };
+
+  std::array<Shard, kMetricShards> shards_;
+};
+
+/**
+ * 作用域计时器，析构时记录耗时
+ */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Histogram& histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() { histogram_.recordSince(start_); }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  Histogram& histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * 指标注册表
+ * 注册和导出时加锁；返回的指标引用在进程生命周期内有效，调用方应缓存
+ * 后在热路径上直接更新。
+ */
+class MetricsRegistry {
+ public:
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  static MetricsRegistry& getInstance();
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+  MetricsRegistry(MetricsRegistry&&) = delete;
+  MetricsRegistry& operator=(MetricsRegistry&&) = delete;
+
+  Counter& counter(const std::string& name,
+                   const std::string& help,
+                   const Labels& labels = {});
+  Gauge& gauge(const std::string& name,
+               const std::string& help,
+               const Labels& labels = {});
+  Histogram& histogram(const std::string& name,
+                       const std::string& help,
+                       const Labels& labels = {});
+
+  /**
+   * 以 Prometheus 文本格式导出所有指标
+   * 直方图以 summary 形式导出 p50/p90/p99/p999 及 _sum/_count（单位秒）
+   */
+  std::string render() const;
+
+ private:
+  MetricsRegistry() = default;
+  ~MetricsRegistry() = default;
+
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Series {
+    std::string labels;  // 已格式化的标签，如 service="UserService"
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+  };
+
+  struct Family {
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+  };
+
+  Series& findOrCreate(const std::string& name,
+                       const std::string& help,
+                       Type type,
+                       const Labels& labels);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family> families_;
+};
+
+/**
+ * 单个 RPC 方法的调用次数、错误次数和延迟
+ * 每个服务方法持有一个静态实例，并用 wrap 包装 done 回调：
+ * 回调触发时记录延迟，响应中 success 字段为 false 时计为错误。
+ */
+class RpcMethodMetrics {
+ public:
+  RpcMethodMetrics(const std::string& service, const std::string& method);
+
+  starry::RpcDoneCallback wrap(const starry::RpcDoneCallback& done);
+
+ private:
+  Counter& calls_;
+  Counter& errors_;
+  Histogram& latency_;
+};
+
+}  // namespace StarryChat
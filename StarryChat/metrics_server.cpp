@@ -0,0 +1,93 @@
+#include "metrics_server.h"
+
+#include <algorithm>
+#include <string>
+#include "buffer.h"
+#include "logging.h"
+#include "metrics.h"
+#include "tcp_connection.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 请求头的最大长度，超过后直接断开
+constexpr size_t kMaxRequestSize = 8192;
+
+}  // namespace
+
+MetricsServer::MetricsServer(starry::EventLoop* loop,
+                             const starry::InetAddress& listenAddr)
+    : server_(loop, listenAddr, "MetricsServer") {
+  server_.setMessageCallback(
+      [this](const starry::TcpConnectionPtr& conn, starry::Buffer* buf,
+             starry::Timestamp receiveTime) {
+        onMessage(conn, buf, receiveTime);
+      });
+}
+
+void MetricsServer::start() {
+  server_.start();
+}
+
+void MetricsServer::onMessage(const starry::TcpConnectionPtr& conn,
+                              starry::Buffer* buf,
+                              starry::Timestamp) {
+  const char* begin = buf->peek();
+  const char* end = begin + buf->readableBytes();
+  static const char kHeaderEnd[] = "\r\n\r\n";
+
+  // 等待完整的请求头
+  const char* headerEnd =
+      std::search(begin, end, kHeaderEnd, kHeaderEnd + 4);
+  if (headerEnd == end) {
+    if (buf->readableBytes() > kMaxRequestSize) {
+      conn->shutdown();
+    }
+    return;
+  }
+
+  std::string requestLine(begin, std::find(begin, headerEnd, '\r'));
+  buf->retrieveAll();
+
+  // 请求行：GET /metrics HTTP/1.1
+  auto firstSpace = requestLine.find(' ');
+  auto secondSpace = requestLine.find(' ', firstSpace + 1);
+  std::string method = requestLine.substr(0, firstSpace);
+  std::string path =
+      firstSpace == std::string::npos
+          ? ""
+          : requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+
+  if (method != "GET") {
+    sendResponse(conn, 405, "Method Not Allowed", "text/plain",
+                 "Method Not Allowed\n");
+  } else if (path == "/metrics") {
+    sendResponse(conn, 200, "OK", "text/plain; version=0.0.4",
+                 MetricsRegistry::getInstance().render());
+  } else {
+    sendResponse(conn, 404, "Not Found", "text/plain", "Not Found\n");
+  }
+
+  conn->shutdown();
+}
+
+void MetricsServer::sendResponse(const starry::TcpConnectionPtr& conn,
+                                 int status,
+                                 const char* reason,
+                                 const char* contentType,
+                                 const std::string& body) {
+  std::string response = "HTTP/1.1 " + std::to_string(status) + " " + reason +
+                         "\r\n"
+                         "Content-Type: " +
+                         contentType +
+                         "\r\n"
+                         "Content-Length: " +
+                         std::to_string(body.size()) +
+                         "\r\n"
+                         "Connection: close\r\n\r\n";
+  response += body;
+  conn->send(response);
+}
+
+}  // namespace StarryChat
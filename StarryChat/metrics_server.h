@@ -0,0 +1,40 @@
+#pragma once
+
+#include "callbacks.h"
+#include "inet_address.h"
+#include "tcp_server.h"
+
+namespace starry {
+class EventLoop;
+}
+
+namespace StarryChat {
+
+/**
+ * 指标 HTTP 服务 - 在独立端口上以 Prometheus 文本格式导出指标
+ * 只处理 GET /metrics，每个请求应答后关闭连接，运行在传入的 EventLoop 上。
+ */
+class MetricsServer {
+ public:
+  MetricsServer(starry::EventLoop* loop, const starry::InetAddress& listenAddr);
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  void start();
+
+ private:
+  void onMessage(const starry::TcpConnectionPtr& conn,
+                 starry::Buffer* buf,
+                 starry::Timestamp receiveTime);
+
+  static void sendResponse(const starry::TcpConnectionPtr& conn,
+                           int status,
+                           const char* reason,
+                           const char* contentType,
+                           const std::string& body);
+
+  starry::TcpServer server_;
+};
+
+}  // namespace StarryChat
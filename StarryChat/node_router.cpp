@@ -0,0 +1,121 @@
+#include "node_router.h"
+
+#include <charconv>
+#include <unordered_map>
+#include "log_control.h"
+#include "logging.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+
+namespace StarryChat {
+
+namespace {
+
+int64_t nowSeconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::vector<std::string> presenceKeys(const std::vector<uint64_t>& userIds) {
+  std::vector<std::string> keys;
+  keys.reserve(userIds.size());
+  for (uint64_t userId : userIds) {
+    keys.push_back(RedisKeys::userNodes(userId).str());
+  }
+  return keys;
+}
+
+}  // namespace
+
+NodeRouter& NodeRouter::getInstance() {
+  static NodeRouter instance;
+  return instance;
+}
+
+NodeRouter::NodeRouter()
+    : envelopes_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_envelopes_published_total",
+          "Push envelopes published to other nodes' inboxes")),
+      recipients_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_envelope_recipients_total",
+          "Recipients carried by published push envelopes")) {}
+
+void NodeRouter::configure(const std::string& nodeId,
+                           std::chrono::seconds presenceTtl) {
+  nodeId_ = nodeId;
+  presenceTtl_ = presenceTtl;
+}
+
+void NodeRouter::addPresence(const std::vector<uint64_t>& userIds) {
+  if (userIds.empty()) {
+    return;
+  }
+  RedisManager::getInstance().hsetBatch(presenceKeys(userIds), nodeId_,
+                                        std::to_string(nowSeconds()),
+                                        presenceTtl_);
+}
+
+void NodeRouter::removePresence(const std::vector<uint64_t>& userIds) {
+  if (userIds.empty()) {
+    return;
+  }
+  RedisManager::getInstance().hdelBatch(presenceKeys(userIds), nodeId_);
+}
+
+void NodeRouter::route(const std::vector<uint64_t>& userIds,
+                       const starrychat::Message& message) {
+  starrychat::PushEnvelope envelope;
+  *envelope.mutable_message() = message;
+  publish(userIds, envelope.SerializeAsString());
+}
+
+void NodeRouter::route(const std::vector<uint64_t>& userIds,
+                       const starrychat::MessageStatusUpdate& update) {
+  starrychat::PushEnvelope envelope;
+  *envelope.mutable_status_update() = update;
+  publish(userIds, envelope.SerializeAsString());
+}
+
+void NodeRouter::publish(const std::vector<uint64_t>& userIds,
+                         const std::string& payload) {
+  if (userIds.empty()) {
+    return;
+  }
+
+  auto& redis = RedisManager::getInstance();
+  auto presence = redis.hgetallBatch(presenceKeys(userIds));
+  if (!presence) {
+    return;
+  }
+
+  // 按节点分组接收者，跳过本节点和长时间未刷新的节点
+  int64_t staleBefore = nowSeconds() - presenceTtl_.count();
+  std::unordered_map<std::string, std::vector<uint64_t>> byNode;
+  for (size_t i = 0; i < userIds.size(); ++i) {
+    for (const auto& [node, seen] : (*presence)[i]) {
+      int64_t seenAt = 0;
+      std::from_chars(seen.data(), seen.data() + seen.size(), seenAt);
+      if (node == nodeId_ || seenAt < staleBefore) {
+        continue;
+      }
+      byNode[node].push_back(userIds[i]);
+    }
+  }
+
+  // protobuf 的拼接等价于合并，负载只序列化一次，每个节点只序列化接收者列表
+  for (const auto& [node, recipients] : byNode) {
+    starrychat::PushEnvelope header;
+    header.mutable_recipient_ids()->Add(recipients.begin(), recipients.end());
+    redis.publish(RedisKeys::nodeInbox(node),
+                  header.SerializeAsString() + payload);
+    envelopes_.inc();
+    recipients_.inc(recipients.size());
+  }
+
+  MLOG_DEBUG(LogModule::kMessage)
+      << "Routed push for " << userIds.size() << " recipients to "
+      << byNode.size() << " nodes";
+}
+
+}  // namespace StarryChat
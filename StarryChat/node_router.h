@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "message.pb.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+/**
+ * 跨节点推送路由
+ * Redis 中为每个用户保存其会话所在的节点 user:nodes:{id}
+ * （节点ID -> 最近刷新时间），由各节点的 PushSubscriber 维护。
+ * 推送时用一个 pipeline 查出全部接收者所在的节点，按节点分组后向每个
+ * 节点的 node:{id}:inbox 发布一个带接收者列表的信封，
+ * 发布次数随节点数而不是成员数增长。
+ * 本节点的会话由调用方直接投递，不经过 Redis；
+ * 超过 presenceTtl 没有刷新的条目属于已宕机的节点，不再投递。
+ */
+class NodeRouter {
+ public:
+  static NodeRouter& getInstance();
+
+  NodeRouter(const NodeRouter&) = delete;
+  NodeRouter& operator=(const NodeRouter&) = delete;
+  NodeRouter(NodeRouter&&) = delete;
+  NodeRouter& operator=(NodeRouter&&) = delete;
+
+  void configure(const std::string& nodeId, std::chrono::seconds presenceTtl);
+
+  const std::string& nodeId() const { return nodeId_; }
+  std::chrono::seconds presenceTtl() const { return presenceTtl_; }
+
+  /**
+   * 登记或刷新用户在本节点的会话，也用于定期续期
+   */
+  void addPresence(const std::vector<uint64_t>& userIds);
+
+  /**
+   * 用户在本节点已没有会话
+   */
+  void removePresence(const std::vector<uint64_t>& userIds);
+
+  /**
+   * 把消息或状态变更转发给其他节点上的接收者
+   */
+  void route(const std::vector<uint64_t>& userIds,
+             const starrychat::Message& message);
+  void route(const std::vector<uint64_t>& userIds,
+             const starrychat::MessageStatusUpdate& update);
+
+ private:
+  NodeRouter();
+  ~NodeRouter() = default;
+
+  // payload 是只含负载字段的已序列化信封
+  void publish(const std::vector<uint64_t>& userIds,
+               const std::string& payload);
+
+  std::string nodeId_;
+  std::chrono::seconds presenceTtl_{60};
+
+  Counter& envelopes_;
+  Counter& recipients_;
+};
+
+}  // namespace StarryChat
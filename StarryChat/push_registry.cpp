@@ -0,0 +1,479 @@
+#include "push_registry.h"
+
+#include <algorithm>
+#include <iterator>
+#include "logging.h"
+
+namespace StarryChat {
+
+PushRegistry& PushRegistry::getInstance() {
+  static PushRegistry instance;
+  return instance;
+}
+
+PushRegistry::PushRegistry()
+    : connections_(MetricsRegistry::getInstance().gauge(
+          "starrychat_push_connections",
+          "Sessions registered for server push on this node")),
+      waiting_(MetricsRegistry::getInstance().gauge(
+          "starrychat_push_waiting",
+          "Subscribe calls currently parked")),
+      queued_(MetricsRegistry::getInstance().gauge(
+          "starrychat_push_queue_depth",
+          "Messages and status updates queued for push on this node")),
+      delivered_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_delivered_total",
+          "Messages and status updates handed to local push queues")),
+      coalesced_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_coalesced_total",
+          "Status updates merged into a queued update for the same message")),
+      dropped_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_dropped_total",
+          "Queued push items dropped for slow consumers")),
+      slowResync_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_slow_consumers_total",
+          "Push queues that reached the high watermark",
+          {{"action", "resync"}})),
+      slowDisconnect_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_slow_consumers_total",
+          "Push queues that reached the high watermark",
+          {{"action", "disconnect"}})) {}
+
+void PushRegistry::configure(const PushOptions& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+}
+
+void PushRegistry::attach(uint64_t userId, const std::string& sessionToken) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  evicted_.erase(sessionToken);
+  auto [it, inserted] = mailboxes_.try_emplace(sessionToken);
+  if (inserted) {
+    it->second.userId = userId;
+    addSession(userId, sessionToken);
+  }
+  it->second.lastSeen = Clock::now();
+  updateGauges();
+}
+
+void PushRegistry::detach(const std::string& sessionToken) {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    evicted_.erase(sessionToken);
+    removeSession(sessionToken, replies);
+    updateGauges();
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+void PushRegistry::detachUser(uint64_t userId) {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(userId);
+    if (it == sessions_.end()) {
+      return;
+    }
+
+    // removeSession 会修改 sessions_，先拷贝出会话列表
+    auto tokens = it->second;
+    for (const auto& token : tokens) {
+      removeSession(token, replies);
+    }
+    updateGauges();
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+void PushRegistry::detachIdle(uint64_t userId) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = sessions_.find(userId);
+  if (it == sessions_.end()) {
+    return;
+  }
+
+  std::vector<std::string> idle;
+  for (const auto& token : it->second) {
+    if (!mailboxes_.at(token).waiter) {
+      idle.push_back(token);
+    }
+  }
+
+  // 没有挂起的订阅，不会产生应答
+  std::vector<Reply> replies;
+  for (const auto& token : idle) {
+    removeSession(token, replies);
+  }
+  updateGauges();
+}
+
+void PushRegistry::subscribe(uint64_t userId,
+                             const std::string& sessionToken,
+                             size_t maxMessages,
+                             std::chrono::milliseconds wait,
+                             PushCallback callback) {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+
+    if (evicted_.count(sessionToken)) {
+      PushBatch batch;
+      batch.closed = true;
+      replies.emplace_back(std::move(callback), std::move(batch));
+    } else {
+      auto [it, inserted] = mailboxes_.try_emplace(sessionToken);
+      auto& mailbox = it->second;
+      if (inserted) {
+        // 队列已回收或服务重启过，期间的消息无从得知
+        mailbox.userId = userId;
+        mailbox.resyncNeeded = true;
+        addSession(userId, sessionToken);
+      }
+      mailbox.lastSeen = now;
+
+      // 同一会话的旧订阅来自已断开或重连前的连接
+      if (mailbox.waiter) {
+        replies.emplace_back(std::move(mailbox.waiter->callback),
+                             PushBatch{});
+        mailbox.waiter.reset();
+        waiting_.add(-1);
+      }
+
+      if (mailbox.depth() > 0 || mailbox.resyncNeeded) {
+        replies.emplace_back(std::move(callback), drain(mailbox, maxMessages));
+      } else {
+        mailbox.waiter = Waiter{std::move(callback), maxMessages, now + wait};
+        waiting_.add(1);
+      }
+      updateGauges();
+    }
+  }
+
+  for (auto& [pending, batch] : replies) {
+    pending(std::move(batch));
+  }
+}
+
+void PushRegistry::deliver(const std::vector<uint64_t>& userIds,
+                           const starrychat::Message& message) {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enqueue(
+        userIds,
+        [this, &message](Mailbox& mailbox) {
+          return appendMessage(mailbox, message);
+        },
+        replies);
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+void PushRegistry::deliverStatus(
+    const std::vector<uint64_t>& userIds,
+    const starrychat::MessageStatusUpdate& update) {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enqueue(
+        userIds,
+        [this, &update](Mailbox& mailbox) {
+          return appendStatus(mailbox, update);
+        },
+        replies);
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+void PushRegistry::deliverRemote(const std::vector<RemotePushEvent>& events) {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& event : events) {
+      if (const auto* message =
+              std::get_if<starrychat::Message>(&event.payload)) {
+        enqueue(
+            event.userIds,
+            [this, message](Mailbox& mailbox) {
+              return appendMessage(mailbox, *message);
+            },
+            replies);
+      } else {
+        const auto& update =
+            std::get<starrychat::MessageStatusUpdate>(event.payload);
+        enqueue(
+            event.userIds,
+            [this, &update](Mailbox& mailbox) {
+              return appendStatus(mailbox, update);
+            },
+            replies);
+      }
+    }
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+void PushRegistry::resyncAll() {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [token, mailbox] : mailboxes_) {
+      mailbox.resyncNeeded = true;
+      if (mailbox.waiter) {
+        size_t max = mailbox.waiter->maxMessages;
+        replies.emplace_back(std::move(mailbox.waiter->callback),
+                             drain(mailbox, max));
+        mailbox.waiter.reset();
+        waiting_.add(-1);
+      }
+    }
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+void PushRegistry::setInterestListener(InterestListener listener) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  interestListener_ = std::move(listener);
+}
+
+std::vector<uint64_t> PushRegistry::localUsers() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<uint64_t> users;
+  users.reserve(sessions_.size());
+  for (const auto& [userId, tokens] : sessions_) {
+    users.push_back(userId);
+  }
+  return users;
+}
+
+size_t PushRegistry::appendMessage(Mailbox& mailbox,
+                                   const starrychat::Message& message) {
+  mailbox.messages.push_back(message);
+  return 1;
+}
+
+size_t PushRegistry::appendStatus(
+    Mailbox& mailbox,
+    const starrychat::MessageStatusUpdate& update) {
+  // 同一消息尚未取走的状态直接覆盖，客户端只需要最新状态
+  auto [it, inserted] = mailbox.statusIndex.try_emplace(
+      update.message_id(), mailbox.statusUpdates.size());
+  if (!inserted) {
+    mailbox.statusUpdates[it->second] = update;
+    coalesced_.inc();
+    return 0;
+  }
+  mailbox.statusUpdates.push_back(update);
+  return 1;
+}
+
+template <typename Append>
+void PushRegistry::enqueue(const std::vector<uint64_t>& userIds,
+                           Append append,
+                           std::vector<Reply>& replies) {
+  std::vector<std::string> slow;
+
+  for (uint64_t userId : userIds) {
+    auto sessionsIt = sessions_.find(userId);
+    if (sessionsIt == sessions_.end()) {
+      continue;
+    }
+
+    for (const auto& token : sessionsIt->second) {
+      auto& mailbox = mailboxes_.at(token);
+      if (!makeRoom(mailbox)) {
+        slow.push_back(token);
+        continue;
+      }
+
+      size_t added = append(mailbox);
+      queued_.add(static_cast<int64_t>(added));
+      delivered_.inc();
+
+      if (mailbox.waiter) {
+        size_t max = mailbox.waiter->maxMessages;
+        replies.emplace_back(std::move(mailbox.waiter->callback),
+                             drain(mailbox, max));
+        mailbox.waiter.reset();
+        waiting_.add(-1);
+      }
+    }
+  }
+
+  // 遍历 sessions_ 时不能删除，断开的会话放到最后处理
+  if (!slow.empty()) {
+    auto now = Clock::now();
+    for (const auto& token : slow) {
+      auto it = mailboxes_.find(token);
+      if (it == mailboxes_.end()) {
+        continue;
+      }
+      LOG_WARN << "Disconnecting slow push consumer for user "
+               << it->second.userId;
+      removeSession(token, replies);
+      evicted_[token] = now;
+    }
+    updateGauges();
+  }
+}
+
+bool PushRegistry::makeRoom(Mailbox& mailbox) {
+  // 有挂起的订阅时积压会被立即取走，只有没有订阅时才会增长
+  if (mailbox.depth() < options_.highWatermark) {
+    return true;
+  }
+
+  if (options_.policy == SlowConsumerPolicy::kDisconnect) {
+    slowDisconnect_.inc();
+    return false;
+  }
+
+  // 客户端补拉时会拿到最新状态，先丢状态变更，再丢最旧的消息
+  size_t target = std::min(options_.lowWatermark, mailbox.depth());
+  size_t removed = 0;
+  if (mailbox.depth() > target && !mailbox.statusUpdates.empty()) {
+    removed += mailbox.statusUpdates.size();
+    mailbox.statusUpdates.clear();
+    mailbox.statusIndex.clear();
+  }
+  if (mailbox.depth() > target) {
+    size_t count = mailbox.depth() - target;
+    mailbox.messages.erase(mailbox.messages.begin(),
+                           mailbox.messages.begin() + count);
+    removed += count;
+  }
+
+  dropped_.inc(removed);
+  queued_.add(-static_cast<int64_t>(removed));
+  mailbox.resyncNeeded = true;
+  slowResync_.inc();
+  return true;
+}
+
+void PushRegistry::expire() {
+  std::vector<Reply> replies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+
+    std::vector<std::string> idle;
+    for (auto& [token, mailbox] : mailboxes_) {
+      if (mailbox.waiter) {
+        // 挂起的订阅说明连接还在，到期时以空结果应答
+        if (now >= mailbox.waiter->deadline) {
+          replies.emplace_back(std::move(mailbox.waiter->callback),
+                               PushBatch{});
+          mailbox.waiter.reset();
+          waiting_.add(-1);
+          mailbox.lastSeen = now;
+        }
+      } else if (now - mailbox.lastSeen >= options_.idleTimeout) {
+        idle.push_back(token);
+      }
+    }
+
+    for (const auto& token : idle) {
+      removeSession(token, replies);
+    }
+    if (!idle.empty()) {
+      LOG_DEBUG << "Reclaimed " << idle.size() << " idle push mailboxes";
+    }
+
+    std::erase_if(evicted_, [&](const auto& entry) {
+      return now - entry.second >= options_.idleTimeout;
+    });
+    updateGauges();
+  }
+
+  for (auto& [callback, batch] : replies) {
+    callback(std::move(batch));
+  }
+}
+
+PushBatch PushRegistry::drain(Mailbox& mailbox, size_t max) {
+  PushBatch batch;
+  size_t count = std::min(max, mailbox.messages.size());
+  batch.messages.assign(
+      std::make_move_iterator(mailbox.messages.begin()),
+      std::make_move_iterator(mailbox.messages.begin() + count));
+  mailbox.messages.erase(mailbox.messages.begin(),
+                         mailbox.messages.begin() + count);
+
+  // 状态变更很小，一次全部带走
+  count += mailbox.statusUpdates.size();
+  batch.statusUpdates = std::move(mailbox.statusUpdates);
+  mailbox.statusUpdates.clear();
+  mailbox.statusIndex.clear();
+
+  queued_.add(-static_cast<int64_t>(count));
+  batch.resyncNeeded = mailbox.resyncNeeded;
+  mailbox.resyncNeeded = false;
+  return batch;
+}
+
+void PushRegistry::addSession(uint64_t userId,
+                              const std::string& sessionToken) {
+  auto& tokens = sessions_[userId];
+  tokens.push_back(sessionToken);
+  if (tokens.size() == 1 && interestListener_) {
+    interestListener_(userId, true);
+  }
+}
+
+void PushRegistry::removeSession(const std::string& sessionToken,
+                                 std::vector<Reply>& replies) {
+  auto it = mailboxes_.find(sessionToken);
+  if (it == mailboxes_.end()) {
+    return;
+  }
+
+  auto& mailbox = it->second;
+  if (mailbox.waiter) {
+    PushBatch batch;
+    batch.closed = true;
+    replies.emplace_back(std::move(mailbox.waiter->callback),
+                         std::move(batch));
+    waiting_.add(-1);
+  }
+  queued_.add(-static_cast<int64_t>(mailbox.depth()));
+
+  auto sessionsIt = sessions_.find(mailbox.userId);
+  if (sessionsIt != sessions_.end()) {
+    auto& tokens = sessionsIt->second;
+    tokens.erase(std::remove(tokens.begin(), tokens.end(), sessionToken),
+                 tokens.end());
+    if (tokens.empty()) {
+      sessions_.erase(sessionsIt);
+      if (interestListener_) {
+        interestListener_(mailbox.userId, false);
+      }
+    }
+  }
+  mailboxes_.erase(it);
+}
+
+void PushRegistry::updateGauges() {
+  connections_.set(static_cast<int64_t>(mailboxes_.size()));
+}
+
+}  // namespace StarryChat
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "message.pb.h"
+#include "metrics.h"
+
+namespace StarryChat {
+
+/**
+ * 一次推送应答的内容
+ */
+struct PushBatch {
+  std::vector<starrychat::Message> messages;
+  std::vector<starrychat::MessageStatusUpdate> statusUpdates;
+  bool resyncNeeded{false};  // 期间有消息被丢弃，需要客户端补拉
+  bool closed{false};        // 会话已登出或被断开
+};
+
+using PushCallback = std::function<void(PushBatch batch)>;
+
+// 会话积压到高水位时的处理方式
+enum class SlowConsumerPolicy {
+  kResync,      // 丢弃最旧的内容直到低水位，留下补拉标记
+  kDisconnect,  // 断开会话，客户端需要重新登录
+};
+
+struct PushOptions {
+  size_t highWatermark{256};  // 积压达到该值视为慢消费者
+  size_t lowWatermark{64};    // kResync 丢弃到该值为止
+  SlowConsumerPolicy policy{SlowConsumerPolicy::kResync};
+  std::chrono::seconds idleTimeout{90};  // 超过该时间没有订阅视为断线
+};
+
+/**
+ * 其他节点经 Redis 转发来的推送事件
+ */
+struct RemotePushEvent {
+  std::vector<uint64_t> userIds;
+  std::variant<starrychat::Message, starrychat::MessageStatusUpdate> payload;
+};
+
+// 本节点用户集合的变化：用户的第一个会话建立或最后一个会话关闭
+using InterestListener = std::function<void(uint64_t userId, bool interested)>;
+
+/**
+ * 用户到连接的推送注册表
+ * starry 的 RPC 处理器拿不到 TcpConnection，推送通过长期挂起的 Subscribe
+ * 调用完成：每个登录会话（会话令牌）对应一个连接，注册表为它保存一个
+ * 出站队列，有新内容时直接应答挂起的调用，没有挂起调用时暂存等下一次订阅。
+ * Login 时建立队列，Logout 时关闭；连接断开后客户端不会再订阅，
+ * 队列在 idleTimeout 内没有订阅即视为断线并回收。
+ *
+ * 每次应答最多带 maxMessages 条消息，TcpConnection 的输出缓冲区里每个会话
+ * 最多只有一批数据；积压只发生在队列中，由高低水位控制：
+ * 达到高水位后按 policy 丢弃到低水位或断开会话。
+ * 同一消息的多次状态变更在队列中合并为最新的一条，不占用额外的积压名额。
+ * 回调都在锁外执行，可能在任意 IO 线程或后台线程上调用。
+ */
+class PushRegistry {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  static PushRegistry& getInstance();
+
+  PushRegistry(const PushRegistry&) = delete;
+  PushRegistry& operator=(const PushRegistry&) = delete;
+  PushRegistry(PushRegistry&&) = delete;
+  PushRegistry& operator=(PushRegistry&&) = delete;
+
+  void configure(const PushOptions& options);
+
+  /**
+   * 登录成功后为会话建立队列，之后到达的消息会被保留
+   */
+  void attach(uint64_t userId, const std::string& sessionToken);
+
+  /**
+   * 会话登出，挂起的订阅以 closed 应答
+   */
+  void detach(const std::string& sessionToken);
+
+  /**
+   * 用户的所有会话下线（如心跳超时）
+   */
+  void detachUser(uint64_t userId);
+
+  /**
+   * 其他节点报告用户下线时，只回收该用户没有挂起订阅的会话
+   * 仍在订阅的会话说明连接在本节点上还活着；误回收的会话下次订阅时
+   * 会重建队列并要求补拉，不会丢消息
+   */
+  void detachIdle(uint64_t userId);
+
+  /**
+   * 挂起一次订阅
+   * 队列中已有内容时立即应答；否则等到有内容或 wait 到期。
+   * 同一会话已有挂起的订阅时，旧订阅以空结果应答（客户端已重连）。
+   * 会话没有队列（服务重启或已回收）时重新建立并要求客户端补拉；
+   * 会话因消费过慢被断开时以 closed 应答。
+   */
+  void subscribe(uint64_t userId,
+                 const std::string& sessionToken,
+                 size_t maxMessages,
+                 std::chrono::milliseconds wait,
+                 PushCallback callback);
+
+  /**
+   * 把消息投递给在本节点上有会话的用户
+   */
+  void deliver(const std::vector<uint64_t>& userIds,
+               const starrychat::Message& message);
+
+  /**
+   * 把消息状态变更投递给在本节点上有会话的用户
+   */
+  void deliverStatus(const std::vector<uint64_t>& userIds,
+                     const starrychat::MessageStatusUpdate& update);
+
+  /**
+   * 投递订阅线程收集的一批跨节点事件，整批只加一次锁
+   */
+  void deliverRemote(const std::vector<RemotePushEvent>& events);
+
+  /**
+   * 所有会话都要求补拉，订阅连接断开重连后调用（期间的事件已丢失）
+   */
+  void resyncAll();
+
+  /**
+   * 设置用户集合变化的回调，在持锁时调用，回调中不能再访问注册表
+   */
+  void setInterestListener(InterestListener listener);
+
+  /**
+   * 当前在本节点有会话的用户
+   */
+  std::vector<uint64_t> localUsers();
+
+  /**
+   * 应答等待到期的订阅，回收长时间没有订阅的队列，由后台线程定期调用
+   */
+  void expire();
+
+ private:
+  struct Waiter {
+    PushCallback callback;
+    size_t maxMessages;
+    Clock::time_point deadline;
+  };
+
+  struct Mailbox {
+    uint64_t userId{0};
+    std::deque<starrychat::Message> messages;
+    std::vector<starrychat::MessageStatusUpdate> statusUpdates;
+    std::unordered_map<uint64_t, size_t> statusIndex;  // 消息ID -> 下标
+    std::optional<Waiter> waiter;
+    Clock::time_point lastSeen;
+    bool resyncNeeded{false};
+
+    size_t depth() const { return messages.size() + statusUpdates.size(); }
+  };
+
+  using Reply = std::pair<PushCallback, PushBatch>;
+
+  PushRegistry();
+  ~PushRegistry() = default;
+
+  /**
+   * 向各用户的会话队列追加内容，调用方持有锁
+   * append 返回本次新增的积压数（合并的状态变更为 0）
+   */
+  template <typename Append>
+  void enqueue(const std::vector<uint64_t>& userIds,
+               Append append,
+               std::vector<Reply>& replies);
+
+  size_t appendMessage(Mailbox& mailbox, const starrychat::Message& message);
+  size_t appendStatus(Mailbox& mailbox,
+                      const starrychat::MessageStatusUpdate& update);
+
+  // 积压达到高水位时按策略处理，返回 false 表示会话应被断开
+  bool makeRoom(Mailbox& mailbox);
+
+  // 记录用户的会话令牌，用户的第一个会话会通知 interestListener_
+  void addSession(uint64_t userId, const std::string& sessionToken);
+
+  // 从队列取出最多 max 条消息和全部状态变更组成应答，调用方持有锁
+  PushBatch drain(Mailbox& mailbox, size_t max);
+
+  void removeSession(const std::string& sessionToken,
+                     std::vector<Reply>& replies);
+  void updateGauges();
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Mailbox> mailboxes_;  // 会话令牌 -> 队列
+  std::unordered_map<uint64_t, std::vector<std::string>> sessions_;
+  // 因消费过慢被断开的会话，idleTimeout 后清除
+  std::unordered_map<std::string, Clock::time_point> evicted_;
+
+  PushOptions options_;
+  InterestListener interestListener_;
+
+  Gauge& connections_;
+  Gauge& waiting_;
+  Gauge& queued_;
+  Counter& delivered_;
+  Counter& coalesced_;
+  Counter& dropped_;
+  Counter& slowResync_;
+  Counter& slowDisconnect_;
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,256 @@
+#include "push_subscriber.h"
+
+#include <charconv>
+#include "logging.h"
+#include "node_router.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+#include "user.pb.h"
+#include "username_filter.h"
+
+namespace StarryChat {
+
+namespace {
+
+// 解析 "{a}:{b}" 形式的两个数字
+bool parsePair(std::string_view text, uint64_t& first, uint64_t& second) {
+  const char* end = text.data() + text.size();
+  auto result = std::from_chars(text.data(), end, first);
+  if (result.ec != std::errc() || result.ptr == end || *result.ptr != ':') {
+    return false;
+  }
+  result = std::from_chars(result.ptr + 1, end, second);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+}  // namespace
+
+PushSubscriber& PushSubscriber::getInstance() {
+  static PushSubscriber instance;
+  return instance;
+}
+
+PushSubscriber::PushSubscriber()
+    : received_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_remote_received_total",
+          "Pub/sub events received by the push subscriber")),
+      skipped_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_remote_skipped_total",
+          "Push envelopes with no local recipient")),
+      reconnects_(MetricsRegistry::getInstance().counter(
+          "starrychat_push_subscriber_reconnects_total",
+          "Times the push subscriber reconnected to Redis")),
+      present_(MetricsRegistry::getInstance().gauge(
+          "starrychat_push_present_users",
+          "Users registered in the Redis presence map by this node")) {}
+
+PushSubscriber::~PushSubscriber() {
+  stop();
+}
+
+void PushSubscriber::start(std::chrono::milliseconds pollTimeout) {
+  if (running_.exchange(true)) {
+    return;
+  }
+  pollTimeout_ = pollTimeout;
+
+  // 先登记回调再取快照，之间建立的会话不会遗漏
+  auto& registry = PushRegistry::getInstance();
+  registry.setInterestListener([this](uint64_t userId, bool interested) {
+    onInterest(userId, interested);
+  });
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint64_t userId : registry.localUsers()) {
+      interest_.insert(userId);
+    }
+    interestChanged_ = true;
+  }
+
+  thread_ = std::thread([this] { run(); });
+  LOG_INFO << "Push subscriber thread started for node "
+           << NodeRouter::getInstance().nodeId();
+}
+
+void PushSubscriber::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  PushRegistry::getInstance().setInterestListener(nullptr);
+  UsernameFilter::getInstance().setSubscribed(false);
+
+  // 本节点退出后其他节点不应再向它转发
+  NodeRouter::getInstance().removePresence(
+      std::vector<uint64_t>(registered_.begin(), registered_.end()));
+  registered_.clear();
+  present_.set(0);
+}
+
+void PushSubscriber::onInterest(uint64_t userId, bool interested) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (interested) {
+    interest_.insert(userId);
+  } else {
+    interest_.erase(userId);
+  }
+  interestChanged_ = true;
+}
+
+void PushSubscriber::run() {
+  auto& router = NodeRouter::getInstance();
+  auto inbox = RedisKeys::nodeInbox(router.nodeId()).str();
+  auto refreshInterval = router.presenceTtl() / 3;
+  bool connectedBefore = false;
+
+  while (running_) {
+    auto subscription = RedisManager::getInstance().subscribe(
+        [this, &inbox](std::string_view, std::string_view channel,
+                       std::string_view message) {
+          received_.inc();
+          if (channel == inbox) {
+            onEnvelope(message);
+          } else if (channel == RedisKeys::kUserStatusChangedChannel) {
+            onUserStatus(message);
+          } else if (channel == RedisKeys::kUserRegisteredChannel) {
+            UsernameFilter::getInstance().add(std::string(message));
+          }
+        },
+        pollTimeout_);
+    if (!subscription) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      continue;
+    }
+
+    try {
+      subscription->subscribe(
+          {inbox, std::string(RedisKeys::kUserStatusChangedChannel),
+           std::string(RedisKeys::kUserRegisteredChannel)});
+      UsernameFilter::getInstance().setSubscribed(true);
+
+      // 断开期间其他节点发来的事件已经丢失，登记也可能已过期
+      if (connectedBefore) {
+        reconnects_.inc();
+        PushRegistry::getInstance().resyncAll();
+      }
+      connectedBefore = true;
+      applyInterest(true);
+
+      while (running_) {
+        bool received = subscription->consume();
+        if (!batch_.empty() &&
+            (!received || batch_.size() >= kMaxBatch ||
+             Clock::now() - batchStart_ >= pollTimeout_)) {
+          flush();
+        }
+        applyInterest(Clock::now() - refreshedAt_ >= refreshInterval);
+      }
+    } catch (const std::exception& e) {
+      LOG_ERROR << "Push subscriber error: " << e.what();
+      UsernameFilter::getInstance().setSubscribed(false);
+      flush();
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  }
+}
+
+void PushSubscriber::applyInterest(bool full) {
+  std::vector<uint64_t> added;
+  std::vector<uint64_t> removed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!interestChanged_ && !full) {
+      return;
+    }
+    interestChanged_ = false;
+
+    // 整体续期时重写所有用户的登记，否则只处理变化的部分
+    for (uint64_t userId : interest_) {
+      if (registered_.insert(userId).second || full) {
+        added.push_back(userId);
+      }
+    }
+    for (auto it = registered_.begin(); it != registered_.end();) {
+      if (!interest_.count(*it)) {
+        removed.push_back(*it);
+        it = registered_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  auto& router = NodeRouter::getInstance();
+  router.addPresence(added);
+  router.removePresence(removed);
+  if (full) {
+    refreshedAt_ = Clock::now();
+  }
+  present_.set(static_cast<int64_t>(registered_.size()));
+}
+
+void PushSubscriber::onEnvelope(std::string_view message) {
+  starrychat::PushEnvelope envelope;
+  if (!envelope.ParseFromArray(message.data(),
+                               static_cast<int>(message.size()))) {
+    LOG_ERROR << "Failed to parse push envelope";
+    return;
+  }
+
+  // 发送方看到的登记可能已过时，只保留仍在本节点的接收者
+  std::vector<uint64_t> recipients;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint64_t userId : envelope.recipient_ids()) {
+      if (interest_.count(userId)) {
+        recipients.push_back(userId);
+      }
+    }
+  }
+  if (recipients.empty()) {
+    skipped_.inc();
+    return;
+  }
+
+  if (batch_.empty()) {
+    batchStart_ = Clock::now();
+  }
+  switch (envelope.payload_case()) {
+    case starrychat::PushEnvelope::kMessage:
+      batch_.push_back(RemotePushEvent{
+          std::move(recipients), std::move(*envelope.mutable_message())});
+      break;
+    case starrychat::PushEnvelope::kStatusUpdate:
+      batch_.push_back(
+          RemotePushEvent{std::move(recipients),
+                          std::move(*envelope.mutable_status_update())});
+      break;
+    default:
+      break;
+  }
+}
+
+void PushSubscriber::onUserStatus(std::string_view message) {
+  uint64_t userId = 0;
+  uint64_t status = 0;
+  if (!parsePair(message, userId, status) ||
+      status != starrychat::USER_STATUS_OFFLINE) {
+    return;
+  }
+
+  // 心跳超时的检测只在一个节点上发生，其他节点在这里回收该用户的会话
+  PushRegistry::getInstance().detachIdle(userId);
+}
+
+void PushSubscriber::flush() {
+  if (batch_.empty()) {
+    return;
+  }
+
+  PushRegistry::getInstance().deliverRemote(batch_);
+  batch_.clear();
+}
+
+}  // namespace StarryChat
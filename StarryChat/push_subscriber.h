@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "metrics.h"
+#include "push_registry.h"
+
+namespace StarryChat {
+
+/**
+ * 跨节点推送的 Redis 订阅线程
+ * 消息发送方所在节点直接投递给本节点的会话，其他节点上的会话靠这里转发：
+ * - node:{id}:inbox 接收其他节点经 NodeRouter 发来的信封，
+ *   信封里的接收者都曾在本节点登记过会话；
+ * - user:status:changed 收到下线通知时结束该用户在本节点的订阅；
+ * - user:registered 把其他节点新注册的用户名加入 UsernameFilter。
+ * 本节点的用户集合变化时在 Redis 中登记或删除所在节点，
+ * 并每隔 presenceTtl / 3 整体续期一次。
+ * 收到的事件攒成一批后一次交给 PushRegistry，连接空闲（读超时）、
+ * 攒够 kMaxBatch 条或超过一个 pollTimeout 时提交。
+ * 订阅连接断开后重连，并要求所有会话补拉期间丢失的事件。
+ */
+class PushSubscriber {
+ public:
+  static PushSubscriber& getInstance();
+
+  PushSubscriber(const PushSubscriber&) = delete;
+  PushSubscriber& operator=(const PushSubscriber&) = delete;
+  PushSubscriber(PushSubscriber&&) = delete;
+  PushSubscriber& operator=(PushSubscriber&&) = delete;
+
+  void start(std::chrono::milliseconds pollTimeout);
+  void stop();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t kMaxBatch = 64;
+
+  PushSubscriber();
+  ~PushSubscriber();
+
+  void run();
+  // 由 PushRegistry 在持锁时调用，只记录变化，由订阅线程应用
+  void onInterest(uint64_t userId, bool interested);
+  void onMessage(std::string_view pattern,
+                 std::string_view channel,
+                 std::string_view message);
+  void onEnvelope(std::string_view message);
+  void onUserStatus(std::string_view message);
+
+  // 以下只在订阅线程上调用
+  void applyInterest(bool full);
+  void flush();
+
+  std::chrono::milliseconds pollTimeout_{5};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+
+  std::mutex mutex_;  // 保护 interest_ 和 interestChanged_
+  std::unordered_set<uint64_t> interest_;
+  bool interestChanged_{false};
+
+  std::unordered_set<uint64_t> registered_;  // 已登记所在节点的用户
+  Clock::time_point refreshedAt_;
+  std::vector<RemotePushEvent> batch_;
+  Clock::time_point batchStart_;
+
+  Counter& received_;
+  Counter& skipped_;
+  Counter& reconnects_;
+  Gauge& present_;
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,582 @@
+#include "redis_client_store.h"
+
+#include <iterator>
+#include <map>
+#include "logging.h"
+
+namespace StarryChat {
+
+namespace {
+
+// redis++ 的 Subscriber 持有自己的连接，与连接池无关
+class RedisClientSubscription : public RedisSubscription {
+ public:
+  RedisClientSubscription(sw::redis::Subscriber subscriber, Handler handler)
+      : subscriber_(std::move(subscriber)) {
+    subscriber_.on_message(
+        [handler](std::string channel, std::string message) {
+          handler({}, channel, message);
+        });
+    subscriber_.on_pmessage([handler](std::string pattern,
+                                      std::string channel,
+                                      std::string message) {
+      handler(pattern, channel, message);
+    });
+  }
+
+  void subscribe(const std::vector<std::string>& channels) override {
+    subscriber_.subscribe(channels.begin(), channels.end());
+  }
+
+  void unsubscribe(const std::vector<std::string>& channels) override {
+    subscriber_.unsubscribe(channels.begin(), channels.end());
+  }
+
+  void psubscribe(const std::vector<std::string>& patterns) override {
+    subscriber_.psubscribe(patterns.begin(), patterns.end());
+  }
+
+  bool consume() override {
+    try {
+      subscriber_.consume();
+      return true;
+    } catch (const sw::redis::TimeoutError&) {
+      return false;
+    }
+  }
+
+ private:
+  sw::redis::Subscriber subscriber_;
+};
+
+// CRC16-CCITT (XMODEM)，与 Redis Cluster 的槽计算一致
+uint16_t crc16(std::string_view data) {
+  uint16_t crc = 0;
+  for (unsigned char c : data) {
+    crc ^= static_cast<uint16_t>(c) << 8;
+    for (int i = 0; i < 8; ++i) {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                           : static_cast<uint16_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// 逐条读取写命令的应答，有错误（包括重定向）时抛出
+void checkReplies(sw::redis::QueuedReplies& replies,
+                  const std::vector<size_t>&) {
+  for (size_t j = 0; j < replies.size(); ++j) {
+    replies.get(j);
+  }
+}
+
+}  // namespace
+
+uint16_t redisKeySlot(std::string_view key) {
+  auto open = key.find('{');
+  if (open != std::string_view::npos) {
+    auto close = key.find('}', open + 1);
+    if (close != std::string_view::npos && close > open + 1) {
+      key = key.substr(open + 1, close - open - 1);
+    }
+  }
+  return crc16(key) & 16383;
+}
+
+template <typename Client>
+BasicRedisClientStore<Client>::BasicRedisClientStore(
+    const sw::redis::ConnectionOptions& connectionOpts,
+    const sw::redis::ConnectionPoolOptions& poolOpts)
+    : connectionOpts_(connectionOpts),
+      redis_(std::make_unique<Client>(connectionOpts, poolOpts)) {}
+
+template <typename Client>
+sw::redis::Pipeline BasicRedisClientStore<Client>::pipeline(
+    std::string_view key) {
+  if constexpr (kCluster) {
+    return redis_->pipeline(key, false);
+  } else {
+    return redis_->pipeline(false);
+  }
+}
+
+template <typename Client>
+std::shared_ptr<const typename BasicRedisClientStore<Client>::SlotMap>
+BasicRedisClientStore<Client>::slotMap(bool refresh) {
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(slotsMutex_);
+    if (slots_ && !refresh && now - slotsLoadedAt_ < kSlotMapTtl) {
+      return slots_;
+    }
+  }
+
+  auto slots = std::make_shared<SlotMap>(16384);
+  for (uint32_t slot = 0; slot < slots->size(); ++slot) {
+    (*slots)[slot] = 0x10000 + slot;
+  }
+
+  if constexpr (kCluster) {
+    // 每项为 [起始槽, 结束槽, [主节点地址, 端口, ...], 从节点...]
+    try {
+      auto reply = redis_->redis("", false).command("CLUSTER", "SLOTS");
+      std::map<std::string, uint32_t> nodes;
+      for (size_t i = 0; reply && i < reply->elements; ++i) {
+        const auto* range = reply->element[i];
+        if (range->type != REDIS_REPLY_ARRAY || range->elements < 3 ||
+            range->element[2]->type != REDIS_REPLY_ARRAY ||
+            range->element[2]->elements < 2) {
+          continue;
+        }
+        const auto* master = range->element[2];
+        std::string address =
+            std::string(master->element[0]->str, master->element[0]->len) +
+            ":" + std::to_string(master->element[1]->integer);
+        uint32_t node =
+            nodes.emplace(address, static_cast<uint32_t>(nodes.size()))
+                .first->second;
+
+        long long first = std::max(range->element[0]->integer, 0LL);
+        long long last = std::min<long long>(range->element[1]->integer,
+                                             slots->size() - 1);
+        for (long long slot = first; slot <= last; ++slot) {
+          (*slots)[slot] = node;
+        }
+      }
+    } catch (const sw::redis::Error& e) {
+      LOG_WARN << "CLUSTER SLOTS failed, pipelining per slot: " << e.what();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(slotsMutex_);
+  slots_ = std::move(slots);
+  slotsLoadedAt_ = now;
+  return slots_;
+}
+
+template <typename Client>
+std::vector<std::vector<size_t>> BasicRedisClientStore<Client>::groupByNode(
+    const std::vector<std::string>& keys) {
+  std::vector<std::vector<size_t>> groups;
+  if constexpr (kCluster) {
+    auto slots = slotMap(false);
+    std::map<uint32_t, std::vector<size_t>> byNode;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      byNode[(*slots)[redisKeySlot(keys[i])]].push_back(i);
+    }
+    groups.reserve(byNode.size());
+    for (auto& [node, indices] : byNode) {
+      groups.push_back(std::move(indices));
+    }
+  } else {
+    groups.emplace_back(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      groups.front()[i] = i;
+    }
+  }
+  return groups;
+}
+
+template <typename Client>
+std::vector<std::vector<size_t>> BasicRedisClientStore<Client>::groupBySlot(
+    const std::vector<std::string>& keys,
+    const std::vector<size_t>& indices) const {
+  std::map<uint16_t, std::vector<size_t>> bySlot;
+  for (size_t i : indices) {
+    bySlot[redisKeySlot(keys[i])].push_back(i);
+  }
+
+  std::vector<std::vector<size_t>> groups;
+  groups.reserve(bySlot.size());
+  for (auto& [slot, group] : bySlot) {
+    groups.push_back(std::move(group));
+  }
+  return groups;
+}
+
+template <typename Client>
+template <typename Fill, typename Collect>
+void BasicRedisClientStore<Client>::pipelined(
+    const std::vector<std::string>& keys,
+    Fill fill,
+    Collect collect) {
+  auto run = [&](const std::vector<size_t>& group) {
+    auto pipe = pipeline(keys[group.front()]);
+    fill(pipe, group);
+    auto replies = pipe.exec();
+    collect(replies, group);
+  };
+
+  for (const auto& group : groupByNode(keys)) {
+    if (group.empty()) {
+      continue;
+    }
+    if constexpr (kCluster) {
+      // 槽已迁移到其他节点：刷新槽分布，这一组按槽重做，批量命令均可重复执行
+      try {
+        run(group);
+      } catch (const sw::redis::RedirectionError&) {
+        slotMap(true);
+        for (const auto& slotGroup : groupBySlot(keys, group)) {
+          run(slotGroup);
+        }
+      }
+    } else {
+      run(group);
+    }
+  }
+}
+
+// 字符串操作
+template <typename Client>
+void BasicRedisClientStore<Client>::set(std::string_view key,
+                                        std::string_view value,
+                                        std::chrono::seconds ttl) {
+  if (ttl.count() > 0) {
+    redis_->set(key, value, ttl);
+  } else {
+    redis_->set(key, value);
+  }
+}
+
+template <typename Client>
+std::optional<std::string> BasicRedisClientStore<Client>::get(
+    std::string_view key) {
+  return redis_->get(key);
+}
+
+template <typename Client>
+bool BasicRedisClientStore<Client>::setIfAbsent(std::string_view key,
+                                                std::string_view value,
+                                                std::chrono::seconds ttl) {
+  return redis_->set(key, value, ttl, sw::redis::UpdateType::NOT_EXIST);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::del(std::string_view key) {
+  redis_->del(key);
+}
+
+// 哈希表操作
+template <typename Client>
+void BasicRedisClientStore<Client>::hset(std::string_view key,
+                                         std::string_view field,
+                                         std::string_view value) {
+  redis_->hset(key, field, value);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::hsetWithExpire(
+    std::string_view key,
+    const std::vector<std::pair<std::string, std::string>>& fields,
+    std::chrono::seconds ttl) {
+  auto pipe = pipeline(key);
+  pipe.hset(key, fields.begin(), fields.end());
+  if (ttl.count() > 0) {
+    pipe.expire(key, ttl);
+  }
+  pipe.exec();
+}
+
+template <typename Client>
+std::optional<std::string> BasicRedisClientStore<Client>::hget(
+    std::string_view key,
+    std::string_view field) {
+  return redis_->hget(key, field);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::hdel(std::string_view key,
+                                         std::string_view field) {
+  redis_->hdel(key, field);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::hsetBatch(
+    const std::vector<std::string>& keys,
+    std::string_view field,
+    std::string_view value,
+    std::chrono::seconds ttl) {
+  pipelined(
+      keys,
+      [&](sw::redis::Pipeline& pipe, const std::vector<size_t>& group) {
+        for (size_t i : group) {
+          pipe.hset(keys[i], field, value);
+          if (ttl.count() > 0) {
+            pipe.expire(keys[i], ttl);
+          }
+        }
+      },
+      checkReplies);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::hdelBatch(
+    const std::vector<std::string>& keys,
+    std::string_view field) {
+  pipelined(
+      keys,
+      [&](sw::redis::Pipeline& pipe, const std::vector<size_t>& group) {
+        for (size_t i : group) {
+          pipe.hdel(keys[i], field);
+        }
+      },
+      checkReplies);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::hsetWithExpireBatch(
+    const std::vector<std::string>& keys,
+    const std::vector<FieldList>& fields,
+    std::chrono::seconds ttl) {
+  pipelined(
+      keys,
+      [&](sw::redis::Pipeline& pipe, const std::vector<size_t>& group) {
+        for (size_t i : group) {
+          if (fields[i].empty()) {
+            continue;
+          }
+          pipe.hset(keys[i], fields[i].begin(), fields[i].end());
+          if (ttl.count() > 0) {
+            pipe.expire(keys[i], ttl);
+          }
+        }
+      },
+      checkReplies);
+}
+
+template <typename Client>
+RedisStore::FieldMap BasicRedisClientStore<Client>::hgetall(
+    std::string_view key) {
+  FieldMap result;
+  redis_->hgetall(key, std::inserter(result, result.begin()));
+  return result;
+}
+
+template <typename Client>
+std::vector<RedisStore::FieldMap> BasicRedisClientStore<Client>::hgetallBatch(
+    const std::vector<std::string>& keys) {
+  std::vector<FieldMap> result(keys.size());
+
+  // 每个节点一个 pipeline，结果按原下标写回
+  pipelined(
+      keys,
+      [&](sw::redis::Pipeline& pipe, const std::vector<size_t>& group) {
+        for (size_t i : group) {
+          pipe.hgetall(keys[i]);
+        }
+      },
+      [&](sw::redis::QueuedReplies& replies,
+          const std::vector<size_t>& group) {
+        for (size_t j = 0; j < group.size(); ++j) {
+          auto& fields = result[group[j]];
+          fields.clear();
+          replies.get(j, std::inserter(fields, fields.begin()));
+        }
+      });
+  return result;
+}
+
+template <typename Client>
+std::vector<std::optional<std::string>> BasicRedisClientStore<Client>::hmget(
+    std::string_view key,
+    const std::vector<std::string>& fields) {
+  std::vector<std::optional<std::string>> result;
+  result.reserve(fields.size());
+  if (!fields.empty()) {
+    redis_->hmget(key, fields.begin(), fields.end(),
+                  std::back_inserter(result));
+  }
+  return result;
+}
+
+// 列表操作
+template <typename Client>
+void BasicRedisClientStore<Client>::lpush(std::string_view key,
+                                          std::string_view value) {
+  redis_->lpush(key, value);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::rpush(std::string_view key,
+                                          std::string_view value) {
+  redis_->rpush(key, value);
+}
+
+template <typename Client>
+std::optional<std::string> BasicRedisClientStore<Client>::lpop(
+    std::string_view key) {
+  return redis_->lpop(key);
+}
+
+template <typename Client>
+std::optional<std::string> BasicRedisClientStore<Client>::rpop(
+    std::string_view key) {
+  return redis_->rpop(key);
+}
+
+template <typename Client>
+std::vector<std::string> BasicRedisClientStore<Client>::lrange(
+    std::string_view key,
+    long start,
+    long stop) {
+  std::vector<std::string> result;
+  redis_->lrange(key, start, stop, std::back_inserter(result));
+  return result;
+}
+
+// 集合操作
+template <typename Client>
+void BasicRedisClientStore<Client>::sadd(std::string_view key,
+                                         std::string_view member) {
+  redis_->sadd(key, member);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::sadd(
+    std::string_view key,
+    const std::vector<std::string>& members) {
+  redis_->sadd(key, members.begin(), members.end());
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::srem(std::string_view key,
+                                         std::string_view member) {
+  redis_->srem(key, member);
+}
+
+template <typename Client>
+std::unordered_set<std::string> BasicRedisClientStore<Client>::smembers(
+    std::string_view key) {
+  std::unordered_set<std::string> result;
+  redis_->smembers(key, std::inserter(result, result.begin()));
+  return result;
+}
+
+// 有序集合操作
+template <typename Client>
+void BasicRedisClientStore<Client>::zadd(std::string_view key,
+                                         std::string_view member,
+                                         double score) {
+  redis_->zadd(key, member, score);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::zrem(std::string_view key,
+                                         std::string_view member) {
+  redis_->zrem(key, member);
+}
+
+template <typename Client>
+std::vector<std::string> BasicRedisClientStore<Client>::zrange(
+    std::string_view key,
+    long start,
+    long stop) {
+  std::vector<std::string> result;
+  redis_->zrange(key, start, stop, std::back_inserter(result));
+  return result;
+}
+
+template <typename Client>
+std::vector<std::pair<std::string, double>>
+BasicRedisClientStore<Client>::zrangeWithScores(std::string_view key,
+                                                long start,
+                                                long stop) {
+  // 1. 获取成员
+  std::vector<std::string> members;
+  redis_->zrange(key, start, stop, std::back_inserter(members));
+
+  // 2. 获取每个成员的分数
+  std::vector<std::pair<std::string, double>> result;
+  for (const auto& member : members) {
+    auto score = redis_->zscore(key, member);
+    if (score) {
+      result.emplace_back(member, *score);
+    }
+  }
+  return result;
+}
+
+template <typename Client>
+std::vector<std::string> BasicRedisClientStore<Client>::zrevrange(
+    std::string_view key,
+    long start,
+    long stop) {
+  std::vector<std::string> result;
+  redis_->zrevrange(key, start, stop, std::back_inserter(result));
+  return result;
+}
+
+template <typename Client>
+std::optional<long long> BasicRedisClientStore<Client>::zrevrank(
+    std::string_view key,
+    std::string_view member) {
+  return redis_->zrevrank(key, member);
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::zremrangebyrank(std::string_view key,
+                                                    long start,
+                                                    long stop) {
+  redis_->zremrangebyrank(key, start, stop);
+}
+
+// 发布/订阅
+template <typename Client>
+void BasicRedisClientStore<Client>::publish(std::string_view channel,
+                                            std::string_view message) {
+  redis_->publish(channel, message);
+}
+
+template <typename Client>
+std::unique_ptr<RedisSubscription> BasicRedisClientStore<Client>::subscribe(
+    RedisSubscription::Handler handler,
+    std::chrono::milliseconds pollTimeout) {
+  // 订阅连接使用更短的读超时，空闲时 consume 很快返回
+  auto options = connectionOpts_;
+  options.socket_timeout = pollTimeout;
+  sw::redis::ConnectionPoolOptions poolOpts;
+  poolOpts.size = 1;
+
+  // 集群中 PUBLISH 会广播到所有节点，订阅任意一个节点即可
+  Client redis(options, poolOpts);
+  return std::make_unique<RedisClientSubscription>(redis.subscriber(),
+                                                   std::move(handler));
+}
+
+// 其他操作
+template <typename Client>
+bool BasicRedisClientStore<Client>::expire(std::string_view key,
+                                           std::chrono::seconds ttl) {
+  return redis_->expire(key, ttl);
+}
+
+template <typename Client>
+bool BasicRedisClientStore<Client>::exists(std::string_view key) {
+  return redis_->exists(key) > 0;
+}
+
+template <typename Client>
+void BasicRedisClientStore<Client>::flushdb() {
+  if constexpr (kCluster) {
+    // 集群没有单一的数据库可清空，逐个主节点清空需要运维操作
+    throw sw::redis::Error("FLUSHDB is not supported in cluster mode");
+  } else {
+    redis_->flushdb();
+  }
+}
+
+template <typename Client>
+long long BasicRedisClientStore<Client>::incr(std::string_view key) {
+  return redis_->incr(key);
+}
+
+template <typename Client>
+long long BasicRedisClientStore<Client>::decr(std::string_view key) {
+  return redis_->decr(key);
+}
+
+template class BasicRedisClientStore<sw::redis::Redis>;
+template class BasicRedisClientStore<sw::redis::RedisCluster>;
+
+}  // namespace StarryChat
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <sw/redis++/redis++.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include "redis_store.h"
+
+namespace StarryChat {
+
+/**
+ * 基于 redis++ 连接池的 Redis 存储
+ * Client 为 sw::redis::Redis（单机）或 sw::redis::RedisCluster（集群）。
+ * 集群模式下 pipeline 只能发往一个节点：单键 pipeline 按该键选择节点，
+ * 多键批量操作按 CLUSTER SLOTS 得到的槽分布把同一节点上的键分为一组，
+ * 每组一个 pipeline，往返次数随节点数而不是键数增长。
+ * 槽分布过期或迁移中遇到重定向时，该组改为每个槽一个 pipeline。
+ */
+template <typename Client>
+class BasicRedisClientStore : public RedisStore {
+ public:
+  BasicRedisClientStore(const sw::redis::ConnectionOptions& connectionOpts,
+                        const sw::redis::ConnectionPoolOptions& poolOpts);
+
+  void set(std::string_view key,
+           std::string_view value,
+           std::chrono::seconds ttl) override;
+  std::optional<std::string> get(std::string_view key) override;
+  void del(std::string_view key) override;
+  bool setIfAbsent(std::string_view key,
+                   std::string_view value,
+                   std::chrono::seconds ttl) override;
+
+  void hset(std::string_view key,
+            std::string_view field,
+            std::string_view value) override;
+  void hsetWithExpire(
+      std::string_view key,
+      const std::vector<std::pair<std::string, std::string>>& fields,
+      std::chrono::seconds ttl) override;
+  std::optional<std::string> hget(std::string_view key,
+                                  std::string_view field) override;
+  void hdel(std::string_view key, std::string_view field) override;
+  void hsetBatch(const std::vector<std::string>& keys,
+                 std::string_view field,
+                 std::string_view value,
+                 std::chrono::seconds ttl) override;
+  void hdelBatch(const std::vector<std::string>& keys,
+                 std::string_view field) override;
+  void hsetWithExpireBatch(const std::vector<std::string>& keys,
+                           const std::vector<FieldList>& fields,
+                           std::chrono::seconds ttl) override;
+  FieldMap hgetall(std::string_view key) override;
+  std::vector<FieldMap> hgetallBatch(
+      const std::vector<std::string>& keys) override;
+  std::vector<std::optional<std::string>> hmget(
+      std::string_view key,
+      const std::vector<std::string>& fields) override;
+
+  void lpush(std::string_view key, std::string_view value) override;
+  void rpush(std::string_view key, std::string_view value) override;
+  std::optional<std::string> lpop(std::string_view key) override;
+  std::optional<std::string> rpop(std::string_view key) override;
+  std::vector<std::string> lrange(std::string_view key,
+                                  long start,
+                                  long stop) override;
+
+  void sadd(std::string_view key, std::string_view member) override;
+  void sadd(std::string_view key,
+            const std::vector<std::string>& members) override;
+  void srem(std::string_view key, std::string_view member) override;
+  std::unordered_set<std::string> smembers(std::string_view key) override;
+
+  void zadd(std::string_view key,
+            std::string_view member,
+            double score) override;
+  void zrem(std::string_view key, std::string_view member) override;
+  std::vector<std::string> zrange(std::string_view key,
+                                  long start,
+                                  long stop) override;
+  std::vector<std::pair<std::string, double>> zrangeWithScores(
+      std::string_view key,
+      long start,
+      long stop) override;
+  std::vector<std::string> zrevrange(std::string_view key,
+                                     long start,
+                                     long stop) override;
+  std::optional<long long> zrevrank(std::string_view key,
+                                    std::string_view member) override;
+  void zremrangebyrank(std::string_view key, long start, long stop) override;
+
+  void publish(std::string_view channel, std::string_view message) override;
+  std::unique_ptr<RedisSubscription> subscribe(
+      RedisSubscription::Handler handler,
+      std::chrono::milliseconds pollTimeout) override;
+
+  bool expire(std::string_view key, std::chrono::seconds ttl) override;
+  bool exists(std::string_view key) override;
+  void flushdb() override;
+  long long incr(std::string_view key) override;
+  long long decr(std::string_view key) override;
+
+ private:
+  static constexpr bool kCluster =
+      std::is_same_v<Client, sw::redis::RedisCluster>;
+
+  // 访问 key 所在节点的 pipeline，复用连接池中的连接
+  sw::redis::Pipeline pipeline(std::string_view key);
+
+  // 槽分布的有效期，之后的批量操作重新读取
+  static constexpr std::chrono::seconds kSlotMapTtl{30};
+
+  // 每个槽所在节点的编号；未分配或读取失败的槽编号为 0x10000 + 槽号，
+  // 各自成组
+  using SlotMap = std::vector<uint32_t>;
+
+  std::shared_ptr<const SlotMap> slotMap(bool refresh);
+
+  // 按节点分组的 keys 下标；单机模式下只有一组
+  std::vector<std::vector<size_t>> groupByNode(
+      const std::vector<std::string>& keys);
+
+  // indices 中的键按槽分组
+  std::vector<std::vector<size_t>> groupBySlot(
+      const std::vector<std::string>& keys,
+      const std::vector<size_t>& indices) const;
+
+  /**
+   * 按节点分组执行批量操作
+   * fill 向 pipeline 加入一组键的命令，collect 读取该组的应答，
+   * 应答中有错误时由 QueuedReplies::get 抛出
+   */
+  template <typename Fill, typename Collect>
+  void pipelined(const std::vector<std::string>& keys,
+                 Fill fill,
+                 Collect collect);
+
+  sw::redis::ConnectionOptions connectionOpts_;
+  std::unique_ptr<Client> redis_;
+
+  std::mutex slotsMutex_;
+  std::shared_ptr<const SlotMap> slots_;
+  std::chrono::steady_clock::time_point slotsLoadedAt_;
+};
+
+using RedisClientStore = BasicRedisClientStore<sw::redis::Redis>;
+using RedisClusterStore = BasicRedisClientStore<sw::redis::RedisCluster>;
+
+/**
+ * 键所在的 Redis Cluster 槽（CRC16 mod 16384），键中有非空的 {...} 时
+ * 只对第一个哈希标签的内容计算
+ */
+uint16_t redisKeySlot(std::string_view key);
+
+}  // namespace StarryChat
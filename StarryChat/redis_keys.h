@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace StarryChat {
+
+/**
+ * 在栈上拼接 Redis 键
+ * 数字用 std::to_chars 直接写入定长缓冲区，常见的键不产生堆分配；
+ * 超出容量（如客户端传入的超长 token）时退回到 std::string。
+ * 通过 std::string_view 传给 RedisManager，使用期间 RedisKey 必须存活。
+ */
+class RedisKey {
+ public:
+  static constexpr size_t kCapacity = 96;
+
+  RedisKey() = default;
+
+  template <typename... Parts>
+  explicit RedisKey(const Parts&... parts) {
+    (append(parts), ...);
+  }
+
+  RedisKey& append(std::string_view text) {
+    if (overflow_.empty() && size_ + text.size() <= kCapacity) {
+      std::memcpy(buffer_.data() + size_, text.data(), text.size());
+      size_ += text.size();
+      return *this;
+    }
+
+    if (overflow_.empty()) {
+      overflow_.assign(buffer_.data(), size_);
+    }
+    overflow_.append(text);
+    return *this;
+  }
+
+  template <typename T>
+    requires std::is_integral_v<T>
+  RedisKey& append(T value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return append(std::string_view(digits, result.ptr - digits));
+  }
+
+  // 枚举按数值写入，与原先 std::to_string(static_cast<int>(...)) 一致
+  template <typename T>
+    requires std::is_enum_v<T>
+  RedisKey& append(T value) {
+    return append(static_cast<std::underlying_type_t<T>>(value));
+  }
+
+  std::string_view view() const {
+    if (!overflow_.empty()) {
+      return overflow_;
+    }
+    return std::string_view(buffer_.data(), size_);
+  }
+
+  operator std::string_view() const { return view(); }
+
+  std::string str() const { return std::string(view()); }
+
+ private:
+  std::array<char, kCapacity> buffer_;
+  size_t size_{0};
+  std::string overflow_;
+};
+
+/**
+ * Redis 键和频道的命名规则
+ * 所有键族集中在这里定义；ID 参数可以是整数，也可以是已经是字符串的 ID
+ * （如 SMEMBERS 的结果）。
+ *
+ * 属于同一个聊天或同一个用户的键带有相同的哈希标签 {chat:类型:ID} 或
+ * {user:ID}，Redis Cluster 模式下落在同一个槽，针对一个聊天或用户的
+ * pipeline 和 Lua 脚本不会跨槽。消息体按消息ID分散，不带标签。
+ */
+namespace RedisKeys {
+
+// 哈希标签中的聊天类型与 ChatType 的数值一致
+inline constexpr int kPrivateChatTag = 1;
+inline constexpr int kGroupChatTag = 2;
+
+// 全局键
+inline constexpr std::string_view kUsersOnline = "users:online";
+inline constexpr std::string_view kUserStatus = "user:status";
+inline constexpr std::string_view kUsernameToId = "username:to:id";
+
+// 用户
+inline RedisKey user(const auto& userId) {
+  return RedisKey("{user:", userId, "}");
+}
+
+inline RedisKey userChats(const auto& userId) {
+  return RedisKey("{user:", userId, "}:chats");
+}
+
+inline RedisKey userFriendIds(const auto& userId) {
+  return RedisKey("{user:", userId, "}:friend_ids");
+}
+
+// 好友列表的版本号，每次失效时递增
+inline RedisKey userFriendVersion(const auto& userId) {
+  return RedisKey("{user:", userId, "}:friend_ver");
+}
+
+inline RedisKey userHeartbeat(const auto& userId) {
+  return RedisKey("{user:", userId, "}:heartbeat");
+}
+
+// 用户所在的节点：节点ID -> 最近刷新时间
+inline RedisKey userNodes(const auto& userId) {
+  return RedisKey("{user:", userId, "}:nodes");
+}
+
+inline RedisKey userSession(const auto& userId) {
+  return RedisKey("{user:", userId, "}:session");
+}
+
+inline RedisKey session(std::string_view token) {
+  return RedisKey("session:", token);
+}
+
+inline RedisKey loginLock(std::string_view limiterKey) {
+  return RedisKey("login:lock:", limiterKey);
+}
+
+// 未读数按用户聚集，一个用户的各聊天未读数可以在一个 pipeline 中读取
+inline RedisKey unread(uint64_t userId, int chatType, uint64_t chatId) {
+  return RedisKey("{user:", userId, "}:unread:", chatType, ":", chatId);
+}
+
+// 消息
+inline RedisKey message(uint64_t messageId) {
+  return RedisKey("message:", messageId);
+}
+
+// 聊天
+inline RedisKey timeline(int chatType, uint64_t chatId) {
+  return RedisKey("{chat:", chatType, ":", chatId, "}:timeline");
+}
+
+inline RedisKey chatLastMessage(int chatType, uint64_t chatId) {
+  return RedisKey("{chat:", chatType, ":", chatId, "}:last_message");
+}
+
+inline RedisKey chatLastActive(int chatType, uint64_t chatId) {
+  return RedisKey("{chat:", chatType, ":", chatId, "}:last_active");
+}
+
+// 群聊
+inline RedisKey chatRoom(uint64_t chatRoomId) {
+  return RedisKey("{chat:", kGroupChatTag, ":", chatRoomId, "}:info");
+}
+
+inline RedisKey chatRoomMembers(uint64_t chatRoomId) {
+  return RedisKey("{chat:", kGroupChatTag, ":", chatRoomId, "}:members");
+}
+
+inline RedisKey chatRoomMember(uint64_t chatRoomId, const auto& userId) {
+  return RedisKey("{chat:", kGroupChatTag, ":", chatRoomId, "}:member:",
+                  userId);
+}
+
+// 私聊
+inline RedisKey privateChat(uint64_t privateChatId) {
+  return RedisKey("{chat:", kPrivateChatTag, ":", privateChatId, "}:info");
+}
+
+inline RedisKey privateChatMembers(uint64_t privateChatId) {
+  return RedisKey("{chat:", kPrivateChatTag, ":", privateChatId,
+                  "}:members");
+}
+
+inline RedisKey privateChatUsers(uint64_t user1Id, uint64_t user2Id) {
+  return RedisKey("private_chat:users:", user1Id, ":", user2Id);
+}
+
+// 集群成员：节点ID集合，以及每个节点带租约的信息（地址）
+inline constexpr std::string_view kClusterNodes = "cluster:nodes";
+
+inline RedisKey clusterNode(std::string_view nodeId) {
+  return RedisKey("cluster:node:", nodeId);
+}
+
+// 消息分区维护的跨节点互斥锁，值为持有者的随机令牌
+inline constexpr std::string_view kMessagePartitionsLock =
+    "lock:message_partitions";
+
+// 发布/订阅频道
+inline constexpr std::string_view kUserStatusChangedChannel =
+    "user:status:changed";
+inline constexpr std::string_view kUserProfileUpdatedChannel =
+    "user:profile:updated";
+// 新注册的用户名，各节点加入用户名过滤器
+inline constexpr std::string_view kUserRegisteredChannel = "user:registered";
+
+inline RedisKey chatMessageChannel(int chatType, uint64_t chatId) {
+  return RedisKey("chat:message:", chatType, ":", chatId);
+}
+
+inline RedisKey chatMessageStatusChannel(int chatType, uint64_t chatId) {
+  return RedisKey("chat:message:status:", chatType, ":", chatId);
+}
+
+inline RedisKey nodeInbox(std::string_view nodeId) {
+  return RedisKey("node:", nodeId, ":inbox");
+}
+
+inline RedisKey chatRoomChangedChannel(uint64_t chatRoomId) {
+  return RedisKey("chat_room:changed:", chatRoomId);
+}
+
+inline RedisKey chatRoomMembershipChannel(uint64_t chatRoomId) {
+  return RedisKey("chat_room:membership:", chatRoomId);
+}
+
+inline RedisKey userChatRoomChannel(uint64_t userId) {
+  return RedisKey("user:chat_room:", userId);
+}
+
+inline RedisKey userPrivateChatChannel(uint64_t userId) {
+  return RedisKey("user:private_chat:", userId);
+}
+
+}  // namespace RedisKeys
+
+}  // namespace StarryChat
@@ -1,9 +1,22 @@
 #include "config.h"
+#include "deadline.h"
 #include "logging.h"
+#include "metrics.h"
+#include "redis_client_store.h"
 #include "redis_manager.h"
 
 namespace StarryChat {
 
+namespace {
+
+Histogram& commandLatency(const std::string& verb) {
+  return MetricsRegistry::getInstance().histogram(
+      "starrychat_redis_command_latency_seconds", "Redis command latency",
+      {{"command", verb}});
+}
+
+}  // namespace
+
 RedisManager& RedisManager::getInstance() {
   static RedisManager instance;
   return instance;
@@ -21,27 +34,44 @@ bool RedisManager::initialize() {
     auto& config = Config::getInstance();
 
     // 设置连接选项
-    connectionOpts_.host = config.getRedisHost();
-    connectionOpts_.port = config.getRedisPort();
-    connectionOpts_.password = config.getRedisPassword();
-    connectionOpts_.db = config.getRedisDB();
-    connectionOpts_.connect_timeout =
+    sw::redis::ConnectionOptions connectionOpts;
+    connectionOpts.host = config.getRedisHost();
+    connectionOpts.port = config.getRedisPort();
+    connectionOpts.password = config.getRedisPassword();
+    connectionOpts.db = config.getRedisDB();
+    connectionOpts.connect_timeout =
         std::chrono::milliseconds(1000);  // 1秒超时
-    connectionOpts_.socket_timeout =
+    connectionOpts.socket_timeout =
         std::chrono::milliseconds(1000);  // 1秒超时
 
     // 设置连接池选项
-    poolOpts_.size = config.getRedisPoolSize();                // 连接池大小
-    poolOpts_.wait_timeout = std::chrono::milliseconds(100);   // 等待超时时间
-    poolOpts_.connection_lifetime = std::chrono::minutes(10);  // 连接生存时间
-
-    // 创建Redis连接池
-    redis_ = std::make_unique<sw::redis::Redis>(connectionOpts_, poolOpts_);
+    sw::redis::ConnectionPoolOptions poolOpts;
+    poolOpts.size = config.getRedisPoolSize();               // 连接池大小
+    poolOpts.wait_timeout = std::chrono::milliseconds(100);  // 等待超时时间
+    poolOpts.connection_lifetime = std::chrono::minutes(10);  // 连接生存时间
+
+    // Redis 熔断参数
+    CircuitBreakerOptions breakerOptions;
+    breakerOptions.windowSeconds = config.getBreakerWindowSeconds();
+    breakerOptions.minCalls = config.getBreakerMinCalls();
+    breakerOptions.failureRate = config.getBreakerFailureRate();
+    breakerOptions.slowCallMs = config.getRedisSlowCallMs();
+    breakerOptions.slowCallRate = config.getBreakerSlowCallRate();
+    breakerOptions.openSeconds = config.getBreakerOpenSeconds();
+    breakerOptions.halfOpenProbes = config.getBreakerHalfOpenProbes();
+    breaker_.configure(breakerOptions);
+
+    // 创建Redis连接池，集群模式下从种子节点发现其余节点
+    if (config.getRedisMode() == "cluster") {
+      store_ = std::make_unique<RedisClusterStore>(connectionOpts, poolOpts);
+    } else {
+      store_ = std::make_unique<RedisClientStore>(connectionOpts, poolOpts);
+    }
 
     // 测试连接
-    if (!exists("test_connection")) {
-      set("test_connection", "1", std::chrono::seconds(1));
-      del("test_connection");
+    if (!store_->exists("test_connection")) {
+      store_->set("test_connection", "1", std::chrono::seconds(1));
+      store_->del("test_connection");
     }
 
     initialized_ = true;
@@ -57,379 +87,686 @@ bool RedisManager::initialize() {
   }
 }
 
+bool RedisManager::initialize(std::unique_ptr<RedisStore> store) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (initialized_ || !store) {
+    return initialized_;
+  }
+
+  store_ = std::move(store);
+  initialized_ = true;
+  return true;
+}
+
+bool RedisManager::available() {
+  // 客户端已放弃等待或 Redis 已熔断时不再发出命令，调用方按未命中或失败处理
+  return initialized_ && !RequestDeadline::exceeded(DeadlineStage::kRedis) &&
+         breaker_.allow();
+}
+
 void RedisManager::shutdown() {
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (initialized_) {
-    redis_.reset();
+    store_.reset();
     initialized_ = false;
     LOG_INFO << "Redis connection shut down";
   }
 }
 
 // 字符串操作
-bool RedisManager::set(const std::string& key,
-                       const std::string& value,
+bool RedisManager::set(std::string_view key,
+                       std::string_view value,
                        std::chrono::seconds ttl) {
-  if (!initialized_)
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("set");
+  BackendCall call(breaker_, latency);
+
   try {
-    if (ttl.count() > 0) {
-      redis_->set(key, value, ttl);
-    } else {
-      redis_->set(key, value);
-    }
+    store_->set(key, value, ttl);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in set: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-std::optional<std::string> RedisManager::get(const std::string& key) {
-  if (!initialized_)
+std::optional<std::string> RedisManager::get(std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("get");
+  BackendCall call(breaker_, latency);
+
   try {
-    auto val = redis_->get(key);
+    auto val = store_->get(key);
     return val;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in get: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
-bool RedisManager::del(const std::string& key) {
-  if (!initialized_)
+bool RedisManager::del(std::string_view key) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("del");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->del(key);
+    store_->del(key);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in del: " << e.what();
+    call.fail();
     return false;
   }
 }
 
+std::optional<bool> RedisManager::setIfAbsent(std::string_view key,
+                                              std::string_view value,
+                                              std::chrono::seconds ttl) {
+  if (!available())
+    return std::nullopt;
+
+  static auto& latency = commandLatency("set_nx");
+  BackendCall call(breaker_, latency);
+
+  try {
+    return store_->setIfAbsent(key, value, ttl);
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in setIfAbsent: " << e.what();
+    call.fail();
+    return std::nullopt;
+  }
+}
+
 // 哈希表操作
-bool RedisManager::hset(const std::string& key,
-                        const std::string& field,
-                        const std::string& value) {
-  if (!initialized_)
+bool RedisManager::hset(std::string_view key,
+                        std::string_view field,
+                        std::string_view value) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("hset");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->hset(key, field, value);
+    store_->hset(key, field, value);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in hset: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-std::optional<std::string> RedisManager::hget(const std::string& key,
-                                              const std::string& field) {
-  if (!initialized_)
+bool RedisManager::hsetWithExpire(
+    std::string_view key,
+    const std::vector<std::pair<std::string, std::string>>& fields,
+    std::chrono::seconds ttl) {
+  if (!available() || fields.empty())
+    return false;
+
+  static auto& latency = commandLatency("hset");
+  BackendCall call(breaker_, latency);
+
+  try {
+    store_->hsetWithExpire(key, fields, ttl);
+    return true;
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in hsetWithExpire: " << e.what();
+    call.fail();
+    return false;
+  }
+}
+
+std::optional<std::string> RedisManager::hget(std::string_view key,
+                                              std::string_view field) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("hget");
+  BackendCall call(breaker_, latency);
+
   try {
-    auto val = redis_->hget(key, field);
+    auto val = store_->hget(key, field);
     return val;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in hget: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
-bool RedisManager::hdel(const std::string& key, const std::string& field) {
-  if (!initialized_)
+bool RedisManager::hdel(std::string_view key, std::string_view field) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("hdel");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->hdel(key, field);
+    store_->hdel(key, field);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in hdel: " << e.what();
+    call.fail();
+    return false;
+  }
+}
+
+bool RedisManager::hsetBatch(const std::vector<std::string>& keys,
+                             std::string_view field,
+                             std::string_view value,
+                             std::chrono::seconds ttl) {
+  if (!available() || keys.empty())
+    return false;
+
+  static auto& latency = commandLatency("hset_pipeline");
+  BackendCall call(breaker_, latency);
+
+  try {
+    store_->hsetBatch(keys, field, value, ttl);
+    return true;
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in hsetBatch: " << e.what();
+    call.fail();
+    return false;
+  }
+}
+
+bool RedisManager::hdelBatch(const std::vector<std::string>& keys,
+                             std::string_view field) {
+  if (!available() || keys.empty())
+    return false;
+
+  static auto& latency = commandLatency("hdel_pipeline");
+  BackendCall call(breaker_, latency);
+
+  try {
+    store_->hdelBatch(keys, field);
+    return true;
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in hdelBatch: " << e.what();
+    call.fail();
+    return false;
+  }
+}
+
+bool RedisManager::hsetWithExpireBatch(
+    const std::vector<std::string>& keys,
+    const std::vector<RedisStore::FieldList>& fields,
+    std::chrono::seconds ttl) {
+  if (!available() || keys.empty() || keys.size() != fields.size())
+    return false;
+
+  static auto& latency = commandLatency("hset_pipeline");
+  BackendCall call(breaker_, latency);
+
+  try {
+    store_->hsetWithExpireBatch(keys, fields, ttl);
+    return true;
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in hsetWithExpireBatch: " << e.what();
+    call.fail();
     return false;
   }
 }
 
 std::optional<std::unordered_map<std::string, std::string>>
-RedisManager::hgetall(const std::string& key) {
-  if (!initialized_)
+RedisManager::hgetall(std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("hgetall");
+  BackendCall call(breaker_, latency);
+
   try {
-    std::unordered_map<std::string, std::string> result;
-    redis_->hgetall(key, std::inserter(result, result.begin()));
-    return result;
+    return store_->hgetall(key);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in hgetall: " << e.what();
+    call.fail();
+    return std::nullopt;
+  }
+}
+
+std::optional<std::vector<std::unordered_map<std::string, std::string>>>
+RedisManager::hgetallBatch(const std::vector<std::string>& keys) {
+  if (!available())
+    return std::nullopt;
+
+  static auto& latency = commandLatency("hgetall_pipeline");
+  BackendCall call(breaker_, latency);
+
+  try {
+    return store_->hgetallBatch(keys);
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in hgetallBatch: " << e.what();
+    call.fail();
+    return std::nullopt;
+  }
+}
+
+std::optional<std::vector<std::optional<std::string>>> RedisManager::hmget(
+    std::string_view key,
+    const std::vector<std::string>& fields) {
+  if (!available())
+    return std::nullopt;
+
+  static auto& latency = commandLatency("hmget");
+  BackendCall call(breaker_, latency);
+
+  try {
+    return store_->hmget(key, fields);
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in hmget: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
 // 列表操作
-bool RedisManager::lpush(const std::string& key, const std::string& value) {
-  if (!initialized_)
+bool RedisManager::lpush(std::string_view key, std::string_view value) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("lpush");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->lpush(key, value);
+    store_->lpush(key, value);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in lpush: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-bool RedisManager::rpush(const std::string& key, const std::string& value) {
-  if (!initialized_)
+bool RedisManager::rpush(std::string_view key, std::string_view value) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("rpush");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->rpush(key, value);
+    store_->rpush(key, value);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in rpush: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-std::optional<std::string> RedisManager::lpop(const std::string& key) {
-  if (!initialized_)
+std::optional<std::string> RedisManager::lpop(std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("lpop");
+  BackendCall call(breaker_, latency);
+
   try {
-    auto val = redis_->lpop(key);
+    auto val = store_->lpop(key);
     return val;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in lpop: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
-std::optional<std::string> RedisManager::rpop(const std::string& key) {
-  if (!initialized_)
+std::optional<std::string> RedisManager::rpop(std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("rpop");
+  BackendCall call(breaker_, latency);
+
   try {
-    auto val = redis_->rpop(key);
+    auto val = store_->rpop(key);
     return val;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in rpop: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
 std::optional<std::vector<std::string>>
-RedisManager::lrange(const std::string& key, long start, long stop) {
-  if (!initialized_)
+RedisManager::lrange(std::string_view key, long start, long stop) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("lrange");
+  BackendCall call(breaker_, latency);
+
   try {
-    std::vector<std::string> result;
-    redis_->lrange(key, start, stop, std::back_inserter(result));
-    return result;
+    return store_->lrange(key, start, stop);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in lrange: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
 // 集合操作
-bool RedisManager::sadd(const std::string& key, const std::string& member) {
-  if (!initialized_)
+bool RedisManager::sadd(std::string_view key, std::string_view member) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("sadd");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->sadd(key, member);
+    store_->sadd(key, member);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in sadd: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-bool RedisManager::srem(const std::string& key, const std::string& member) {
-  if (!initialized_)
+bool RedisManager::sadd(std::string_view key,
+                        const std::vector<std::string>& members) {
+  if (!available())
     return false;
 
+  if (members.empty())
+    return true;
+
+  static auto& latency = commandLatency("sadd");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->srem(key, member);
+    store_->sadd(key, members);
+    return true;
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in sadd: " << e.what();
+    call.fail();
+    return false;
+  }
+}
+
+bool RedisManager::srem(std::string_view key, std::string_view member) {
+  if (!available())
+    return false;
+
+  static auto& latency = commandLatency("srem");
+  BackendCall call(breaker_, latency);
+
+  try {
+    store_->srem(key, member);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in srem: " << e.what();
+    call.fail();
     return false;
   }
 }
 
 std::optional<std::unordered_set<std::string>> RedisManager::smembers(
-    const std::string& key) {
-  if (!initialized_)
+    std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("smembers");
+  BackendCall call(breaker_, latency);
+
   try {
-    std::unordered_set<std::string> result;
-    redis_->smembers(key, std::inserter(result, result.begin()));
-    return result;
+    return store_->smembers(key);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in smembers: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
 // 有序集合操作
-bool RedisManager::zadd(const std::string& key,
-                        const std::string& member,
+bool RedisManager::zadd(std::string_view key,
+                        std::string_view member,
                         double score) {
-  if (!initialized_)
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("zadd");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->zadd(key, member, score);
+    store_->zadd(key, member, score);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in zadd: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-bool RedisManager::zrem(const std::string& key, const std::string& member) {
-  if (!initialized_)
+bool RedisManager::zrem(std::string_view key, std::string_view member) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("zrem");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->zrem(key, member);
+    store_->zrem(key, member);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in zrem: " << e.what();
+    call.fail();
     return false;
   }
 }
 
 std::optional<std::vector<std::string>>
-RedisManager::zrange(const std::string& key, long start, long stop) {
-  if (!initialized_)
+RedisManager::zrange(std::string_view key, long start, long stop) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("zrange");
+  BackendCall call(breaker_, latency);
+
   try {
-    std::vector<std::string> result;
-    redis_->zrange(key, start, stop, std::back_inserter(result));
-    return result;
+    return store_->zrange(key, start, stop);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in zrange: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
 std::optional<std::vector<std::pair<std::string, double>>>
-RedisManager::zrangeWithScores(const std::string& key, long start, long stop) {
-  if (!initialized_)
+RedisManager::zrangeWithScores(std::string_view key, long start, long stop) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("zrange");
+  BackendCall call(breaker_, latency);
+
   try {
-    // 1. 获取成员
-    std::vector<std::string> members;
-    redis_->zrange(key, start, stop, std::back_inserter(members));
+    return store_->zrangeWithScores(key, start, stop);
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in zrangeWithScores: " << e.what();
+    call.fail();
+    return std::nullopt;
+  }
+}
 
-    // 2. 获取每个成员的分数
-    std::vector<std::pair<std::string, double>> result;
-    for (const auto& member : members) {
-      auto score = redis_->zscore(key, member);
-      if (score) {
-        result.emplace_back(member, *score);
-      }
-    }
+std::optional<std::vector<std::string>>
+RedisManager::zrevrange(std::string_view key, long start, long stop) {
+  if (!available())
+    return std::nullopt;
 
-    return result;
+  static auto& latency = commandLatency("zrevrange");
+  BackendCall call(breaker_, latency);
+
+  try {
+    return store_->zrevrange(key, start, stop);
   } catch (const std::exception& e) {
-    LOG_ERROR << "Redis error in zrangeWithScores: " << e.what();
+    LOG_ERROR << "Redis error in zrevrange: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
+std::optional<long long> RedisManager::zrevrank(std::string_view key,
+                                                std::string_view member) {
+  if (!available())
+    return std::nullopt;
+
+  static auto& latency = commandLatency("zrevrank");
+  BackendCall call(breaker_, latency);
+
+  try {
+    return store_->zrevrank(key, member);
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in zrevrank: " << e.what();
+    call.fail();
+    return std::nullopt;
+  }
+}
+
+bool RedisManager::zremrangebyrank(std::string_view key,
+                                   long start,
+                                   long stop) {
+  if (!available())
+    return false;
+
+  static auto& latency = commandLatency("zremrangebyrank");
+  BackendCall call(breaker_, latency);
+
+  try {
+    store_->zremrangebyrank(key, start, stop);
+    return true;
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in zremrangebyrank: " << e.what();
+    call.fail();
+    return false;
+  }
+}
+
 // 发布/订阅
-bool RedisManager::publish(const std::string& channel,
-                           const std::string& message) {
-  if (!initialized_)
+bool RedisManager::publish(std::string_view channel, std::string_view message) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("publish");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->publish(channel, message);
+    store_->publish(channel, message);
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in publish: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-// 其他操作
-bool RedisManager::expire(const std::string& key, std::chrono::seconds ttl) {
+std::unique_ptr<RedisSubscription> RedisManager::subscribe(
+    RedisSubscription::Handler handler,
+    std::chrono::milliseconds pollTimeout) {
   if (!initialized_)
+    return nullptr;
+
+  try {
+    return store_->subscribe(std::move(handler), pollTimeout);
+  } catch (const std::exception& e) {
+    LOG_ERROR << "Redis error in subscribe: " << e.what();
+    return nullptr;
+  }
+}
+
+// 其他操作
+bool RedisManager::expire(std::string_view key, std::chrono::seconds ttl) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("expire");
+  BackendCall call(breaker_, latency);
+
   try {
-    return redis_->expire(key, ttl);
+    return store_->expire(key, ttl);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in expire: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-bool RedisManager::exists(const std::string& key) {
-  if (!initialized_)
+bool RedisManager::exists(std::string_view key) {
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("exists");
+  BackendCall call(breaker_, latency);
+
   try {
-    return redis_->exists(key) > 0;
+    return store_->exists(key);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in exists: " << e.what();
+    call.fail();
     return false;
   }
 }
 
 bool RedisManager::flushdb() {
-  if (!initialized_)
+  if (!available())
     return false;
 
+  static auto& latency = commandLatency("flushdb");
+  BackendCall call(breaker_, latency);
+
   try {
-    redis_->flushdb();
+    store_->flushdb();
     return true;
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in flushdb: " << e.what();
+    call.fail();
     return false;
   }
 }
 
-std::optional<long long> RedisManager::incr(const std::string& key) {
-  if (!initialized_)
+std::optional<long long> RedisManager::incr(std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("incr");
+  BackendCall call(breaker_, latency);
+
   try {
-    return redis_->incr(key);
+    return store_->incr(key);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in incr: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
-std::optional<long long> RedisManager::decr(const std::string& key) {
-  if (!initialized_)
+std::optional<long long> RedisManager::decr(std::string_view key) {
+  if (!available())
     return std::nullopt;
 
+  static auto& latency = commandLatency("decr");
+  BackendCall call(breaker_, latency);
+
   try {
-    return redis_->decr(key);
+    return store_->decr(key);
   } catch (const std::exception& e) {
     LOG_ERROR << "Redis error in decr: " << e.what();
+    call.fail();
     return std::nullopt;
   }
 }
 
-sw::redis::Redis* RedisManager::getRedis() {
-  return initialized_ ? redis_.get() : nullptr;
-}
-
 }  // namespace StarryChat
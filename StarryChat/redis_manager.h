@@ -1,16 +1,22 @@
 #pragma once
 
-#include <sw/redis++/redis++.h>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include "circuit_breaker.h"
+#include "redis_store.h"
 
 namespace StarryChat {
 
 /**
  * Redis 管理类 - 负责管理 Redis 连接和提供基本操作
+ * 命令由 RedisStore 执行：默认连接 Redis 服务，基准测试可注入内存替身。
  */
 class RedisManager {
  public:
@@ -22,72 +28,106 @@ class RedisManager {
   RedisManager& operator=(RedisManager&&) = delete;
 
   bool initialize();
+  // 使用指定的存储实现初始化，不读取 Redis 配置
+  bool initialize(std::unique_ptr<RedisStore> store);
   void shutdown();
 
   // 字符串操作
-  bool set(const std::string& key,
-           const std::string& value,
+  bool set(std::string_view key,
+           std::string_view value,
            std::chrono::seconds ttl = std::chrono::seconds(0));
-  std::optional<std::string> get(const std::string& key);
-  bool del(const std::string& key);
+  std::optional<std::string> get(std::string_view key);
+  bool del(std::string_view key);
+  // 键不存在时写入并设置过期时间（SET NX），用作跨节点的互斥；
+  // 返回是否写入，出错时返回 nullopt
+  std::optional<bool> setIfAbsent(std::string_view key,
+                                  std::string_view value,
+                                  std::chrono::seconds ttl);
 
   // 哈希表操作
-  bool hset(const std::string& key,
-            const std::string& field,
-            const std::string& value);
-  std::optional<std::string> hget(const std::string& key,
-                                  const std::string& field);
-  bool hdel(const std::string& key, const std::string& field);
+  bool hset(std::string_view key,
+            std::string_view field,
+            std::string_view value);
+  // 一条 HSET 写入多个字段，并在同一个 pipeline 中设置过期时间
+  bool hsetWithExpire(
+      std::string_view key,
+      const std::vector<std::pair<std::string, std::string>>& fields,
+      std::chrono::seconds ttl);
+  std::optional<std::string> hget(std::string_view key, std::string_view field);
+  bool hdel(std::string_view key, std::string_view field);
+  // 使用一个 pipeline 在多个哈希表上写入或删除同一个字段
+  bool hsetBatch(const std::vector<std::string>& keys,
+                 std::string_view field,
+                 std::string_view value,
+                 std::chrono::seconds ttl);
+  bool hdelBatch(const std::vector<std::string>& keys, std::string_view field);
+  // 使用一个 pipeline 在多个哈希表上各自写入多个字段，fields 与 keys 对应
+  bool hsetWithExpireBatch(const std::vector<std::string>& keys,
+                           const std::vector<RedisStore::FieldList>& fields,
+                           std::chrono::seconds ttl);
   std::optional<std::unordered_map<std::string, std::string>> hgetall(
-      const std::string& key);
+      std::string_view key);
+  // 使用一个 pipeline 批量执行 HGETALL，结果与 keys 一一对应
+  std::optional<std::vector<std::unordered_map<std::string, std::string>>>
+  hgetallBatch(const std::vector<std::string>& keys);
+  std::optional<std::vector<std::optional<std::string>>> hmget(
+      std::string_view key,
+      const std::vector<std::string>& fields);
 
   // 列表操作
-  bool lpush(const std::string& key, const std::string& value);
-  bool rpush(const std::string& key, const std::string& value);
-  std::optional<std::string> lpop(const std::string& key);
-  std::optional<std::string> rpop(const std::string& key);
-  std::optional<std::vector<std::string>> lrange(const std::string& key,
+  bool lpush(std::string_view key, std::string_view value);
+  bool rpush(std::string_view key, std::string_view value);
+  std::optional<std::string> lpop(std::string_view key);
+  std::optional<std::string> rpop(std::string_view key);
+  std::optional<std::vector<std::string>> lrange(std::string_view key,
                                                  long start,
                                                  long stop);
 
   // 集合操作
-  bool sadd(const std::string& key, const std::string& member);
-  bool srem(const std::string& key, const std::string& member);
-  std::optional<std::unordered_set<std::string>> smembers(
-      const std::string& key);
+  bool sadd(std::string_view key, std::string_view member);
+  bool sadd(std::string_view key, const std::vector<std::string>& members);
+  bool srem(std::string_view key, std::string_view member);
+  std::optional<std::unordered_set<std::string>> smembers(std::string_view key);
 
   // 有序集合操作
-  bool zadd(const std::string& key, const std::string& member, double score);
-  bool zrem(const std::string& key, const std::string& member);
-  std::optional<std::vector<std::string>> zrange(const std::string& key,
+  bool zadd(std::string_view key, std::string_view member, double score);
+  bool zrem(std::string_view key, std::string_view member);
+  std::optional<std::vector<std::string>> zrange(std::string_view key,
                                                  long start,
                                                  long stop);
   std::optional<std::vector<std::pair<std::string, double>>>
-  zrangeWithScores(const std::string& key, long start, long stop);
+  zrangeWithScores(std::string_view key, long start, long stop);
+  std::optional<std::vector<std::string>> zrevrange(std::string_view key,
+                                                    long start,
+                                                    long stop);
+  std::optional<long long> zrevrank(std::string_view key,
+                                    std::string_view member);
+  bool zremrangebyrank(std::string_view key, long start, long stop);
 
   // 发布/订阅
-  bool publish(const std::string& channel, const std::string& message);
+  bool publish(std::string_view channel, std::string_view message);
+  // 建立独立的订阅连接，失败或不支持时返回 nullptr；
+  // 订阅连接长期阻塞读取，不计入命令延迟和熔断统计
+  std::unique_ptr<RedisSubscription> subscribe(
+      RedisSubscription::Handler handler,
+      std::chrono::milliseconds pollTimeout);
 
   // 其他操作
-  bool expire(const std::string& key, std::chrono::seconds ttl);
-  bool exists(const std::string& key);
+  bool expire(std::string_view key, std::chrono::seconds ttl);
+  bool exists(std::string_view key);
   bool flushdb();
-  std::optional<long long> incr(const std::string& key);
-  std::optional<long long> decr(const std::string& key);
-
-  // 获取原始 Redis 连接对象，用于高级操作
-  sw::redis::Redis* getRedis();
+  std::optional<long long> incr(std::string_view key);
+  std::optional<long long> decr(std::string_view key);
 
  private:
   RedisManager() = default;
   ~RedisManager() = default;
 
-  // Redis++ 连接对象
-  std::unique_ptr<sw::redis::Redis> redis_;
+  // 已初始化、当前请求未超时且未熔断
+  bool available();
 
-  // 连接池配置
-  sw::redis::ConnectionOptions connectionOpts_;
-  sw::redis::ConnectionPoolOptions poolOpts_;
+  std::unique_ptr<RedisStore> store_;
+  CircuitBreaker breaker_{"redis"};
 
   // 连接池状态
   bool initialized_{false};
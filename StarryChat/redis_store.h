@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace StarryChat {
+
+/**
+ * Redis 订阅连接
+ * 独占一个连接，只能在创建它的线程上使用。consume 等待一条消息并回调
+ * handler，超过读超时没有消息时返回 false；连接出错时抛出 std::exception。
+ */
+class RedisSubscription {
+ public:
+  // pattern 为空表示通过 SUBSCRIBE 收到的消息
+  using Handler = std::function<void(std::string_view pattern,
+                                     std::string_view channel,
+                                     std::string_view message)>;
+
+  virtual ~RedisSubscription() = default;
+
+  virtual void subscribe(const std::vector<std::string>& channels) = 0;
+  virtual void unsubscribe(const std::vector<std::string>& channels) = 0;
+  virtual void psubscribe(const std::vector<std::string>& patterns) = 0;
+  virtual bool consume() = 0;
+};
+
+/**
+ * Redis 存储接口
+ * RedisManager 负责初始化检查、计时和异常处理，具体命令由实现类执行；
+ * 实现类出错时抛出 std::exception。
+ */
+class RedisStore {
+ public:
+  using FieldMap = std::unordered_map<std::string, std::string>;
+  using FieldList = std::vector<std::pair<std::string, std::string>>;
+
+  virtual ~RedisStore() = default;
+
+  // 字符串操作，ttl 为 0 表示不过期
+  virtual void set(std::string_view key,
+                   std::string_view value,
+                   std::chrono::seconds ttl) = 0;
+  virtual std::optional<std::string> get(std::string_view key) = 0;
+  virtual void del(std::string_view key) = 0;
+  // SET NX：键不存在时写入，返回是否写入
+  virtual bool setIfAbsent(std::string_view key,
+                           std::string_view value,
+                           std::chrono::seconds ttl) = 0;
+
+  // 哈希表操作
+  virtual void hset(std::string_view key,
+                    std::string_view field,
+                    std::string_view value) = 0;
+  // 多字段写入和设置过期时间作为一次往返
+  virtual void hsetWithExpire(
+      std::string_view key,
+      const std::vector<std::pair<std::string, std::string>>& fields,
+      std::chrono::seconds ttl) = 0;
+  virtual std::optional<std::string> hget(std::string_view key,
+                                          std::string_view field) = 0;
+  virtual void hdel(std::string_view key, std::string_view field) = 0;
+  // 在多个哈希表上写入或删除同一个字段，作为一次往返
+  virtual void hsetBatch(const std::vector<std::string>& keys,
+                         std::string_view field,
+                         std::string_view value,
+                         std::chrono::seconds ttl) = 0;
+  virtual void hdelBatch(const std::vector<std::string>& keys,
+                         std::string_view field) = 0;
+  // 多个哈希表各自写入多个字段并设置过期时间，作为一次往返
+  virtual void hsetWithExpireBatch(const std::vector<std::string>& keys,
+                                   const std::vector<FieldList>& fields,
+                                   std::chrono::seconds ttl) = 0;
+  virtual FieldMap hgetall(std::string_view key) = 0;
+  // 多个 HGETALL 作为一次往返
+  virtual std::vector<FieldMap> hgetallBatch(
+      const std::vector<std::string>& keys) = 0;
+  virtual std::vector<std::optional<std::string>> hmget(
+      std::string_view key,
+      const std::vector<std::string>& fields) = 0;
+
+  // 列表操作
+  virtual void lpush(std::string_view key, std::string_view value) = 0;
+  virtual void rpush(std::string_view key, std::string_view value) = 0;
+  virtual std::optional<std::string> lpop(std::string_view key) = 0;
+  virtual std::optional<std::string> rpop(std::string_view key) = 0;
+  virtual std::vector<std::string> lrange(std::string_view key,
+                                          long start,
+                                          long stop) = 0;
+
+  // 集合操作
+  virtual void sadd(std::string_view key, std::string_view member) = 0;
+  virtual void sadd(std::string_view key,
+                    const std::vector<std::string>& members) = 0;
+  virtual void srem(std::string_view key, std::string_view member) = 0;
+  virtual std::unordered_set<std::string> smembers(std::string_view key) = 0;
+
+  // 有序集合操作
+  virtual void zadd(std::string_view key,
+                    std::string_view member,
+                    double score) = 0;
+  virtual void zrem(std::string_view key, std::string_view member) = 0;
+  virtual std::vector<std::string> zrange(std::string_view key,
+                                          long start,
+                                          long stop) = 0;
+  virtual std::vector<std::pair<std::string, double>> zrangeWithScores(
+      std::string_view key,
+      long start,
+      long stop) = 0;
+  virtual std::vector<std::string> zrevrange(std::string_view key,
+                                             long start,
+                                             long stop) = 0;
+  virtual std::optional<long long> zrevrank(std::string_view key,
+                                            std::string_view member) = 0;
+  virtual void zremrangebyrank(std::string_view key, long start, long stop) = 0;
+
+  // 发布/订阅
+  virtual void publish(std::string_view channel, std::string_view message) = 0;
+  // 建立独立的订阅连接，pollTimeout 为 consume 的读超时；
+  // 不支持订阅的实现返回 nullptr
+  virtual std::unique_ptr<RedisSubscription> subscribe(
+      RedisSubscription::Handler handler,
+      std::chrono::milliseconds pollTimeout) = 0;
+
+  // 其他操作
+  virtual bool expire(std::string_view key, std::chrono::seconds ttl) = 0;
+  virtual bool exists(std::string_view key) = 0;
+  virtual void flushdb() = 0;
+  virtual long long incr(std::string_view key) = 0;
+  virtual long long decr(std::string_view key) = 0;
+};
+
+}  // namespace StarryChat
@@ -0,0 +1,36 @@
+#include "rpc_errors.h"
+
+#include <google/protobuf/descriptor.h>
+
+namespace StarryChat {
+
+void replyError(const google::protobuf::Message& prototype,
+                const starry::RpcDoneCallback& done,
+                starrychat::ErrorCode code,
+                const std::string& message) {
+  using google::protobuf::FieldDescriptor;
+
+  auto* response = prototype.New();
+  const auto* descriptor = response->GetDescriptor();
+  const auto* reflection = response->GetReflection();
+
+  const auto* success = descriptor->FindFieldByName("success");
+  if (success && success->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+    reflection->SetBool(response, success, false);
+  }
+
+  const auto* errorMessage = descriptor->FindFieldByName("error_message");
+  if (errorMessage &&
+      errorMessage->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+    reflection->SetString(response, errorMessage, message);
+  }
+
+  const auto* errorCode = descriptor->FindFieldByName("error_code");
+  if (errorCode && errorCode->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+    reflection->SetEnumValue(response, errorCode, code);
+  }
+
+  done(response);
+}
+
+}  // namespace StarryChat
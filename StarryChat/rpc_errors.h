@@ -0,0 +1,20 @@
+#pragma once
+
+#include <google/protobuf/message.h>
+#include <string>
+#include "common.pb.h"
+#include "service.h"
+
+namespace StarryChat {
+
+/**
+ * 按响应原型创建失败响应并立即应答
+ * 通过反射设置 success、error_message 和 error_code，响应中没有的字段跳过
+ * （如 UpdateStatus 返回的 UserInfo 只能得到一个空对象）。
+ */
+void replyError(const google::protobuf::Message& prototype,
+                const starry::RpcDoneCallback& done,
+                starrychat::ErrorCode code,
+                const std::string& message);
+
+}  // namespace StarryChat
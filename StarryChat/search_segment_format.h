@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+namespace StarryChat {
+
+/**
+ * 消息搜索索引段文件格式（主机字节序，小端）
+ *
+ *   char[8] "SCIDX001" | 倒排表... | 词项字符串 | 词项目录 | 文件尾
+ *
+ * 倒排表：varint count | varint 块数 | 跳表 | 各块
+ *   id 严格递增，每 kPostingsBlock 个分为一块
+ *   跳表每块一项：块首 id 与上一块首 id 之差的 varint、块的字节数 varint
+ *   块：第二个 id 起与前一个 id 之差的 varint（块首 id 在跳表中）
+ *   查询从新到旧遍历时按跳表定位块，只解码走到的块
+ * 词项字符串：所有词项首尾相接，由词项目录按偏移和长度引用
+ * 词项目录：每个 (chatType, chatId, token) 一项 TermEntry，按该三元组排序，
+ * 查询时二分查找。段文件写完后不再修改，合并时写出新文件再删除旧文件。
+ */
+namespace searchseg {
+
+constexpr char kMagic[8] = {'S', 'C', 'I', 'D', 'X', '0', '0', '1'};
+// 分词或倒排表格式变化时递增，旧段文件按损坏处理，索引从数据库重建
+constexpr uint32_t kVersion = 3;
+constexpr uint32_t kPostingsBlock = 128;
+
+struct TermEntry {
+  uint64_t chatId;
+  uint64_t postingsOffset;  // 倒排表在文件中的偏移
+  uint32_t postingsSize;    // 倒排表字节数
+  uint32_t tokenOffset;     // 在词项字符串中的偏移
+  uint16_t tokenLength;
+  uint8_t chatType;
+  uint8_t reserved[5];
+};
+static_assert(sizeof(TermEntry) == 32);
+
+struct Footer {
+  uint64_t tokensOffset;
+  uint64_t termsOffset;
+  uint64_t watermark;  // 写出时已从数据库补齐到的消息 id
+  uint32_t termCount;
+  uint32_t version;
+  char magic[8];
+};
+static_assert(sizeof(Footer) == 40);
+
+}  // namespace searchseg
+
+}  // namespace StarryChat
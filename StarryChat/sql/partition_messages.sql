@@ -0,0 +1,29 @@
+-- 将已有的 messages 表改为按月分区
+-- 执行前把 @boundary 设为下个月初（UTC），当月及以前的消息进入 p_history，
+-- 之后的月份由服务端（database.mariadb.messagePartitions）或
+-- starrychat_partitions maintain 从 p_future 拆出。
+-- 重建表会复制全部数据，应在低峰期执行。
+
+USE chatroom;
+
+SET time_zone = '+00:00';
+SET @boundary = UNIX_TIMESTAMP('2026-11-01 00:00:00');
+
+-- 分区表不支持外键
+ALTER TABLE message_mentions DROP FOREIGN KEY message_mentions_ibfk_1;
+ALTER TABLE messages DROP FOREIGN KEY messages_ibfk_1;
+ALTER TABLE messages DROP FOREIGN KEY messages_ibfk_2;
+
+-- 主键包含分区列；分区裁剪取代按时间的单列索引
+ALTER TABLE messages
+    DROP PRIMARY KEY,
+    ADD PRIMARY KEY (id, timestamp),
+    DROP INDEX idx_timestamp;
+
+SET @sql = CONCAT(
+    'ALTER TABLE messages PARTITION BY RANGE (timestamp) (',
+    'PARTITION p_history VALUES LESS THAN (', @boundary, '), ',
+    'PARTITION p_future VALUES LESS THAN MAXVALUE)');
+PREPARE stmt FROM @sql;
+EXECUTE stmt;
+DEALLOCATE PREPARE stmt;
@@ -21,6 +21,17 @@ CREATE TABLE users (
     INDEX idx_username (username)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
+-- 好友关系表（双向存储：每对好友写入两行，按 user_id 查询即得邻接表）
+CREATE TABLE friendships (
+    user_id BIGINT UNSIGNED NOT NULL,
+    friend_id BIGINT UNSIGNED NOT NULL,
+    created_time BIGINT UNSIGNED NOT NULL,
+    PRIMARY KEY (user_id, friend_id),
+    FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,
+    FOREIGN KEY (friend_id) REFERENCES users(id) ON DELETE CASCADE,
+    INDEX idx_friend_id (friend_id)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+
 -- 聊天室表
 CREATE TABLE chat_rooms (
     id BIGINT UNSIGNED AUTO_INCREMENT PRIMARY KEY,
@@ -62,9 +73,10 @@ CREATE TABLE chat_room_members (
     INDEX idx_user_id (user_id)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
--- 消息表
+-- 消息表（按 timestamp 按月 RANGE 分区，分区由服务端或 starrychat_partitions 维护）
+-- 分区表不支持外键，主键必须包含分区列
 CREATE TABLE messages (
-    id BIGINT UNSIGNED AUTO_INCREMENT PRIMARY KEY,
+    id BIGINT UNSIGNED AUTO_INCREMENT,
     sender_id BIGINT UNSIGNED NOT NULL,
     chat_type TINYINT UNSIGNED NOT NULL,
     chat_id BIGINT UNSIGNED NOT NULL,
@@ -74,19 +86,19 @@ CREATE TABLE messages (
     timestamp BIGINT UNSIGNED NOT NULL,
     status TINYINT UNSIGNED DEFAULT 1,
     reply_to_id BIGINT UNSIGNED DEFAULT NULL,
-    FOREIGN KEY (sender_id) REFERENCES users(id),
-    FOREIGN KEY (reply_to_id) REFERENCES messages(id) ON DELETE SET NULL,
+    PRIMARY KEY (id, timestamp),
     INDEX idx_chat (chat_type, chat_id, timestamp),
-    INDEX idx_sender (sender_id),
-    INDEX idx_timestamp (timestamp)
-) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
+    INDEX idx_sender (sender_id)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4
+PARTITION BY RANGE (timestamp) (
+    PARTITION p_future VALUES LESS THAN MAXVALUE
+);
 
 -- 消息@提及表
 CREATE TABLE message_mentions (
     message_id BIGINT UNSIGNED NOT NULL,
     user_id BIGINT UNSIGNED NOT NULL,
     PRIMARY KEY (message_id, user_id),
-    FOREIGN KEY (message_id) REFERENCES messages(id) ON DELETE CASCADE,
     FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
@@ -103,6 +115,7 @@ CREATE TABLE sessions (
 
 -- 添加表注释
 ALTER TABLE users COMMENT '用户表';
+ALTER TABLE friendships COMMENT '好友关系表';
 ALTER TABLE chat_rooms COMMENT '聊天室表';
 ALTER TABLE chat_room_members COMMENT '聊天室成员表';
 ALTER TABLE private_chats COMMENT '私聊表';
@@ -0,0 +1,222 @@
+// 二进制日志离线解码工具
+// 用法: starrychat_logdecode <file>...
+// 按时间顺序传入同一进程的全部日志文件，格式定义可能位于较早的文件中。
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "binary_log_format.h"
+
+namespace {
+
+using namespace StarryChat;
+
+const char* kLevelNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+struct Format {
+  std::string file;
+  uint32_t line;
+  std::string fmt;
+};
+
+class Reader {
+ public:
+  explicit Reader(const std::string& data) : data_(data) {}
+
+  bool eof() const { return pos_ >= data_.size(); }
+
+  template <typename T>
+  bool read(T& value) {
+    if (data_.size() - pos_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_.data() + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return true;
+  }
+
+  bool readBytes(size_t len, std::string& out) {
+    if (data_.size() - pos_ < len) {
+      return false;
+    }
+    out.assign(data_, pos_, len);
+    pos_ += len;
+    return true;
+  }
+
+  size_t position() const { return pos_; }
+
+ private:
+  const std::string& data_;
+  size_t pos_{0};
+};
+
+bool readArg(Reader& reader, std::string& out) {
+  uint8_t tag;
+  if (!reader.read(tag)) {
+    return false;
+  }
+
+  switch (tag) {
+    case binlog::kArgInt: {
+      int64_t v;
+      if (!reader.read(v))
+        return false;
+      out = std::to_string(v);
+      return true;
+    }
+    case binlog::kArgUInt: {
+      uint64_t v;
+      if (!reader.read(v))
+        return false;
+      out = std::to_string(v);
+      return true;
+    }
+    case binlog::kArgDouble: {
+      double v;
+      if (!reader.read(v))
+        return false;
+      out = std::to_string(v);
+      return true;
+    }
+    case binlog::kArgBool: {
+      uint8_t v;
+      if (!reader.read(v))
+        return false;
+      out = v ? "true" : "false";
+      return true;
+    }
+    case binlog::kArgString: {
+      uint32_t len;
+      return reader.read(len) && reader.readBytes(len, out);
+    }
+    default:
+      return false;
+  }
+}
+
+std::string formatTime(int64_t micros) {
+  time_t seconds = static_cast<time_t>(micros / 1000000);
+  struct tm tm;
+  gmtime_r(&seconds, &tm);
+
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%04d%02d%02d %02d:%02d:%02d.%06d",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                tm.tm_min, tm.tm_sec, static_cast<int>(micros % 1000000));
+  return buf;
+}
+
+std::string substitute(const std::string& fmt,
+                       const std::vector<std::string>& args) {
+  std::string out;
+  size_t argIndex = 0;
+  for (size_t i = 0; i < fmt.size(); ++i) {
+    if (fmt[i] == '{' && i + 1 < fmt.size() && fmt[i + 1] == '}' &&
+        argIndex < args.size()) {
+      out += args[argIndex++];
+      ++i;
+    } else {
+      out += fmt[i];
+    }
+  }
+  return out;
+}
+
+// 解码单个文件，返回是否完整解码
+bool decodeFile(const std::string& path,
+                std::unordered_map<uint32_t, Format>& formats) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+
+  Reader reader(data);
+  while (!reader.eof()) {
+    size_t recordStart = reader.position();
+    uint8_t type;
+    reader.read(type);
+
+    if (type == binlog::kFormatRecord) {
+      uint32_t formatId;
+      Format format;
+      uint16_t fileLen, fmtLen;
+      if (!reader.read(formatId) || !reader.read(format.line) ||
+          !reader.read(fileLen) || !reader.readBytes(fileLen, format.file) ||
+          !reader.read(fmtLen) || !reader.readBytes(fmtLen, format.fmt)) {
+        std::cerr << path << ": truncated format record at " << recordStart
+                  << std::endl;
+        return false;
+      }
+      formats[formatId] = std::move(format);
+    } else if (type == binlog::kEventRecord) {
+      uint32_t formatId;
+      int64_t micros;
+      uint8_t level, argc;
+      if (!reader.read(formatId) || !reader.read(micros) ||
+          !reader.read(level) || !reader.read(argc)) {
+        std::cerr << path << ": truncated event record at " << recordStart
+                  << std::endl;
+        return false;
+      }
+
+      std::vector<std::string> args(argc);
+      for (auto& arg : args) {
+        if (!readArg(reader, arg)) {
+          std::cerr << path << ": bad argument in record at " << recordStart
+                    << std::endl;
+          return false;
+        }
+      }
+
+      const char* levelName =
+          level < std::size(kLevelNames) ? kLevelNames[level] : "UNKNOWN";
+      auto it = formats.find(formatId);
+      if (it == formats.end()) {
+        std::cout << formatTime(micros) << " " << levelName
+                  << " <unknown format " << formatId << ">";
+        for (const auto& arg : args) {
+          std::cout << " " << arg;
+        }
+        std::cout << "\n";
+        continue;
+      }
+
+      const auto& format = it->second;
+      std::cout << formatTime(micros) << " " << levelName << " "
+                << substitute(format.fmt, args) << " - " << format.file << ":"
+                << format.line << "\n";
+    } else {
+      std::cerr << path << ": unknown record type at " << recordStart
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <binary log file>..." << std::endl;
+    return 1;
+  }
+
+  std::unordered_map<uint32_t, Format> formats;
+  bool ok = true;
+  for (int i = 1; i < argc; ++i) {
+    ok = decodeFile(argv[i], formats) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// 消息缓存压缩字典训练工具
+// 用法: starrychat_dicttrain <output> <samples>... [--size bytes]
+// 样本文件由若干条 varint 长度前缀的 starrychat::Message 序列化数据组成
+// （即 SerializeDelimitedToOstream 的输出），应取自线上真实消息。
+
+#include <zdict.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 与 MessageCacheCodec 的压缩阈值一致，过短的消息不会被压缩，不参与训练
+constexpr size_t kMinSampleSize = 128;
+constexpr size_t kDefaultDictSize = 64 * 1024;
+
+bool readVarint(const std::string& data, size_t& pos, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+    auto byte = static_cast<uint8_t>(data[pos++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool loadSamples(const std::string& path,
+                 std::string& buffer,
+                 std::vector<size_t>& sizes) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  size_t pos = 0;
+  while (pos < data.size()) {
+    uint64_t length = 0;
+    if (!readVarint(data, pos, length) || length > data.size() - pos) {
+      std::cerr << path << ": truncated sample at offset " << pos
+                << std::endl;
+      return false;
+    }
+    if (length >= kMinSampleSize) {
+      buffer.append(data, pos, length);
+      sizes.push_back(length);
+    }
+    pos += length;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <output> <samples>... [--size bytes]" << std::endl;
+    return 1;
+  }
+
+  std::string output = argv[1];
+  size_t dictSize = kDefaultDictSize;
+  std::string samples;
+  std::vector<size_t> sampleSizes;
+
+  for (int i = 2; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      dictSize = std::strtoull(argv[++i], nullptr, 10);
+      continue;
+    }
+    if (!loadSamples(argv[i], samples, sampleSizes)) {
+      return 1;
+    }
+  }
+
+  if (sampleSizes.empty()) {
+    std::cerr << "No samples of at least " << kMinSampleSize << " bytes"
+              << std::endl;
+    return 1;
+  }
+
+  std::string dictionary(dictSize, '\0');
+  size_t result = ZDICT_trainFromBuffer(
+      dictionary.data(), dictionary.size(), samples.data(), sampleSizes.data(),
+      static_cast<unsigned>(sampleSizes.size()));
+  if (ZDICT_isError(result)) {
+    std::cerr << "Training failed: " << ZDICT_getErrorName(result)
+              << std::endl;
+    return 1;
+  }
+  dictionary.resize(result);
+
+  std::ofstream out(output, std::ios::binary | std::ios::trunc);
+  out.write(dictionary.data(), static_cast<std::streamsize>(dictionary.size()));
+  if (!out) {
+    std::cerr << "Cannot write " << output << std::endl;
+    return 1;
+  }
+
+  std::cout << "Trained " << dictionary.size() << " byte dictionary (id "
+            << ZDICT_getDictID(dictionary.data(), dictionary.size())
+            << ") from " << sampleSizes.size() << " samples" << std::endl;
+  return 0;
+}
@@ -0,0 +1,106 @@
+// messages 表分区维护工具
+// 用法: starrychat_partitions <config.yaml> list
+//       starrychat_partitions <config.yaml> maintain
+//       starrychat_partitions <config.yaml> archive|segment|drop <分区名>
+// maintain 与服务端的定时维护相同：建好未来的月份，按保留期清理旧分区。
+// archive 把分区交换到 messages_archive_<分区名> 后删除，segment 把分区
+// 导出为 segmentDirectory 中的冷历史段文件后删除，drop 直接删除。
+
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include "config.h"
+#include "db_manager.h"
+#include "message_partitions.h"
+
+namespace {
+
+using namespace StarryChat;
+
+std::string formatMonth(uint64_t timestamp) {
+  std::time_t time = static_cast<std::time_t>(timestamp);
+  std::tm tm{};
+  gmtime_r(&time, &tm);
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d", &tm);
+  return buffer;
+}
+
+int list() {
+  auto partitions = MessagePartitions::getInstance().list();
+  if (!partitions) {
+    return 1;
+  }
+  if (partitions->empty()) {
+    std::cout << "messages is not partitioned" << std::endl;
+    return 0;
+  }
+
+  for (const auto& partition : *partitions) {
+    std::cout << partition.name << "\t< "
+              << (partition.lessThan ? formatMonth(*partition.lessThan)
+                                     : std::string("MAXVALUE"))
+              << "\t~" << partition.rows << " rows" << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <config.yaml> list|maintain|archive <partition>|"
+                 "segment <partition>|drop <partition>"
+              << std::endl;
+    return 1;
+  }
+
+  auto& config = Config::getInstance();
+  if (!config.loadConfig(argv[1])) {
+    std::cerr << "Failed to load " << argv[1] << std::endl;
+    return 1;
+  }
+  if (!DBManager::getInstance().initialize()) {
+    std::cerr << "Failed to connect to database" << std::endl;
+    return 1;
+  }
+
+  MessagePartitionOptions options;
+  options.enabled = true;
+  options.monthsAhead = config.getMessagePartitionsMonthsAhead();
+  options.retentionMonths = config.getMessagePartitionsRetentionMonths();
+  options.archive = config.getMessagePartitionsArchive();
+  options.segmentDirectory = config.getMessagePartitionsSegmentDirectory();
+  auto& partitions = MessagePartitions::getInstance();
+  partitions.configure(options);
+
+  std::string command = argv[2];
+  int result = 1;
+  if (command == "list") {
+    result = list();
+  } else if (command == "maintain") {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    result = partitions.maintain(static_cast<uint64_t>(now)) ? 0 : 1;
+  } else if ((command == "archive" || command == "segment" ||
+              command == "drop") &&
+             argc >= 4) {
+    bool ok;
+    if (command == "archive") {
+      ok = partitions.archive(argv[3]);
+    } else if (command == "segment") {
+      ok = partitions.exportSegment(argv[3]);
+    } else {
+      ok = partitions.drop(argv[3]);
+    }
+    result = ok ? 0 : 1;
+  } else {
+    std::cerr << "Unknown command: " << command << std::endl;
+  }
+
+  DBManager::getInstance().shutdown();
+  return result;
+}
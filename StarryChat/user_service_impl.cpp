@@ -1,16 +1,103 @@
 #include "user_service_impl.h"
 
+#include <algorithm>
 #include <chrono>
+#include <google/protobuf/util/field_mask_util.h>
 #include <mariadb/conncpp.hpp>
 #include <random>
 #include <sstream>
+#include <unordered_set>
+#include "admission_control.h"
+#include "circuit_breaker.h"
 #include "db_manager.h"
+#include "deadline.h"
+#include "friend_cache.h"
+#include "log_control.h"
 #include "logging.h"
+#include "metrics.h"
+#include "login_rate_limiter.h"
+#include "push_registry.h"
+#include "redis_keys.h"
 #include "redis_manager.h"
 #include "user.h"
+#include "username_filter.h"
 
 namespace StarryChat {
 
+namespace {
+
+constexpr LogModule kLogModule = LogModule::kUser;
+
+// GetUsers 单次请求的最大用户数
+constexpr int kMaxBatchUsers = 500;
+
+// 从数据库结果创建用户对象
+User userFromResultSet(sql::ResultSet& rs) {
+  User user(rs.getUInt64("id"), std::string(rs.getString("username")));
+  user.setNickname(std::string(rs.getString("nickname")));
+  user.setEmail(std::string(rs.getString("email")));
+  user.setStatus(static_cast<starrychat::UserStatus>(rs.getInt("status")));
+
+  if (!rs.isNull("avatar_url")) {
+    user.setAvatarUrl(std::string(rs.getString("avatar_url")));
+  }
+
+  if (!rs.isNull("last_login_time")) {
+    user.setLastLoginTime(rs.getUInt64("last_login_time"));
+  }
+
+  return user;
+}
+
+// 从缓存哈希字段创建用户对象，缺少用户名视为未命中
+std::optional<User> userFromCacheFields(
+    uint64_t userId,
+    const std::unordered_map<std::string, std::string>& fields) {
+  auto username = fields.find("username");
+  if (username == fields.end()) {
+    return std::nullopt;
+  }
+
+  User user(userId, username->second);
+
+  if (auto it = fields.find("nickname"); it != fields.end())
+    user.setNickname(it->second);
+
+  if (auto it = fields.find("email"); it != fields.end())
+    user.setEmail(it->second);
+
+  if (auto it = fields.find("avatar_url"); it != fields.end())
+    user.setAvatarUrl(it->second);
+
+  if (auto it = fields.find("status"); it != fields.end())
+    user.setStatus(static_cast<starrychat::UserStatus>(std::stoi(it->second)));
+
+  if (auto it = fields.find("last_login_time"); it != fields.end())
+    user.setLastLoginTime(std::stoull(it->second));
+
+  return user;
+}
+
+// 用户信息缓存哈希的字段
+RedisStore::FieldList userCacheFields(const User& user) {
+  RedisStore::FieldList fields{
+      {"username", user.getUsername()},
+      {"nickname", user.getNickname()},
+      {"email", user.getEmail()},
+      {"status", std::to_string(static_cast<int>(user.getStatus()))},
+      {"created_time", std::to_string(user.getCreatedTime())},
+      {"last_login_time", std::to_string(user.getLastLoginTime())},
+  };
+
+  // 可选字段
+  if (!user.getAvatarUrl().empty()) {
+    fields.emplace_back("avatar_url", user.getAvatarUrl());
+  }
+  return fields;
+}
+
+}  // namespace
+
 std::shared_ptr<sql::Connection> UserServiceImpl::getConnection() {
   return DBManager::getInstance().getConnection();
 }
@@ -19,10 +106,20 @@ std::shared_ptr<sql::Connection> UserServiceImpl::getConnection() {
 void UserServiceImpl::RegisterUser(
     const starrychat::RegisterUserRequestPtr& request,
     const starrychat::RegisterUserResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
-  LOG_INFO << "RegisterUser called with username: [" << request->username()
-           << "], length: " << request->username().length() << ", email: ["
-           << request->email() << "]";
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "RegisterUser");
+  static RpcAdmission admission("UserService", "RegisterUser",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
+  MLOG_DEBUG(kLogModule) << "RegisterUser called with username: ["
+                         << request->username() << "], length: "
+                         << request->username().length() << ", email: ["
+                         << request->email() << "]";
 
   // 确保用户名不为空
   if (request->username().empty()) {
@@ -37,14 +134,22 @@ void UserServiceImpl::RegisterUser(
 
   try {
     auto& redis = RedisManager::getInstance();
+    auto& filter = UsernameFilter::getInstance();
+
+    // 过滤器判定用户名一定不存在时，跳过 Redis 和数据库的重复检查
+    // 并发注册同名用户由 username 唯一索引兜底
+    bool mightExist = filter.mightContain(request->username());
 
     // 快速检查用户名是否已存在 (Redis)
-    auto existingId = redis.hget("username:to:id", request->username());
-    if (existingId) {
-      response->set_success(false);
-      response->set_error_message("Username already exists");
-      done(response);
-      return;
+    if (mightExist) {
+      auto existingId =
+          redis.hget(RedisKeys::kUsernameToId, request->username());
+      if (existingId) {
+        response->set_success(false);
+        response->set_error_message("Username already exists");
+        done(response);
+        return;
+      }
     }
 
     auto conn = getConnection();
@@ -56,16 +161,17 @@ void UserServiceImpl::RegisterUser(
     }
 
     // 再次检查用户名是否存在 (数据库)
-    std::unique_ptr<sql::PreparedStatement> checkStmt(
-        conn->prepareStatement("SELECT 1 FROM users WHERE username = ?"));
-    checkStmt->setString(1, request->username());
+    if (mightExist) {
+      TimedStatement checkStmt(conn, "SELECT 1 FROM users WHERE username = ?");
+      checkStmt->setString(1, request->username());
 
-    std::unique_ptr<sql::ResultSet> checkRs(checkStmt->executeQuery());
-    if (checkRs->next()) {
-      response->set_success(false);
-      response->set_error_message("Username already exists");
-      done(response);
-      return;
+      std::unique_ptr<sql::ResultSet> checkRs(checkStmt.executeQuery());
+      if (checkRs->next()) {
+        response->set_success(false);
+        response->set_error_message("Username already exists");
+        done(response);
+        return;
+      }
     }
 
     // 创建用户对象处理密码
@@ -79,11 +185,11 @@ void UserServiceImpl::RegisterUser(
     uint64_t currentTime = std::time(nullptr);
 
     // 插入新用户
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("INSERT INTO users (username, nickname, email, "
-                               "status, created_time, password_hash, salt) "
-                               "VALUES (?, ?, ?, ?, ?, ?, ?)",
-                               sql::Statement::RETURN_GENERATED_KEYS));
+    TimedStatement stmt(conn,
+                        "INSERT INTO users (username, nickname, email, "
+                        "status, created_time, password_hash, salt) "
+                        "VALUES (?, ?, ?, ?, ?, ?, ?)",
+                        sql::Statement::RETURN_GENERATED_KEYS);
 
     stmt->setString(1, user.getUsername());
     stmt->setString(2, user.getNickname());
@@ -93,9 +199,9 @@ void UserServiceImpl::RegisterUser(
     stmt->setString(6, user.getPasswordHash());
     stmt->setString(7, user.getSalt());
 
-    int result = stmt->executeUpdate();
-    LOG_INFO << "SQL execution result: "
-             << (result > 0 ? "success" : "failure");
+    int result = stmt.executeUpdate();
+    MLOG_DEBUG(kLogModule) << "SQL execution result: "
+                           << (result > 0 ? "success" : "failure");
 
     if (result > 0) {
       // 获取新用户ID
@@ -104,6 +210,10 @@ void UserServiceImpl::RegisterUser(
         uint64_t userId = rs->getUInt64(1);
         user.setId(userId);
 
+        // 加入用户名过滤器，并通知其他节点
+        filter.add(user.getUsername());
+        redis.publish(RedisKeys::kUserRegisteredChannel, user.getUsername());
+
         // 缓存用户信息
         cacheUserInfo(user);
 
@@ -111,9 +221,9 @@ void UserServiceImpl::RegisterUser(
         response->set_success(true);
         *response->mutable_user_info() = user.toProto();
 
-        LOG_INFO << "User registered - ID: " << user.getId()
-                 << ", Username: " << user.getUsername()
-                 << ", Nickname: " << user.getNickname();
+        MLOG_INFO(kLogModule) << "User registered - ID: " << user.getId()
+                              << ", Username: " << user.getUsername()
+                              << ", Nickname: " << user.getNickname();
       } else {
         response->set_success(false);
         response->set_error_message("Failed to get new user ID");
@@ -123,9 +233,20 @@ void UserServiceImpl::RegisterUser(
       response->set_error_message("Failed to insert user");
     }
   } catch (sql::SQLException& e) {
-    LOG_ERROR << "RegisterUser SQL error: " << e.what();
+    DBManager::reportError(e);
     response->set_success(false);
-    response->set_error_message("Database error");
+    if (e.getErrorCode() == 1062) {
+      // ER_DUP_ENTRY：跳过预检查时由唯一索引发现重名
+      UsernameFilter::getInstance().add(request->username());
+      response->set_error_message("Username already exists");
+    } else {
+      LOG_ERROR << "RegisterUser SQL error: " << e.what();
+      response->set_error_message("Database error");
+    }
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "RegisterUser error: " << e.what();
     response->set_success(false);
@@ -138,9 +259,18 @@ void UserServiceImpl::RegisterUser(
 // 用户登录
 void UserServiceImpl::Login(const starrychat::LoginRequestPtr& request,
                             const starrychat::LoginResponse* responsePrototype,
-                            const starry::RpcDoneCallback& done) {
-  LOG_INFO << "Login called with username: [" << request->username()
-           << "], length: " << request->username().length();
+                            const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "Login");
+  static RpcAdmission admission("UserService", "Login", RpcPriority::kCritical);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
+  MLOG_DEBUG(kLogModule) << "Login called with username: ["
+                         << request->username() << "], length: "
+                         << request->username().length();
 
   // 确保用户名不为空
   if (request->username().empty()) {
@@ -153,84 +283,69 @@ void UserServiceImpl::Login(const starrychat::LoginRequestPtr& request,
 
   auto response = responsePrototype->New();
 
+  // 限流检查，拒绝的请求不访问数据库也不计算密码哈希
+  auto& limiter = LoginRateLimiter::getInstance();
+  if (!limiter.allowAttempt(request->username(), request->client_address())) {
+    response->set_success(false);
+    response->set_error_message("Too many login attempts, try again later");
+    done(response);
+    return;
+  }
+
+  // 过滤器判定用户名一定不存在时直接返回，不访问 Redis 和数据库
+  if (!UsernameFilter::getInstance().mightContain(request->username())) {
+    limiter.recordFailure(request->username(), request->client_address(), 0);
+    response->set_success(false);
+    response->set_error_message("User not found");
+    done(response);
+    return;
+  }
+
   try {
     auto& redis = RedisManager::getInstance();
 
     // 从Redis缓存尝试获取用户ID
-    auto cachedUserId = redis.hget("username:to:id", request->username());
+    auto cachedUserId =
+        redis.hget(RedisKeys::kUsernameToId, request->username());
     uint64_t userId = 0;
 
     if (cachedUserId) {
       userId = std::stoull(*cachedUserId);
-      LOG_INFO << "Found cached user ID mapping: " << request->username()
-               << " -> " << userId;
+      MLOG_DEBUG(kLogModule) << "Found cached user ID mapping: "
+                             << request->username() << " -> " << userId;
     }
 
-    // 从数据库查询用户（主要是为了验证密码）
-    auto conn = getConnection();
-    if (!conn) {
-      response->set_success(false);
-      response->set_error_message("Database connection failed");
+    // 客户端已超时，不再查询数据库和计算密码哈希
+    if (deadline.expired()) {
+      setDeadlineExceeded(response);
       done(response);
       return;
     }
 
-    // 查询语句，如果已知用户ID，按ID查询效率更高
-    std::unique_ptr<sql::PreparedStatement> stmt;
-    if (userId > 0) {
-      stmt.reset(conn->prepareStatement("SELECT * FROM users WHERE id = ?"));
-      stmt->setUInt64(1, userId);
-    } else {
-      stmt.reset(
-          conn->prepareStatement("SELECT * FROM users WHERE username = ?"));
-      stmt->setString(1, request->username());
-    }
-
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
-    if (!rs->next()) {
+    // 从数据库查询用户（主要是为了验证密码）
+    // 如果已知用户ID，按ID查询效率更高
+    auto& store = DBManager::getInstance().store();
+    auto found = userId > 0 ? store.findUserById(userId)
+                            : store.findUserByUsername(request->username());
+    if (!found) {
+      limiter.recordFailure(request->username(), request->client_address(), 0);
       response->set_success(false);
       response->set_error_message("User not found");
       done(response);
       return;
     }
 
-    // 获取用户信息
-    userId = rs->getUInt64("id");
-    User user(userId, std::string(rs->getString("username")));
-
-    // 设置其他用户字段
-    user.setNickname(std::string(rs->getString("nickname")));
-    user.setEmail(std::string(rs->getString("email")));
-    user.setStatus(static_cast<starrychat::UserStatus>(rs->getInt("status")));
-
-    if (!rs->isNull("avatar_url")) {
-      user.setAvatarUrl(std::string(rs->getString("avatar_url")));
-    }
-
-    if (!rs->isNull("created_time")) {
-      // 注意：这里不应该覆盖用户ID
-      // user.setId(rs->getUInt64("created_time")); // 这行是错的，已删除
-    }
-
-    if (!rs->isNull("last_login_time")) {
-      user.setLastLoginTime(rs->getUInt64("last_login_time"));
-    }
-
-    // 获取密码验证信息
-    std::string passwordHash = std::string(rs->getString("password_hash"));
-    std::string salt = std::string(rs->getString("salt"));
-    user.setPasswordHashAndSalt(passwordHash, salt);
+    User& user = *found;
+    userId = user.getId();
 
     // 验证密码
     if (!user.verifyPassword(request->password())) {
       response->set_success(false);
       response->set_error_message("Invalid password");
 
-      // 增加登录尝试次数
-      std::unique_ptr<sql::PreparedStatement> updateStmt(conn->prepareStatement(
-          "UPDATE users SET login_attempts = login_attempts + 1 WHERE id = ?"));
-      updateStmt->setUInt64(1, userId);
-      updateStmt->executeUpdate();
+      // 记录失败，登录尝试次数由限流器批量回写数据库
+      limiter.recordFailure(request->username(), request->client_address(),
+                            userId);
 
       done(response);
       return;
@@ -238,13 +353,8 @@ void UserServiceImpl::Login(const starrychat::LoginRequestPtr& request,
 
     // 登录成功，更新用户状态和登录时间
     uint64_t currentTime = std::time(nullptr);
-    std::unique_ptr<sql::PreparedStatement> updateStmt(
-        conn->prepareStatement("UPDATE users SET status = ?, last_login_time = "
-                               "?, login_attempts = 0 WHERE id = ?"));
-    updateStmt->setInt(1, static_cast<int>(starrychat::USER_STATUS_ONLINE));
-    updateStmt->setUInt64(2, currentTime);
-    updateStmt->setUInt64(3, userId);
-    updateStmt->executeUpdate();
+    store.recordLogin(userId, currentTime);
+    limiter.recordSuccess(request->username(), userId);
 
     // 更新用户对象
     user.setStatus(starrychat::USER_STATUS_ONLINE);
@@ -256,11 +366,14 @@ void UserServiceImpl::Login(const starrychat::LoginRequestPtr& request,
     // 存储会话
     storeSession(sessionToken, userId);
 
+    // 为会话建立推送邮箱，订阅之前到达的消息会被保留
+    PushRegistry::getInstance().attach(userId, sessionToken);
+
     // 更新用户状态
     updateUserStatusInCache(userId, starrychat::USER_STATUS_ONLINE);
 
     // 设置心跳
-    redis.set("user:heartbeat:" + std::to_string(userId), "1",
+    redis.set(RedisKeys::userHeartbeat(userId), "1",
               std::chrono::minutes(5));
 
     // 缓存用户信息
@@ -270,19 +383,24 @@ void UserServiceImpl::Login(const starrychat::LoginRequestPtr& request,
     std::string notification =
         std::to_string(userId) + ":" +
         std::to_string(static_cast<int>(starrychat::USER_STATUS_ONLINE));
-    redis.publish("user:status:changed", notification);
+    redis.publish(RedisKeys::kUserStatusChangedChannel, notification);
 
-    LOG_INFO << "User logged in successfully: " << user.getUsername()
-             << " (ID: " << userId << ")";
+    MLOG_INFO(kLogModule) << "User logged in successfully: "
+                          << user.getUsername() << " (ID: " << userId << ")";
 
     // 设置登录响应
     response->set_success(true);
     response->set_session_token(sessionToken);
     *response->mutable_user_info() = user.toProto();
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "Login SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "Login error: " << e.what();
     response->set_success(false);
@@ -296,7 +414,15 @@ void UserServiceImpl::Login(const starrychat::LoginRequestPtr& request,
 void UserServiceImpl::GetUser(
     const starrychat::GetUserRequestPtr& request,
     const starrychat::GetUserResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "GetUser");
+  static RpcAdmission admission("UserService", "GetUser", RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -304,7 +430,8 @@ void UserServiceImpl::GetUser(
     auto cachedUser = getUserFromCache(request->user_id());
 
     if (cachedUser) {
-      LOG_INFO << "User cache hit for user ID: " << request->user_id();
+      MLOG_DEBUG(kLogModule) << "User cache hit for user ID: "
+                             << request->user_id();
 
       // 设置响应
       response->set_success(true);
@@ -314,7 +441,8 @@ void UserServiceImpl::GetUser(
       return;  // 直接返回，无需查询数据库
     }
 
-    LOG_INFO << "User cache miss for user ID: " << request->user_id();
+    MLOG_DEBUG(kLogModule) << "User cache miss for user ID: "
+                           << request->user_id();
 
     // 缓存未命中，从数据库获取
     auto conn = getConnection();
@@ -326,33 +454,17 @@ void UserServiceImpl::GetUser(
     }
 
     // 查询用户
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement("SELECT * FROM users WHERE id = ?"));
+    TimedStatement stmt(conn, "SELECT * FROM users WHERE id = ?");
     stmt->setUInt64(1, request->user_id());
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     if (rs->next()) {
       // 从数据库结果创建用户对象
-      User user(rs->getUInt64("id"), std::string(rs->getString("username")));
-      user.setNickname(std::string(rs->getString("nickname")));
-      user.setEmail(std::string(rs->getString("email")));
-      user.setStatus(static_cast<starrychat::UserStatus>(rs->getInt("status")));
-
-      if (!rs->isNull("avatar_url")) {
-        user.setAvatarUrl(std::string(rs->getString("avatar_url")));
-      }
+      User user = userFromResultSet(*rs);
 
-      // if (!rs->isNull("created_time")) {
-      //   user.setCreatedTime(rs->getUInt64("created_time"));
-      // }
-
-      if (!rs->isNull("last_login_time")) {
-        user.setLastLoginTime(rs->getUInt64("last_login_time"));
-      }
-
-      LOG_INFO << "Loaded user from DB - ID: " << user.getId()
-               << ", Username: " << user.getUsername()
-               << ", Nickname: " << user.getNickname();
+      MLOG_DEBUG(kLogModule) << "Loaded user from DB - ID: " << user.getId()
+                             << ", Username: " << user.getUsername()
+                             << ", Nickname: " << user.getNickname();
 
       // 设置响应
       response->set_success(true);
@@ -363,12 +475,17 @@ void UserServiceImpl::GetUser(
     } else {
       response->set_success(false);
       response->set_error_message("User not found");
-      LOG_WARN << "User not found with ID: " << request->user_id();
+      MLOG_WARN(kLogModule) << "User not found with ID: " << request->user_id();
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "GetUser SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "GetUser error: " << e.what();
     response->set_success(false);
@@ -378,11 +495,167 @@ void UserServiceImpl::GetUser(
   done(response);
 }
 
+// 批量获取用户信息
+void UserServiceImpl::GetUsers(
+    const starrychat::GetUsersRequestPtr& request,
+    const starrychat::GetUsersResponse* responsePrototype,
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "GetUsers");
+  static RpcAdmission admission("UserService", "GetUsers", RpcPriority::kBulk);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
+  auto response = responsePrototype->New();
+
+  if (request->user_ids_size() > kMaxBatchUsers) {
+    response->set_success(false);
+    response->set_error_message("Too many user IDs (max " +
+                                std::to_string(kMaxBatchUsers) + ")");
+    done(response);
+    return;
+  }
+
+  // 拼错的路径会被 TrimMessage 忽略并返回空字段，直接拒绝
+  if (!google::protobuf::util::FieldMaskUtil::IsValidFieldMask<
+          starrychat::UserInfo>(request->field_mask())) {
+    response->set_success(false);
+    response->set_error_message("Invalid field mask");
+    done(response);
+    return;
+  }
+
+  try {
+    // 去重并保持请求顺序
+    std::vector<uint64_t> ids;
+    ids.reserve(request->user_ids_size());
+    std::unordered_set<uint64_t> seen;
+    for (uint64_t userId : request->user_ids()) {
+      if (userId > 0 && seen.insert(userId).second) {
+        ids.push_back(userId);
+      }
+    }
+
+    // 1. 一个 pipeline 批量读取缓存
+    std::vector<std::string> keys;
+    keys.reserve(ids.size());
+    for (uint64_t userId : ids) {
+      keys.push_back(RedisKeys::user(userId).str());
+    }
+
+    std::unordered_map<uint64_t, User> users;
+    std::vector<uint64_t> misses;
+    auto cached = RedisManager::getInstance().hgetallBatch(keys);
+    for (size_t i = 0; i < ids.size(); ++i) {
+      std::optional<User> user;
+      if (cached) {
+        user = userFromCacheFields(ids[i], (*cached)[i]);
+      }
+
+      if (user) {
+        users.emplace(ids[i], std::move(*user));
+      } else {
+        misses.push_back(ids[i]);
+      }
+    }
+
+    // 2. 未命中的用户一次 IN 查询回源并回填缓存
+    if (!misses.empty()) {
+      // 客户端已超时，不再回源
+      if (deadline.expired()) {
+        setDeadlineExceeded(response);
+        done(response);
+        return;
+      }
+
+      auto conn = getConnection();
+      if (!conn) {
+        response->set_success(false);
+        response->set_error_message("Database connection failed");
+        done(response);
+        return;
+      }
+
+      std::string query = "SELECT * FROM users WHERE id IN (";
+      for (size_t i = 0; i < misses.size(); ++i) {
+        query += (i == 0 ? "?" : ", ?");
+      }
+      query += ")";
+
+      TimedStatement stmt(conn, query);
+      for (size_t i = 0; i < misses.size(); ++i) {
+        stmt->setUInt64(static_cast<int32_t>(i + 1), misses[i]);
+      }
+
+      std::vector<User> loaded;
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+      while (rs->next()) {
+        loaded.push_back(userFromResultSet(*rs));
+      }
+
+      cacheUserInfos(loaded);
+      for (auto& user : loaded) {
+        users.emplace(user.getId(), std::move(user));
+      }
+    }
+
+    // 3. 按请求顺序输出，并按字段掩码裁剪
+    google::protobuf::FieldMask mask = request->field_mask();
+    if (mask.paths_size() > 0) {
+      mask.add_paths("id");
+    }
+
+    for (uint64_t userId : ids) {
+      auto it = users.find(userId);
+      if (it == users.end()) {
+        continue;
+      }
+
+      auto* userInfo = response->add_users();
+      *userInfo = it->second.toProto();
+      if (mask.paths_size() > 0) {
+        google::protobuf::util::FieldMaskUtil::TrimMessage(mask, userInfo);
+      }
+    }
+
+    response->set_success(true);
+    MLOG_DEBUG(kLogModule) << "GetUsers returned " << response->users_size()
+                           << " of " << ids.size() << " users, cache misses: "
+                           << misses.size();
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "GetUsers SQL error: " << e.what();
+    response->set_success(false);
+    response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
+  } catch (std::exception& e) {
+    LOG_ERROR << "GetUsers error: " << e.what();
+    response->set_success(false);
+    response->set_error_message("Internal error");
+  }
+
+  done(response);
+}
+
 // 更新用户资料
 void UserServiceImpl::UpdateProfile(
     const starrychat::UpdateProfileRequestPtr& request,
     const starrychat::UpdateProfileResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "UpdateProfile");
+  static RpcAdmission admission("UserService", "UpdateProfile",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -427,8 +700,7 @@ void UserServiceImpl::UpdateProfile(
 
     updateQuery += " WHERE id = ?";
 
-    std::unique_ptr<sql::PreparedStatement> stmt(
-        conn->prepareStatement(updateQuery));
+    TimedStatement stmt(conn, updateQuery);
     int paramIndex = 1;
 
     if (!request->nickname().empty()) {
@@ -445,13 +717,12 @@ void UserServiceImpl::UpdateProfile(
 
     stmt->setUInt64(paramIndex, request->user_id());
 
-    if (stmt->executeUpdate() > 0) {
+    if (stmt.executeUpdate() > 0) {
       // 查询更新后的用户信息
-      std::unique_ptr<sql::PreparedStatement> selectStmt(
-          conn->prepareStatement("SELECT * FROM users WHERE id = ?"));
+      TimedStatement selectStmt(conn, "SELECT * FROM users WHERE id = ?");
       selectStmt->setUInt64(1, request->user_id());
 
-      std::unique_ptr<sql::ResultSet> rs(selectStmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(selectStmt.executeQuery());
       if (rs->next()) {
         User user(rs->getUInt64("id"), std::string(rs->getString("username")));
         user.setNickname(std::string(rs->getString("nickname")));
@@ -476,12 +747,14 @@ void UserServiceImpl::UpdateProfile(
 
         // 发布更新通知
         auto& redis = RedisManager::getInstance();
-        redis.publish("user:profile:updated", std::to_string(user.getId()));
+        redis.publish(RedisKeys::kUserProfileUpdatedChannel,
+                      std::to_string(user.getId()));
 
         response->set_success(true);
         *response->mutable_user_info() = user.toProto();
 
-        LOG_INFO << "Updated profile for user ID: " << user.getId();
+        MLOG_INFO(kLogModule) << "Updated profile for user ID: "
+                              << user.getId();
       } else {
         response->set_success(false);
         response->set_error_message("User not found after update");
@@ -491,9 +764,14 @@ void UserServiceImpl::UpdateProfile(
       response->set_error_message("Update failed");
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "UpdateProfile SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "UpdateProfile error: " << e.what();
     response->set_success(false);
@@ -507,35 +785,50 @@ void UserServiceImpl::UpdateProfile(
 void UserServiceImpl::GetFriends(
     const starrychat::GetFriendsRequestPtr& request,
     const starrychat::GetFriendsResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "GetFriends");
+  static RpcAdmission admission("UserService", "GetFriends",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
     auto& redis = RedisManager::getInstance();
 
-    // 从缓存尝试获取好友列表
-    std::string friendsKey =
-        "user:friends:" + std::to_string(request->user_id());
-    auto cachedFriends = redis.get(friendsKey);
-
-    if (cachedFriends) {
-      // 尝试解析缓存的好友列表
-      try {
-        starrychat::GetFriendsResponse cachedResponse;
-        if (cachedResponse.ParseFromString(*cachedFriends)) {
-          *response = cachedResponse;
-          done(response);
-          return;
-        }
-      } catch (...) {
-        // 解析错误，继续获取新数据
-        LOG_WARN << "Failed to parse cached friends list for user "
-                 << request->user_id();
-      }
+    // 获取好友ID列表（进程内缓存 -> Redis -> 数据库）
+    auto friendIds =
+        FriendCache::getInstance().getFriendIds(request->user_id());
+    if (!friendIds) {
+      response->set_success(false);
+      response->set_error_message("Failed to load friends");
+      done(response);
+      return;
     }
 
-    // 从数据库获取好友列表
-    auto conn = getConnection();
+    // 好友ID升序排列，按游标二分定位本页
+    const auto& ids = **friendIds;
+    int limit = request->limit() > 0 ? std::min(request->limit(), 500) : 100;
+    auto begin = std::upper_bound(ids.begin(), ids.end(), request->cursor());
+    auto end = begin + std::min<std::ptrdiff_t>(limit, ids.end() - begin);
+    std::vector<uint64_t> page(begin, end);
+
+    response->set_success(true);
+    response->set_total_count(static_cast<uint32_t>(ids.size()));
+    response->set_has_more(end != ids.end());
+    response->set_next_cursor(page.empty() ? request->cursor() : page.back());
+
+    if (page.empty()) {
+      done(response);
+      return;
+    }
+
+    auto conn = DBManager::getInstance().getConnection(DBAccess::kReadOnly,
+                                                       request->user_id());
     if (!conn) {
       response->set_success(false);
       response->set_error_message("Database connection failed");
@@ -543,43 +836,66 @@ void UserServiceImpl::GetFriends(
       return;
     }
 
-    // 简单实现：返回所有其他用户作为"好友"
-    // 实际应用中需要好友关系表
-    std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(
-        "SELECT id, nickname, status FROM users WHERE id != ? LIMIT 100"));
-    stmt->setUInt64(1, request->user_id());
+    // 一次查询获取本页好友的昵称和状态
+    std::string query = "SELECT id, nickname, status FROM users WHERE id IN (";
+    for (size_t i = 0; i < page.size(); ++i) {
+      query += (i == 0 ? "?" : ", ?");
+    }
+    query += ")";
 
-    std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+    TimedStatement stmt(conn, query);
+    for (size_t i = 0; i < page.size(); ++i) {
+      stmt->setUInt64(static_cast<int32_t>(i + 1), page[i]);
+    }
 
-    response->set_success(true);
+    std::unordered_map<uint64_t, starrychat::UserBrief> briefs;
+    std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
     while (rs->next()) {
-      auto* friend_info = response->add_friends();
-      friend_info->set_id(rs->getUInt64("id"));
-      friend_info->set_nickname(rs->getString("nickname"));
-      friend_info->set_status(
+      starrychat::UserBrief brief;
+      brief.set_id(rs->getUInt64("id"));
+      brief.set_nickname(std::string(rs->getString("nickname")));
+      brief.set_status(
           static_cast<starrychat::UserStatus>(rs->getInt("status")));
+      briefs.emplace(brief.id(), std::move(brief));
+    }
 
-      // 从Redis获取实时状态
-      auto statusStr =
-          redis.hget("user:status", std::to_string(friend_info->id()));
-      if (statusStr) {
-        friend_info->set_status(
-            static_cast<starrychat::UserStatus>(std::stoi(*statusStr)));
-      }
+    // 一次 HMGET 获取本页好友的实时状态
+    std::vector<std::string> fields;
+    fields.reserve(page.size());
+    for (uint64_t friendId : page) {
+      fields.push_back(std::to_string(friendId));
     }
+    auto statuses = redis.hmget(RedisKeys::kUserStatus, fields);
+
+    // 按好友ID顺序输出
+    for (size_t i = 0; i < page.size(); ++i) {
+      auto it = briefs.find(page[i]);
+      if (it == briefs.end()) {
+        continue;
+      }
+
+      auto* friendInfo = response->add_friends();
+      *friendInfo = std::move(it->second);
 
-    // 缓存好友列表（短期缓存）
-    std::string serialized;
-    if (response->SerializeToString(&serialized)) {
-      redis.set(friendsKey, serialized, std::chrono::minutes(5));
+      if (statuses && (*statuses)[i]) {
+        friendInfo->set_status(
+            static_cast<starrychat::UserStatus>(std::stoi(*(*statuses)[i])));
+      }
     }
 
-    LOG_INFO << "Retrieved friends list for user " << request->user_id()
-             << ", count: " << response->friends_size();
+    MLOG_DEBUG(kLogModule) << "Retrieved friends list for user "
+                           << request->user_id() << ", count: "
+                           << response->friends_size() << ", total: "
+                           << ids.size();
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "GetFriends SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "GetFriends error: " << e.what();
     response->set_success(false);
@@ -589,11 +905,181 @@ void UserServiceImpl::GetFriends(
   done(response);
 }
 
+// 添加好友
+void UserServiceImpl::AddFriend(
+    const starrychat::AddFriendRequestPtr& request,
+    const starrychat::AddFriendResponse* responsePrototype,
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "AddFriend");
+  static RpcAdmission admission("UserService", "AddFriend",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
+  auto response = responsePrototype->New();
+
+  try {
+    // 验证会话
+    if (!validateSession(request->session_token(), request->user_id())) {
+      response->set_success(false);
+      response->set_error_message("Invalid session");
+      done(response);
+      return;
+    }
+
+    uint64_t userId = request->user_id();
+    uint64_t friendId = request->friend_id();
+    if (friendId == 0 || friendId == userId) {
+      response->set_success(false);
+      response->set_error_message("Invalid friend ID");
+      done(response);
+      return;
+    }
+
+    // 双向写入好友关系
+    bool friendExists = false;
+    bool result = DBManager::getInstance().executeTransaction(
+        [&](std::shared_ptr<sql::Connection> conn) {
+          TimedStatement checkStmt(conn, "SELECT 1 FROM users WHERE id = ?");
+          checkStmt->setUInt64(1, friendId);
+          std::unique_ptr<sql::ResultSet> checkRs(checkStmt.executeQuery());
+          friendExists = checkRs->next();
+          if (!friendExists) {
+            return false;
+          }
+
+          uint64_t currentTime = std::time(nullptr);
+          TimedStatement stmt(conn,
+                              "INSERT IGNORE INTO friendships (user_id, "
+                              "friend_id, created_time) "
+                              "VALUES (?, ?, ?), (?, ?, ?)");
+          stmt->setUInt64(1, userId);
+          stmt->setUInt64(2, friendId);
+          stmt->setUInt64(3, currentTime);
+          stmt->setUInt64(4, friendId);
+          stmt->setUInt64(5, userId);
+          stmt->setUInt64(6, currentTime);
+          DBManager::getInstance().noteWrite(userId);
+          DBManager::getInstance().noteWrite(friendId);
+          stmt.executeUpdate();
+          return true;
+        });
+
+    if (result) {
+      auto& friendCache = FriendCache::getInstance();
+      friendCache.invalidate(userId);
+      friendCache.invalidate(friendId);
+
+      response->set_success(true);
+      MLOG_INFO(kLogModule) << "User " << userId << " added friend "
+                            << friendId;
+    } else {
+      response->set_success(false);
+      response->set_error_message(friendExists ? "Failed to add friend"
+                                               : "User not found");
+    }
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
+  } catch (std::exception& e) {
+    LOG_ERROR << "AddFriend error: " << e.what();
+    response->set_success(false);
+    response->set_error_message("Internal error");
+  }
+
+  done(response);
+}
+
+// 删除好友
+void UserServiceImpl::RemoveFriend(
+    const starrychat::RemoveFriendRequestPtr& request,
+    const starrychat::RemoveFriendResponse* responsePrototype,
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "RemoveFriend");
+  static RpcAdmission admission("UserService", "RemoveFriend",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
+  auto response = responsePrototype->New();
+
+  try {
+    // 验证会话
+    if (!validateSession(request->session_token(), request->user_id())) {
+      response->set_success(false);
+      response->set_error_message("Invalid session");
+      done(response);
+      return;
+    }
+
+    auto conn = getConnection();
+    if (!conn) {
+      response->set_success(false);
+      response->set_error_message("Database connection failed");
+      done(response);
+      return;
+    }
+
+    uint64_t userId = request->user_id();
+    uint64_t friendId = request->friend_id();
+
+    TimedStatement stmt(conn,
+                        "DELETE FROM friendships WHERE (user_id = ? AND "
+                        "friend_id = ?) OR (user_id = ? AND friend_id = ?)");
+    stmt->setUInt64(1, userId);
+    stmt->setUInt64(2, friendId);
+    stmt->setUInt64(3, friendId);
+    stmt->setUInt64(4, userId);
+    DBManager::getInstance().noteWrite(userId);
+    DBManager::getInstance().noteWrite(friendId);
+    stmt.executeUpdate();
+
+    auto& friendCache = FriendCache::getInstance();
+    friendCache.invalidate(userId);
+    friendCache.invalidate(friendId);
+
+    response->set_success(true);
+    MLOG_INFO(kLogModule) << "User " << userId << " removed friend "
+                          << friendId;
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "RemoveFriend SQL error: " << e.what();
+    response->set_success(false);
+    response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
+  } catch (std::exception& e) {
+    LOG_ERROR << "RemoveFriend error: " << e.what();
+    response->set_success(false);
+    response->set_error_message("Internal error");
+  }
+
+  done(response);
+}
+
 // 用户注销
 void UserServiceImpl::Logout(
     const starrychat::LogoutRequestPtr& request,
     const starrychat::LogoutResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "Logout");
+  static RpcAdmission admission("UserService", "Logout",
+                                 RpcPriority::kCritical);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -607,35 +1093,40 @@ void UserServiceImpl::Logout(
 
     uint64_t userId = request->user_id();
 
-    // 移除会话
+    // 移除会话，挂起的推送订阅随之结束
     removeSession(request->session_token());
+    PushRegistry::getInstance().detach(request->session_token());
 
     // 更新用户状态为离线
     updateUserStatusInCache(userId, starrychat::USER_STATUS_OFFLINE);
 
     // 从在线用户集合中移除
     auto& redis = RedisManager::getInstance();
-    redis.srem("users:online", std::to_string(userId));
+    redis.srem(RedisKeys::kUsersOnline, std::to_string(userId));
 
     // 清除心跳检测
-    redis.del("user:heartbeat:" + std::to_string(userId));
+    redis.del(RedisKeys::userHeartbeat(userId));
 
     // 更新数据库状态
     auto conn = getConnection();
     if (conn) {
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("UPDATE users SET status = ? WHERE id = ?"));
+      TimedStatement stmt(conn, "UPDATE users SET status = ? WHERE id = ?");
       stmt->setInt(1, static_cast<int>(starrychat::USER_STATUS_OFFLINE));
       stmt->setUInt64(2, userId);
-      stmt->executeUpdate();
+      stmt.executeUpdate();
     }
 
     response->set_success(true);
-    LOG_INFO << "User logged out: " << userId;
+    MLOG_INFO(kLogModule) << "User logged out: " << userId;
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "Logout SQL error: " << e.what();
     response->set_success(false);
     response->set_error_message("Database error");
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "Logout error: " << e.what();
     response->set_success(false);
@@ -649,7 +1140,16 @@ void UserServiceImpl::Logout(
 void UserServiceImpl::UpdateStatus(
     const starrychat::UserStatusUpdatePtr& request,
     const starrychat::UserInfo* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "UpdateStatus");
+  static RpcAdmission admission("UserService", "UpdateStatus",
+                                 RpcPriority::kNormal);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -657,8 +1157,8 @@ void UserServiceImpl::UpdateStatus(
     uint64_t userId = request->user_id();
     starrychat::UserStatus newStatus = request->status();
 
-    LOG_INFO << "Updating status for user " << userId << " to "
-             << static_cast<int>(newStatus);
+    MLOG_DEBUG(kLogModule) << "Updating status for user " << userId << " to "
+                           << static_cast<int>(newStatus);
 
     // 更新Redis中的用户状态
     updateUserStatusInCache(userId, newStatus);
@@ -668,45 +1168,45 @@ void UserServiceImpl::UpdateStatus(
         newStatus == starrychat::USER_STATUS_BUSY ||
         newStatus == starrychat::USER_STATUS_AWAY) {
       // 用户处于某种在线状态
-      redis.sadd("users:online", std::to_string(userId));
+      redis.sadd(RedisKeys::kUsersOnline, std::to_string(userId));
 
       // 设置或更新心跳，5分钟过期
-      redis.set("user:heartbeat:" + std::to_string(userId), "1",
+      redis.set(RedisKeys::userHeartbeat(userId), "1",
                 std::chrono::minutes(5));
 
-      LOG_INFO << "User " << userId
-               << " added to online users set with heartbeat";
+      MLOG_DEBUG(kLogModule) << "User " << userId
+                             << " added to online users set with heartbeat";
     } else if (newStatus == starrychat::USER_STATUS_OFFLINE) {
       // 用户离线，从在线集合移除
-      redis.srem("users:online", std::to_string(userId));
+      redis.srem(RedisKeys::kUsersOnline, std::to_string(userId));
 
       // 移除心跳检测
-      redis.del("user:heartbeat:" + std::to_string(userId));
+      redis.del(RedisKeys::userHeartbeat(userId));
 
-      LOG_INFO << "User " << userId << " removed from online users set";
+      MLOG_DEBUG(kLogModule) << "User " << userId
+                             << " removed from online users set";
     }
 
     // 发布状态变更通知
     std::string notification = std::to_string(userId) + ":" +
                                std::to_string(static_cast<int>(newStatus));
-    redis.publish("user:status:changed", notification);
-    LOG_INFO << "Published status change notification: " << notification;
+    redis.publish(RedisKeys::kUserStatusChangedChannel, notification);
+    MLOG_DEBUG(kLogModule) << "Published status change notification: "
+                           << notification;
 
     // 更新数据库（保持数据一致性）
     auto conn = getConnection();
     if (conn) {
-      std::unique_ptr<sql::PreparedStatement> stmt(
-          conn->prepareStatement("UPDATE users SET status = ? WHERE id = ?"));
+      TimedStatement stmt(conn, "UPDATE users SET status = ? WHERE id = ?");
       stmt->setInt(1, static_cast<int>(newStatus));
       stmt->setUInt64(2, userId);
-      stmt->executeUpdate();
+      stmt.executeUpdate();
 
       // 查询完整的用户信息
-      std::unique_ptr<sql::PreparedStatement> selectStmt(
-          conn->prepareStatement("SELECT * FROM users WHERE id = ?"));
+      TimedStatement selectStmt(conn, "SELECT * FROM users WHERE id = ?");
       selectStmt->setUInt64(1, userId);
 
-      std::unique_ptr<sql::ResultSet> rs(selectStmt->executeQuery());
+      std::unique_ptr<sql::ResultSet> rs(selectStmt.executeQuery());
       if (rs->next()) {
         User user(rs->getUInt64("id"), std::string(rs->getString("username")));
         user.setNickname(std::string(rs->getString("nickname")));
@@ -729,11 +1229,17 @@ void UserServiceImpl::UpdateStatus(
         cacheUserInfo(user);
 
         *response = user.toProto();
-        LOG_INFO << "User status updated successfully for user " << userId;
+        MLOG_DEBUG(kLogModule) << "User status updated successfully for user "
+                               << userId;
       }
     }
   } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
     LOG_ERROR << "UpdateStatus SQL error: " << e.what();
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "UpdateStatus error: " << e.what();
   }
@@ -745,7 +1251,16 @@ void UserServiceImpl::UpdateStatus(
 void UserServiceImpl::UpdateHeartbeat(
     const starrychat::UserHeartbeatRequestPtr& request,
     const starrychat::HeartbeatResponse* responsePrototype,
-    const starry::RpcDoneCallback& done) {
+    const starry::RpcDoneCallback& rawDone) {
+  static RpcMethodMetrics metrics("UserService", "UpdateHeartbeat");
+  static RpcAdmission admission("UserService", "UpdateHeartbeat",
+                                 RpcPriority::kCritical);
+  auto done = admission.admit(*responsePrototype, metrics.wrap(rawDone));
+  if (!done) {
+    return;
+  }
+  RequestDeadline deadline(*request);
+
   auto response = responsePrototype->New();
 
   try {
@@ -755,14 +1270,15 @@ void UserServiceImpl::UpdateHeartbeat(
       uint64_t userId = request->user_id();
 
       // 更新心跳，设置5分钟过期
-      redis.set("user:heartbeat:" + std::to_string(userId), "1",
+      redis.set(RedisKeys::userHeartbeat(userId), "1",
                 std::chrono::minutes(5));
 
       // 确保用户在在线集合中
-      redis.sadd("users:online", std::to_string(userId));
+      redis.sadd(RedisKeys::kUsersOnline, std::to_string(userId));
 
       // 获取当前用户状态
-      auto statusStr = redis.hget("user:status", std::to_string(userId));
+      auto statusStr =
+          redis.hget(RedisKeys::kUserStatus, std::to_string(userId));
       starrychat::UserStatus currentStatus = starrychat::USER_STATUS_OFFLINE;
 
       if (statusStr) {
@@ -775,17 +1291,21 @@ void UserServiceImpl::UpdateHeartbeat(
         // 更新为在线状态
         updateUserStatusInCache(userId, starrychat::USER_STATUS_ONLINE);
 
-        LOG_INFO << "User " << userId
-                 << " status updated to ONLINE via heartbeat";
+        MLOG_DEBUG(kLogModule) << "User " << userId
+                               << " status updated to ONLINE via heartbeat";
       }
 
       response->set_success(true);
-      LOG_INFO << "Updated heartbeat for user " << userId;
+      MLOG_DEBUG(kLogModule) << "Updated heartbeat for user " << userId;
     } else {
       response->set_success(false);
-      LOG_WARN << "Invalid session in heartbeat update for user "
-               << request->user_id();
+      MLOG_WARN(kLogModule) << "Invalid session in heartbeat update for user "
+                            << request->user_id();
     }
+  } catch (BackendUnavailable&) {
+    setUnavailable(response);
+  } catch (DeadlineExceeded&) {
+    setDeadlineExceeded(response);
   } catch (std::exception& e) {
     LOG_ERROR << "UpdateHeartbeat error: " << e.what();
     response->set_success(false);
@@ -823,37 +1343,38 @@ bool UserServiceImpl::validateSession(const std::string& token,
   auto& redis = RedisManager::getInstance();
 
   // 检查会话token是否存在
-  auto sessionUserId = redis.get("session:" + token);
+  auto sessionUserId = redis.get(RedisKeys::session(token));
   if (!sessionUserId) {
-    LOG_WARN << "Session token not found for user " << userId;
+    MLOG_WARN(kLogModule) << "Session token not found for user " << userId;
     return false;
   }
 
   // 验证用户ID是否匹配
   if (std::stoull(*sessionUserId) != userId) {
-    LOG_WARN << "Session token user ID mismatch for user " << userId;
+    MLOG_WARN(kLogModule) << "Session token user ID mismatch for user "
+                          << userId;
     return false;
   }
 
   // 检查这是否是用户的当前会话
-  auto currentToken = redis.get("user:session:" + std::to_string(userId));
+  auto currentToken = redis.get(RedisKeys::userSession(userId));
   if (!currentToken || *currentToken != token) {
     // 这是一个旧会话
-    LOG_WARN << "Session token is old/invalid for user " << userId;
+    MLOG_WARN(kLogModule) << "Session token is old/invalid for user " << userId;
     return false;
   }
 
   // 刷新会话和心跳时间
-  redis.expire("session:" + token, std::chrono::hours(24));
-  redis.expire("user:session:" + std::to_string(userId),
+  redis.expire(RedisKeys::session(token), std::chrono::hours(24));
+  redis.expire(RedisKeys::userSession(userId),
                std::chrono::hours(24));
 
   // 更新心跳
-  redis.set("user:heartbeat:" + std::to_string(userId), "1",
+  redis.set(RedisKeys::userHeartbeat(userId), "1",
             std::chrono::minutes(5));
 
   // 确保用户在在线集合中
-  redis.sadd("users:online", std::to_string(userId));
+  redis.sadd(RedisKeys::kUsersOnline, std::to_string(userId));
 
   return true;
 }
@@ -863,14 +1384,15 @@ void UserServiceImpl::storeSession(const std::string& token, uint64_t userId) {
   auto& redis = RedisManager::getInstance();
 
   // 存储会话令牌，24小时过期
-  redis.set("session:" + token, std::to_string(userId), std::chrono::hours(24));
+  redis.set(RedisKeys::session(token), std::to_string(userId),
+            std::chrono::hours(24));
 
   // 移除旧会话（如果存在）
-  std::string userSessionKey = "user:session:" + std::to_string(userId);
+  auto userSessionKey = RedisKeys::userSession(userId);
   auto oldToken = redis.get(userSessionKey);
   if (oldToken) {
     // 删除旧会话
-    redis.del("session:" + *oldToken);
+    redis.del(RedisKeys::session(*oldToken));
   }
 
   // 记录用户当前会话
@@ -882,16 +1404,16 @@ void UserServiceImpl::removeSession(const std::string& token) {
   auto& redis = RedisManager::getInstance();
 
   // 获取用户ID
-  auto userIdStr = redis.get("session:" + token);
+  auto userIdStr = redis.get(RedisKeys::session(token));
   if (userIdStr) {
     // 移除用户会话记录
-    redis.del("user:session:" + *userIdStr);
+    redis.del(RedisKeys::userSession(*userIdStr));
   }
 
   // 移除会话令牌
-  redis.del("session:" + token);
+  redis.del(RedisKeys::session(token));
 
-  LOG_INFO << "Removed session: " << token;
+  MLOG_DEBUG(kLogModule) << "Removed session: " << token;
 }
 
 // 更新用户在线状态
@@ -903,36 +1425,41 @@ void UserServiceImpl::updateUserOnlineStatus(uint64_t userId,
 // 缓存用户信息
 void UserServiceImpl::cacheUserInfo(const User& user) {
   auto& redis = RedisManager::getInstance();
-  std::string userKey = "user:" + std::to_string(user.getId());
-
-  // 缓存基本信息
-  redis.hset(userKey, "username", user.getUsername());
-  redis.hset(userKey, "nickname", user.getNickname());
-  redis.hset(userKey, "email", user.getEmail());
-
-  // 可选字段
-  if (!user.getAvatarUrl().empty()) {
-    redis.hset(userKey, "avatar_url", user.getAvatarUrl());
-  }
+  auto userKey = RedisKeys::user(user.getId());
 
-  // 状态信息
-  redis.hset(userKey, "status",
-             std::to_string(static_cast<int>(user.getStatus())));
-
-  // 时间相关字段
-  redis.hset(userKey, "created_time", std::to_string(user.getCreatedTime()));
-  redis.hset(userKey, "last_login_time",
-             std::to_string(user.getLastLoginTime()));
+  // 一次写入全部字段并设置缓存过期时间
+  redis.hsetWithExpire(userKey, userCacheFields(user), std::chrono::hours(24));
 
   // 用户名到ID映射
-  redis.hset("username:to:id", user.getUsername(),
+  redis.hset(RedisKeys::kUsernameToId, user.getUsername(),
              std::to_string(user.getId()));
 
-  // 设置缓存过期时间
-  redis.expire(userKey, std::chrono::hours(24));
+  MLOG_DEBUG(kLogModule) << "Cached user information for " << user.getUsername()
+                         << " (ID: " << user.getId() << ")";
+}
+
+// 批量缓存用户信息：用户哈希表一个 pipeline，用户名映射一次写入
+void UserServiceImpl::cacheUserInfos(const std::vector<User>& users) {
+  if (users.empty()) {
+    return;
+  }
 
-  LOG_INFO << "Cached user information for " << user.getUsername()
-           << " (ID: " << user.getId() << ")";
+  std::vector<std::string> keys;
+  std::vector<RedisStore::FieldList> fields;
+  RedisStore::FieldList usernames;
+  keys.reserve(users.size());
+  fields.reserve(users.size());
+  usernames.reserve(users.size());
+  for (const auto& user : users) {
+    keys.push_back(RedisKeys::user(user.getId()).str());
+    fields.push_back(userCacheFields(user));
+    usernames.emplace_back(user.getUsername(), std::to_string(user.getId()));
+  }
+
+  auto& redis = RedisManager::getInstance();
+  redis.hsetWithExpireBatch(keys, fields, std::chrono::hours(24));
+  redis.hsetWithExpire(RedisKeys::kUsernameToId, usernames,
+                       std::chrono::seconds(0));
 }
 
 // 从缓存获取用户信息
@@ -940,40 +1467,20 @@ std::optional<User> UserServiceImpl::getUserFromCache(uint64_t userId) {
   auto& redis = RedisManager::getInstance();
 
   // 尝试从Redis缓存获取用户信息
-  std::string userKey = "user:" + std::to_string(userId);
+  auto userKey = RedisKeys::user(userId);
   auto userData = redis.hgetall(userKey);
 
-  if (userData && !userData->empty() &&
-      userData->find("username") != userData->end()) {
-    // 从缓存构建用户对象
-    User user(userId, (*userData)["username"]);
-
-    if (userData->find("nickname") != userData->end())
-      user.setNickname((*userData)["nickname"]);
-
-    if (userData->find("email") != userData->end())
-      user.setEmail((*userData)["email"]);
-
-    if (userData->find("avatar_url") != userData->end())
-      user.setAvatarUrl((*userData)["avatar_url"]);
-
-    if (userData->find("status") != userData->end())
-      user.setStatus(static_cast<starrychat::UserStatus>(
-          std::stoi((*userData)["status"])));
-
-    // if (userData->find("created_time") != userData->end())
-    // user.setCreatedTime(std::stoull((*userData)["created_time"]));
-
-    if (userData->find("last_login_time") != userData->end())
-      user.setLastLoginTime(std::stoull((*userData)["last_login_time"]));
+  if (!userData) {
+    return std::nullopt;
+  }
 
+  auto user = userFromCacheFields(userId, *userData);
+  if (user) {
     // 刷新缓存过期时间
     redis.expire(userKey, std::chrono::hours(24));
-
-    return user;
   }
 
-  return std::nullopt;
+  return user;
 }
 
 // 使缓存中的用户信息失效
@@ -984,13 +1491,13 @@ void UserServiceImpl::invalidateUserCache(uint64_t userId) {
   auto user = getUserFromCache(userId);
   if (user) {
     // 移除用户名到ID映射
-    redis.hdel("username:to:id", user->getUsername());
+    redis.hdel(RedisKeys::kUsernameToId, user->getUsername());
   }
 
   // 删除用户缓存
-  redis.del("user:" + std::to_string(userId));
+  redis.del(RedisKeys::user(userId));
 
-  LOG_INFO << "Invalidated cache for user ID: " << userId;
+  MLOG_DEBUG(kLogModule) << "Invalidated cache for user ID: " << userId;
 }
 
 // 更新缓存中的用户状态
@@ -999,24 +1506,24 @@ void UserServiceImpl::updateUserStatusInCache(uint64_t userId,
   auto& redis = RedisManager::getInstance();
 
   // 更新用户状态哈希表
-  redis.hset("user:status", std::to_string(userId),
+  redis.hset(RedisKeys::kUserStatus, std::to_string(userId),
              std::to_string(static_cast<int>(status)));
 
   // 更新用户信息缓存中的状态
-  std::string userKey = "user:" + std::to_string(userId);
+  auto userKey = RedisKeys::user(userId);
   redis.hset(userKey, "status", std::to_string(static_cast<int>(status)));
 
   // 管理在线用户集合
   if (status == starrychat::USER_STATUS_ONLINE ||
       status == starrychat::USER_STATUS_BUSY ||
       status == starrychat::USER_STATUS_AWAY) {
-    redis.sadd("users:online", std::to_string(userId));
+    redis.sadd(RedisKeys::kUsersOnline, std::to_string(userId));
   } else {
-    redis.srem("users:online", std::to_string(userId));
+    redis.srem(RedisKeys::kUsersOnline, std::to_string(userId));
   }
 
-  LOG_INFO << "Updated status in cache for user " << userId << " to "
-           << static_cast<int>(status);
+  MLOG_DEBUG(kLogModule) << "Updated status in cache for user " << userId
+                         << " to " << static_cast<int>(status);
 }
 
 }  // namespace StarryChat
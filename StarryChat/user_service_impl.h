@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include "service.h"
 #include "user.pb.h"
 #include "user.h"
@@ -30,6 +31,10 @@ class UserServiceImpl : public starrychat::UserService {
                const starrychat::GetUserResponse* responsePrototype,
                const starry::RpcDoneCallback& done) override;
 
+  void GetUsers(const starrychat::GetUsersRequestPtr& request,
+                const starrychat::GetUsersResponse* responsePrototype,
+                const starry::RpcDoneCallback& done) override;
+
   void UpdateProfile(const starrychat::UpdateProfileRequestPtr& request,
                      const starrychat::UpdateProfileResponse* responsePrototype,
                      const starry::RpcDoneCallback& done) override;
@@ -38,6 +43,14 @@ class UserServiceImpl : public starrychat::UserService {
                   const starrychat::GetFriendsResponse* responsePrototype,
                   const starry::RpcDoneCallback& done) override;
 
+  void AddFriend(const starrychat::AddFriendRequestPtr& request,
+                 const starrychat::AddFriendResponse* responsePrototype,
+                 const starry::RpcDoneCallback& done) override;
+
+  void RemoveFriend(const starrychat::RemoveFriendRequestPtr& request,
+                    const starrychat::RemoveFriendResponse* responsePrototype,
+                    const starry::RpcDoneCallback& done) override;
+
   void Logout(const starrychat::LogoutRequestPtr& request,
               const starrychat::LogoutResponse* responsePrototype,
               const starry::RpcDoneCallback& done) override;
@@ -66,6 +79,7 @@ class UserServiceImpl : public starrychat::UserService {
 
   // Redis缓存相关方法
   void cacheUserInfo(const User& user);
+  void cacheUserInfos(const std::vector<User>& users);
   std::optional<User> getUserFromCache(uint64_t userId);
   void invalidateUserCache(uint64_t userId);
   void updateUserStatusInCache(uint64_t userId, starrychat::UserStatus status);
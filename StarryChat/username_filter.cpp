@@ -0,0 +1,209 @@
+#include "username_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mariadb/conncpp.hpp>
+#include <stdexcept>
+#include "config.h"
+#include "db_manager.h"
+#include "logging.h"
+
+namespace StarryChat {
+
+// BloomFilter 实现
+
+BloomFilter::BloomFilter(size_t expectedItems, double falsePositiveRate) {
+  expectedItems = std::max<size_t>(expectedItems, 1);
+  falsePositiveRate = std::clamp(falsePositiveRate, 1e-6, 0.5);
+
+  // m = -n * ln(p) / (ln2)^2, k = m / n * ln2
+  double ln2 = std::log(2.0);
+  double bits = -static_cast<double>(expectedItems) *
+                std::log(falsePositiveRate) / (ln2 * ln2);
+  bitCount_ = std::max<size_t>(64, static_cast<size_t>(std::ceil(bits)));
+  hashCount_ = std::max<size_t>(
+      1, static_cast<size_t>(std::round(bits / expectedItems * ln2)));
+
+  words_ = std::vector<std::atomic<uint64_t>>((bitCount_ + 63) / 64);
+  bitCount_ = words_.size() * 64;
+}
+
+void BloomFilter::hashPair(const std::string& key, uint64_t& h1, uint64_t& h2) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char ch : key) {
+    hash ^= ch;
+    hash *= 1099511628211ULL;
+  }
+  h1 = hash;
+
+  // splitmix64 派生第二个哈希，保证为奇数
+  uint64_t z = hash + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  h2 = (z ^ (z >> 31)) | 1;
+}
+
+void BloomFilter::add(const std::string& key) {
+  uint64_t h1, h2;
+  hashPair(key, h1, h2);
+
+  for (size_t i = 0; i < hashCount_; ++i) {
+    size_t bit = (h1 + i * h2) % bitCount_;
+    words_[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+  }
+}
+
+bool BloomFilter::mightContain(const std::string& key) const {
+  uint64_t h1, h2;
+  hashPair(key, h1, h2);
+
+  for (size_t i = 0; i < hashCount_; ++i) {
+    size_t bit = (h1 + i * h2) % bitCount_;
+    if (!(words_[bit / 64].load(std::memory_order_relaxed) &
+          (1ULL << (bit % 64)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// UsernameFilter 实现
+
+UsernameFilter& UsernameFilter::getInstance() {
+  static UsernameFilter instance;
+  return instance;
+}
+
+bool UsernameFilter::rebuild() {
+  auto& config = Config::getInstance();
+
+  // 按上次的用户数预留增长空间
+  size_t expected =
+      std::max<size_t>(config.getUsernameFilterExpectedItems(),
+                       lastCount_.load(std::memory_order_relaxed) * 2);
+  auto filter = std::make_shared<BloomFilter>(
+      expected, config.getUsernameFilterFalsePositiveRate());
+
+  uint64_t epoch = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    building_ = filter;
+    rebuildRequested_ = false;
+    epoch = subscriptionEpoch_;
+  }
+
+  size_t count = 0;
+  bool success = true;
+
+  try {
+    auto conn = DBManager::getInstance().getConnection();
+    if (!conn) {
+      throw std::runtime_error("Database connection failed");
+    }
+
+    // 按主键分页流式扫描，避免一次性加载所有用户名
+    TimedStatement stmt(conn,
+                        "SELECT id, username FROM users WHERE id > ? "
+                        "ORDER BY id LIMIT ?");
+    const int pageSize = config.getUsernameFilterScanBatch();
+    uint64_t lastId = 0;
+
+    while (true) {
+      stmt->setUInt64(1, lastId);
+      stmt->setInt(2, pageSize);
+
+      std::unique_ptr<sql::ResultSet> rs(stmt.executeQuery());
+      int rows = 0;
+      while (rs->next()) {
+        lastId = rs->getUInt64("id");
+        filter->add(std::string(rs->getString("username")));
+        ++rows;
+      }
+
+      count += rows;
+      if (rows < pageSize) {
+        break;
+      }
+    }
+  } catch (sql::SQLException& e) {
+    DBManager::reportError(e);
+    LOG_ERROR << "UsernameFilter rebuild SQL error: " << e.what();
+    success = false;
+  } catch (std::exception& e) {
+    LOG_ERROR << "UsernameFilter rebuild error: " << e.what();
+    success = false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  building_.reset();
+
+  if (!success) {
+    return false;
+  }
+
+  current_ = filter;
+  lastCount_.store(count, std::memory_order_relaxed);
+
+  // 扫描期间订阅断开过，其他节点的注册可能没有进入新过滤器
+  bool synced =
+      !requireSubscription_ || (subscribed_ && subscriptionEpoch_ == epoch);
+  ready_.store(synced, std::memory_order_release);
+
+  LOG_INFO << "Username filter rebuilt with " << count << " usernames, "
+           << filter->bitCount() << " bits, " << filter->hashCount()
+           << " hashes";
+  return true;
+}
+
+void UsernameFilter::add(const std::string& username) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (current_) {
+    current_->add(username);
+  }
+  if (building_) {
+    building_->add(username);
+  }
+}
+
+void UsernameFilter::requireSubscription() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  requireSubscription_ = true;
+  ready_.store(false, std::memory_order_release);
+}
+
+void UsernameFilter::setSubscribed(bool subscribed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (subscribed_ == subscribed) {
+    return;
+  }
+  subscribed_ = subscribed;
+  ++subscriptionEpoch_;
+
+  if (!subscribed) {
+    ready_.store(false, std::memory_order_release);
+  } else {
+    rebuildRequested_ = true;
+    rebuildCv_.notify_all();
+  }
+}
+
+void UsernameFilter::waitForRebuild(std::chrono::seconds interval) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  rebuildCv_.wait_for(lock, interval, [this] { return rebuildRequested_; });
+}
+
+bool UsernameFilter::mightContain(const std::string& username) const {
+  std::shared_ptr<BloomFilter> filter;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    filter = current_;
+  }
+
+  if (!filter || !isReady()) {
+    return true;
+  }
+  return filter->mightContain(username);
+}
+
+}  // namespace StarryChat
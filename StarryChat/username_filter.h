@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace StarryChat {
+
+/**
+ * 布隆过滤器 - 位数组使用原子操作，支持并发插入和查询
+ */
+class BloomFilter {
+ public:
+  BloomFilter(size_t expectedItems, double falsePositiveRate);
+
+  BloomFilter(const BloomFilter&) = delete;
+  BloomFilter& operator=(const BloomFilter&) = delete;
+
+  void add(const std::string& key);
+  bool mightContain(const std::string& key) const;
+
+  size_t bitCount() const { return bitCount_; }
+  size_t hashCount() const { return hashCount_; }
+
+ private:
+  // 双重哈希：第 i 个位置为 h1 + i * h2
+  static void hashPair(const std::string& key, uint64_t& h1, uint64_t& h2);
+
+  size_t bitCount_;
+  size_t hashCount_;
+  std::vector<std::atomic<uint64_t>> words_;
+};
+
+/**
+ * 用户名存在性过滤器
+ * 启动时流式扫描 users 表构建，注册时增量插入，并周期性重建。
+ * mightContain 返回 false 表示用户名一定不存在，可跳过 Redis 和数据库查询。
+ *
+ * 多节点部署时其他节点的注册经 user:registered 频道由 PushSubscriber
+ * 同步过来。启用 requireSubscription 后，只有在订阅存续期间完成的重建
+ * 才用于判定：订阅断开即失效（总是返回 true），重新订阅后立即重建。
+ */
+class UsernameFilter {
+ public:
+  static UsernameFilter& getInstance();
+
+  UsernameFilter(const UsernameFilter&) = delete;
+  UsernameFilter& operator=(const UsernameFilter&) = delete;
+  UsernameFilter(UsernameFilter&&) = delete;
+  UsernameFilter& operator=(UsernameFilter&&) = delete;
+
+  /**
+   * 从数据库全量重建过滤器
+   * 重建期间的新注册会同时写入新旧过滤器
+   * @return 重建是否成功
+   */
+  bool rebuild();
+
+  /**
+   * 注册成功后插入新用户名
+   */
+  void add(const std::string& username);
+
+  /**
+   * 查询用户名是否可能存在
+   * 过滤器尚未构建完成时总是返回 true
+   */
+  bool mightContain(const std::string& username) const;
+
+  bool isReady() const { return ready_.load(std::memory_order_acquire); }
+
+  // 其他节点的注册需要经订阅同步，在 rebuild 之前调用
+  void requireSubscription();
+
+  /**
+   * 注册事件的订阅建立或断开时由订阅线程调用
+   * 断开期间的注册已经丢失，重新建立时请求重建
+   */
+  void setSubscribed(bool subscribed);
+
+  // 等待 interval 或收到重建请求
+  void waitForRebuild(std::chrono::seconds interval);
+
+ private:
+  UsernameFilter() = default;
+  ~UsernameFilter() = default;
+
+  mutable std::mutex mutex_;
+  std::condition_variable rebuildCv_;
+  std::shared_ptr<BloomFilter> current_;
+  std::shared_ptr<BloomFilter> building_;
+  bool requireSubscription_{false};
+  bool subscribed_{false};
+  bool rebuildRequested_{false};
+  uint64_t subscriptionEpoch_{0};  // 订阅每次建立或断开时递增
+  std::atomic<bool> ready_{false};
+  std::atomic<size_t> lastCount_{0};
+};
+
+}  // namespace StarryChat
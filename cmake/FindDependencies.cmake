@@ -62,3 +62,7 @@ find_path(REDIS_PLUS_PLUS_HEADER sw)
 
 find_library(REDIS_PLUS_PLUS_LIB redis++)
 # target_link_libraries(target ${REDIS_PLUS_PLUS_LIB})
+
+# <------------ add zstd dependency -------------->
+find_path(ZSTD_INCLUDE_DIR zstd.h)
+find_library(ZSTD_LIB zstd)
@@ -11,6 +11,9 @@ endif()
 # 启用测试
 option(BUILD_TESTING "Build the testing tree." OFF)
 
+# 基于内存替身存储的处理器微基准（需要 Google Benchmark）
+option(STARRYCHAT_BUILD_BENCHMARKS "Build handler microbenchmarks." OFF)
+
 # 设置输出目录
 set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/bin)
 set(CMAKE_LIBRARY_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/lib)
@@ -19,6 +22,11 @@ set(CMAKE_ARCHIVE_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/lib)
 # 添加编译选项
 add_compile_options(-Wall -Wextra -Wpedantic)
 
+# 编译期最低日志级别（0=TRACE 1=DEBUG 2=INFO 3=WARN 4=ERROR 5=FATAL）
+# 低于该级别的 MLOG/SLOG 调用在编译期移除
+set(STARRYCHAT_LOG_MIN_LEVEL 0 CACHE STRING "Minimum compiled-in log level")
+add_compile_definitions(STARRYCHAT_LOG_MIN_LEVEL=${STARRYCHAT_LOG_MIN_LEVEL})
+
 # 复制配置文件到构建目录
 configure_file(${CMAKE_SOURCE_DIR}/config/config.yaml 
                ${CMAKE_BINARY_DIR}/bin/config.yaml 
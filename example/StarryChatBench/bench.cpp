@@ -0,0 +1,773 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 网络库头文件
+#include "eventloop.h"
+#include "eventloop_thread.h"
+#include "inet_address.h"
+#include "logging.h"
+#include "rpc_channel.h"
+#include "tcp_client.h"
+
+// Protocol Buffers头文件
+#include "chat.pb.h"
+#include "message.pb.h"
+#include "user.pb.h"
+
+// 复用服务端的分片直方图
+#include "metrics.h"
+
+using namespace std;
+using namespace starry;
+using namespace starrychat;
+
+namespace {
+
+const char* kUsage =
+    "Usage: starrychat_bench [options]\n"
+    "  --host=127.0.0.1       服务器地址\n"
+    "  --port=8080            服务器端口\n"
+    "  --threads=4            事件循环线程数\n"
+    "  --connections=1000     RPC 连接数\n"
+    "  --users=200            参与压测的用户数\n"
+    "  --workload=private_chat\n"
+    "       login_storm | private_chat | room_broadcast | history_scroll |\n"
+    "       chat_list | mixed\n"
+    "  --qps=1000             目标总QPS（开环发送）\n"
+    "  --duration=30          统计时长（秒）\n"
+    "  --warmup=5             预热时长（秒），不计入统计\n"
+    "  --room-size=500        room_broadcast 的聊天室人数\n"
+    "  --max-inflight=8       单连接最大未完成请求数，超出的请求排队\n"
+    "  --json=result.json     输出 JSON 结果文件\n";
+
+struct BenchOptions {
+  string host = "127.0.0.1";
+  uint16_t port = 8080;
+  int threads = 4;
+  int connections = 1000;
+  int users = 200;
+  string workload = "private_chat";
+  double qps = 1000;
+  int durationSec = 30;
+  int warmupSec = 5;
+  int roomSize = 500;
+  int maxInflight = 8;
+  string jsonPath;
+};
+
+bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    auto eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == string::npos) {
+      return false;
+    }
+
+    string key = arg.substr(2, eq - 2);
+    string value = arg.substr(eq + 1);
+
+    if (key == "host") {
+      options.host = value;
+    } else if (key == "port") {
+      options.port = static_cast<uint16_t>(stoi(value));
+    } else if (key == "threads") {
+      options.threads = stoi(value);
+    } else if (key == "connections") {
+      options.connections = stoi(value);
+    } else if (key == "users") {
+      options.users = stoi(value);
+    } else if (key == "workload") {
+      options.workload = value;
+    } else if (key == "qps") {
+      options.qps = stod(value);
+    } else if (key == "duration") {
+      options.durationSec = stoi(value);
+    } else if (key == "warmup") {
+      options.warmupSec = stoi(value);
+    } else if (key == "room-size") {
+      options.roomSize = stoi(value);
+    } else if (key == "max-inflight") {
+      options.maxInflight = stoi(value);
+    } else if (key == "json") {
+      options.jsonPath = value;
+    } else {
+      return false;
+    }
+  }
+
+  return options.threads > 0 && options.connections > 0 &&
+         options.users >= 2 && options.qps > 0 && options.durationSec > 0 &&
+         options.maxInflight > 0;
+}
+
+// 单个 RPC 的统计
+struct RpcStats {
+  atomic<uint64_t> calls{0};
+  atomic<uint64_t> errors{0};
+  StarryChat::Histogram latency;
+};
+
+// 一条 RPC 连接及其服务存根
+class BenchConnection {
+ public:
+  BenchConnection(EventLoop* loop,
+                  size_t loopIndex,
+                  const InetAddress& serverAddr,
+                  int index)
+      : loopIndex(loopIndex),
+        client_(loop, serverAddr, "BenchClient-" + to_string(index)),
+        channel_(make_shared<RpcChannel>()),
+        userService_(channel_.get()),
+        chatService_(channel_.get()),
+        messageService_(channel_.get()) {
+    client_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+      if (conn->connected()) {
+        channel_->setConnection(conn);
+        connected_ = true;
+      } else {
+        channel_->setConnection(TcpConnectionPtr());
+        connected_ = false;
+      }
+    });
+
+    client_.setMessageCallback(
+        bind(&RpcChannel::onMessage, channel_.get(), _1, _2, _3));
+  }
+
+  void connect() { client_.connect(); }
+  void disconnect() { client_.disconnect(); }
+  bool connected() const { return connected_; }
+
+  UserService::Stub& users() { return userService_; }
+  ChatService::Stub& chats() { return chatService_; }
+  MessageService::Stub& messages() { return messageService_; }
+
+  const size_t loopIndex;
+  atomic<int> inflight{0};
+  // 达到 maxInflight 时排队的请求的计划发送时间，只在所属事件循环上访问
+  deque<chrono::steady_clock::time_point> backlog;
+
+ private:
+  TcpClient client_;
+  shared_ptr<RpcChannel> channel_;
+  UserService::Stub userService_;
+  ChatService::Stub chatService_;
+  MessageService::Stub messageService_;
+  atomic<bool> connected_{false};
+};
+
+// 压测用户
+struct BenchUser {
+  string username;
+  string password;
+  uint64_t id = 0;
+  uint64_t privateChatId = 0;  // 与配对用户的私聊
+};
+
+// 一组并发请求的完成计数
+class BatchWaiter {
+ public:
+  explicit BatchWaiter(size_t count) : remaining_(count) {
+    if (count == 0) {
+      promise_.set_value();
+    }
+  }
+
+  void done() {
+    if (remaining_.fetch_sub(1) == 1) {
+      promise_.set_value();
+    }
+  }
+
+  bool wait(chrono::seconds timeout) {
+    return promise_.get_future().wait_for(timeout) == future_status::ready;
+  }
+
+ private:
+  atomic<size_t> remaining_;
+  promise<void> promise_;
+};
+
+class StarryChatBench {
+ public:
+  explicit StarryChatBench(const BenchOptions& options)
+      : options_(options),
+        serverAddr_(options.host, options.port),
+        runId_(to_string(time(nullptr))) {
+    for (const char* name :
+         {"Login", "SendMessage", "GetMessages", "GetUserChats"}) {
+      stats_[name] = make_unique<RpcStats>();
+    }
+  }
+
+  bool run() {
+    if (!connect()) {
+      return false;
+    }
+
+    if (!setup()) {
+      cerr << "Setup failed" << endl;
+      return false;
+    }
+
+    cout << "Running workload " << options_.workload << " at "
+         << options_.qps << " QPS for " << options_.durationSec
+         << "s (warmup " << options_.warmupSec << "s)" << endl;
+
+    // 预热阶段的请求不计入统计
+    auto now = chrono::steady_clock::now();
+    measureStart_ = now + chrono::seconds(options_.warmupSec);
+    measureEnd_ = measureStart_ + chrono::seconds(options_.durationSec);
+    running_ = true;
+
+    for (size_t i = 0; i < loops_.size(); ++i) {
+      EventLoop* loop = loops_[i];
+      loop->runInLoop([this, i, loop] {
+        loop->runEvery(0.001, [this, i] { tick(i); });
+      });
+    }
+
+    this_thread::sleep_until(measureEnd_);
+    running_ = false;
+
+    // 等待未完成和排队的请求返回
+    this_thread::sleep_for(chrono::seconds(1));
+
+    report();
+    stopped_ = true;
+    for (auto& conn : connections_) {
+      conn->disconnect();
+    }
+    return true;
+  }
+
+ private:
+  // ============ 连接管理 ============
+
+  bool connect() {
+    for (int i = 0; i < options_.threads; ++i) {
+      loopThreads_.push_back(make_unique<EventLoopThread>());
+      loops_.push_back(loopThreads_.back()->startLoop());
+    }
+
+    connectionsByLoop_.resize(loops_.size());
+    tickState_.resize(loops_.size());
+    for (int i = 0; i < options_.connections; ++i) {
+      size_t loopIndex = i % loops_.size();
+      connections_.push_back(make_unique<BenchConnection>(
+          loops_[loopIndex], loopIndex, serverAddr_, i));
+      connectionsByLoop_[loopIndex].push_back(connections_.back().get());
+      connections_.back()->connect();
+    }
+
+    // 等待所有连接建立
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(30);
+    while (chrono::steady_clock::now() < deadline) {
+      size_t ready = count_if(connections_.begin(), connections_.end(),
+                              [](const auto& conn) { return conn->connected(); });
+      if (ready == connections_.size()) {
+        cout << "Established " << ready << " connections over "
+             << loops_.size() << " threads" << endl;
+        return true;
+      }
+      this_thread::sleep_for(chrono::milliseconds(100));
+    }
+
+    cerr << "Timed out establishing connections" << endl;
+    return false;
+  }
+
+  BenchConnection& connectionFor(size_t index) {
+    return *connections_[index % connections_.size()];
+  }
+
+  // ============ 数据准备 ============
+
+  bool setup() {
+    users_.resize(options_.users);
+    historyCursors_ = make_unique<atomic<uint64_t>[]>(users_.size());
+    for (int i = 0; i < options_.users; ++i) {
+      users_[i].username = "bench_" + runId_ + "_" + to_string(i);
+      users_[i].password = "bench_password_" + to_string(i);
+    }
+
+    if (!registerUsers()) {
+      return false;
+    }
+
+    const string& workload = options_.workload;
+    if (workload == "private_chat" || workload == "history_scroll" ||
+        workload == "chat_list" || workload == "mixed") {
+      if (!createPrivateChats()) {
+        return false;
+      }
+    }
+    if (workload == "room_broadcast" || workload == "mixed") {
+      if (!createRoom()) {
+        return false;
+      }
+    }
+    if (workload == "history_scroll" || workload == "mixed") {
+      seedHistory();
+    }
+    return true;
+  }
+
+  bool registerUsers() {
+    BatchWaiter waiter(users_.size());
+    for (size_t i = 0; i < users_.size(); ++i) {
+      RegisterUserRequest request;
+      request.set_username(users_[i].username);
+      request.set_password(users_[i].password);
+      request.set_nickname("Bench User " + to_string(i));
+      request.set_email(users_[i].username + "@bench.local");
+
+      connectionFor(i).users().RegisterUser(
+          request, [this, i, &waiter](
+                       const shared_ptr<RegisterUserResponse>& response) {
+            if (response && response->success()) {
+              users_[i].id = response->user_info().id();
+            }
+            waiter.done();
+          });
+    }
+
+    if (!waiter.wait(chrono::seconds(120))) {
+      cerr << "Timed out registering users" << endl;
+      return false;
+    }
+
+    size_t registered = count_if(users_.begin(), users_.end(),
+                                 [](const auto& user) { return user.id > 0; });
+    cout << "Registered " << registered << " users" << endl;
+    return registered == users_.size();
+  }
+
+  // 用户 2k 与 2k+1 配对创建私聊
+  bool createPrivateChats() {
+    size_t pairs = users_.size() / 2;
+    BatchWaiter waiter(pairs);
+    for (size_t i = 0; i < pairs; ++i) {
+      CreatePrivateChatRequest request;
+      request.set_initiator_id(users_[2 * i].id);
+      request.set_receiver_id(users_[2 * i + 1].id);
+
+      connectionFor(i).chats().CreatePrivateChat(
+          request, [this, i, &waiter](
+                       const shared_ptr<CreatePrivateChatResponse>& response) {
+            if (response && response->success()) {
+              uint64_t chatId = response->private_chat().id();
+              users_[2 * i].privateChatId = chatId;
+              users_[2 * i + 1].privateChatId = chatId;
+            }
+            waiter.done();
+          });
+    }
+
+    if (!waiter.wait(chrono::seconds(120))) {
+      cerr << "Timed out creating private chats" << endl;
+      return false;
+    }
+    cout << "Created " << pairs << " private chats" << endl;
+    return true;
+  }
+
+  // 创建一个大聊天室并分批加入成员
+  bool createRoom() {
+    CreateChatRoomRequest request;
+    request.set_name("bench_room_" + runId_);
+    request.set_creator_id(users_[0].id);
+    request.set_description("starrychat_bench broadcast room");
+
+    promise<uint64_t> created;
+    connectionFor(0).chats().CreateChatRoom(
+        request, [&created](const shared_ptr<CreateChatRoomResponse>& r) {
+          created.set_value(r && r->success() ? r->chat_room().id() : 0);
+        });
+
+    auto future = created.get_future();
+    if (future.wait_for(chrono::seconds(10)) != future_status::ready ||
+        (roomId_ = future.get()) == 0) {
+      cerr << "Failed to create chat room" << endl;
+      return false;
+    }
+
+    int members = min<int>(options_.roomSize, static_cast<int>(users_.size()));
+    const int batchSize = 100;
+    int batches = (members - 1 + batchSize - 1) / batchSize;
+    BatchWaiter waiter(batches);
+    for (int b = 0; b < batches; ++b) {
+      AddChatRoomMemberRequest addRequest;
+      addRequest.set_chat_room_id(roomId_);
+      addRequest.set_operator_id(users_[0].id);
+      for (int i = 1 + b * batchSize; i < min(members, 1 + (b + 1) * batchSize);
+           ++i) {
+        addRequest.add_user_ids(users_[i].id);
+      }
+
+      connectionFor(b).chats().AddChatRoomMember(
+          addRequest,
+          [&waiter](const shared_ptr<AddChatRoomMemberResponse>&) {
+            waiter.done();
+          });
+    }
+
+    if (!waiter.wait(chrono::seconds(120))) {
+      cerr << "Timed out adding room members" << endl;
+      return false;
+    }
+
+    roomMembers_ = members;
+    cout << "Created chat room " << roomId_ << " with " << members
+         << " members" << endl;
+    return true;
+  }
+
+  // 为翻页读取准备历史消息
+  void seedHistory() {
+    const int messagesPerChat = 50;
+    size_t pairs = users_.size() / 2;
+    BatchWaiter waiter(pairs * messagesPerChat);
+    for (size_t i = 0; i < pairs; ++i) {
+      for (int m = 0; m < messagesPerChat; ++m) {
+        auto request = makeTextMessage(users_[2 * i + m % 2].id,
+                                       CHAT_TYPE_PRIVATE,
+                                       users_[2 * i].privateChatId);
+        connectionFor(i).messages().SendMessage(
+            request, [&waiter](const shared_ptr<SendMessageResponse>&) {
+              waiter.done();
+            });
+      }
+    }
+    waiter.wait(chrono::seconds(300));
+    cout << "Seeded " << messagesPerChat << " messages per private chat"
+         << endl;
+  }
+
+  static SendMessageRequest makeTextMessage(uint64_t senderId,
+                                            ChatType chatType,
+                                            uint64_t chatId) {
+    SendMessageRequest request;
+    request.set_sender_id(senderId);
+    request.set_chat_type(chatType);
+    request.set_chat_id(chatId);
+    request.set_type(MESSAGE_TYPE_TEXT);
+    request.mutable_text()->set_text("starrychat_bench payload message");
+    return request;
+  }
+
+  // ============ 压测发送 ============
+
+  // 每毫秒在各事件循环上按目标速率发送请求
+  void tick(size_t loopIndex) {
+    if (!running_) {
+      return;
+    }
+
+    auto& state = tickState_[loopIndex];
+    state.budget += options_.qps / loops_.size() / 1000.0;
+
+    auto& conns = connectionsByLoop_[loopIndex];
+    auto now = chrono::steady_clock::now();
+    while (state.budget >= 1.0) {
+      state.budget -= 1.0;
+      BenchConnection* conn = conns[state.next++ % conns.size()];
+
+      // 连接忙时排队而不是丢弃，延迟从计划发送时间算起，
+      // 否则服务端变慢时恰好漏掉最慢的那部分请求
+      if (conn->inflight.load() >= options_.maxInflight ||
+          !conn->backlog.empty()) {
+        conn->backlog.push_back(now);
+        queued_.fetch_add(1);
+        continue;
+      }
+      issue(*conn, state.rng, now);
+    }
+  }
+
+  // 有请求完成后发送排队的请求，在连接所属的事件循环上调用
+  void drainBacklog(BenchConnection& conn) {
+    if (stopped_) {
+      return;
+    }
+    auto& rng = tickState_[conn.loopIndex].rng;
+    while (!conn.backlog.empty() &&
+           conn.inflight.load() < options_.maxInflight) {
+      auto intended = conn.backlog.front();
+      conn.backlog.pop_front();
+      issue(conn, rng, intended);
+    }
+  }
+
+  void issue(BenchConnection& conn,
+             mt19937_64& rng,
+             chrono::steady_clock::time_point start) {
+    const string& workload = options_.workload;
+    if (workload == "mixed") {
+      // 60% 发消息，20% 翻历史，15% 刷新会话列表，5% 登录
+      int roll = uniform_int_distribution<int>(0, 99)(rng);
+      if (roll < 40) {
+        sendPrivateMessage(conn, rng, start);
+      } else if (roll < 60) {
+        sendRoomMessage(conn, rng, start);
+      } else if (roll < 80) {
+        scrollHistory(conn, rng, start);
+      } else if (roll < 95) {
+        refreshChatList(conn, rng, start);
+      } else {
+        login(conn, rng, start);
+      }
+    } else if (workload == "login_storm") {
+      login(conn, rng, start);
+    } else if (workload == "private_chat") {
+      sendPrivateMessage(conn, rng, start);
+    } else if (workload == "room_broadcast") {
+      sendRoomMessage(conn, rng, start);
+    } else if (workload == "history_scroll") {
+      scrollHistory(conn, rng, start);
+    } else if (workload == "chat_list") {
+      refreshChatList(conn, rng, start);
+    }
+  }
+
+  size_t randomUserIndex(mt19937_64& rng) {
+    return uniform_int_distribution<size_t>(0, users_.size() - 1)(rng);
+  }
+
+  const BenchUser& randomUser(mt19937_64& rng) {
+    return users_[randomUserIndex(rng)];
+  }
+
+  // 返回在响应到达时记录延迟和错误的回调，延迟从计划发送时间 start 算起
+  template <typename Response, typename Callback = nullptr_t>
+  auto timed(const string& rpc,
+             BenchConnection& conn,
+             chrono::steady_clock::time_point start,
+             Callback onResponse = nullptr) {
+    auto& stats = *stats_[rpc];
+    conn.inflight.fetch_add(1);
+
+    return [this, &stats, &conn, start,
+            onResponse](const shared_ptr<Response>& response) {
+      conn.inflight.fetch_sub(1);
+      if (start >= measureStart_ && start < measureEnd_) {
+        stats.calls.fetch_add(1);
+        stats.latency.recordSince(start);
+        if (!response || !response->success()) {
+          stats.errors.fetch_add(1);
+        }
+      }
+      if constexpr (!is_same_v<Callback, nullptr_t>) {
+        onResponse(response);
+      }
+      drainBacklog(conn);
+    };
+  }
+
+  void login(BenchConnection& conn,
+             mt19937_64& rng,
+             chrono::steady_clock::time_point start) {
+    const auto& user = randomUser(rng);
+    LoginRequest request;
+    request.set_username(user.username);
+    request.set_password(user.password);
+    conn.users().Login(request, timed<LoginResponse>("Login", conn, start));
+  }
+
+  void sendPrivateMessage(BenchConnection& conn,
+                          mt19937_64& rng,
+                          chrono::steady_clock::time_point start) {
+    const auto& user = randomUser(rng);
+    if (user.privateChatId == 0) {
+      return;
+    }
+    conn.messages().SendMessage(
+        makeTextMessage(user.id, CHAT_TYPE_PRIVATE, user.privateChatId),
+        timed<SendMessageResponse>("SendMessage", conn, start));
+  }
+
+  void sendRoomMessage(BenchConnection& conn,
+                       mt19937_64& rng,
+                       chrono::steady_clock::time_point start) {
+    if (roomId_ == 0) {
+      return;
+    }
+    const auto& user = users_[uniform_int_distribution<int>(
+        0, roomMembers_ - 1)(rng)];
+    conn.messages().SendMessage(
+        makeTextMessage(user.id, CHAT_TYPE_GROUP, roomId_),
+        timed<SendMessageResponse>("SendMessage", conn, start));
+  }
+
+  // 每个用户沿 before_msg_id 向前翻页自己的私聊，翻到底后从最新处重新开始
+  // 游标按 (用户, 聊天) 保存，每个用户只有一个私聊，按用户下标索引
+  void scrollHistory(BenchConnection& conn,
+                     mt19937_64& rng,
+                     chrono::steady_clock::time_point start) {
+    size_t index = randomUserIndex(rng);
+    const auto& user = users_[index];
+    if (user.privateChatId == 0) {
+      return;
+    }
+
+    auto& cursor = historyCursors_[index];
+    GetMessagesRequest request;
+    request.set_user_id(user.id);
+    request.set_chat_type(CHAT_TYPE_PRIVATE);
+    request.set_chat_id(user.privateChatId);
+    request.set_before_msg_id(cursor.load());
+    request.set_limit(20);
+
+    conn.messages().GetMessages(
+        request, timed<GetMessagesResponse>(
+                     "GetMessages", conn, start,
+                     [&cursor](const shared_ptr<GetMessagesResponse>& r) {
+                       if (r && r->success() && r->messages_size() > 0) {
+                         cursor = r->messages(r->messages_size() - 1).id();
+                       } else {
+                         cursor = 0;
+                       }
+                     }));
+  }
+
+  void refreshChatList(BenchConnection& conn,
+                       mt19937_64& rng,
+                       chrono::steady_clock::time_point start) {
+    GetUserChatsRequest request;
+    request.set_user_id(randomUser(rng).id);
+    conn.chats().GetUserChats(
+        request, timed<GetUserChatsResponse>("GetUserChats", conn, start));
+  }
+
+  // ============ 结果输出 ============
+
+  void report() {
+    double seconds = options_.durationSec;
+    char line[256];
+
+    cout << "\n========== starrychat_bench: " << options_.workload
+         << " ==========" << endl;
+    snprintf(line, sizeof(line), "%-14s %10s %8s %10s %9s %9s %9s %9s %9s",
+             "RPC", "count", "errors", "qps", "p50(us)", "p90(us)",
+             "p99(us)", "p999(us)", "max(us)");
+    cout << line << endl;
+
+    string json = "{\n  \"workload\": \"" + options_.workload + "\",\n" +
+                  "  \"target_qps\": " + to_string(options_.qps) + ",\n" +
+                  "  \"duration_sec\": " + to_string(options_.durationSec) +
+                  ",\n" + "  \"connections\": " +
+                  to_string(options_.connections) + ",\n" +
+                  "  \"threads\": " + to_string(options_.threads) + ",\n" +
+                  "  \"queued\": " + to_string(queued_.load()) + ",\n" +
+                  "  \"rpcs\": {";
+
+    bool first = true;
+    for (const auto& [name, stats] : stats_) {
+      uint64_t calls = stats->calls.load();
+      if (calls == 0) {
+        continue;
+      }
+
+      auto snap = stats->latency.snapshot();
+      uint64_t maxLatency = 0;
+      for (int i = StarryChat::Histogram::kBucketCount - 1; i >= 0; --i) {
+        if (snap.buckets[i] > 0) {
+          maxLatency = StarryChat::Histogram::bucketUpperBound(i);
+          break;
+        }
+      }
+
+      snprintf(line, sizeof(line),
+               "%-14s %10llu %8llu %10.1f %9llu %9llu %9llu %9llu %9llu",
+               name.c_str(), static_cast<unsigned long long>(calls),
+               static_cast<unsigned long long>(stats->errors.load()),
+               calls / seconds,
+               static_cast<unsigned long long>(snap.quantile(0.5)),
+               static_cast<unsigned long long>(snap.quantile(0.9)),
+               static_cast<unsigned long long>(snap.quantile(0.99)),
+               static_cast<unsigned long long>(snap.quantile(0.999)),
+               static_cast<unsigned long long>(maxLatency));
+      cout << line << endl;
+
+      json += string(first ? "\n" : ",\n") + "    \"" + name + "\": {" +
+              "\"count\": " + to_string(calls) +
+              ", \"errors\": " + to_string(stats->errors.load()) +
+              ", \"qps\": " + to_string(calls / seconds) +
+              ", \"p50_us\": " + to_string(snap.quantile(0.5)) +
+              ", \"p90_us\": " + to_string(snap.quantile(0.9)) +
+              ", \"p99_us\": " + to_string(snap.quantile(0.99)) +
+              ", \"p999_us\": " + to_string(snap.quantile(0.999)) +
+              ", \"max_us\": " + to_string(maxLatency) + "}";
+      first = false;
+    }
+    json += "\n  }\n}\n";
+
+    cout << "Queued (connection at max in-flight): " << queued_.load()
+         << endl;
+
+    if (!options_.jsonPath.empty()) {
+      ofstream out(options_.jsonPath);
+      out << json;
+      cout << "Wrote " << options_.jsonPath << endl;
+    }
+  }
+
+  struct TickState {
+    double budget = 0;
+    size_t next = 0;
+    mt19937_64 rng{random_device{}()};
+  };
+
+  BenchOptions options_;
+  InetAddress serverAddr_;
+  string runId_;
+
+  vector<unique_ptr<EventLoopThread>> loopThreads_;
+  vector<EventLoop*> loops_;
+  vector<unique_ptr<BenchConnection>> connections_;
+  vector<vector<BenchConnection*>> connectionsByLoop_;
+  vector<TickState> tickState_;
+
+  vector<BenchUser> users_;
+  uint64_t roomId_ = 0;
+  int roomMembers_ = 0;
+
+  map<string, unique_ptr<RpcStats>> stats_;
+  unique_ptr<atomic<uint64_t>[]> historyCursors_;  // 按用户下标
+  atomic<uint64_t> queued_{0};
+  atomic<bool> running_{false};
+  atomic<bool> stopped_{false};  // 断开连接前停止发送排队的请求
+  chrono::steady_clock::time_point measureStart_;
+  chrono::steady_clock::time_point measureEnd_;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    cerr << kUsage;
+    return 1;
+  }
+
+  Logger::setLogLevel(LogLevel::WARN);
+
+  cout << "starrychat_bench connecting to " << options.host << ":"
+       << options.port << endl;
+
+  StarryChatBench bench(options);
+  return bench.run() ? 0 : 1;
+}
@@ -0,0 +1,529 @@
+#include <benchmark/benchmark.h>
+#include <zdict.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+
+// Protocol Buffers头文件
+#include "chat.pb.h"
+#include "message.pb.h"
+#include "user.pb.h"
+
+// 服务实现和内存替身存储
+#include "chat_service_impl.h"
+#include "db_manager.h"
+#include "log_control.h"
+#include "memory_db_store.h"
+#include "memory_redis_store.h"
+#include "message_cache_codec.h"
+#include "message_service_impl.h"
+#include "redis_keys.h"
+#include "redis_manager.h"
+#include "user_service_impl.h"
+
+using namespace std;
+using namespace starry;
+using namespace starrychat;
+
+namespace {
+
+// 当前线程的堆分配次数，由下面替换的全局 operator new 累加
+thread_local uint64_t t_allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  ++t_allocations;
+  if (void* p = malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+namespace {
+
+const char* kUsage =
+    "Usage: starrychat_microbench [options] [--benchmark_...]\n"
+    "  --redis-latency-us=0   内存 Redis 每次往返的基础延迟（微秒）\n"
+    "  --redis-jitter-us=0    内存 Redis 每次往返的最大抖动（微秒）\n"
+    "  --db-latency-us=0      内存数据库每次往返的基础延迟（微秒）\n"
+    "  --db-jitter-us=0       内存数据库每次往返的最大抖动（微秒）\n"
+    "  --seed=1               抖动序列的随机种子\n"
+    "  --users=100000         预置用户数，Login 按顺序轮换以避开登录限流\n"
+    "  --room-size=50         群聊人数，SendMessage/GetMessages 在该群内进行\n"
+    "  --history=200          预置的群聊历史消息数\n"
+    "  --chats=20             每个用户聊天列表缓存中的会话数\n"
+    "其余 --benchmark_* 参数由 Google Benchmark 处理\n";
+
+struct BenchOptions {
+  StarryChat::FakeLatencyOptions redisLatency;
+  StarryChat::FakeLatencyOptions dbLatency;
+  int users = 100000;
+  int roomSize = 50;
+  int history = 200;
+  int chats = 20;
+};
+
+const string kPassword = "microbench-password";
+constexpr uint64_t kRoomId = 1;
+
+BenchOptions g_options;
+vector<string> g_usernames;
+vector<uint64_t> g_roomMembers;
+
+StarryChat::UserServiceImpl* g_userService = nullptr;
+StarryChat::ChatServiceImpl* g_chatService = nullptr;
+StarryChat::MessageServiceImpl* g_messageService = nullptr;
+
+// 解析本工具的参数，其余参数原样留给 Google Benchmark
+bool parseOptions(int argc, char* argv[], vector<char*>& rest) {
+  rest.push_back(argv[0]);
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    auto eq = arg.find('=');
+    if (arg.rfind("--benchmark_", 0) == 0) {
+      rest.push_back(argv[i]);
+      continue;
+    }
+    if (arg.rfind("--", 0) != 0 || eq == string::npos) {
+      return false;
+    }
+
+    string key = arg.substr(2, eq - 2);
+    string value = arg.substr(eq + 1);
+
+    if (key == "redis-latency-us") {
+      g_options.redisLatency.base = chrono::microseconds(stoll(value));
+    } else if (key == "redis-jitter-us") {
+      g_options.redisLatency.jitter = chrono::microseconds(stoll(value));
+    } else if (key == "db-latency-us") {
+      g_options.dbLatency.base = chrono::microseconds(stoll(value));
+    } else if (key == "db-jitter-us") {
+      g_options.dbLatency.jitter = chrono::microseconds(stoll(value));
+    } else if (key == "seed") {
+      g_options.redisLatency.seed = stoull(value);
+      g_options.dbLatency.seed = stoull(value) + 1;
+    } else if (key == "users") {
+      g_options.users = stoi(value);
+    } else if (key == "room-size") {
+      g_options.roomSize = stoi(value);
+    } else if (key == "history") {
+      g_options.history = stoi(value);
+    } else if (key == "chats") {
+      g_options.chats = stoi(value);
+    } else {
+      return false;
+    }
+  }
+
+  return g_options.users >= 2 && g_options.roomSize >= 2 &&
+         g_options.roomSize <= g_options.users && g_options.history >= 0 &&
+         g_options.chats >= 0;
+}
+
+// 每次迭代的平均堆分配次数，基准结束时报告为 allocs_per_op
+class AllocationCounter {
+ public:
+  explicit AllocationCounter(benchmark::State& state)
+      : state_(state), start_(t_allocations) {}
+
+  ~AllocationCounter() {
+    state_.counters["allocs_per_op"] =
+        benchmark::Counter(static_cast<double>(t_allocations - start_),
+                           benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State& state_;
+  uint64_t start_;
+};
+
+// 处理器同步调用 done；回调负责释放响应
+template <typename Response>
+RpcDoneCallback collectSuccess(bool& ok) {
+  return [&ok](google::protobuf::Message* message) {
+    auto* response = static_cast<Response*>(message);
+    ok = response->success();
+    delete response;
+  };
+}
+
+SendMessageRequestPtr makeSendRequest(uint64_t senderId) {
+  auto request = make_shared<SendMessageRequest>();
+  request->set_sender_id(senderId);
+  request->set_chat_type(CHAT_TYPE_GROUP);
+  request->set_chat_id(kRoomId);
+  request->set_type(MESSAGE_TYPE_TEXT);
+  request->mutable_text()->set_text("microbench message from user " +
+                                    to_string(senderId));
+  return request;
+}
+
+// 预置用户、群成员、历史消息和聊天列表缓存
+bool seed(StarryChat::MemoryDBStore& db) {
+  g_usernames.reserve(g_options.users);
+  for (int i = 0; i < g_options.users; ++i) {
+    g_usernames.push_back("microbench_user_" + to_string(i));
+    uint64_t userId = db.addUser(g_usernames.back(), kPassword);
+    if (static_cast<int>(g_roomMembers.size()) < g_options.roomSize) {
+      g_roomMembers.push_back(userId);
+    }
+  }
+
+  auto& redis = StarryChat::RedisManager::getInstance();
+  vector<string> members;
+  for (uint64_t memberId : g_roomMembers) {
+    members.push_back(to_string(memberId));
+  }
+  redis.sadd(StarryChat::RedisKeys::chatRoomMembers(kRoomId), members);
+
+  // 通过 SendMessage 写入历史消息，同时填充消息缓存和时间线
+  bool ok = false;
+  auto done = collectSuccess<SendMessageResponse>(ok);
+  for (int i = 0; i < g_options.history; ++i) {
+    g_messageService->SendMessage(
+        makeSendRequest(g_roomMembers[i % g_roomMembers.size()]),
+        &SendMessageResponse::default_instance(), done);
+    if (!ok) {
+      cerr << "Failed to seed message history" << endl;
+      return false;
+    }
+  }
+
+  // 聊天列表缓存：一个群聊加若干私聊
+  GetUserChatsResponse chatList;
+  chatList.set_success(true);
+  for (int i = 0; i < g_options.chats; ++i) {
+    auto* chat = chatList.add_chats();
+    chat->set_id(i == 0 ? kRoomId : 1000 + i);
+    chat->set_type(i == 0 ? CHAT_TYPE_GROUP : CHAT_TYPE_PRIVATE);
+    chat->set_name("chat " + to_string(i));
+    chat->set_last_message_time(1700000000 + i);
+    chat->set_last_message_preview("preview of the last message");
+    chat->set_unread_count(i % 3);
+  }
+  string serialized = chatList.SerializeAsString();
+  for (uint64_t memberId : g_roomMembers) {
+    redis.set(StarryChat::RedisKeys::userChats(memberId), serialized,
+              chrono::hours(24));
+  }
+
+  return true;
+}
+
+void BM_SendMessage(benchmark::State& state) {
+  bool ok = false;
+  auto done = collectSuccess<SendMessageResponse>(ok);
+  size_t next = state.thread_index();
+
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    auto request = makeSendRequest(g_roomMembers[next % g_roomMembers.size()]);
+    next += state.threads();
+    g_messageService->SendMessage(request,
+                                  &SendMessageResponse::default_instance(),
+                                  done);
+    if (!ok) {
+      state.SkipWithError("SendMessage failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_GetMessages(benchmark::State& state) {
+  bool ok = false;
+  auto done = collectSuccess<GetMessagesResponse>(ok);
+  auto request = make_shared<GetMessagesRequest>();
+  request->set_chat_type(CHAT_TYPE_GROUP);
+  request->set_chat_id(kRoomId);
+  request->set_limit(static_cast<int32_t>(state.range(0)));
+  size_t next = state.thread_index();
+
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    request->set_user_id(g_roomMembers[next % g_roomMembers.size()]);
+    next += state.threads();
+    g_messageService->GetMessages(request,
+                                  &GetMessagesResponse::default_instance(),
+                                  done);
+    if (!ok) {
+      state.SkipWithError("GetMessages failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_GetUserChats(benchmark::State& state) {
+  bool ok = false;
+  auto done = collectSuccess<GetUserChatsResponse>(ok);
+  auto request = make_shared<GetUserChatsRequest>();
+  size_t next = state.thread_index();
+
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    request->set_user_id(g_roomMembers[next % g_roomMembers.size()]);
+    next += state.threads();
+    g_chatService->GetUserChats(request,
+                                &GetUserChatsResponse::default_instance(),
+                                done);
+    if (!ok) {
+      state.SkipWithError("GetUserChats failed");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Login(benchmark::State& state) {
+  // 所有线程和轮次共享游标，每个用户名只消耗少量登录令牌
+  static atomic<size_t> cursor{0};
+
+  bool ok = false;
+  auto done = collectSuccess<LoginResponse>(ok);
+  auto request = make_shared<LoginRequest>();
+  request->set_password(kPassword);
+
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    size_t index = cursor.fetch_add(1, memory_order_relaxed);
+    request->set_username(g_usernames[index % g_usernames.size()]);
+    g_userService->Login(request, &LoginResponse::default_instance(), done);
+    if (!ok) {
+      state.SkipWithError("Login failed (rate limited? raise --users)");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// 拼接一个未读计数键：字符串相加与栈上键构造的对比
+void BM_UnreadKeyConcat(benchmark::State& state) {
+  uint64_t userId = 1000000;
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    string key = "{user:" + to_string(userId++) + "}:unread:" +
+                 to_string(static_cast<int>(CHAT_TYPE_GROUP)) + ":" +
+                 to_string(kRoomId);
+    benchmark::DoNotOptimize(key.data());
+  }
+}
+
+void BM_UnreadKeyBuilder(benchmark::State& state) {
+  uint64_t userId = 1000000;
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    auto key =
+        StarryChat::RedisKeys::unread(userId++, CHAT_TYPE_GROUP, kRoomId);
+    benchmark::DoNotOptimize(key.view().data());
+  }
+}
+
+// 模拟线上的消息：中英文混合、长短不一，部分带回复和 @
+vector<string> makeMessageCorpus(size_t count, uint32_t seed) {
+  static const vector<string> kPhrases = {
+      "好的，我晚点看一下",
+      "今天的需求评审改到下午三点了，大家注意一下时间",
+      "收到",
+      "这个问题我昨天也遇到了，重启服务之后就好了",
+      "周末有人一起去爬山吗？天气预报说是晴天",
+      "can you take a look at the latest build?",
+      "deploy finished, all health checks green",
+      "LGTM, merging now",
+      "哈哈哈哈",
+      "会议链接发群里了，记得提前五分钟进",
+      "the dashboard shows p99 latency went up after the release",
+      "我把文档更新了，有问题直接在评论里提",
+  };
+
+  mt19937 rng(seed);
+  uniform_int_distribution<size_t> phrase(0, kPhrases.size() - 1);
+  uniform_int_distribution<int> phraseCount(1, 8);
+  uniform_int_distribution<uint64_t> user(1, 100000);
+  uniform_int_distribution<int> percent(0, 99);
+
+  vector<string> corpus;
+  corpus.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    Message message;
+    message.set_id(1000000 + i);
+    message.set_sender_id(user(rng));
+    message.set_chat_type(CHAT_TYPE_GROUP);
+    message.set_chat_id(kRoomId);
+    message.set_type(MESSAGE_TYPE_TEXT);
+    message.set_timestamp(1700000000000 + i * 1375);
+    message.set_status(MESSAGE_STATUS_SENT);
+
+    string text;
+    for (int n = phraseCount(rng); n > 0; --n) {
+      if (!text.empty()) {
+        text += ' ';
+      }
+      text += kPhrases[phrase(rng)];
+    }
+    message.mutable_text()->set_text(text);
+
+    if (percent(rng) < 20) {
+      message.set_reply_to_id(1000000 + i / 2);
+    }
+    if (percent(rng) < 10) {
+      message.add_mention_user_ids(user(rng));
+      message.add_mention_user_ids(user(rng));
+    }
+    corpus.push_back(message.SerializeAsString());
+  }
+  return corpus;
+}
+
+const vector<string>& messageCorpus() {
+  static const vector<string> corpus = makeMessageCorpus(4096, 7);
+  return corpus;
+}
+
+// 用另一批样本训练字典，避免在测试数据上训练
+const string& messageDictionary() {
+  static const string dictionary = [] {
+    auto samples = makeMessageCorpus(20000, 13);
+    string buffer;
+    vector<size_t> sizes;
+    for (const auto& sample : samples) {
+      buffer += sample;
+      sizes.push_back(sample.size());
+    }
+    string dict(16 * 1024, '\0');
+    size_t size = ZDICT_trainFromBuffer(dict.data(), dict.size(),
+                                        buffer.data(), sizes.data(),
+                                        static_cast<unsigned>(sizes.size()));
+    dict.resize(ZDICT_isError(size) ? 0 : size);
+    return dict;
+  }();
+  return dictionary;
+}
+
+// 参数 0 为原始数据，1 为无字典 zstd，2 为训练字典 zstd
+void configureCodec(int64_t mode) {
+  StarryChat::MessageCacheCodec::Options options;
+  options.enabled = mode != 0;
+  options.minSize = 0;
+  StarryChat::MessageCacheCodec::getInstance().initialize(
+      options, mode == 2 ? string_view(messageDictionary()) : string_view());
+}
+
+void BM_MessageCacheEncode(benchmark::State& state) {
+  const auto& corpus = messageCorpus();
+  auto& codec = StarryChat::MessageCacheCodec::getInstance();
+  configureCodec(state.range(0));
+
+  string compressed;
+  size_t index = 0;
+  uint64_t rawBytes = 0;
+  uint64_t storedBytes = 0;
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    const auto& serialized = corpus[index++ % corpus.size()];
+    bool encoded = codec.encode(serialized, &compressed);
+    rawBytes += serialized.size();
+    storedBytes += encoded ? compressed.size() : serialized.size();
+    benchmark::DoNotOptimize(compressed.data());
+  }
+
+  state.counters["raw_bytes_per_msg"] = benchmark::Counter(
+      static_cast<double>(rawBytes), benchmark::Counter::kAvgIterations);
+  state.counters["stored_bytes_per_msg"] = benchmark::Counter(
+      static_cast<double>(storedBytes), benchmark::Counter::kAvgIterations);
+  configureCodec(0);
+}
+
+void BM_MessageCacheDecode(benchmark::State& state) {
+  const auto& corpus = messageCorpus();
+  auto& codec = StarryChat::MessageCacheCodec::getInstance();
+  configureCodec(state.range(0));
+
+  vector<string> stored;
+  stored.reserve(corpus.size());
+  for (const auto& serialized : corpus) {
+    string compressed;
+    stored.push_back(codec.encode(serialized, &compressed) ? compressed
+                                                           : serialized);
+  }
+
+  Message message;
+  size_t index = 0;
+  AllocationCounter allocations(state);
+  for (auto _ : state) {
+    if (!codec.decode(stored[index++ % stored.size()], &message)) {
+      state.SkipWithError("Failed to decode cached message");
+      break;
+    }
+    benchmark::DoNotOptimize(message.id());
+  }
+  configureCodec(0);
+}
+
+BENCHMARK(BM_UnreadKeyConcat);
+BENCHMARK(BM_UnreadKeyBuilder);
+BENCHMARK(BM_SendMessage)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_GetMessages)->Arg(20)->Arg(50)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_GetUserChats)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Login)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MessageCacheEncode)->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_MessageCacheDecode)->Arg(0)->Arg(1)->Arg(2);
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  vector<char*> rest;
+  if (!parseOptions(argc, argv, rest)) {
+    cerr << kUsage;
+    return 1;
+  }
+
+  int restArgc = static_cast<int>(rest.size());
+  benchmark::Initialize(&restArgc, rest.data());
+  if (benchmark::ReportUnrecognizedArguments(restArgc, rest.data())) {
+    return 1;
+  }
+
+  Logger::setLogLevel(LogLevel::WARN);
+  StarryChat::LogControl::getInstance().setAllLevels(LogLevel::WARN);
+
+  // 注入内存替身，处理器逻辑与线上一致
+  auto db = make_unique<StarryChat::MemoryDBStore>(g_options.dbLatency);
+  auto* dbStore = db.get();
+  StarryChat::DBManager::getInstance().initialize(std::move(db));
+  StarryChat::RedisManager::getInstance().initialize(
+      make_unique<StarryChat::MemoryRedisStore>(g_options.redisLatency));
+
+  StarryChat::UserServiceImpl userService;
+  StarryChat::ChatServiceImpl chatService;
+  StarryChat::MessageServiceImpl messageService;
+  g_userService = &userService;
+  g_chatService = &chatService;
+  g_messageService = &messageService;
+
+  if (!seed(*dbStore)) {
+    return 1;
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}